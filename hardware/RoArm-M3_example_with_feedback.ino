@@ -45,10 +45,11 @@ StaticJsonDocument<256> jsonInfoHttp;
 #include "http_server.h"
 
 // Include the follower position feedback system
+// (also defines CMD_SET_ARM_IDENTITY and CMD_GET_ARM_IDENTITY)
 #include "follower_position_feedback.h"
 
-// Command ID for setting arm identity
-#define CMD_SET_ARM_IDENTITY 400
+// Joint velocity streaming (CMD_JOINTS_VEL_CTRL)
+#include "joint_velocity_ctrl.h"
 
 
 void setup() {
@@ -193,6 +194,9 @@ void loop() {
     runNewJsonCmd = false;
   }
   
+  // Integrate streamed joint velocities
+  handleJointVelocity();
+
   // Handle position reporting for follower mode
   handlePositionReporting();
 }
\ No newline at end of file
@@ -0,0 +1,353 @@
+/**
+ * Arm Command Channels
+ */
+
+#include "hardware/arm_interface/arm_command_channel.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace shoplifter {
+
+namespace {
+
+speed_t baudConstant(int baud) {
+  switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    case 1000000: return B1000000;
+    default: return 0;
+  }
+}
+
+// Write all of a short buffer to a non-blocking descriptor, waiting at most timeoutMs per stall
+bool writeAll(int fd, const char* data, size_t length, int timeoutMs) {
+  while (length > 0) {
+    const ssize_t n = ::write(fd, data, length);
+    if (n > 0) {
+      data += n;
+      length -= static_cast<size_t>(n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+      return false;
+    }
+    struct pollfd p = {fd, POLLOUT, 0};
+    if (::poll(&p, 1, timeoutMs) <= 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool unreserved(char c) {
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+         c == '-' || c == '_' || c == '.' || c == '~';
+}
+
+}  // namespace
+
+size_t formatJointCommand(const double* joints, char* out, uint32_t speed, uint32_t acceleration) {
+  const int n = std::snprintf(
+      out, kMaxArmCommandLength,
+      "{\"T\":%d,\"base\":%.4f,\"shoulder\":%.4f,\"elbow\":%.4f,\"wrist\":%.4f,\"roll\":%.4f,\"hand\":%.4f,"
+      "\"spd\":%u,\"acc\":%u}\n",
+      kCmdJointsRadCtrl, joints[0], joints[1], joints[2], joints[3], joints[4], joints[5], speed, acceleration);
+  return n > 0 && static_cast<size_t>(n) < kMaxArmCommandLength ? static_cast<size_t>(n) : 0;
+}
+
+size_t formatJointVelocityCommand(const double* velocities, uint32_t ttlMs, char* out) {
+  // An array instead of named joints: about 70 bytes, so 115200 baud carries some 160 commands/s
+  const int n = std::snprintf(out, kMaxArmCommandLength, "{\"T\":%d,\"v\":[%.4f,%.4f,%.4f,%.4f,%.4f,%.4f],\"ttl\":%u}\n",
+                              kCmdJointsVelCtrl, velocities[0], velocities[1], velocities[2], velocities[3],
+                              velocities[4], velocities[5], ttlMs);
+  return n > 0 && static_cast<size_t>(n) < kMaxArmCommandLength ? static_cast<size_t>(n) : 0;
+}
+
+// ----------------------------------------------------------------------------
+// Serial
+// ----------------------------------------------------------------------------
+
+SerialCommandChannel::SerialCommandChannel(const std::string& device, int baud) : device_(device), baud_(baud) {
+  const speed_t speed = baudConstant(baud);
+  if (!speed) {
+    throw std::runtime_error("Unsupported baud rate " + std::to_string(baud));
+  }
+  fd_ = ::open(device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd_ < 0) {
+    throw std::runtime_error("Cannot open " + device + ": " + std::strerror(errno));
+  }
+  // Drop DTR/RTS at once: the ESP32 auto-reset circuit reboots the arm on their edge (as open_serial() does)
+  const int modemLines = TIOCM_DTR | TIOCM_RTS;
+  ::ioctl(fd_, TIOCMBIC, &modemLines);
+  struct termios tio;
+  if (::tcgetattr(fd_, &tio) != 0) {
+    const int err = errno;
+    ::close(fd_);
+    throw std::runtime_error("Not a serial port " + device + ": " + std::strerror(err));
+  }
+  ::cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cflag &= ~(CSTOPB | CRTSCTS | HUPCL);   // Keep DTR low on close too
+  ::cfsetispeed(&tio, speed);
+  ::cfsetospeed(&tio, speed);
+  if (::tcsetattr(fd_, TCSANOW, &tio) != 0) {
+    const int err = errno;
+    ::close(fd_);
+    throw std::runtime_error("Cannot configure " + device + ": " + std::strerror(err));
+  }
+  ::tcflush(fd_, TCIOFLUSH);
+}
+
+SerialCommandChannel::~SerialCommandChannel() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+bool SerialCommandChannel::sendJoints(const double* joints) {
+  char command[kMaxArmCommandLength];
+  return sendCommand(command, formatJointCommand(joints, command));
+}
+
+bool SerialCommandChannel::sendJointsAtSpeed(const double* joints, uint32_t speed, uint32_t acceleration) {
+  char command[kMaxArmCommandLength];
+  return sendCommand(command, formatJointCommand(joints, command, speed, acceleration));
+}
+
+bool SerialCommandChannel::sendJointVelocities(const double* velocities, uint32_t ttlMs) {
+  char command[kMaxArmCommandLength];
+  return sendCommand(command, formatJointVelocityCommand(velocities, ttlMs, command));
+}
+
+bool SerialCommandChannel::sendCommand(const char* command, size_t length) {
+  // A command still in the UART queue means the line is saturated; a newer target follows soon
+  int queued = 0;
+  if (::ioctl(fd_, TIOCOUTQ, &queued) == 0 && queued > 0) {
+    return false;
+  }
+  return length && writeAll(fd_, command, length, 5);
+}
+
+bool SerialCommandChannel::pollFeedback(PositionSample& out) {
+  char buffer[4096];
+  bool received = false;
+  for (;;) {
+    const ssize_t n = ::read(fd_, buffer, sizeof(buffer));
+    if (n <= 0) {
+      break;
+    }
+    parser_.feed(buffer, static_cast<size_t>(n), [&](const PositionSample& s) {
+      out = s;
+      received = true;
+    });
+  }
+  return received;
+}
+
+double SerialCommandChannel::maxCommandRate() const {
+  // 10 bits per byte (8N1) and a typical command of ~120 bytes
+  return baud_ / 10.0 / 120.0;
+}
+
+// ----------------------------------------------------------------------------
+// HTTP
+// ----------------------------------------------------------------------------
+
+HttpCommandChannel::HttpCommandChannel(const std::string& host, int port) : host_(host), port_(port) {
+  struct in_addr addr;
+  if (::inet_pton(AF_INET, host.c_str(), &addr) != 1) {
+    throw std::runtime_error("Invalid arm address " + host + " (expected an IPv4 address)");
+  }
+  address_ = addr.s_addr;
+}
+
+HttpCommandChannel::~HttpCommandChannel() {
+  disconnect();
+}
+
+bool HttpCommandChannel::connect() {
+  fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd_ < 0) {
+    return false;
+  }
+  const int one = 1;
+  ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  struct sockaddr_in sa;
+  std::memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(static_cast<uint16_t>(port_));
+  sa.sin_addr.s_addr = address_;
+  if (::connect(fd_, reinterpret_cast<const sockaddr*>(&sa), sizeof(sa)) != 0) {
+    struct pollfd p = {fd_, POLLOUT, 0};
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (errno != EINPROGRESS || ::poll(&p, 1, 200) <= 0 ||
+        ::getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+      disconnect();
+      return false;
+    }
+  }
+  connects_++;
+  return true;
+}
+
+void HttpCommandChannel::disconnect() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  awaitingResponse_ = false;
+}
+
+bool HttpCommandChannel::drainResponses() {
+  // Responses are not needed; read whatever arrived so the socket never fills up
+  char buffer[2048];
+  for (;;) {
+    const ssize_t n = ::recv(fd_, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (n > 0) {
+      awaitingResponse_ = false;
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return true;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    return false;  // closed by the server or failed
+  }
+}
+
+bool HttpCommandChannel::sendJoints(const double* joints) {
+  char command[kMaxArmCommandLength];
+  return sendCommand(command, formatJointCommand(joints, command));
+}
+
+bool HttpCommandChannel::sendJointsAtSpeed(const double* joints, uint32_t speed, uint32_t acceleration) {
+  char command[kMaxArmCommandLength];
+  return sendCommand(command, formatJointCommand(joints, command, speed, acceleration));
+}
+
+bool HttpCommandChannel::sendJointVelocities(const double* velocities, uint32_t ttlMs) {
+  char command[kMaxArmCommandLength];
+  return sendCommand(command, formatJointVelocityCommand(velocities, ttlMs, command));
+}
+
+bool HttpCommandChannel::sendCommand(const char* command, size_t length) {
+  if (!length) {
+    return false;
+  }
+  if (fd_ >= 0 && !drainResponses()) {
+    disconnect();
+  }
+  // The ESP32 web server may close after each response, so never queue a
+  // second request behind one that has not been answered yet
+  if (awaitingResponse_) {
+    if (std::chrono::steady_clock::now() - sentAt_ < std::chrono::seconds(1)) {
+      return false;
+    }
+    disconnect();  // no answer; assume the connection is dead
+  }
+  if (fd_ < 0 && !connect()) {
+    return false;
+  }
+
+  static const char kHex[] = "0123456789ABCDEF";
+  std::string request = "GET /js?json=";
+  for (size_t i = 0; i + 1 < length; i++) {  // without the newline
+    const char c = command[i];
+    if (unreserved(c)) {
+      request += c;
+    } else {
+      request += '%';
+      request += kHex[static_cast<unsigned char>(c) >> 4];
+      request += kHex[static_cast<unsigned char>(c) & 15];
+    }
+  }
+  request += " HTTP/1.1\r\nHost: " + host_ + "\r\nConnection: keep-alive\r\n\r\n";
+
+  const ssize_t n = ::send(fd_, request.data(), request.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+  if (n != static_cast<ssize_t>(request.size())) {
+    // A partial request cannot be resumed later; start over on a new connection
+    disconnect();
+    return false;
+  }
+  awaitingResponse_ = true;
+  sentAt_ = std::chrono::steady_clock::now();
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Null
+// ----------------------------------------------------------------------------
+
+bool NullCommandChannel::sendJoints(const double* joints) {
+  std::memcpy(last_, joints, sizeof(last_));
+  commands_++;
+  return true;
+}
+
+bool NullCommandChannel::sendJointsAtSpeed(const double* joints, uint32_t, uint32_t) {
+  return sendJoints(joints);
+}
+
+bool NullCommandChannel::sendJointVelocities(const double* velocities, uint32_t) {
+  std::memcpy(lastVelocities_, velocities, sizeof(lastVelocities_));
+  velocityCommands_++;
+  return true;
+}
+
+std::unique_ptr<ArmCommandChannel> openCommandChannel(const std::string& spec) {
+  if (spec == "null") {
+    return std::make_unique<NullCommandChannel>();
+  }
+  if (spec.compare(0, 5, "http:") == 0) {
+    std::string host = spec.substr(5);
+    while (!host.empty() && host[0] == '/') {
+      host.erase(0, 1);
+    }
+    int port = 80;
+    const size_t colon = host.find(':');
+    if (colon != std::string::npos) {
+      port = std::atoi(host.c_str() + colon + 1);
+      host.resize(colon);
+    }
+    return std::make_unique<HttpCommandChannel>(host, port);
+  }
+  std::string device = spec.compare(0, 7, "serial:") == 0 ? spec.substr(7) : spec;
+  int baud = 115200;
+  const size_t at = device.find('@');
+  if (at != std::string::npos) {
+    baud = std::atoi(device.c_str() + at + 1);
+    device.resize(at);
+  }
+  if (device.empty() || device[0] != '/') {
+    throw std::runtime_error("Invalid command channel " + spec);
+  }
+  return std::make_unique<SerialCommandChannel>(device, baud);
+}
+
+}  // namespace shoplifter
@@ -0,0 +1,214 @@
+/**
+ * Arm Command Channels
+ *
+ * Host-side transports for streaming joint targets to a RoArm-M3 arm with
+ * the CMD_JOINTS_RAD_CTRL JSON command:
+ *
+ *   {"T":102,"base":0.0000,"shoulder":0.0000,"elbow":1.5708,
+ *    "wrist":0.0000,"roll":0.0000,"hand":3.1416,"spd":0,"acc":0}
+ *
+ * or joint velocities with CMD_JOINTS_VEL_CTRL (joint_velocity_ctrl.h in
+ * the firmware), which the arm integrates between commands and stops
+ * following ttl milliseconds after the last one:
+ *
+ *   {"T":410,"v":[0.0000,0.1000,-0.1000,0.0000,0.0000,0.0000],"ttl":50}
+ *
+ * SerialCommandChannel writes newline-terminated commands to the USB serial
+ * port (the lowest-latency path, no TCP handshake or HTTP parsing on the
+ * ESP32) and also decodes the sendPositionData() reports coming back on the
+ * same port. HttpCommandChannel sends GET /js?json=... like
+ * ArmController.send_command() in arm_controller.py, but reuses the TCP
+ * connection when the server keeps it open and never blocks on a response.
+ * NullCommandChannel discards commands, for dry runs and timing.
+ *
+ * sendJoints() never blocks for long: if the transport still holds an
+ * earlier command, the new one is refused and the caller moves on to the
+ * next, newer target.
+ */
+
+#ifndef ARM_COMMAND_CHANNEL_H
+#define ARM_COMMAND_CHANNEL_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "hardware/telemetry/position_parser.h"
+
+namespace shoplifter {
+
+constexpr int kCmdJointsRadCtrl = 102;
+constexpr int kCmdJointsVelCtrl = 410;
+constexpr size_t kArmJointCount = 6;       // base, shoulder, elbow, wrist, roll, hand
+constexpr size_t kMaxArmCommandLength = 256;
+
+/**
+ * Format a CMD_JOINTS_RAD_CTRL command, newline-terminated
+ *
+ * @param joints Joint targets in radians, base .. hand
+ * @param out Buffer of at least kMaxArmCommandLength bytes
+ * @param speed Servo speed in steps per second ("spd", 0 = full speed)
+ * @param acceleration Servo acceleration in 100 steps/s² ("acc", 0 = full)
+ * @return Command length in bytes
+ */
+size_t formatJointCommand(const double* joints, char* out, uint32_t speed = 0, uint32_t acceleration = 0);
+
+/**
+ * Format a CMD_JOINTS_VEL_CTRL command, newline-terminated
+ *
+ * @param velocities Joint velocities in radians per second, base .. hand
+ * @param ttlMs Milliseconds the arm keeps integrating them without a newer command
+ * @param out Buffer of at least kMaxArmCommandLength bytes
+ * @return Command length in bytes
+ */
+size_t formatJointVelocityCommand(const double* velocities, uint32_t ttlMs, char* out);
+
+class ArmCommandChannel {
+ public:
+  virtual ~ArmCommandChannel() = default;
+
+  /**
+   * Send joint targets
+   *
+   * @param joints kArmJointCount targets in radians
+   * @return false if the command was not sent (transport busy or failed)
+   */
+  virtual bool sendJoints(const double* joints) = 0;
+
+  /**
+   * Send joint targets the servos approach at bounded speed, e.g. to move
+   * from an unknown pose
+   *
+   * @param speed, acceleration As in formatJointCommand()
+   * @return false if the command was not sent (transport busy or failed)
+   */
+  virtual bool sendJointsAtSpeed(const double* joints, uint32_t speed, uint32_t acceleration) = 0;
+
+  /**
+   * Send joint velocities for the firmware to integrate
+   *
+   * @param velocities kArmJointCount velocities in radians per second
+   * @param ttlMs Milliseconds until the arm stops integrating them
+   * @return false if the command was not sent (transport busy or failed)
+   */
+  virtual bool sendJointVelocities(const double* velocities, uint32_t ttlMs) = 0;
+
+  /**
+   * Latest position report received on this channel, if it carries any
+   *
+   * @param out Receives the newest report since the last call
+   * @return true if a new report arrived
+   */
+  virtual bool pollFeedback(PositionSample& out) {
+    (void)out;
+    return false;
+  }
+
+  /**
+   * Highest command rate the transport can carry, in Hz (0 if unknown)
+   */
+  virtual double maxCommandRate() const { return 0.0; }
+
+  virtual std::string describe() const = 0;
+};
+
+class SerialCommandChannel : public ArmCommandChannel {
+ public:
+  /**
+   * Open and configure a serial port (raw mode, 8N1)
+   *
+   * @param device e.g. "/dev/ttyUSB0"
+   * @param baud Baud rate; the RoArm-M3 firmware uses 115200
+   * @throws std::runtime_error if the port cannot be opened or configured
+   */
+  explicit SerialCommandChannel(const std::string& device, int baud = 115200);
+  ~SerialCommandChannel() override;
+
+  SerialCommandChannel(const SerialCommandChannel&) = delete;
+  SerialCommandChannel& operator=(const SerialCommandChannel&) = delete;
+
+  bool sendJoints(const double* joints) override;
+  bool sendJointsAtSpeed(const double* joints, uint32_t speed, uint32_t acceleration) override;
+  bool sendJointVelocities(const double* velocities, uint32_t ttlMs) override;
+  bool pollFeedback(PositionSample& out) override;
+  double maxCommandRate() const override;
+  std::string describe() const override { return "serial:" + device_; }
+
+ private:
+  bool sendCommand(const char* command, size_t length);
+
+  std::string device_;
+  int baud_;
+  int fd_ = -1;
+  PositionStreamParser parser_;
+};
+
+class HttpCommandChannel : public ArmCommandChannel {
+ public:
+  /**
+   * @param host Arm IP address, e.g. "192.168.4.1"
+   * @param port HTTP port
+   * @throws std::runtime_error if the address is invalid
+   */
+  explicit HttpCommandChannel(const std::string& host, int port = 80);
+  ~HttpCommandChannel() override;
+
+  HttpCommandChannel(const HttpCommandChannel&) = delete;
+  HttpCommandChannel& operator=(const HttpCommandChannel&) = delete;
+
+  bool sendJoints(const double* joints) override;
+  bool sendJointsAtSpeed(const double* joints, uint32_t speed, uint32_t acceleration) override;
+  bool sendJointVelocities(const double* velocities, uint32_t ttlMs) override;
+  std::string describe() const override { return "http:" + host_; }
+
+  // Connections opened so far (the ESP32 web server may close after every response)
+  uint64_t connects() const { return connects_; }
+
+ private:
+  bool connect();
+  void disconnect();
+  bool drainResponses();
+  bool sendCommand(const char* command, size_t length);
+
+  std::string host_;
+  int port_;
+  uint32_t address_ = 0;
+  int fd_ = -1;
+  bool awaitingResponse_ = false;
+  std::chrono::steady_clock::time_point sentAt_;
+  uint64_t connects_ = 0;
+};
+
+class NullCommandChannel : public ArmCommandChannel {
+ public:
+  bool sendJoints(const double* joints) override;
+  bool sendJointsAtSpeed(const double* joints, uint32_t speed, uint32_t acceleration) override;
+  bool sendJointVelocities(const double* velocities, uint32_t ttlMs) override;
+  std::string describe() const override { return "null"; }
+
+  uint64_t commands() const { return commands_; }
+  const double* lastJoints() const { return last_; }
+  uint64_t velocityCommands() const { return velocityCommands_; }
+  const double* lastVelocities() const { return lastVelocities_; }
+
+ private:
+  uint64_t commands_ = 0;
+  double last_[kArmJointCount] = {};
+  uint64_t velocityCommands_ = 0;
+  double lastVelocities_[kArmJointCount] = {};
+};
+
+/**
+ * Open a channel from a spec string
+ *
+ * "serial:/dev/ttyUSB0[@115200]", "/dev/ttyUSB0", "http:192.168.4.1[:80]" or "null"
+ *
+ * @throws std::runtime_error if the spec is invalid or the transport cannot be opened
+ */
+std::unique_ptr<ArmCommandChannel> openCommandChannel(const std::string& spec);
+
+}  // namespace shoplifter
+
+#endif // ARM_COMMAND_CHANNEL_H
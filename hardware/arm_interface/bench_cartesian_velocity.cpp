@@ -0,0 +1,221 @@
+/**
+ * Cartesian Velocity Streaming Benchmark
+ *
+ * Times CartesianVelocityController::solve(), then simulates visual servoing
+ * at the control rate on a null channel: every tick the "camera" sees the
+ * pose of the joints the firmware is integrating and publishes
+ *
+ *   twist = feedforward + gain (reference - seen)
+ *
+ * The reference moves straight out from the initial pose past full stretch
+ * and back, so the arm runs through the elbow singularity. The same run
+ * with damping off shows what the damping buys: the largest change of joint
+ * velocity between ticks, and the tracking error once the reference is back
+ * within reach. A second run pushes the wrist into its limit; no joint may
+ * ever leave its range.
+ *
+ * With --channel the controller also streams a slow vertical oscillation to
+ * a real arm for --seconds, starting from the firmware's initial pose.
+ *
+ * Usage:
+ *   bench_cartesian_velocity [--rate HZ] [--solves N] [--channel SPEC] [--seconds S]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hardware/arm_interface/cartesian_velocity.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr double kInitialPose[kArmJointCount] = {0.0, 0.0, M_PI / 2, 0.0, 0.0, M_PI};
+constexpr double kGain = 5.0;          // 1/s
+constexpr double kReach = 200.0;       // mm the reference moves out past the initial pose
+constexpr double kPathSeconds = 4.0;   // Out and back
+constexpr double kBackWithin = 0.125;  // Tracking error measured over the last half second
+
+struct ServoSummary {
+  double maxVelocityJump = 0.0;        // rad/s, largest change of a joint velocity between ticks
+  double maxError = 0.0;               // mm, tracking error while the reference is back within reach
+  double finalError = 0.0;
+  double minSigma = 1e30;
+  uint64_t damped = 0;
+  uint64_t limited = 0;
+  size_t outsideLimits = 0;
+};
+
+ArmPose reference(double t, const ArmPose& start) {
+  ArmPose p = start;
+  p.x += kReach * 0.5 * (1.0 - std::cos(2.0 * M_PI * t / kPathSeconds));
+  return p;
+}
+
+// Integrate offline: tick() with simulated time, the pose fed back from the controller's own joints
+ServoSummary servo(const CartesianVelocityOptions& options, const Twist& drift) {
+  CartesianVelocityController controller(options);
+  NullCommandChannel channel;
+  controller.reset(kInitialPose);
+  const ArmPose start = forwardKinematics(kInitialPose);
+  const int64_t periodNs = static_cast<int64_t>(1e9 / options.rate);
+  const size_t ticks = static_cast<size_t>(kPathSeconds * options.rate);
+  const double dt = 1.0 / options.rate;
+
+  ServoSummary s;
+  double previous[kArmJointCount] = {};
+  VelocityTick t;
+  for (size_t k = 0; k <= ticks; k++) {
+    const int64_t now = static_cast<int64_t>(k) * periodNs + 1;
+    const double time = static_cast<double>(k) * dt;
+    const ArmPose seen = forwardKinematics(controller.joints());
+    const ArmPose ref = reference(time, start);
+    const ArmPose ahead = reference(time + dt, start);
+    const double error = std::sqrt((ref.x - seen.x) * (ref.x - seen.x) + (ref.y - seen.y) * (ref.y - seen.y) +
+                                   (ref.z - seen.z) * (ref.z - seen.z));
+    if (time >= kPathSeconds * (1.0 - kBackWithin)) {
+      s.maxError = std::max(s.maxError, error);
+    }
+    s.finalError = error;
+
+    Twist twist;
+    twist.vx = (ahead.x - ref.x) / dt + kGain * (ref.x - seen.x) + drift.vx;
+    twist.vy = (ahead.y - ref.y) / dt + kGain * (ref.y - seen.y) + drift.vy;
+    twist.vz = (ahead.z - ref.z) / dt + kGain * (ref.z - seen.z) + drift.vz;
+    twist.tiltRate = kGain * (ref.tilt - seen.tilt) + drift.tiltRate;
+    twist.rollRate = drift.rollRate;
+    controller.setTwist(twist, now);
+    controller.tick(channel, now, &t);
+
+    const VelocitySolution& v = t.solution;
+    for (size_t j = 0; j < kArmJointCount; j++) {
+      if (k > 0) s.maxVelocityJump = std::max(s.maxVelocityJump, std::fabs(v.velocities[j] - previous[j]));
+      previous[j] = v.velocities[j];
+    }
+    for (size_t j = 0; j < kKinematicJointCount; j++) {
+      s.outsideLimits += t.joints[j] < options.limits.lower[j] || t.joints[j] > options.limits.upper[j];
+    }
+    s.outsideLimits += t.joints[4] < options.rollLower || t.joints[4] > options.rollUpper;
+    s.minSigma = std::min(s.minSigma, v.sigma);
+    s.damped += v.damping > 0.0;
+    s.limited += v.held != 0;
+  }
+  return s;
+}
+
+void print(const char* name, const ServoSummary& s) {
+  std::printf("%-10s %12.2f %12.2f %10.3f %9.2f %7lu %8lu %8zu\n", name, s.maxVelocityJump, s.maxError, s.finalError,
+              s.minSigma, static_cast<unsigned long>(s.damped), static_cast<unsigned long>(s.limited), s.outsideLimits);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double rate = 150.0;
+  size_t solves = 1000000;
+  std::string spec;
+  double seconds = 5.0;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--rate")) rate = std::atof(next());
+    else if (!std::strcmp(argv[i], "--solves")) solves = static_cast<size_t>(std::atol(next()));
+    else if (!std::strcmp(argv[i], "--channel")) spec = next();
+    else if (!std::strcmp(argv[i], "--seconds")) seconds = std::atof(next());
+    else {
+      std::fprintf(stderr, "Usage: %s [--rate HZ] [--solves N] [--channel SPEC] [--seconds S]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  CartesianVelocityOptions options;
+  options.rate = rate;
+  const CartesianVelocityController controller(options);
+  const ArmJointLimits& limits = options.limits;
+
+  // solve() over random configurations and twists
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<double> joints(1024 * kArmJointCount);
+  std::vector<Twist> twists(1024);
+  for (size_t i = 0; i < twists.size(); i++) {
+    for (size_t j = 0; j < kKinematicJointCount; j++) {
+      joints[i * kArmJointCount + j] = limits.lower[j] + unit(rng) * (limits.upper[j] - limits.lower[j]);
+    }
+    twists[i] = {200.0 * (unit(rng) - 0.5), 200.0 * (unit(rng) - 0.5), 200.0 * (unit(rng) - 0.5), unit(rng) - 0.5,
+                 unit(rng) - 0.5};
+  }
+  double checksum = 0.0;
+  const auto t0 = Clock::now();
+  for (size_t i = 0; i < solves; i++) {
+    const size_t k = i & 1023;
+    checksum += controller.solve(&joints[k * kArmJointCount], twists[k]).velocities[1];
+  }
+  const double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / static_cast<double>(solves);
+  std::printf("solve: %.1f ns (checksum %.3f)\n", ns, checksum);
+
+  // Out past full stretch and back, with and without damping; then a constant wrist push into its limit
+  CartesianVelocityOptions undampedOptions = options;
+  undampedOptions.maxDamping = 0.0;
+  const ServoSummary damped = servo(options, Twist());
+  const ServoSummary undamped = servo(undampedOptions, Twist());
+  Twist push;
+  push.tiltRate = 1.5;
+  push.rollRate = 1.5;
+  const ServoSummary limited = servo(options, push);
+
+  std::printf("%.0f Hz servo, reference %.0f mm out and back in %.1f s\n", rate, kReach, kPathSeconds);
+  std::printf("%-10s %12s %12s %10s %9s %7s %8s %8s\n", "case", "max dv rad/s", "back err mm", "final mm", "min sigma",
+              "damped", "limited", "outside");
+  print("damped", damped);
+  print("undamped", undamped);
+  print("wrist push", limited);
+
+  if (!spec.empty()) {
+    std::unique_ptr<ArmCommandChannel> channel = openCommandChannel(spec);
+    CartesianVelocityController live(options);
+    live.reset(kInitialPose);
+    std::atomic<bool> done{false};
+    std::thread perception([&]() {
+      const int64_t start = CartesianVelocityController::nowNs();
+      while (!done.load(std::memory_order_relaxed)) {
+        const int64_t now = CartesianVelocityController::nowNs();
+        Twist twist;
+        twist.vz = 30.0 * std::sin(2.0 * M_PI * static_cast<double>(now - start) * 1e-9 / 2.0);
+        live.setTwist(twist, now);
+        std::this_thread::sleep_for(std::chrono::milliseconds(33));
+      }
+    });
+    std::thread timer([&]() {
+      std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+      live.stop();
+    });
+    const VelocityStreamStats stats = live.run(*channel);
+    done.store(true, std::memory_order_relaxed);
+    perception.join();
+    timer.join();
+    std::printf("live %s: %lu ticks, %lu skipped, %lu stale, %lu refused, lateness max %.3f ms\n",
+                channel->describe().c_str(), static_cast<unsigned long>(stats.ticks),
+                static_cast<unsigned long>(stats.skipped), static_cast<unsigned long>(stats.stale),
+                static_cast<unsigned long>(stats.refused), stats.latenessMax * 1e3);
+  }
+
+  const bool ok = damped.outsideLimits == 0 && undamped.outsideLimits == 0 && limited.outsideLimits == 0 &&
+                  damped.finalError < 1.0 && damped.maxVelocityJump < undamped.maxVelocityJump && limited.limited > 0;
+  if (!ok) {
+    std::fprintf(stderr, "Cartesian velocity check failed\n");
+    return 1;
+  }
+  return 0;
+}
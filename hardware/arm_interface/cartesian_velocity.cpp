@@ -0,0 +1,268 @@
+/**
+ * Cartesian Velocity Streaming
+ */
+
+#include "hardware/arm_interface/cartesian_velocity.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "hardware/kinematics/small_linalg.h"
+#include "utils/deadline_clock.h"
+
+namespace shoplifter {
+
+namespace {
+
+constexpr size_t kJoints = kKinematicJointCount;
+constexpr int kReadAttempts = 3;
+constexpr double kMinDamping2 = 1e-6;    // (mm/rad)^2, keeps J J^T invertible with joints held
+constexpr size_t kRoll = 4;
+
+}  // namespace
+
+CartesianVelocityController::CartesianVelocityController(const CartesianVelocityOptions& options)
+    : options_(options), periodNs_(options.rate > 0.0 ? static_cast<int64_t>(1e9 / options.rate) : 0) {
+  if (!(options.rate > 0.0) || !(options.tiltWeight > 0.0) || !(options.maxJointVelocity > 0.0) ||
+      !(options.limitMargin > 0.0) || !(options.twistTimeout > 0.0)) {
+    throw std::invalid_argument("Cartesian velocity rate, tiltWeight, maxJointVelocity, limitMargin and "
+                                "twistTimeout must be positive");
+  }
+  for (size_t j = 0; j < kJoints; j++) {
+    if (!(options.limits.lower[j] <= options.limits.upper[j])) {
+      throw std::invalid_argument("Cartesian velocity joint limits must have lower <= upper");
+    }
+  }
+  if (!(options.rollLower <= options.rollUpper)) {
+    throw std::invalid_argument("Cartesian velocity roll limits must have lower <= upper");
+  }
+  for (std::atomic<double>& v : twist_) v.store(0.0, std::memory_order_relaxed);
+}
+
+int64_t CartesianVelocityController::nowNs() { return monotonicNs(); }
+
+void CartesianVelocityController::setTwist(const Twist& twist, int64_t stampNs) {
+  const uint64_t n = seq_.load(std::memory_order_relaxed) / 2;
+  seq_.store(2 * n + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  stampNs_.store(stampNs, std::memory_order_relaxed);
+  twist_[0].store(twist.vx, std::memory_order_relaxed);
+  twist_[1].store(twist.vy, std::memory_order_relaxed);
+  twist_[2].store(twist.vz, std::memory_order_relaxed);
+  twist_[3].store(twist.tiltRate, std::memory_order_relaxed);
+  twist_[4].store(twist.rollRate, std::memory_order_relaxed);
+  seq_.store(2 * n + 2, std::memory_order_release);
+  hasTwist_.store(true, std::memory_order_release);
+}
+
+bool CartesianVelocityController::latestTwist(int64_t nowNs, Twist& twist) const {
+  if (!hasTwist_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  for (int attempt = 0; attempt < kReadAttempts; attempt++) {
+    const uint64_t before = seq_.load(std::memory_order_acquire);
+    if (before & 1) continue;
+    const int64_t stamp = stampNs_.load(std::memory_order_relaxed);
+    twist.vx = twist_[0].load(std::memory_order_relaxed);
+    twist.vy = twist_[1].load(std::memory_order_relaxed);
+    twist.vz = twist_[2].load(std::memory_order_relaxed);
+    twist.tiltRate = twist_[3].load(std::memory_order_relaxed);
+    twist.rollRate = twist_[4].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq_.load(std::memory_order_relaxed) == before) {
+      return static_cast<double>(nowNs - stamp) * 1e-9 <= options_.twistTimeout;
+    }
+  }
+  return false;  // Caught mid-write every time; a newer twist is being published anyway
+}
+
+void CartesianVelocityController::reset(const double* joints) {
+  std::copy(joints, joints + kArmJointCount, joints_);
+  std::fill(sent_, sent_ + kArmJointCount, 0.0);
+  sentNs_ = 0;
+  lastTickNs_ = 0;
+  ticks_ = 0;
+}
+
+VelocitySolution CartesianVelocityController::solve(const double* joints, const Twist& twist) const {
+  const double w = options_.tiltWeight;
+  const double maxV = options_.maxJointVelocity;
+  VelocitySolution out = {};
+  out.scale = 1.0;
+
+  double jac[4][kJoints];
+  armJacobian(joints, jac);
+  for (size_t j = 0; j < kJoints; j++) jac[3][j] *= w;
+  const double v[4] = {twist.vx, twist.vy, twist.vz, w * twist.tiltRate};
+
+  double a[4][kJoints];
+  for (size_t r = 0; r < 4; r++) {
+    for (size_t c = 0; c < 4; c++) {
+      double s = 0.0;
+      for (size_t j = 0; j < kJoints; j++) s += jac[r][j] * jac[c][j];
+      a[r][c] = s;
+    }
+  }
+  out.sigma = std::sqrt(std::max(0.0, smallestEigenvalue(a)));
+  double lambda2 = 0.0;
+  if (out.sigma < options_.singularThreshold) {
+    const double ratio = out.sigma / options_.singularThreshold;
+    lambda2 = (1.0 - ratio * ratio) * options_.maxDamping * options_.maxDamping;
+  }
+  out.damping = std::sqrt(lambda2);
+
+  // Speed allowed towards each limit: maxV, ramping to 0 over the last limitMargin
+  double low[kJoints], high[kJoints];
+  for (size_t j = 0; j < kJoints; j++) {
+    low[j] = -maxV * std::min(1.0, std::max(0.0, (joints[j] - options_.limits.lower[j]) / options_.limitMargin));
+    high[j] = maxV * std::min(1.0, std::max(0.0, (options_.limits.upper[j] - joints[j]) / options_.limitMargin));
+  }
+
+  // Solve, hold joints that break their bound at the bound, re-solve the rest for what is left
+  double qd[kJoints] = {};
+  for (size_t pass = 0; pass <= kJoints; pass++) {
+    double rest[4];
+    for (size_t r = 0; r < 4; r++) {
+      rest[r] = v[r];
+      for (size_t j = 0; j < kJoints; j++) {
+        if (out.held & (1u << j)) rest[r] -= jac[r][j] * qd[j];
+      }
+    }
+    for (size_t r = 0; r < 4; r++) {
+      for (size_t c = 0; c <= r; c++) {
+        double s = 0.0;
+        for (size_t j = 0; j < kJoints; j++) {
+          if (!(out.held & (1u << j))) s += jac[r][j] * jac[c][j];
+        }
+        a[r][c] = a[c][r] = s + (r == c ? std::max(lambda2, kMinDamping2) : 0.0);
+      }
+    }
+    choleskySolve(a, rest);
+    bool broke = false;
+    for (size_t j = 0; j < kJoints; j++) {
+      if (out.held & (1u << j)) continue;
+      double s = 0.0;
+      for (size_t r = 0; r < 4; r++) s += jac[r][j] * rest[r];
+      qd[j] = s;
+    }
+    for (size_t j = 0; j < kJoints; j++) {
+      if (!(out.held & (1u << j)) && (qd[j] < low[j] || qd[j] > high[j])) {
+        qd[j] = std::min(high[j], std::max(low[j], qd[j]));
+        out.held |= 1u << j;
+        broke = true;
+      }
+    }
+    if (!broke) {
+      break;
+    }
+  }
+
+  double fastest = 0.0;
+  for (size_t j = 0; j < kJoints; j++) fastest = std::max(fastest, std::fabs(qd[j]));
+  if (fastest > maxV) {
+    out.scale = maxV / fastest;
+  }
+  for (size_t j = 0; j < kJoints; j++) out.velocities[j] = qd[j] * out.scale;
+
+  const double rollLow =
+      -maxV * std::min(1.0, std::max(0.0, (joints[kRoll] - options_.rollLower) / options_.limitMargin));
+  const double rollHigh =
+      maxV * std::min(1.0, std::max(0.0, (options_.rollUpper - joints[kRoll]) / options_.limitMargin));
+  out.velocities[kRoll] = std::min(rollHigh, std::max(rollLow, twist.rollRate));
+  out.held |= out.velocities[kRoll] != twist.rollRate ? 1u << kRoll : 0u;
+  return out;
+}
+
+bool CartesianVelocityController::tick(ArmCommandChannel& channel, int64_t nowNs, VelocityTick* out) {
+  const double ttl = options_.ttlMs * 1e-3;
+  if (options_.sendVelocities && ticks_ > 0) {
+    // What the firmware integrated since the last tick: the velocities it holds, until their ttl ran out
+    const int64_t until = std::min(nowNs, sentNs_ + static_cast<int64_t>(ttl * 1e9));
+    const double dt = std::max<int64_t>(0, until - lastTickNs_) * 1e-9;
+    for (size_t j = 0; j < kArmJointCount; j++) joints_[j] += sent_[j] * dt;
+  }
+
+  Twist twist;
+  const bool fresh = latestTwist(nowNs, twist);
+  if (!fresh) {
+    twist = Twist();
+  }
+  const VelocitySolution solution = solve(joints_, twist);
+
+  bool sent;
+  if (options_.sendVelocities) {
+    sent = channel.sendJointVelocities(solution.velocities, options_.ttlMs);
+    if (sent) {
+      std::copy(solution.velocities, solution.velocities + kArmJointCount, sent_);
+      sentNs_ = nowNs;
+    }
+  } else {
+    // Lead by one period, as a position stream at this rate would
+    double target[kArmJointCount];
+    const double period = static_cast<double>(periodNs_) * 1e-9;
+    for (size_t j = 0; j < kArmJointCount; j++) target[j] = joints_[j] + solution.velocities[j] * period;
+    sent = channel.sendJoints(target);
+    if (sent) {
+      std::copy(target, target + kArmJointCount, joints_);
+    }
+  }
+  lastTickNs_ = nowNs;
+
+  if (out) {
+    out->index = ticks_;
+    out->timeNs = nowNs;
+    out->lateness = 0.0;
+    out->fresh = fresh;
+    out->sent = sent;
+    std::copy(joints_, joints_ + kArmJointCount, out->joints);
+    out->solution = solution;
+  }
+  ticks_++;
+  return sent;
+}
+
+VelocityStreamStats CartesianVelocityController::run(ArmCommandChannel& channel,
+                                                     const std::function<void(const VelocityTick&)>& onTick) {
+  VelocityStreamStats stats;
+  stop_.store(false, std::memory_order_relaxed);
+  const int64_t start = nowNs();
+  VelocityTick t;
+  for (uint64_t k = 0; !stop_.load(std::memory_order_relaxed);) {
+    int64_t deadline = start + static_cast<int64_t>(k) * periodNs_;
+    sleepUntilNs(deadline);
+    int64_t now = nowNs();
+    if (options_.skipLate && now - deadline > periodNs_) {
+      const uint64_t due = static_cast<uint64_t>((now - start) / periodNs_);
+      stats.skipped += due - k;
+      k = due;
+      deadline = start + static_cast<int64_t>(k) * periodNs_;
+    }
+
+    tick(channel, deadline, &t);
+    now = nowNs();
+    t.lateness = (now - deadline) * 1e-9;
+
+    stats.ticks++;
+    stats.stale += !t.fresh;
+    stats.refused += !t.sent;
+    stats.damped += t.solution.damping > 0.0;
+    stats.limited += t.solution.held != 0;
+    stats.latenessMax = std::max(stats.latenessMax, t.lateness);
+    if (onTick) {
+      onTick(t);
+    }
+    k++;
+  }
+
+  // Stop the arm now rather than after the ttl
+  if (options_.sendVelocities) {
+    const double zero[kArmJointCount] = {};
+    for (int attempt = 0; attempt < 10 && !channel.sendJointVelocities(zero, options_.ttlMs); attempt++) {
+      sleepUntilNs(nowNs() + periodNs_);
+    }
+  }
+  return stats;
+}
+
+}  // namespace shoplifter
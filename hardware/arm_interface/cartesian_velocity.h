@@ -0,0 +1,190 @@
+/**
+ * Cartesian Velocity Streaming
+ *
+ * Commands end-effector velocity instead of absolute poses, for visual
+ * servoing and reactive grasping: a perception thread publishes a twist
+ * (linear velocity of the point and tilt rate, in the frame of
+ * hardware/kinematics/arm_kinematics.h), and every control tick maps it to
+ * joint velocities through the RoArm-M3 Jacobian, with no IK round trip:
+ *
+ *   qdot = J^T (J J^T + lambda^2 I)^-1 v       (tilt row weighted)
+ *
+ * lambda is zero away from singularities and grows as the smallest
+ * singular value sigma of J drops below a threshold (Nakamura and Hanafusa;
+ * Chiaverini): lambda^2 = (1 - (sigma / sigma0)^2) lambda_max^2. Near full
+ * stretch or the base axis the arm then slows down along the singular
+ * direction instead of spinning its joints. A joint that would run into a
+ * limit is held at a velocity that ramps to zero within limitMargin, and the
+ * other joints are re-solved for the rest of the twist. A solution faster
+ * than maxJointVelocity is scaled down as a whole, keeping its direction.
+ *
+ * The joint velocities go out with CMD_JOINTS_VEL_CTRL, which the firmware
+ * integrates between ticks and stops integrating ttlMs after the last
+ * command (joint_velocity_ctrl.h). The controller keeps the same integral
+ * of the velocities actually sent, so its Jacobian is evaluated where the
+ * firmware's targets are. With sendVelocities off it integrates on the
+ * host and sends CMD_JOINTS_RAD_CTRL targets instead, for firmware without
+ * the velocity command.
+ *
+ * setTwist() (any one thread) and the control thread share a single
+ * seqlocked slot, as in chunk_executor.h. A twist older than twistTimeout
+ * counts as zero, so the arm stops if perception stalls.
+ */
+
+#ifndef CARTESIAN_VELOCITY_H
+#define CARTESIAN_VELOCITY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "hardware/arm_interface/arm_command_channel.h"
+#include "hardware/kinematics/arm_kinematics.h"
+
+namespace shoplifter {
+
+/**
+ * End-effector velocity
+ */
+struct Twist {
+  double vx = 0.0;                     // mm/s
+  double vy = 0.0;
+  double vz = 0.0;
+  double tiltRate = 0.0;               // rad/s
+  double rollRate = 0.0;               // rad/s, passed to the roll joint
+};
+
+struct CartesianVelocityOptions {
+  ArmJointLimits limits;
+  double rollLower = -M_PI;            // Roll joint range, radians
+  double rollUpper = M_PI;
+  double rate = 150.0;                 // run(): control ticks per second; a T:410 line fits ~160/s at 115200 baud
+  bool skipLate = true;                // run(): skip to the due tick when behind by more than a period
+  double tiltWeight = 100.0;           // mm/s weighing as much as 1 rad/s of tilt rate
+  double singularThreshold = 40.0;     // sigma0: damping starts below this sigma, mm/rad
+  double maxDamping = 40.0;            // lambda_max, mm/rad
+  double maxJointVelocity = 2.0;       // rad/s
+  double limitMargin = 0.15;           // radians before a limit over which joint speed ramps to zero
+  double twistTimeout = 0.1;           // seconds after which a twist counts as zero
+  uint32_t ttlMs = 50;                 // CMD_JOINTS_VEL_CTRL ttl
+  bool sendVelocities = true;          // false: send integrated CMD_JOINTS_RAD_CTRL targets
+};
+
+/**
+ * Joint velocities for one twist
+ */
+struct VelocitySolution {
+  double velocities[kArmJointCount];   // rad/s, base .. hand (hand is always 0)
+  double sigma;                        // Smallest singular value of the weighted Jacobian, mm/rad
+  double damping;                      // lambda used, mm/rad
+  double scale;                        // <= 1: slow-down to respect maxJointVelocity
+  uint32_t held;                       // Bit j: joint j slowed by its limit
+};
+
+/**
+ * One control tick of tick() / run()
+ */
+struct VelocityTick {
+  uint64_t index;
+  int64_t timeNs;                      // CLOCK_MONOTONIC
+  double lateness;                     // run(): send time minus deadline, seconds
+  bool fresh;                          // false if the twist was missing or older than twistTimeout
+  bool sent;                           // false if the channel refused the command
+  double joints[kArmJointCount];       // Joint targets after the tick, radians
+  VelocitySolution solution;
+};
+
+struct VelocityStreamStats {
+  uint64_t ticks = 0;
+  uint64_t skipped = 0;                // ticks skipped because the loop was late
+  uint64_t stale = 0;                  // ticks with no fresh twist (arm stopped)
+  uint64_t refused = 0;                // commands the channel did not accept
+  uint64_t damped = 0;                 // ticks near a singularity (lambda > 0)
+  uint64_t limited = 0;                // ticks with a joint slowed by its limit
+  double latenessMax = 0.0;            // seconds
+};
+
+class CartesianVelocityController {
+ public:
+  /**
+   * @throws std::invalid_argument if rate, tiltWeight, maxJointVelocity,
+   *         limitMargin or twistTimeout is not positive, or a limit range is empty
+   */
+  explicit CartesianVelocityController(const CartesianVelocityOptions& options = CartesianVelocityOptions());
+
+  CartesianVelocityController(const CartesianVelocityController&) = delete;
+  CartesianVelocityController& operator=(const CartesianVelocityController&) = delete;
+
+  // CLOCK_MONOTONIC in nanoseconds, the time base of twists and ticks
+  static int64_t nowNs();
+
+  /**
+   * Publish the commanded twist (perception thread)
+   *
+   * @param stampNs Time the twist was computed, CLOCK_MONOTONIC
+   */
+  void setTwist(const Twist& twist, int64_t stampNs);
+
+  /**
+   * Start from measured joints (control thread, before the first tick)
+   *
+   * @param joints kArmJointCount angles in radians
+   */
+  void reset(const double* joints);
+
+  /**
+   * Joint velocities for a twist at a configuration; no state, any thread
+   *
+   * @param joints kArmJointCount angles in radians
+   */
+  VelocitySolution solve(const double* joints, const Twist& twist) const;
+
+  /**
+   * Advance to nowNs and send one command (control thread)
+   *
+   * @param out Filled with the tick (may be nullptr)
+   * @return false if the channel refused the command
+   */
+  bool tick(ArmCommandChannel& channel, int64_t nowNs, VelocityTick* out = nullptr);
+
+  /**
+   * Tick on absolute deadlines until stop() is called, then send zero velocity
+   *
+   * @param onTick Called after every tick (may be empty)
+   */
+  VelocityStreamStats run(ArmCommandChannel& channel, const std::function<void(const VelocityTick&)>& onTick = {});
+
+  // Ask run() to return after the current tick; safe from other threads and signal handlers
+  void stop() { stop_.store(true, std::memory_order_relaxed); }
+
+  const CartesianVelocityOptions& options() const { return options_; }
+
+  // Joint targets the firmware is integrating (control thread)
+  const double* joints() const { return joints_; }
+
+ private:
+  // Latest twist if it is fresh at nowNs
+  bool latestTwist(int64_t nowNs, Twist& twist) const;
+
+  CartesianVelocityOptions options_;
+  int64_t periodNs_;
+  std::atomic<bool> stop_{false};
+
+  // Twist slot, seqlocked
+  std::atomic<uint64_t> seq_{0};
+  std::atomic<int64_t> stampNs_{0};
+  std::atomic<double> twist_[5];
+  std::atomic<bool> hasTwist_{false};
+
+  // Control-thread state
+  double joints_[kArmJointCount] = {};
+  double sent_[kArmJointCount] = {};   // Velocities the firmware is integrating
+  int64_t sentNs_ = 0;                 // When they were sent
+  int64_t lastTickNs_ = 0;
+  uint64_t ticks_ = 0;
+};
+
+}  // namespace shoplifter
+
+#endif // CARTESIAN_VELOCITY_H
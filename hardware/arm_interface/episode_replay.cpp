@@ -0,0 +1,239 @@
+/**
+ * Episode Replay
+ */
+
+#include "hardware/arm_interface/episode_replay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "perception/multimodal/stream_aligner.h"
+#include "training/data/episode_reader.h"
+#include "utils/deadline_clock.h"
+
+namespace shoplifter {
+
+namespace {
+
+double percentile(std::vector<double>& values, double p) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  const size_t k = std::min(values.size() - 1, static_cast<size_t>(p * values.size()));
+  std::nth_element(values.begin(), values.begin() + k, values.end());
+  return values[k];
+}
+
+}  // namespace
+
+ReplayTrajectory loadReplayTrajectory(const std::string& path, double rate, double start, double duration,
+                                      double maxGap) {
+  if (rate <= 0.0) {
+    throw std::runtime_error("Replay rate must be positive");
+  }
+  EpisodeReader episode(path);
+  std::vector<size_t> channels;
+  for (size_t c = kChannelBase; c <= kChannelGripper; c++) {
+    channels.push_back(c);
+  }
+  const OwnedSeries series = loadEpisodeSeries(episode, channels);
+
+  AlignStreamConfig config;
+  config.name = "joints";
+  config.channels = kArmJointCount;
+  config.mode = AlignMode::kLinear;
+  config.maxGap = maxGap;
+  const std::vector<AlignStreamConfig> configs = {config};
+  const std::vector<StreamSeries> views = {series.view()};
+
+  double t0 = 0.0;
+  double t1 = 0.0;
+  if (!commonTimeRange(configs, views, t0, t1)) {
+    throw std::runtime_error(path + " has no joint samples");
+  }
+  t0 += start;
+  if (duration > 0.0) {
+    t1 = std::min(t1, t0 + duration);
+  }
+  if (t1 < t0) {
+    throw std::runtime_error(path + " is shorter than the requested start offset");
+  }
+
+  const double period = 1.0 / rate;
+  const size_t count = static_cast<size_t>(std::floor((t1 - t0) / period)) + 1;
+  AlignedTable table;
+  alignOffline(configs, views, t0, period, count, table);
+
+  ReplayTrajectory trajectory;
+  trajectory.startTime = t0;
+  trajectory.period = period;
+  trajectory.joints.resize(count * kArmJointCount);
+  for (size_t j = 0; j < kArmJointCount; j++) {
+    const double* column = table.channel(0, j);
+    for (size_t i = 0; i < count; i++) {
+      trajectory.joints[i * kArmJointCount + j] = column[i];
+    }
+  }
+  for (uint8_t flags : table.flags[0]) {
+    trajectory.gapSteps += (flags & kAlignGap) != 0;
+  }
+  return trajectory;
+}
+
+ReplayEngine::ReplayEngine(ArmCommandChannel& channel, const ReplayOptions& options)
+    : channel_(channel), options_(options) {
+  if (options_.speed <= 0.0) {
+    options_.speed = 1.0;
+  }
+}
+
+bool ReplayEngine::measure(double* joints) {
+  if (measurement_) {
+    return measurement_(joints);
+  }
+  if (channel_.pollFeedback(feedback_)) {
+    haveFeedback_ = true;
+  }
+  if (!haveFeedback_) {
+    return false;
+  }
+  const double values[kArmJointCount] = {feedback_.b, feedback_.s, feedback_.e,
+                                         feedback_.t, feedback_.r, feedback_.g};
+  std::memcpy(joints, values, sizeof(values));
+  return true;
+}
+
+ReplayStats ReplayEngine::run(const ReplayTrajectory& trajectory,
+                              const std::function<void(const ReplayStep&)>& onStep) {
+  ReplayStats stats;
+  const size_t steps = trajectory.steps();
+  if (steps == 0) {
+    return stats;
+  }
+  stop_.store(false, std::memory_order_relaxed);
+  const int64_t periodNs = static_cast<int64_t>(trajectory.period / options_.speed * 1e9);
+
+  // Move to the first pose so the arm is not yanked into the trajectory: interpolate from the measured
+  // pose if one arrives within the first quarter of the lead-in, else let the servos approach it slowly
+  const double* first = trajectory.step(0);
+  double from[kArmJointCount];
+  double target[kArmJointCount];
+  int64_t deadline = monotonicNs();
+  const int64_t leadInEnd = deadline + static_cast<int64_t>(options_.leadIn * 1e9);
+  const int64_t waitEnd = deadline + static_cast<int64_t>(options_.leadIn * 0.25e9);
+  int64_t rampStart = -1;
+  while (deadline < leadInEnd && !stop_.load(std::memory_order_relaxed)) {
+    if (rampStart >= 0) {
+      // Cosine ramp, at rest at both ends; the last tick sends the first pose itself
+      const double u = std::min(1.0, static_cast<double>(deadline + periodNs - rampStart) /
+                                         static_cast<double>(leadInEnd - rampStart));
+      const double w = 0.5 - 0.5 * std::cos(M_PI * u);
+      for (size_t j = 0; j < kArmJointCount; j++) {
+        target[j] = from[j] + w * (first[j] - from[j]);
+      }
+      channel_.sendJoints(target);
+      measure(target);
+    } else if (deadline < waitEnd) {
+      if (measure(from)) {
+        rampStart = deadline;
+        continue;
+      }
+    } else {
+      channel_.sendJointsAtSpeed(first, options_.leadInSpeed, options_.leadInAcceleration);
+      measure(target);
+    }
+    deadline += periodNs;
+    sleepUntilNs(deadline);
+  }
+
+  std::vector<double> lateness;
+  lateness.reserve(steps);
+  double squaredError[kArmJointCount] = {};
+  const int64_t start = monotonicNs();
+  ReplayStep step;
+  for (size_t k = 0; k < steps && !stop_.load(std::memory_order_relaxed);) {
+    deadline = start + static_cast<int64_t>(k) * periodNs;
+    sleepUntilNs(deadline);
+    int64_t now = monotonicNs();
+    if (options_.skipLate && now - deadline > periodNs) {
+      const size_t due = static_cast<size_t>((now - start) / periodNs);
+      stats.skipped += std::min(due, steps) - k;
+      k = due;
+      if (k >= steps) {
+        break;
+      }
+      deadline = start + static_cast<int64_t>(k) * periodNs;
+    }
+
+    step.index = k;
+    step.time = k * trajectory.period;
+    std::memcpy(step.commanded, trajectory.step(k), sizeof(step.commanded));
+    step.sent = channel_.sendJoints(step.commanded);
+    now = monotonicNs();
+    step.lateness = (now - deadline) * 1e-9;
+    step.measured = measure(step.measuredJoints);
+
+    stats.steps++;
+    stats.refused += !step.sent;
+    stats.missedDeadlines += (now - deadline) * 2 > periodNs;
+    lateness.push_back(step.lateness);
+    if (step.measured) {
+      stats.measuredSteps++;
+      for (size_t j = 0; j < kArmJointCount; j++) {
+        step.error[j] = step.measuredJoints[j] - step.commanded[j];
+        squaredError[j] += step.error[j] * step.error[j];
+        stats.maxError[j] = std::max(stats.maxError[j], std::fabs(step.error[j]));
+      }
+    }
+    if (onStep) {
+      onStep(step);
+    }
+    k++;
+  }
+
+  stats.latenessMax = lateness.empty() ? 0.0 : *std::max_element(lateness.begin(), lateness.end());
+  stats.latenessP50 = percentile(lateness, 0.50);
+  stats.latenessP99 = percentile(lateness, 0.99);
+  for (size_t j = 0; j < kArmJointCount; j++) {
+    stats.rmsError[j] = stats.measuredSteps ? std::sqrt(squaredError[j] / stats.measuredSteps) : 0.0;
+  }
+  return stats;
+}
+
+void writeReplayCsvHeader(std::FILE* out) {
+  std::fprintf(out, "step,time,lateness_ms,sent");
+  static const char* kNames[kArmJointCount] = {"b", "s", "e", "t", "r", "g"};
+  for (const char* prefix : {"cmd", "meas", "err"}) {
+    for (const char* name : kNames) {
+      std::fprintf(out, ",%s_%s", prefix, name);
+    }
+  }
+  std::fprintf(out, "\n");
+}
+
+void writeReplayCsvRow(std::FILE* out, const ReplayStep& step) {
+  std::fprintf(out, "%llu,%.4f,%.3f,%d", static_cast<unsigned long long>(step.index), step.time,
+               step.lateness * 1e3, step.sent ? 1 : 0);
+  for (size_t j = 0; j < kArmJointCount; j++) {
+    std::fprintf(out, ",%.5f", step.commanded[j]);
+  }
+  for (size_t j = 0; j < kArmJointCount; j++) {
+    if (step.measured) {
+      std::fprintf(out, ",%.5f", step.measuredJoints[j]);
+    } else {
+      std::fprintf(out, ",");
+    }
+  }
+  for (size_t j = 0; j < kArmJointCount; j++) {
+    if (step.measured) {
+      std::fprintf(out, ",%.5f", step.error[j]);
+    } else {
+      std::fprintf(out, ",");
+    }
+  }
+  std::fprintf(out, "\n");
+}
+
+}  // namespace shoplifter
@@ -0,0 +1,146 @@
+/**
+ * Episode Replay
+ *
+ * Streams a recorded follower episode back to an arm for regression tests.
+ * The six joint channels of the episode are resampled onto a uniform grid at
+ * the command rate (linear interpolation, perception/multimodal/stream_aligner.h),
+ * then sent through an ArmCommandChannel on absolute deadlines:
+ *
+ *   deadline(k) = start + k * period / speed
+ *
+ * The replay thread sleeps with clock_nanosleep(TIMER_ABSTIME), so timing
+ * errors do not accumulate. If it falls more than one period behind, it
+ * skips ahead to the step that is due instead of sending stale targets.
+ *
+ * Every step records its lateness and, when a measurement source is
+ * available (position reports on the serial channel, or the shared-memory
+ * arm state from hardware/telemetry/arm_state_shm.h), the tracking error
+ * between the commanded and the latest measured joints.
+ */
+
+#ifndef EPISODE_REPLAY_H
+#define EPISODE_REPLAY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "hardware/arm_interface/arm_command_channel.h"
+
+namespace shoplifter {
+
+/**
+ * Joint targets on a uniform time grid
+ */
+struct ReplayTrajectory {
+  double startTime = 0.0;              // recording time of step 0 (Unix seconds)
+  double period = 0.0;                 // seconds between steps at 1x
+  std::vector<double> joints;          // step-major: step * kArmJointCount + joint
+  uint64_t gapSteps = 0;               // steps interpolated across recording gaps
+
+  size_t steps() const { return joints.size() / kArmJointCount; }
+  const double* step(size_t i) const { return joints.data() + i * kArmJointCount; }
+};
+
+/**
+ * Load and resample the joint channels of an episode
+ *
+ * @param path .episode file
+ * @param rate Command rate in Hz
+ * @param start Seconds to skip from the beginning of the recording
+ * @param duration Seconds to keep (0 = to the end)
+ * @param maxGap Recording gaps longer than this are counted in gapSteps
+ * @throws std::runtime_error if the file cannot be read or holds no joint data
+ */
+ReplayTrajectory loadReplayTrajectory(const std::string& path, double rate, double start = 0.0,
+                                      double duration = 0.0, double maxGap = 0.1);
+
+struct ReplayOptions {
+  double speed = 1.0;                  // playback speed factor
+  double leadIn = 2.0;                 // seconds moving to the first pose before playback
+  uint32_t leadInSpeed = 400;          // servo steps/s and 100 steps/s² for the lead-in
+  uint32_t leadInAcceleration = 10;    //   when the arm's pose is not measured
+  bool skipLate = true;                // skip to the due step when behind by more than a period
+};
+
+/**
+ * One replayed step
+ */
+struct ReplayStep {
+  uint64_t index;                      // trajectory step
+  double time;                         // seconds since playback start, at 1x
+  double lateness;                     // send time minus deadline, seconds
+  bool sent;                           // false if the channel refused the command
+  bool measured;                       // measuredJoints is valid
+  double commanded[kArmJointCount];
+  double measuredJoints[kArmJointCount];
+  double error[kArmJointCount];        // measured - commanded, valid if measured
+};
+
+struct ReplayStats {
+  uint64_t steps = 0;                  // steps sent or attempted
+  uint64_t skipped = 0;                // steps skipped because the replay was late
+  uint64_t refused = 0;                // commands the channel did not accept
+  uint64_t missedDeadlines = 0;        // steps sent more than half a period late
+  double latenessP50 = 0.0;
+  double latenessP99 = 0.0;
+  double latenessMax = 0.0;
+  uint64_t measuredSteps = 0;
+  double rmsError[kArmJointCount] = {};
+  double maxError[kArmJointCount] = {};
+};
+
+/**
+ * Latest measured joints, base .. hand
+ *
+ * @return false if no measurement is available
+ */
+using JointMeasurement = std::function<bool(double* joints)>;
+
+class ReplayEngine {
+ public:
+  ReplayEngine(ArmCommandChannel& channel, const ReplayOptions& options = ReplayOptions());
+
+  /**
+   * Measurement source for tracking error
+   *
+   * Without one, reports from channel.pollFeedback() are used if it has any.
+   */
+  void setMeasurement(JointMeasurement measurement) { measurement_ = std::move(measurement); }
+
+  /**
+   * Replay a trajectory; blocks until done or stop() is called
+   *
+   * @param trajectory Resampled joint targets
+   * @param onStep Called after every step (may be empty)
+   * @return Summary over all steps
+   */
+  ReplayStats run(const ReplayTrajectory& trajectory, const std::function<void(const ReplayStep&)>& onStep = {});
+
+  // Ask run() to return after the current step; safe from other threads and signal handlers
+  void stop() { stop_.store(true, std::memory_order_relaxed); }
+
+ private:
+  bool measure(double* joints);
+
+  ArmCommandChannel& channel_;
+  ReplayOptions options_;
+  JointMeasurement measurement_;
+  PositionSample feedback_{};
+  bool haveFeedback_ = false;
+  std::atomic<bool> stop_{false};
+};
+
+/**
+ * Write a per-step CSV report header and rows
+ */
+void writeReplayCsvHeader(std::FILE* out);
+void writeReplayCsvRow(std::FILE* out, const ReplayStep& step);
+
+}  // namespace shoplifter
+
+#endif // EPISODE_REPLAY_H
@@ -0,0 +1,144 @@
+/**
+ * Episode Replay Tool
+ *
+ * Replays the joint trajectory of a recorded .episode on a follower arm and
+ * reports deadline and tracking statistics.
+ *
+ * Usage:
+ *   replay_episode --channel SPEC [--rate HZ] [--speed X] [--start S] [--duration S]
+ *                  [--lead-in S] [--shm-arm ID] [--report steps.csv] recording.episode
+ *
+ * SPEC is "serial:/dev/ttyUSB0[@115200]" (default, fastest), "http:192.168.4.1"
+ * or "null" (dry run). Tracking error uses the position reports on the serial
+ * port, or with --shm-arm the shared-memory arm state published by
+ * read_multi_follower_positions.py --shm.
+ */
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "hardware/arm_interface/episode_replay.h"
+#include "hardware/telemetry/arm_state_shm.h"
+
+using namespace shoplifter;
+
+namespace {
+
+ReplayEngine* g_engine = nullptr;
+
+void onSignal(int) {
+  if (g_engine) {
+    g_engine->stop();
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string spec = "serial:/dev/ttyUSB0";
+  std::string shmArm;
+  std::string reportPath;
+  std::string input;
+  double rate = 50.0;
+  double start = 0.0;
+  double duration = 0.0;
+  ReplayOptions options;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--channel")) spec = next();
+    else if (!std::strcmp(argv[i], "--rate")) rate = std::atof(next());
+    else if (!std::strcmp(argv[i], "--speed")) options.speed = std::atof(next());
+    else if (!std::strcmp(argv[i], "--start")) start = std::atof(next());
+    else if (!std::strcmp(argv[i], "--duration")) duration = std::atof(next());
+    else if (!std::strcmp(argv[i], "--lead-in")) options.leadIn = std::atof(next());
+    else if (!std::strcmp(argv[i], "--shm-arm")) shmArm = next();
+    else if (!std::strcmp(argv[i], "--report")) reportPath = next();
+    else input = argv[i];
+  }
+  if (input.empty()) {
+    std::fprintf(stderr,
+                 "Usage: %s --channel SPEC [--rate HZ] [--speed X] [--start S] [--duration S]\n"
+                 "          [--lead-in S] [--shm-arm ID] [--report steps.csv] recording.episode\n",
+                 argv[0]);
+    return 2;
+  }
+
+  try {
+    const ReplayTrajectory trajectory = loadReplayTrajectory(input, rate, start, duration);
+    std::unique_ptr<ArmCommandChannel> channel = openCommandChannel(spec);
+    std::printf("%s: %zu steps at %.0f Hz (%.1f s at %.2fx), %llu steps across recording gaps\n",
+                input.c_str(), trajectory.steps(), rate, trajectory.steps() / rate / options.speed,
+                options.speed, static_cast<unsigned long long>(trajectory.gapSteps));
+    const double limit = channel->maxCommandRate();
+    if (limit > 0.0 && rate * options.speed > limit) {
+      std::printf("warning: %s carries about %.0f commands/s; expect refused commands\n",
+                  channel->describe().c_str(), limit);
+    }
+
+    ReplayEngine engine(*channel, options);
+    std::unique_ptr<ArmStateReader> shm;
+    int shmSlot = -1;
+    if (!shmArm.empty()) {
+      shm = std::make_unique<ArmStateReader>();
+      engine.setMeasurement([&](double* joints) {
+        if (shmSlot < 0) {
+          shmSlot = shm->findArm(shmArm);
+        }
+        ArmState state;
+        if (shmSlot < 0 || !shm->latest(shmSlot, state)) {
+          return false;
+        }
+        std::memcpy(joints, state.values + kChannelBase, kArmJointCount * sizeof(double));
+        return true;
+      });
+    }
+
+    std::FILE* report = nullptr;
+    if (!reportPath.empty()) {
+      report = std::fopen(reportPath.c_str(), "w");
+      if (!report) {
+        std::fprintf(stderr, "Cannot create %s\n", reportPath.c_str());
+        return 1;
+      }
+      writeReplayCsvHeader(report);
+    }
+
+    g_engine = &engine;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    const ReplayStats stats = engine.run(trajectory, [&](const ReplayStep& step) {
+      if (report) {
+        writeReplayCsvRow(report, step);
+      }
+    });
+    g_engine = nullptr;
+    if (report) {
+      std::fclose(report);
+    }
+
+    std::printf("steps %llu, skipped %llu, refused %llu, missed deadlines %llu\n",
+                static_cast<unsigned long long>(stats.steps), static_cast<unsigned long long>(stats.skipped),
+                static_cast<unsigned long long>(stats.refused),
+                static_cast<unsigned long long>(stats.missedDeadlines));
+    std::printf("lateness p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", stats.latenessP50 * 1e3,
+                stats.latenessP99 * 1e3, stats.latenessMax * 1e3);
+    if (stats.measuredSteps) {
+      static const char* kNames[kArmJointCount] = {"b", "s", "e", "t", "r", "g"};
+      std::printf("tracking error over %llu steps (rad):\n", static_cast<unsigned long long>(stats.measuredSteps));
+      for (size_t j = 0; j < kArmJointCount; j++) {
+        std::printf("  %s  rms %.4f  max %.4f\n", kNames[j], stats.rmsError[j], stats.maxError[j]);
+      }
+    } else {
+      std::printf("no joint measurements; tracking error not available\n");
+    }
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
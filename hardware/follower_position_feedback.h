@@ -17,6 +17,10 @@
 // Default identity if not configured
 String armIdentity = "unknown";
 
+// Command IDs for arm identity
+#define CMD_SET_ARM_IDENTITY 400
+#define CMD_GET_ARM_IDENTITY 401
+
 // Timestamp for position reporting
 unsigned long lastPositionReportTime = 0;
 
@@ -78,6 +82,21 @@ void initArmIdentity() {
   }
 }
 
+/**
+ * Reply to an identity query via serial
+ * 
+ * Sent in response to CMD_GET_ARM_IDENTITY so the host can identify the arm
+ * immediately instead of waiting for the next position report. This works in
+ * every ESP-NOW mode, not only follower mode.
+ */
+void sendArmIdentity() {
+  StaticJsonDocument<96> idData;
+  idData["T"] = CMD_GET_ARM_IDENTITY;
+  idData["arm_id"] = armIdentity;
+  serializeJson(idData, Serial);
+  Serial.println();
+}
+
 /**
  * Send position data via serial
  * 
@@ -0,0 +1,99 @@
+/**
+ * Joint Velocity Streaming for RoArm-M3 Pro
+ *
+ * Lets the host command joint velocities at a high rate instead of absolute
+ * poses. The arm integrates the latest velocities into joint targets every
+ * JOINT_VELOCITY_STEP_MS and sends them to the servos, so motion stays
+ * smooth between host commands. If no new command arrives within its ttl,
+ * integration stops and the arm holds the last target. Targets stop at the
+ * joint ranges of CMD_JOINTS_RAD_CTRL, so pushing against a limit does not
+ * wind them up past it.
+ *
+ * {"T":410,"v":[base,shoulder,elbow,wrist,roll,hand],"ttl":50}
+ *
+ * Velocities are in radians per second, ttl in milliseconds.
+ */
+
+#ifndef JOINT_VELOCITY_CTRL_H
+#define JOINT_VELOCITY_CTRL_H
+
+#define CMD_JOINTS_VEL_CTRL 410
+
+// Integration step (ms); 200 Hz, faster than any host stream over serial
+#define JOINT_VELOCITY_STEP_MS 5
+
+// Longest ttl accepted (ms), so a lost host cannot keep the arm moving
+#define JOINT_VELOCITY_MAX_TTL_MS 500
+
+// Joint ranges (rad), base .. hand: the RoArm-M3 T:102 ranges, as in ArmJointLimits on the host
+const double jointVelocityLower[6] = {-M_PI, -M_PI / 2, -M_PI / 4, -M_PI / 2, -M_PI, 1.08};
+const double jointVelocityUpper[6] = {M_PI, M_PI / 2, M_PI, M_PI / 2, M_PI, M_PI};
+
+double jointVelocity[6] = {0, 0, 0, 0, 0, 0};
+double jointVelocityTarget[6] = {0, 0, 0, 0, 0, 0};
+unsigned long jointVelocityDeadline = 0;
+unsigned long jointVelocityLastStep = 0;
+bool jointVelocityActive = false;
+
+/**
+ * Take a CMD_JOINTS_VEL_CTRL command
+ *
+ * A stream starts from the measured joint angles; later commands keep
+ * integrating from the current targets.
+ */
+void setJointVelocities(const JsonDocument& cmd) {
+  unsigned long now = millis();
+  if (!jointVelocityActive) {
+    jointVelocityTarget[0] = radB;
+    jointVelocityTarget[1] = radS;
+    jointVelocityTarget[2] = radE;
+    jointVelocityTarget[3] = radT;
+    jointVelocityTarget[4] = radR;
+    jointVelocityTarget[5] = radG;
+    for (int i = 0; i < 6; i++) {
+      jointVelocityTarget[i] = constrain(jointVelocityTarget[i], jointVelocityLower[i], jointVelocityUpper[i]);
+    }
+    jointVelocityLastStep = now;
+  }
+  for (int i = 0; i < 6; i++) {
+    jointVelocity[i] = cmd["v"][i].as<double>();
+  }
+  unsigned long ttl = cmd["ttl"] | 50;
+  if (ttl > JOINT_VELOCITY_MAX_TTL_MS) {
+    ttl = JOINT_VELOCITY_MAX_TTL_MS;
+  }
+  jointVelocityDeadline = now + ttl;
+  jointVelocityActive = true;
+}
+
+/**
+ * Integrate and send the joint targets
+ *
+ * This should be called in the main loop.
+ */
+void handleJointVelocity() {
+  if (!jointVelocityActive) {
+    return;
+  }
+  unsigned long now = millis();
+  if (now - jointVelocityLastStep < JOINT_VELOCITY_STEP_MS) {
+    return;
+  }
+  // Integrate up to the deadline at most, then hold
+  long left = (long)(jointVelocityDeadline - jointVelocityLastStep);
+  long step = (long)(now - jointVelocityLastStep);
+  double dt = (step < left ? step : (left > 0 ? left : 0)) / 1000.0;
+  jointVelocityLastStep = now;
+  for (int i = 0; i < 6; i++) {
+    jointVelocityTarget[i] = constrain(jointVelocityTarget[i] + jointVelocity[i] * dt,
+                                       jointVelocityLower[i], jointVelocityUpper[i]);
+  }
+  // The CMD_JOINTS_RAD_CTRL path, radians in
+  RoArmM3_allJointsCtrlRad(jointVelocityTarget[0], jointVelocityTarget[1], jointVelocityTarget[2],
+                           jointVelocityTarget[3], jointVelocityTarget[4], jointVelocityTarget[5], 0, 0);
+  if ((long)(now - jointVelocityDeadline) >= 0) {
+    jointVelocityActive = false;
+  }
+}
+
+#endif // JOINT_VELOCITY_CTRL_H
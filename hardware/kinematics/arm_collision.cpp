@@ -0,0 +1,392 @@
+/**
+ * Bimanual Collision Checking
+ */
+
+#include "hardware/kinematics/arm_collision.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "models/transformer/simd.h"
+
+namespace shoplifter {
+
+namespace {
+
+using namespace simd;
+
+constexpr size_t kChunk = 256;           // Pairs per broad + narrow pass, a multiple of every kFloatLanes
+constexpr size_t kPoints = 3;            // Moving points per arm: elbow, wrist, end effector
+constexpr size_t kPointRows = 2 * kPoints * 3;
+constexpr float kMinLength2 = 1e-6f;     // mm^2, keeps degenerate segments finite
+constexpr float kMinDenominator = 1e-6f; // mm^4, parallel segments
+
+double dot(const double* a, const double* b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+double clamp01(double x) { return std::min(1.0, std::max(0.0, x)); }
+
+// Distance between segments p1-q1 and p2-q2 (Ericson, Real-Time Collision Detection 5.1.9)
+double segmentDistance(const double* p1, const double* q1, const double* p2, const double* q2) {
+  double d1[3], d2[3], r[3];
+  for (int k = 0; k < 3; k++) {
+    d1[k] = q1[k] - p1[k];
+    d2[k] = q2[k] - p2[k];
+    r[k] = p1[k] - p2[k];
+  }
+  const double a = dot(d1, d1), e = dot(d2, d2), f = dot(d2, r);
+  double s, t;
+  if (a <= 1e-12 && e <= 1e-12) {
+    s = t = 0.0;
+  } else if (a <= 1e-12) {
+    s = 0.0;
+    t = clamp01(f / e);
+  } else {
+    const double c = dot(d1, r);
+    if (e <= 1e-12) {
+      t = 0.0;
+      s = clamp01(-c / a);
+    } else {
+      const double b = dot(d1, d2);
+      const double denom = a * e - b * b;
+      s = denom > 0.0 ? clamp01((b * f - c * e) / denom) : 0.0;
+      t = (b * s + f) / e;
+      if (t < 0.0) {
+        t = 0.0;
+        s = clamp01(-c / a);
+      } else if (t > 1.0) {
+        t = 1.0;
+        s = clamp01((b - c) / a);
+      }
+    }
+  }
+  double d2sum = 0.0;
+  for (int k = 0; k < 3; k++) {
+    const double diff = r[k] + d1[k] * s - d2[k] * t;
+    d2sum += diff * diff;
+  }
+  return std::sqrt(d2sum);
+}
+
+double capsuleClearance(const Capsule& u, const Capsule& v) {
+  return segmentDistance(u.a, u.b, v.a, v.b) - u.radius - v.radius;
+}
+
+struct Vec3 {
+  VecF x, y, z;
+};
+
+inline VecF dot(const Vec3& a, const Vec3& b) { return fma(a.x, b.x, fma(a.y, b.y, mul(a.z, b.z))); }
+
+inline VecF clamp01(VecF x) { return min(max(x, zero()), broadcast(1.0f)); }
+
+// Squared segment distance in lanes: the branches of segmentDistance() folded into clamps. With t fixed, s is
+// re-solved rather than kept, which can only move closer, so the result matches the branching version
+inline VecF segmentDistance2(const Vec3& p1, const Vec3& q1, const Vec3& p2, const Vec3& q2) {
+  const Vec3 d1 = {sub(q1.x, p1.x), sub(q1.y, p1.y), sub(q1.z, p1.z)};
+  const Vec3 d2 = {sub(q2.x, p2.x), sub(q2.y, p2.y), sub(q2.z, p2.z)};
+  const Vec3 r = {sub(p1.x, p2.x), sub(p1.y, p2.y), sub(p1.z, p2.z)};
+  const VecF a = max(dot(d1, d1), broadcast(kMinLength2));
+  const VecF e = max(dot(d2, d2), broadcast(kMinLength2));
+  const VecF b = dot(d1, d2), c = dot(d1, r), f = dot(d2, r);
+  const VecF denom = max(sub(mul(a, e), mul(b, b)), broadcast(kMinDenominator));
+  VecF s = clamp01(div(sub(mul(b, f), mul(c, e)), denom));
+  const VecF t = clamp01(div(fma(b, s, f), e));
+  s = clamp01(div(sub(mul(b, t), c), a));
+  const VecF x = sub(fma(d1.x, s, r.x), mul(d2.x, t));
+  const VecF y = sub(fma(d1.y, s, r.y), mul(d2.y, t));
+  const VecF z = sub(fma(d1.z, s, r.z), mul(d2.z, t));
+  return fma(x, x, fma(y, y, mul(z, z)));
+}
+
+/**
+ * Mount constants in float, and the box of the static base column
+ */
+struct MountLanes {
+  float x, y, z, cosYaw, sinYaw;
+  float bottom;                          // z of the base plate
+  float pad;                             // Largest radius of the arm
+};
+
+MountLanes mountLanes(const ArmMount& mount, const ArmCapsuleModel& model) {
+  MountLanes m;
+  m.x = static_cast<float>(mount.x);
+  m.y = static_cast<float>(mount.y);
+  m.z = static_cast<float>(mount.z);
+  m.cosYaw = static_cast<float>(std::cos(mount.yaw));
+  m.sinYaw = static_cast<float>(std::sin(mount.yaw));
+  m.bottom = static_cast<float>(mount.z - model.baseHeight);
+  m.pad = static_cast<float>(
+      std::max(std::max(model.baseRadius, model.upperArmRadius), std::max(model.forearmRadius, model.handRadius)));
+  return m;
+}
+
+/**
+ * Elbow, wrist and end-effector points of pairs i .. i + kFloatLanes - 1,
+ * workcell frame; rows x, y, z of each point at points[0 .. 8][i]
+ */
+inline void armPointsBlock(const JointColumns& joints, size_t i, const MountLanes& m, float* const* points,
+                           size_t o) {
+  VecF sb, cb, s1, c1, s2, c2, s3, c3;
+  const VecF shoulder = load(joints.shoulder + i);
+  const VecF forearm = add(shoulder, load(joints.elbow + i));
+  const VecF hand = add(forearm, load(joints.wrist + i));
+  sincos(load(joints.base + i), sb, cb);
+  sincos(shoulder, s1, c1);
+  sincos(forearm, s2, c2);
+  sincos(hand, s3, c3);
+  // Heading of the arm plane in the workcell: base angle plus mount yaw
+  const VecF ch = sub(mul(cb, broadcast(m.cosYaw)), mul(sb, broadcast(m.sinYaw)));
+  const VecF sh = fma(sb, broadcast(m.cosYaw), mul(cb, broadcast(m.sinYaw)));
+  VecF r = fma(broadcast(static_cast<float>(kArmL2A)), s1, mul(broadcast(static_cast<float>(kArmL2B)), c1));
+  VecF z = fma(broadcast(static_cast<float>(kArmL2A)), c1, mul(broadcast(static_cast<float>(-kArmL2B)), s1));
+  VecF rs[kPoints], zs[kPoints];
+  rs[0] = r;
+  zs[0] = z;
+  r = fma(broadcast(static_cast<float>(kArmL3A)), s2, r);
+  z = fma(broadcast(static_cast<float>(kArmL3A)), c2, z);
+  rs[1] = r;
+  zs[1] = z;
+  rs[2] = fma(broadcast(static_cast<float>(kArmL4A)), s3, fma(broadcast(static_cast<float>(kArmL4B)), c3, r));
+  zs[2] = fma(broadcast(static_cast<float>(kArmL4A)), c3, fma(broadcast(static_cast<float>(-kArmL4B)), s3, z));
+  for (size_t p = 0; p < kPoints; p++) {
+    store(points[3 * p] + o, fma(rs[p], ch, broadcast(m.x)));
+    store(points[3 * p + 1] + o, fma(rs[p], sh, broadcast(m.y)));
+    store(points[3 * p + 2] + o, add(zs[p], broadcast(m.z)));
+  }
+}
+
+// Bounding box of one arm in lanes, padded by its largest radius
+struct Box {
+  VecF lo[3], hi[3];
+};
+
+inline Box armBox(float* const* points, size_t o, const MountLanes& m) {
+  Box box;
+  const float origin[3] = {m.x, m.y, m.z};
+  for (int k = 0; k < 3; k++) {
+    box.lo[k] = box.hi[k] = broadcast(origin[k]);
+  }
+  box.lo[2] = broadcast(m.bottom);
+  for (size_t p = 0; p < kPoints; p++) {
+    for (int k = 0; k < 3; k++) {
+      const VecF v = load(points[3 * p + k] + o);
+      box.lo[k] = min(box.lo[k], v);
+      box.hi[k] = max(box.hi[k], v);
+    }
+  }
+  for (int k = 0; k < 3; k++) {
+    box.lo[k] = sub(box.lo[k], broadcast(m.pad));
+    box.hi[k] = add(box.hi[k], broadcast(m.pad));
+  }
+  return box;
+}
+
+}  // namespace
+
+void armCapsules(const double* joints, const ArmMount& mount, const ArmCapsuleModel& model,
+                 Capsule capsules[kArmCapsuleCount]) {
+  const double shoulder = joints[1];
+  const double forearm = shoulder + joints[2];
+  const double hand = forearm + joints[3];
+  const double r1 = kArmL2A * std::sin(shoulder) + kArmL2B * std::cos(shoulder);
+  const double z1 = kArmL2A * std::cos(shoulder) - kArmL2B * std::sin(shoulder);
+  const double r2 = r1 + kArmL3A * std::sin(forearm);
+  const double z2 = z1 + kArmL3A * std::cos(forearm);
+  const double r3 = r2 + kArmL4A * std::sin(hand) + kArmL4B * std::cos(hand);
+  const double z3 = z2 + kArmL4A * std::cos(hand) - kArmL4B * std::sin(hand);
+  const double heading = joints[0] + mount.yaw;
+  const double ch = std::cos(heading), sh = std::sin(heading);
+  const double points[4][3] = {{mount.x, mount.y, mount.z},
+                               {mount.x + r1 * ch, mount.y + r1 * sh, mount.z + z1},
+                               {mount.x + r2 * ch, mount.y + r2 * sh, mount.z + z2},
+                               {mount.x + r3 * ch, mount.y + r3 * sh, mount.z + z3}};
+  const double radii[kArmCapsuleCount] = {model.baseRadius, model.upperArmRadius, model.forearmRadius, model.handRadius};
+  capsules[0] = {{mount.x, mount.y, mount.z - model.baseHeight}, {mount.x, mount.y, mount.z}, radii[0]};
+  for (size_t l = 1; l < kArmCapsuleCount; l++) {
+    capsules[l] = {{points[l - 1][0], points[l - 1][1], points[l - 1][2]},
+                   {points[l][0], points[l][1], points[l][2]},
+                   radii[l]};
+  }
+}
+
+BimanualCollisionChecker::BimanualCollisionChecker(const BimanualOptions& options) : options_(options) {
+  const ArmCapsuleModel& m = options.model;
+  if (!(m.baseHeight >= 0.0) || !(m.baseRadius >= 0.0) || !(m.upperArmRadius >= 0.0) || !(m.forearmRadius >= 0.0) ||
+      !(m.handRadius >= 0.0)) {
+    throw std::invalid_argument("Collision model radii and base height must not be negative");
+  }
+  if (!(options.margin >= 0.0) || !(options.exactWithin >= options.margin)) {
+    throw std::invalid_argument("Collision margin must not be negative or exceed exactWithin");
+  }
+  const double home[kKinematicJointCount] = {};
+  Capsule left[kArmCapsuleCount], right[kArmCapsuleCount];
+  armCapsules(home, options.left, m, left);
+  armCapsules(home, options.right, m, right);
+  if (capsuleClearance(left[0], right[0]) < options.margin) {
+    throw std::invalid_argument("Collision model base columns are within margin of each other");
+  }
+
+  // Farthest any surface gets from the arm origin, over all configurations
+  const double links = std::hypot(kArmL2A, kArmL2B) + kArmL3A + std::hypot(kArmL4A, kArmL4B);
+  const double moving = std::max(m.upperArmRadius, std::max(m.forearmRadius, m.handRadius));
+  const double reach = std::max(links + moving, m.baseHeight + m.baseRadius);
+  const double apart = std::sqrt((options.left.x - options.right.x) * (options.left.x - options.right.x) +
+                                 (options.left.y - options.right.y) * (options.left.y - options.right.y) +
+                                 (options.left.z - options.right.z) * (options.left.z - options.right.z));
+  canCollide_ = apart - 2.0 * reach < options.margin;
+}
+
+double BimanualCollisionChecker::clearance(const double* left, const double* right) const {
+  Capsule a[kArmCapsuleCount], b[kArmCapsuleCount];
+  armCapsules(left, options_.left, options_.model, a);
+  armCapsules(right, options_.right, options_.model, b);
+  double best = std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < kArmCapsuleCount; i++) {
+    for (size_t j = i == 0 ? 1 : 0; j < kArmCapsuleCount; j++) {
+      best = std::min(best, capsuleClearance(a[i], b[j]));
+    }
+  }
+  return best;
+}
+
+void BimanualCollisionChecker::checkChunk(const JointColumns& left, const JointColumns& right, size_t count,
+                                          float* clearance, uint8_t* collides, CollisionBatchStats& stats) const {
+  alignas(64) float storage[kPointRows][kChunk];
+  float* rows[kPointRows];
+  for (size_t k = 0; k < kPointRows; k++) rows[k] = storage[k];
+  float* const* leftPoints = rows;
+  float* const* rightPoints = rows + 3 * kPoints;
+  const MountLanes lm = mountLanes(options_.left, options_.model);
+  const MountLanes rm = mountLanes(options_.right, options_.model);
+
+  // Broad phase: points of both arms, then the gap between their boxes
+  for (size_t i = 0; i < count; i += kFloatLanes) {
+    if (i + kFloatLanes <= count) {
+      armPointsBlock(left, i, lm, leftPoints, i);
+      armPointsBlock(right, i, rm, rightPoints, i);
+    } else {
+      // Tail: padded copies through the same lanes
+      float in[2][kKinematicJointCount][kFloatLanes] = {};
+      const JointColumns* sides[2] = {&left, &right};
+      for (int a = 0; a < 2; a++) {
+        const float* columns[kKinematicJointCount] = {sides[a]->base, sides[a]->shoulder, sides[a]->elbow,
+                                                      sides[a]->wrist};
+        for (size_t j = 0; j < kKinematicJointCount; j++) std::copy(columns[j] + i, columns[j] + count, in[a][j]);
+      }
+      armPointsBlock({in[0][0], in[0][1], in[0][2], in[0][3]}, 0, lm, leftPoints, i);
+      armPointsBlock({in[1][0], in[1][1], in[1][2], in[1][3]}, 0, rm, rightPoints, i);
+    }
+    const Box a = armBox(leftPoints, i, lm);
+    const Box b = armBox(rightPoints, i, rm);
+    VecF gap2 = zero();
+    for (int k = 0; k < 3; k++) {
+      const VecF g = max(zero(), max(sub(a.lo[k], b.hi[k]), sub(b.lo[k], a.hi[k])));
+      gap2 = fma(g, g, gap2);
+    }
+    alignas(64) float gap[kFloatLanes];
+    store(gap, sqrt(gap2));
+    std::copy(gap, gap + std::min(kFloatLanes, count - i), clearance + i);
+  }
+
+  // Pairs the boxes cannot settle, packed
+  uint16_t packed[kChunk];
+  size_t n = 0;
+  const float exactWithin = static_cast<float>(options_.exactWithin);
+  for (size_t k = 0; k < count; k++) {
+    packed[n] = static_cast<uint16_t>(k);
+    n += clearance[k] <= exactWithin;
+  }
+  stats.culled += count - n;
+
+  // Narrow phase: 15 capsule pairs per lane
+  Capsule base[2];
+  {
+    const double home[kKinematicJointCount] = {};
+    Capsule capsules[kArmCapsuleCount];
+    armCapsules(home, options_.left, options_.model, capsules);
+    base[0] = capsules[0];
+    armCapsules(home, options_.right, options_.model, capsules);
+    base[1] = capsules[0];
+  }
+  const ArmCapsuleModel& model = options_.model;
+  const float radii[kArmCapsuleCount] = {static_cast<float>(model.baseRadius), static_cast<float>(model.upperArmRadius),
+                                         static_cast<float>(model.forearmRadius), static_cast<float>(model.handRadius)};
+  for (size_t i = 0; i < n; i += kFloatLanes) {
+    const size_t lanes = std::min(kFloatLanes, n - i);
+    alignas(64) float g[kPointRows][kFloatLanes];
+    for (size_t l = 0; l < kFloatLanes; l++) {
+      const size_t k = packed[i + std::min(l, lanes - 1)];
+      for (size_t row = 0; row < kPointRows; row++) g[row][l] = storage[row][k];
+    }
+    // Segment endpoints per arm: base plate, origin, elbow, wrist, end effector
+    Vec3 ends[2][kArmCapsuleCount + 1];
+    for (int a = 0; a < 2; a++) {
+      const Capsule& c = base[a];
+      ends[a][0] = {broadcast(static_cast<float>(c.a[0])), broadcast(static_cast<float>(c.a[1])),
+                    broadcast(static_cast<float>(c.a[2]))};
+      ends[a][1] = {broadcast(static_cast<float>(c.b[0])), broadcast(static_cast<float>(c.b[1])),
+                    broadcast(static_cast<float>(c.b[2]))};
+      for (size_t p = 0; p < kPoints; p++) {
+        const size_t row = a * 3 * kPoints + 3 * p;
+        ends[a][p + 2] = {load(g[row]), load(g[row + 1]), load(g[row + 2])};
+      }
+    }
+    VecF best = broadcast(std::numeric_limits<float>::infinity());
+    for (size_t u = 0; u < kArmCapsuleCount; u++) {
+      for (size_t v = u == 0 ? 1 : 0; v < kArmCapsuleCount; v++) {
+        const VecF d = sqrt(segmentDistance2(ends[0][u], ends[0][u + 1], ends[1][v], ends[1][v + 1]));
+        best = min(best, sub(d, broadcast(radii[u] + radii[v])));
+      }
+    }
+    alignas(64) float out[kFloatLanes];
+    store(out, best);
+    for (size_t l = 0; l < lanes; l++) clearance[packed[i + l]] = out[l];
+  }
+
+  const float margin = static_cast<float>(options_.margin);
+  size_t colliding = 0;
+  for (size_t k = 0; k < count; k++) {
+    const bool hit = clearance[k] < margin;
+    colliding += hit;
+    if (collides) collides[k] = hit;
+  }
+  stats.colliding += colliding;
+  stats.pairs += count;
+}
+
+CollisionBatchStats BimanualCollisionChecker::clearanceBatch(const JointColumns& left, const JointColumns& right,
+                                                             size_t count, float* clearance, uint8_t* collides) const {
+  CollisionBatchStats stats;
+  for (size_t i = 0; i < count; i += kChunk) {
+    const size_t n = std::min(kChunk, count - i);
+    const JointColumns l = {left.base + i, left.shoulder + i, left.elbow + i, left.wrist + i};
+    const JointColumns r = {right.base + i, right.shoulder + i, right.elbow + i, right.wrist + i};
+    checkChunk(l, r, n, clearance + i, collides ? collides + i : nullptr, stats);
+  }
+  return stats;
+}
+
+CollisionBatchStats BimanualCollisionChecker::clearanceRows(const float* left, const float* right, size_t stride,
+                                                            size_t count, float* clearance, uint8_t* collides) const {
+  CollisionBatchStats stats;
+  alignas(64) float columns[2][kKinematicJointCount][kChunk];
+  for (size_t i = 0; i < count; i += kChunk) {
+    const size_t n = std::min(kChunk, count - i);
+    for (size_t k = 0; k < n; k++) {
+      const float* a = left + (i + k) * stride;
+      const float* b = right + (i + k) * stride;
+      for (size_t j = 0; j < kKinematicJointCount; j++) {
+        columns[0][j][k] = a[j];
+        columns[1][j][k] = b[j];
+      }
+    }
+    checkChunk({columns[0][0], columns[0][1], columns[0][2], columns[0][3]},
+               {columns[1][0], columns[1][1], columns[1][2], columns[1][3]}, n, clearance + i,
+               collides ? collides + i : nullptr, stats);
+  }
+  return stats;
+}
+
+}  // namespace shoplifter
@@ -0,0 +1,157 @@
+/**
+ * Bimanual Collision Checking
+ *
+ * Clearance between two RoArm-M3 arms sharing a workcell (follower_left and
+ * follower_right), for checking every planning candidate. Each arm is four
+ * capsules, segments swept by a radius, in the frame of arm_kinematics.h:
+ *
+ *   base      the column below the shoulder axis, baseHeight long
+ *   upper arm shoulder axis to elbow
+ *   forearm   elbow to wrist
+ *   hand      wrist to the end-effector point, gripper included in the radius
+ *
+ * A pair of configurations (one per arm) is clear by the smallest surface
+ * distance over the 15 link pairs between the arms (the two base columns
+ * never move and are checked once, at construction). Links of one arm are
+ * not checked against each other.
+ *
+ * The batch query works on chunks of pairs in two passes:
+ *
+ *   broad   forward kinematics of both arms in SIMD lanes, then the gap
+ *           between the arms' bounding boxes; pairs farther apart than
+ *           exactWithin are done, with the gap as their clearance
+ *   narrow  the remaining pairs, packed into full lanes, get all 15
+ *           segment-segment distances (Ericson's closest points, written
+ *           without branches so every lane shares the code)
+ *
+ * Clearance is therefore exact (to float rounding) up to exactWithin and a
+ * lower bound above it. Every query is const and works on stack buffers,
+ * so one checker serves all rollout workers at once.
+ */
+
+#ifndef ARM_COLLISION_H
+#define ARM_COLLISION_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "hardware/kinematics/arm_kinematics.h"
+
+namespace shoplifter {
+
+constexpr size_t kArmCapsuleCount = 4;  // base, upper arm, forearm, hand
+
+/**
+ * Link radii and base height, millimeters
+ *
+ * Approximate RoArm-M3 housing with the gripper closed; measure your build
+ * (cabling, tools) and pad accordingly.
+ */
+struct ArmCapsuleModel {
+  double baseHeight = 120.0;         // Shoulder axis above the base plate
+  double baseRadius = 60.0;
+  double upperArmRadius = 30.0;
+  double forearmRadius = 25.0;
+  double handRadius = 35.0;
+};
+
+/**
+ * Where an arm stands in the workcell frame
+ */
+struct ArmMount {
+  double x = 0.0;                    // Arm origin (on the shoulder axis), millimeters
+  double y = 0.0;
+  double z = 0.0;
+  double yaw = 0.0;                  // Radians; base angle 0 points along this heading
+};
+
+struct BimanualOptions {
+  ArmCapsuleModel model;
+  ArmMount left = {0.0, 200.0, 0.0, 0.0};
+  ArmMount right = {0.0, -200.0, 0.0, 0.0};
+  double margin = 10.0;              // Pairs with less clearance collide, millimeters
+  double exactWithin = 50.0;         // Clearance up to this is exact; farther pairs report a lower bound
+};
+
+/**
+ * One link: the points within radius of segment a-b, workcell frame
+ */
+struct Capsule {
+  double a[3];
+  double b[3];
+  double radius;
+};
+
+/**
+ * Link capsules of one arm, double precision
+ *
+ * @param joints kKinematicJointCount angles in radians
+ */
+void armCapsules(const double* joints, const ArmMount& mount, const ArmCapsuleModel& model,
+                 Capsule capsules[kArmCapsuleCount]);
+
+struct CollisionBatchStats {
+  size_t pairs = 0;
+  size_t culled = 0;                 // Settled by the broad phase
+  size_t colliding = 0;              // Clearance below margin
+};
+
+class BimanualCollisionChecker {
+ public:
+  /**
+   * @throws std::invalid_argument if a radius or the base height is
+   *         negative, margin is negative, exactWithin is below margin, or
+   *         the two base columns are within margin of each other
+   */
+  explicit BimanualCollisionChecker(const BimanualOptions& options = BimanualOptions());
+
+  /**
+   * Reference clearance of one pair, double precision
+   *
+   * @param left, right kKinematicJointCount angles in radians
+   * @return Smallest surface distance between the arms, millimeters;
+   *         negative when they overlap
+   */
+  double clearance(const double* left, const double* right) const;
+
+  /**
+   * Clearance of count pairs, joint columns in SIMD lanes
+   *
+   * @param left, right Joint columns of the two arms, count values each
+   * @param clearance Filled with count values, millimeters: exact up to
+   *                  exactWithin, a lower bound above it
+   * @param collides Filled with count flags, clearance < margin (may be nullptr)
+   */
+  CollisionBatchStats clearanceBatch(const JointColumns& left, const JointColumns& right, size_t count,
+                                     float* clearance, uint8_t* collides = nullptr) const;
+
+  /**
+   * clearanceBatch() over rows, e.g. predicted states of a rollout shard
+   *
+   * @param left, right First of kKinematicJointCount consecutive joint
+   *                    angles of each arm in row 0
+   * @param stride Floats from one row to the next
+   */
+  CollisionBatchStats clearanceRows(const float* left, const float* right, size_t stride, size_t count,
+                                    float* clearance, uint8_t* collides = nullptr) const;
+
+  /**
+   * false if the arms cannot come within margin in any configuration, so
+   * no pair needs checking
+   */
+  bool canCollide() const { return canCollide_; }
+
+  const BimanualOptions& options() const { return options_; }
+
+ private:
+  // Up to kChunk pairs through both passes
+  void checkChunk(const JointColumns& left, const JointColumns& right, size_t count, float* clearance,
+                  uint8_t* collides, CollisionBatchStats& stats) const;
+
+  BimanualOptions options_;
+  bool canCollide_ = true;
+};
+
+}  // namespace shoplifter
+
+#endif // ARM_COLLISION_H
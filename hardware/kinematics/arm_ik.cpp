@@ -0,0 +1,231 @@
+/**
+ * RoArm-M3 Inverse Kinematics
+ */
+
+#include "hardware/kinematics/arm_ik.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "hardware/kinematics/small_linalg.h"
+
+namespace shoplifter {
+
+namespace {
+
+constexpr size_t kJoints = kKinematicJointCount;
+constexpr double kTwoPi = 2.0 * M_PI;
+constexpr double kAxisEpsilon = 1e-9;    // mm from the base axis below which the base angle is free
+constexpr double kLimitSlack = 1e-12;    // radians a closed-form branch may exceed a limit by
+constexpr double kMinStep = 1e-12;       // radians; smaller steps mean the limits block progress
+constexpr double kMinProgress = 1e-6;    // mm of weighted error a step must remove to go on
+
+// Shift a by whole turns into [lo, hi], or as close to it as a turn allows
+double wrapInto(double a, double lo, double hi) {
+  double w = lo + std::fmod(a - lo, kTwoPi);
+  if (w < lo) w += kTwoPi;
+  if (w <= hi) return w;
+  return w - hi <= lo - (w - kTwoPi) ? w : w - kTwoPi;
+}
+
+}  // namespace
+
+ArmIkSolver::ArmIkSolver(const IkOptions& options) : options_(options) {
+  for (size_t j = 0; j < kJoints; j++) {
+    if (!(options.limits.lower[j] <= options.limits.upper[j])) {
+      throw std::invalid_argument("IK joint limits must have lower <= upper");
+    }
+  }
+  if (!(options.tiltWeight > 0.0) || !(options.tolerance > 0.0) || !(options.damping > 0.0)) {
+    throw std::invalid_argument("IK tiltWeight, tolerance and damping must be positive");
+  }
+}
+
+size_t ArmIkSolver::analyticSolutions(const ArmPose& target, const double* seed,
+                                      double solutions[4][kKinematicJointCount]) const {
+  // Shoulder to elbow is one link of length l2 at alpha from the shoulder angle
+  const double l2 = std::hypot(kArmL2A, kArmL2B);
+  const double l3 = kArmL3A;
+  const double alpha = std::atan2(kArmL2B, kArmL2A);
+  const double psi = target.tilt + M_PI / 2;
+  const double wristR = kArmL4A * std::sin(psi) + kArmL4B * std::cos(psi);
+  const double wristZ = kArmL4A * std::cos(psi) - kArmL4B * std::sin(psi);
+  const double rho = std::hypot(target.x, target.y);
+  const double facing = rho > kAxisEpsilon ? std::atan2(target.y, target.x) : seed[0];
+
+  size_t count = 0;
+  for (int reach = 0; reach < 2; reach++) {
+    // reach 1: the base turned away from the target, the arm bent back over
+    const double base = reach == 0 ? facing : facing + M_PI;
+    const double pr = (reach == 0 ? rho : -rho) - wristR;
+    const double pz = target.z - wristZ;
+    double c = (pr * pr + pz * pz - l2 * l2 - l3 * l3) / (2.0 * l2 * l3);
+    if (c > 1.0 + 1e-12 || c < -1.0 - 1e-12) {
+      continue;
+    }
+    c = std::min(1.0, std::max(-1.0, c));
+    const double bend = std::acos(c);
+    for (int side = 0; side < (bend > 0.0 ? 2 : 1); side++) {
+      // delta: forearm direction relative to the shoulder-elbow link
+      const double delta = side == 0 ? bend : -bend;
+      const double theta = std::atan2(pr, pz) - std::atan2(l3 * std::sin(delta), l2 + l3 * std::cos(delta));
+      double* q = solutions[count++];
+      q[0] = base;
+      q[1] = theta - alpha;
+      q[2] = delta + alpha;
+      q[3] = psi - theta - delta;
+      for (size_t j = 0; j < kJoints; j++) {
+        q[j] = wrapInto(q[j], options_.limits.lower[j], options_.limits.upper[j]);
+      }
+    }
+  }
+  return count;
+}
+
+double ArmIkSolver::violation(const double* joints) const {
+  double v = 0.0;
+  for (size_t j = 0; j < kJoints; j++) {
+    v += std::max(0.0, options_.limits.lower[j] - joints[j]) + std::max(0.0, joints[j] - options_.limits.upper[j]);
+  }
+  return v;
+}
+
+IkResult ArmIkSolver::measure(const ArmPose& target, const double* joints) const {
+  const ArmPose pose = forwardKinematics(joints);
+  IkResult result;
+  result.positionError = std::sqrt((target.x - pose.x) * (target.x - pose.x) + (target.y - pose.y) * (target.y - pose.y) +
+                                   (target.z - pose.z) * (target.z - pose.z));
+  result.tiltError = std::fabs(std::remainder(target.tilt - pose.tilt, kTwoPi));
+  return result;
+}
+
+uint32_t ArmIkSolver::refine(const ArmPose& target, double* joints) const {
+  const ArmJointLimits& limits = options_.limits;
+  const double w = options_.tiltWeight;
+  const double lambda2 = options_.damping * options_.damping;
+  double best[kJoints];
+  std::copy(joints, joints + kJoints, best);
+  double bestError = std::numeric_limits<double>::infinity();
+  double lastError = bestError;
+  uint32_t steps = 0;
+  for (;;) {
+    double jac[4][kJoints];
+    const ArmPose pose = armJacobian(joints, jac);
+    double e[4] = {target.x - pose.x, target.y - pose.y, target.z - pose.z,
+                   w * std::remainder(target.tilt - pose.tilt, kTwoPi)};
+    const double error = std::sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2] + e[3] * e[3]);
+    if (error < bestError) {
+      bestError = error;
+      std::copy(joints, joints + kJoints, best);
+    }
+    if (error < options_.tolerance || steps == options_.maxIterations || !(lastError - error > kMinProgress)) {
+      break;
+    }
+    lastError = error;
+    // dq = J^T (J J^T + lambda^2 I)^-1 e, tilt row weighted
+    for (size_t j = 0; j < kJoints; j++) jac[3][j] *= w;
+    double a[4][kJoints];
+    for (size_t r = 0; r < 4; r++) {
+      for (size_t c = 0; c <= r; c++) {
+        double s = 0.0;
+        for (size_t j = 0; j < kJoints; j++) s += jac[r][j] * jac[c][j];
+        a[r][c] = a[c][r] = s + (r == c ? lambda2 : 0.0);
+      }
+    }
+    choleskySolve(a, e);
+    double moved = 0.0;
+    for (size_t j = 0; j < kJoints; j++) {
+      double dq = 0.0;
+      for (size_t r = 0; r < 4; r++) dq += jac[r][j] * e[r];
+      const double q = std::min(limits.upper[j], std::max(limits.lower[j], joints[j] + dq));
+      moved += std::fabs(q - joints[j]);
+      joints[j] = q;
+    }
+    steps++;
+    if (moved < kMinStep) {
+      break;
+    }
+  }
+  std::copy(best, best + kJoints, joints);
+  return steps;
+}
+
+IkResult ArmIkSolver::solve(const ArmPose& target, const double* seed, double* joints) const {
+  double start[kJoints];
+  std::copy(seed, seed + kJoints, start);
+  double branches[4][kJoints];
+  const size_t count = analyticSolutions(target, start, branches);
+
+  // Within the limits: the branch closest to the seed; otherwise the least violating one
+  int inside = -1, nearest = -1;
+  double insideDistance = std::numeric_limits<double>::infinity();
+  double nearestViolation = std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < count; i++) {
+    const double v = violation(branches[i]);
+    if (v <= kLimitSlack) {
+      double d = 0.0;
+      for (size_t j = 0; j < kJoints; j++) d += (branches[i][j] - start[j]) * (branches[i][j] - start[j]);
+      if (d < insideDistance) {
+        insideDistance = d;
+        inside = static_cast<int>(i);
+      }
+    } else if (v < nearestViolation) {
+      nearestViolation = v;
+      nearest = static_cast<int>(i);
+    }
+  }
+
+  auto clampInto = [&](const double* from, double* to) {
+    for (size_t j = 0; j < kJoints; j++) {
+      to[j] = std::min(options_.limits.upper[j], std::max(options_.limits.lower[j], from[j]));
+    }
+  };
+  if (inside >= 0) {
+    clampInto(branches[inside], joints);
+    IkResult result = measure(target, joints);
+    result.status = IkStatus::kAnalytic;
+    return result;
+  }
+
+  // From the seed first, so a warm start stays continuous; then from the nearest branch if that does better
+  clampInto(start, joints);
+  const uint32_t seedSteps = refine(target, joints);
+  IkResult result = measure(target, joints);
+  result.iterations = seedSteps;
+  double weighted = std::hypot(result.positionError, options_.tiltWeight * result.tiltError);
+  if (weighted >= options_.tolerance && nearest >= 0) {
+    double alternative[kJoints];
+    clampInto(branches[nearest], alternative);
+    const uint32_t steps = refine(target, alternative);
+    const IkResult other = measure(target, alternative);
+    const double otherWeighted = std::hypot(other.positionError, options_.tiltWeight * other.tiltError);
+    if (otherWeighted < weighted - options_.tolerance) {
+      std::copy(alternative, alternative + kJoints, joints);
+      result = other;
+      weighted = otherWeighted;
+    }
+    result.iterations += steps;
+  }
+  result.status = weighted < options_.tolerance ? IkStatus::kIterative : IkStatus::kApproximate;
+  return result;
+}
+
+void ArmIkSolver::solveSequence(const ArmPose* targets, size_t count, const double* seed, double* joints,
+                                IkResult* results) const {
+  for (size_t i = 0; i < count; i++) {
+    const IkResult r = solve(targets[i], i == 0 ? seed : joints + (i - 1) * kJoints, joints + i * kJoints);
+    if (results) results[i] = r;
+  }
+}
+
+void ArmIkSolver::solveBatch(const ArmPose* targets, size_t count, const double* seeds, double* joints,
+                             IkResult* results) const {
+  for (size_t i = 0; i < count; i++) {
+    const IkResult r = solve(targets[i], seeds + i * kJoints, joints + i * kJoints);
+    if (results) results[i] = r;
+  }
+}
+
+}  // namespace shoplifter
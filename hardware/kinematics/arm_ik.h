@@ -0,0 +1,114 @@
+/**
+ * RoArm-M3 Inverse Kinematics
+ *
+ * Joint angles for an end-effector point and tilt (ArmPose, the frame of
+ * arm_kinematics.h), solved on the host instead of one CMD_COORDCTRL_POS
+ * request per pose. The arm has 5+1 DoF: base, shoulder, elbow and wrist
+ * place the point and tilt, while roll and gripper do not move it and pass
+ * straight through to the command.
+ *
+ * Closed form first: the base faces the target (or turns away from it and
+ * the arm reaches back over), the wrist link is subtracted along the tilt,
+ * and the shoulder-elbow pair is a two-link arm with elbow up and elbow
+ * down. Of the up to four branches, the one within the joint limits
+ * closest to the seed wins, so consecutive solves from the previous
+ * solution never flip branch.
+ *
+ * When no branch is within the limits, or the target is out of reach,
+ * damped least squares on armJacobian() takes over from the nearest
+ * branch (or the seed), with every step clamped to the limits. It returns
+ * the closest pose it finds, and says so in the result.
+ */
+
+#ifndef ARM_IK_H
+#define ARM_IK_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "hardware/kinematics/arm_kinematics.h"
+
+namespace shoplifter {
+
+enum class IkStatus : uint8_t {
+  kAnalytic,      // closed-form branch within the limits
+  kIterative,     // damped least squares reached the tolerance within the limits
+  kApproximate,   // out of reach or blocked by the limits: the closest pose found
+};
+
+struct IkOptions {
+  ArmJointLimits limits;
+  double tiltWeight = 100.0;       // mm of position error weighing as much as 1 rad of tilt
+  double tolerance = 1e-3;         // Weighted error (mm) the iterative solver stops at
+  double damping = 5.0;            // Damped least squares lambda, mm
+  uint32_t maxIterations = 50;
+};
+
+struct IkResult {
+  IkStatus status = IkStatus::kApproximate;
+  uint32_t iterations = 0;         // Damped least squares steps, 0 for kAnalytic
+  double positionError = 0.0;      // mm, from the target point
+  double tiltError = 0.0;          // radians
+};
+
+class ArmIkSolver {
+ public:
+  /**
+   * @throws std::invalid_argument if a limit range is empty, or tiltWeight,
+   *         tolerance or damping is not positive
+   */
+  explicit ArmIkSolver(const IkOptions& options = IkOptions());
+
+  /**
+   * Solve one target
+   *
+   * @param target Point (mm) and tilt (radians)
+   * @param seed kKinematicJointCount angles to stay close to, usually the
+   *             previous solution or the measured joints
+   * @param joints Filled with kKinematicJointCount angles, always within
+   *               the limits; may be the same array as seed
+   */
+  IkResult solve(const ArmPose& target, const double* seed, double* joints) const;
+
+  /**
+   * Solve a trajectory, each target seeded with the previous solution
+   *
+   * @param seed Seed of the first target
+   * @param joints count x kKinematicJointCount, row-major
+   * @param results count results, or nullptr
+   */
+  void solveSequence(const ArmPose* targets, size_t count, const double* seed, double* joints,
+                     IkResult* results) const;
+
+  /**
+   * Solve independent targets, each with its own seed
+   *
+   * @param seeds count x kKinematicJointCount; may be joints, to warm start
+   *              every target from its solution of the previous cycle
+   */
+  void solveBatch(const ArmPose* targets, size_t count, const double* seeds, double* joints,
+                  IkResult* results) const;
+
+  /**
+   * Every closed-form branch, within the limits or not, angles wrapped into
+   * the limits where a turn of 2 pi allows
+   *
+   * @param seed Used for the base angle when the target is on the base axis
+   * @return Number of branches written to solutions, at most 4
+   */
+  size_t analyticSolutions(const ArmPose& target, const double* seed,
+                           double solutions[4][kKinematicJointCount]) const;
+
+  const IkOptions& options() const { return options_; }
+
+ private:
+  uint32_t refine(const ArmPose& target, double* joints) const;
+  double violation(const double* joints) const;
+  IkResult measure(const ArmPose& target, const double* joints) const;
+
+  IkOptions options_;
+};
+
+}  // namespace shoplifter
+
+#endif // ARM_IK_H
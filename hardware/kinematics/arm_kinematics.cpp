@@ -0,0 +1,118 @@
+/**
+ * RoArm-M3 Forward Kinematics
+ */
+
+#include "hardware/kinematics/arm_kinematics.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "models/transformer/simd.h"
+
+namespace shoplifter {
+
+namespace {
+
+using namespace simd;
+
+// Poses i .. i + kFloatLanes - 1
+inline void forwardBlock(const JointColumns& joints, size_t i, const PoseColumns& poses) {
+  VecF sb, cb, s1, c1, s2, c2, s3, c3;
+  const VecF shoulder = load(joints.shoulder + i);
+  const VecF forearm = add(shoulder, load(joints.elbow + i));
+  const VecF hand = add(forearm, load(joints.wrist + i));
+  sincos(load(joints.base + i), sb, cb);
+  sincos(shoulder, s1, c1);
+  sincos(forearm, s2, c2);
+  sincos(hand, s3, c3);
+  // In the arm's vertical plane: r outward, z up
+  VecF r = fma(broadcast(static_cast<float>(kArmL2A)), s1, mul(broadcast(static_cast<float>(kArmL2B)), c1));
+  VecF z = fma(broadcast(static_cast<float>(kArmL2A)), c1, mul(broadcast(static_cast<float>(-kArmL2B)), s1));
+  r = fma(broadcast(static_cast<float>(kArmL3A)), s2, r);
+  z = fma(broadcast(static_cast<float>(kArmL3A)), c2, z);
+  r = fma(broadcast(static_cast<float>(kArmL4A)), s3, fma(broadcast(static_cast<float>(kArmL4B)), c3, r));
+  z = fma(broadcast(static_cast<float>(kArmL4A)), c3, fma(broadcast(static_cast<float>(-kArmL4B)), s3, z));
+  store(poses.x + i, mul(r, cb));
+  store(poses.y + i, mul(r, sb));
+  store(poses.z + i, z);
+  store(poses.tilt + i, sub(hand, broadcast(static_cast<float>(M_PI / 2))));
+}
+
+}  // namespace
+
+ArmPose forwardKinematics(const double* joints) {
+  const double shoulder = joints[1];
+  const double forearm = shoulder + joints[2];
+  const double hand = forearm + joints[3];
+  const double r = kArmL2A * std::sin(shoulder) + kArmL2B * std::cos(shoulder) + kArmL3A * std::sin(forearm) +
+                   kArmL4A * std::sin(hand) + kArmL4B * std::cos(hand);
+  const double z = kArmL2A * std::cos(shoulder) - kArmL2B * std::sin(shoulder) + kArmL3A * std::cos(forearm) +
+                   kArmL4A * std::cos(hand) - kArmL4B * std::sin(hand);
+  ArmPose pose;
+  pose.x = r * std::cos(joints[0]);
+  pose.y = r * std::sin(joints[0]);
+  pose.z = z;
+  pose.tilt = hand - M_PI / 2;
+  return pose;
+}
+
+ArmPose armJacobian(const double* joints, double jacobian[4][kKinematicJointCount]) {
+  const double shoulder = joints[1];
+  const double forearm = shoulder + joints[2];
+  const double hand = forearm + joints[3];
+  const double ss = std::sin(shoulder), cs = std::cos(shoulder);
+  const double sf = std::sin(forearm), cf = std::cos(forearm);
+  const double sh = std::sin(hand), ch = std::cos(hand);
+  const double sb = std::sin(joints[0]), cb = std::cos(joints[0]);
+  // Radius and height contributed by the wrist link, the forearm onwards, and the whole arm
+  const double rHand = kArmL4A * sh + kArmL4B * ch;
+  const double zHand = kArmL4A * ch - kArmL4B * sh;
+  const double rForearm = kArmL3A * sf + rHand;
+  const double zForearm = kArmL3A * cf + zHand;
+  const double r = kArmL2A * ss + kArmL2B * cs + rForearm;
+  const double z = kArmL2A * cs - kArmL2B * ss + zForearm;
+  // Rotating a joint turns everything after it: dr = z dq, dz = -r dq
+  const double dr[3] = {z, zForearm, zHand};
+  const double dz[3] = {-r, -rForearm, -rHand};
+  ArmPose pose;
+  pose.x = r * cb;
+  pose.y = r * sb;
+  pose.z = z;
+  pose.tilt = hand - M_PI / 2;
+  jacobian[0][0] = -pose.y;
+  jacobian[1][0] = pose.x;
+  jacobian[2][0] = 0.0;
+  jacobian[3][0] = 0.0;
+  for (size_t j = 0; j < 3; j++) {
+    jacobian[0][j + 1] = dr[j] * cb;
+    jacobian[1][j + 1] = dr[j] * sb;
+    jacobian[2][j + 1] = dz[j];
+    jacobian[3][j + 1] = 1.0;
+  }
+  return pose;
+}
+
+void forwardKinematicsBatch(const JointColumns& joints, size_t count, const PoseColumns& poses) {
+  size_t i = 0;
+  for (; i + kFloatLanes <= count; i += kFloatLanes) {
+    forwardBlock(joints, i, poses);
+  }
+  if (i == count) {
+    return;
+  }
+  // Tail: padded copies through the same lanes, so every pose gets identical arithmetic
+  const size_t rest = count - i;
+  float in[4][kFloatLanes] = {};
+  float out[4][kFloatLanes];
+  std::copy(joints.base + i, joints.base + count, in[0]);
+  std::copy(joints.shoulder + i, joints.shoulder + count, in[1]);
+  std::copy(joints.elbow + i, joints.elbow + count, in[2]);
+  std::copy(joints.wrist + i, joints.wrist + count, in[3]);
+  forwardBlock({in[0], in[1], in[2], in[3]}, 0, {out[0], out[1], out[2], out[3]});
+  std::copy(out[0], out[0] + rest, poses.x + i);
+  std::copy(out[1], out[1] + rest, poses.y + i);
+  std::copy(out[2], out[2] + rest, poses.z + i);
+  std::copy(out[3], out[3] + rest, poses.tilt + i);
+}
+
+}  // namespace shoplifter
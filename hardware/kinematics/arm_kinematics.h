@@ -0,0 +1,115 @@
+/**
+ * RoArm-M3 Forward Kinematics
+ *
+ * End-effector pose from joint angles, with the link constants and frame
+ * of the firmware's RoArmM3_computePosbyJointRad(), which fills the
+ * lastX / lastY / lastZ / lastT values of every position report:
+ *
+ *   origin    on the shoulder axis, above the base; millimeters
+ *   upper arm l2A along the shoulder direction plus the l2B offset
+ *   forearm   l3A, at shoulder + elbow from vertical
+ *   wrist     ARM_L4_LENGTH_MM_A along, ARM_L4_LENGTH_MM_B below the
+ *             forearm-plus-wrist direction
+ *   tilt      shoulder + elbow + wrist - pi/2
+ *
+ * Roll and gripper do not move the reported point. At the firmware's
+ * initial pose (0, 0, pi/2, 0) the point is (l2B + l3A + L4A, 0, l2A - L4B).
+ *
+ * forwardKinematics() is the scalar double-precision reference, the
+ * firmware's arithmetic. forwardKinematicsBatch() evaluates columns of
+ * joint angles (structure of arrays, as in the episode format) in float
+ * SIMD lanes (models/transformer/simd.h) with polynomial sin/cos, for
+ * offline passes over recordings and for scoring planning candidates.
+ * armJacobian() is the analytic derivative of the same pose.
+ */
+
+#ifndef ARM_KINEMATICS_H
+#define ARM_KINEMATICS_H
+
+#include <cmath>
+#include <cstddef>
+
+namespace shoplifter {
+
+// Link lengths from the RoArm-M3 firmware, millimeters
+constexpr double kArmL2A = 236.82;  // l2A, ARM_L2_LENGTH_MM_A
+constexpr double kArmL2B = 30.00;   // l2B, ARM_L2_LENGTH_MM_B
+constexpr double kArmL3A = 144.49;  // l3A, ARM_L3_LENGTH_MM_A_0
+constexpr double kArmL4A = 67.85;   // ARM_L4_LENGTH_MM_A
+constexpr double kArmL4B = 5.98;    // ARM_L4_LENGTH_MM_B
+
+// Joints that place the end effector: base, shoulder, elbow, wrist
+constexpr size_t kKinematicJointCount = 4;
+
+/**
+ * Joint ranges, radians
+ *
+ * The defaults follow the RoArm-M3 specification (base 360, shoulder 180,
+ * elbow 225, wrist 180 degrees) in the firmware's zero positions.
+ */
+struct ArmJointLimits {
+  double lower[kKinematicJointCount] = {-M_PI, -M_PI / 2, -M_PI / 4, -M_PI / 2};
+  double upper[kKinematicJointCount] = {M_PI, M_PI / 2, M_PI, M_PI / 2};
+};
+
+/**
+ * End-effector point and tilt, as reported by the firmware
+ */
+struct ArmPose {
+  double x;                 // Millimeters
+  double y;
+  double z;
+  double tilt;              // Radians, 0 = level
+};
+
+/**
+ * Reference forward kinematics, double precision
+ *
+ * @param joints kKinematicJointCount angles in radians: base, shoulder,
+ *               elbow, wrist (the first four of the kArmJointCount command
+ *               order)
+ */
+ArmPose forwardKinematics(const double* joints);
+
+/**
+ * Pose and its Jacobian at one configuration
+ *
+ * @param joints kKinematicJointCount angles, radians
+ * @param jacobian Filled row-major: d(x, y, z, tilt) / d(base, shoulder,
+ *                 elbow, wrist), millimeters (tilt: radians) per radian
+ * @return forwardKinematics(joints)
+ */
+ArmPose armJacobian(const double* joints, double jacobian[4][kKinematicJointCount]);
+
+/**
+ * Joint angle columns, radians; each holds count values
+ */
+struct JointColumns {
+  const float* base;
+  const float* shoulder;
+  const float* elbow;
+  const float* wrist;
+};
+
+/**
+ * Pose columns to fill; each holds count values
+ */
+struct PoseColumns {
+  float* x;
+  float* y;
+  float* z;
+  float* tilt;
+};
+
+/**
+ * Forward kinematics of count joint configurations in SIMD lanes
+ *
+ * Within 1e-3 mm and a few 1e-6 rad (float rounding of the summed angles)
+ * of forwardKinematics() for angles within a few turns. Columns need no
+ * alignment.
+ */
+void forwardKinematicsBatch(const JointColumns& joints, size_t count, const PoseColumns& poses);
+
+}  // namespace shoplifter
+
+#endif // ARM_KINEMATICS_H
@@ -0,0 +1,145 @@
+/**
+ * Bimanual Collision Benchmark
+ *
+ * Random configuration pairs within the joint limits, for three workcells:
+ *
+ *   side      the arms 400 mm apart, facing the same way (default options)
+ *   facing    700 mm apart across a table, facing each other
+ *   apart     1000 mm apart, out of each other's reach
+ *
+ * Checks clearanceBatch() against the double-precision reference: within
+ * 0.01 mm where the reference is up to exactWithin, never above it where
+ * the broad phase settled the pair, and the same collision flag away from
+ * the margin. Then times the reference, clearanceBatch() on joint columns
+ * and clearanceRows() on interleaved rows (left and right joints of one
+ * state, as a rollout shard holds them), in pair queries per second.
+ *
+ * Usage:
+ *   bench_collision [--pairs N] [--seed S]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "hardware/kinematics/arm_collision.h"
+#include "models/transformer/simd.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t kJoints = kKinematicJointCount;
+constexpr size_t kRowStride = 12;      // Left joints at 0, right joints at 6
+constexpr size_t kChecked = 20000;     // Pairs compared with the reference
+constexpr double kTolerance = 0.01;    // mm
+
+struct Workcell {
+  const char* name;
+  BimanualOptions options;
+};
+
+double seconds(Clock::time_point t0) { return std::chrono::duration<double>(Clock::now() - t0).count(); }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t count = 1000000;
+  uint32_t seed = 1;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--pairs")) count = static_cast<size_t>(std::atol(next()));
+    else if (!std::strcmp(argv[i], "--seed")) seed = static_cast<uint32_t>(std::atoi(next()));
+    else {
+      std::fprintf(stderr, "Usage: %s [--pairs N] [--seed S]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  const ArmJointLimits limits;
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<double> joints(count * 2 * kJoints);
+  std::vector<float> columns(2 * kJoints * count);
+  std::vector<float> rows(count * kRowStride);
+  for (size_t i = 0; i < count; i++) {
+    for (size_t a = 0; a < 2; a++) {
+      for (size_t j = 0; j < kJoints; j++) {
+        const double q = limits.lower[j] + unit(rng) * (limits.upper[j] - limits.lower[j]);
+        joints[(i * 2 + a) * kJoints + j] = q;
+        columns[(a * kJoints + j) * count + i] = static_cast<float>(q);
+        rows[i * kRowStride + a * 6 + j] = static_cast<float>(q);
+      }
+    }
+  }
+  const float* c = columns.data();
+  const JointColumns left = {c, c + count, c + 2 * count, c + 3 * count};
+  const JointColumns right = {c + 4 * count, c + 5 * count, c + 6 * count, c + 7 * count};
+
+  Workcell cells[3] = {{"side", BimanualOptions()}, {"facing", BimanualOptions()}, {"apart", BimanualOptions()}};
+  cells[1].options.left = {0.0, 0.0, 0.0, 0.0};
+  cells[1].options.right = {700.0, 0.0, 0.0, M_PI};
+  cells[2].options.left = {0.0, 500.0, 0.0, 0.0};
+  cells[2].options.right = {0.0, -500.0, 0.0, 0.0};
+
+  std::printf("%zu random pairs per workcell (%s)\n", count, simd::kTargetName);
+  std::printf("%-8s %9s %8s %10s %10s %6s %11s %11s %11s\n", "cell", "colliding", "culled", "max err mm", "bound err",
+              "flags", "ref M/s", "batch M/s", "rows M/s");
+  bool ok = true;
+  std::vector<float> clearance(count), fromRows(count);
+  std::vector<uint8_t> collides(count);
+  for (const Workcell& cell : cells) {
+    const BimanualCollisionChecker checker(cell.options);
+    const size_t checked = std::min(count, kChecked);
+
+    auto t0 = Clock::now();
+    std::vector<double> reference(checked);
+    for (size_t i = 0; i < checked; i++) {
+      reference[i] = checker.clearance(&joints[i * 2 * kJoints], &joints[(i * 2 + 1) * kJoints]);
+    }
+    const double referenceRate = static_cast<double>(checked) / seconds(t0) * 1e-6;
+
+    t0 = Clock::now();
+    const CollisionBatchStats stats = checker.clearanceBatch(left, right, count, clearance.data(), collides.data());
+    const double batchRate = static_cast<double>(count) / seconds(t0) * 1e-6;
+
+    t0 = Clock::now();
+    checker.clearanceRows(rows.data(), rows.data() + 6, kRowStride, count, fromRows.data());
+    const double rowsRate = static_cast<double>(count) / seconds(t0) * 1e-6;
+
+    // Exact up to exactWithin, a lower bound beyond; flags agree outside the tolerance band around the margin
+    const double exactWithin = cell.options.exactWithin, margin = cell.options.margin;
+    double maxError = 0.0, boundError = 0.0;
+    size_t flagMismatches = 0;
+    for (size_t i = 0; i < checked; i++) {
+      const double r = reference[i], b = clearance[i];
+      if (r <= exactWithin) {
+        maxError = std::max(maxError, std::fabs(b - r));
+      }
+      boundError = std::max(boundError, b - r);
+      if (std::fabs(r - margin) > kTolerance) {
+        flagMismatches += (r < margin) != (collides[i] != 0);
+      }
+    }
+    const bool rowsMatch = std::equal(clearance.begin(), clearance.end(), fromRows.begin());
+
+    std::printf("%-8s %8.2f%% %7.1f%% %10.2e %10.2e %6zu %11.2f %11.2f %11.2f%s\n", cell.name,
+                100.0 * static_cast<double>(stats.colliding) / static_cast<double>(count),
+                100.0 * static_cast<double>(stats.culled) / static_cast<double>(count), maxError, boundError,
+                flagMismatches, referenceRate, batchRate, rowsRate, checker.canCollide() ? "" : "  (cannot collide)");
+    ok = ok && maxError < kTolerance && boundError < kTolerance && flagMismatches == 0 && rowsMatch;
+  }
+
+  if (!ok) {
+    std::fprintf(stderr, "collision check failed\n");
+    return 1;
+  }
+  return 0;
+}
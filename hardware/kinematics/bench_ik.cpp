@@ -0,0 +1,174 @@
+/**
+ * Inverse Kinematics Benchmark
+ *
+ * Checks, then times, ArmIkSolver on:
+ *
+ *   reachable   poses of random configurations within the limits, seeded
+ *               near the true configuration (warm) and from the firmware's
+ *               initial pose (cold); every target must be solved exactly
+ *   blocked     poses of configurations just outside the wrist limits, so
+ *               no closed-form branch is allowed and damped least squares
+ *               finds the closest pose within the limits
+ *   unreachable points beyond the arm's reach
+ *   trajectory  a Cartesian circle solved with solveSequence(), against
+ *               solving every point from an unrelated random seed: warm
+ *               starts must never flip branch between consecutive points
+ *
+ * Every returned configuration must be within the joint limits.
+ *
+ * Usage:
+ *   bench_ik [--targets N] [--seed S]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "hardware/kinematics/arm_ik.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t kJoints = kKinematicJointCount;
+constexpr double kInitialPose[kJoints] = {0.0, 0.0, M_PI / 2, 0.0};
+constexpr size_t kCirclePoints = 1000;
+
+struct Summary {
+  size_t counts[3] = {};           // Per IkStatus
+  double maxPositionError = 0.0;   // Over kAnalytic and kIterative results
+  double maxTiltError = 0.0;
+  double meanIterations = 0.0;
+  double usPerSolve = 0.0;
+  size_t outsideLimits = 0;
+};
+
+Summary run(const ArmIkSolver& solver, const std::vector<ArmPose>& targets, const std::vector<double>& seeds) {
+  const size_t n = targets.size();
+  std::vector<double> joints(n * kJoints);
+  std::vector<IkResult> results(n);
+  const auto t0 = Clock::now();
+  solver.solveBatch(targets.data(), n, seeds.data(), joints.data(), results.data());
+  const double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+  Summary s;
+  s.usPerSolve = seconds * 1e6 / static_cast<double>(n);
+  const ArmJointLimits& limits = solver.options().limits;
+  for (size_t i = 0; i < n; i++) {
+    const IkResult& r = results[i];
+    s.counts[static_cast<int>(r.status)]++;
+    s.meanIterations += r.iterations;
+    if (r.status != IkStatus::kApproximate) {
+      s.maxPositionError = std::max(s.maxPositionError, r.positionError);
+      s.maxTiltError = std::max(s.maxTiltError, r.tiltError);
+    }
+    for (size_t j = 0; j < kJoints; j++) {
+      const double q = joints[i * kJoints + j];
+      s.outsideLimits += q < limits.lower[j] || q > limits.upper[j];
+    }
+  }
+  s.meanIterations /= static_cast<double>(n);
+  return s;
+}
+
+void print(const char* name, const Summary& s) {
+  std::printf("%-12s %9zu %9zu %11zu %12.2e %10.2e %8.1f %9.3f\n", name, s.counts[0], s.counts[1], s.counts[2],
+              s.maxPositionError, s.maxTiltError, s.meanIterations, s.usPerSolve);
+}
+
+// Largest joint change between consecutive rows
+double maxJump(const std::vector<double>& joints) {
+  double worst = 0.0;
+  for (size_t i = kJoints; i < joints.size(); i++) worst = std::max(worst, std::fabs(joints[i] - joints[i - kJoints]));
+  return worst;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t count = 200000;
+  uint32_t seed = 1;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--targets")) count = static_cast<size_t>(std::atol(next()));
+    else if (!std::strcmp(argv[i], "--seed")) seed = static_cast<uint32_t>(std::atoi(next()));
+    else {
+      std::fprintf(stderr, "Usage: %s [--targets N] [--seed S]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  const ArmIkSolver solver;
+  const ArmJointLimits& limits = solver.options().limits;
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::normal_distribution<double> nudge(0.0, 0.05);
+
+  std::vector<double> truth(count * kJoints), warm(count * kJoints), cold(count * kJoints);
+  std::vector<ArmPose> reachable(count), blocked(count), unreachable(count);
+  for (size_t i = 0; i < count; i++) {
+    double* q = &truth[i * kJoints];
+    for (size_t j = 0; j < kJoints; j++) {
+      q[j] = limits.lower[j] + unit(rng) * (limits.upper[j] - limits.lower[j]);
+      warm[i * kJoints + j] = std::min(limits.upper[j], std::max(limits.lower[j], q[j] + nudge(rng)));
+      cold[i * kJoints + j] = kInitialPose[j];
+    }
+    reachable[i] = forwardKinematics(q);
+    double outside[kJoints] = {q[0], q[1], q[2], unit(rng) < 0.5 ? limits.lower[3] - 0.3 : limits.upper[3] + 0.3};
+    blocked[i] = forwardKinematics(outside);
+    const double radius = 520.0 + 200.0 * unit(rng);
+    const double azimuth = 2.0 * M_PI * unit(rng), elevation = M_PI * (unit(rng) - 0.5);
+    unreachable[i] = {radius * std::cos(elevation) * std::cos(azimuth), radius * std::cos(elevation) * std::sin(azimuth),
+                      radius * std::sin(elevation), 0.0};
+  }
+
+  std::printf("%zu targets per case\n", count);
+  std::printf("%-12s %9s %9s %11s %12s %10s %8s %9s\n", "case", "analytic", "iterative", "approximate", "max err mm",
+              "tilt rad", "steps", "us/solve");
+  const Summary warmSummary = run(solver, reachable, warm);
+  const Summary coldSummary = run(solver, reachable, cold);
+  const Summary blockedSummary = run(solver, blocked, warm);
+  const Summary unreachableSummary = run(solver, unreachable, warm);
+  print("warm", warmSummary);
+  print("cold", coldSummary);
+  print("blocked", blockedSummary);
+  print("unreachable", unreachableSummary);
+
+  // A level 60 mm circle high above the base, gripper 1 rad down: two branches are within the limits all round
+  std::vector<ArmPose> circle(kCirclePoints);
+  for (size_t i = 0; i < kCirclePoints; i++) {
+    const double a = 2.0 * M_PI * static_cast<double>(i) / kCirclePoints;
+    circle[i] = {150.0 + 60.0 * std::cos(a), 60.0 * std::sin(a), 300.0, -1.0};
+  }
+  std::vector<double> sequenced(kCirclePoints * kJoints), independent(kCirclePoints * kJoints);
+  std::vector<IkResult> results(kCirclePoints);
+  const auto t0 = Clock::now();
+  solver.solveSequence(circle.data(), kCirclePoints, kInitialPose, sequenced.data(), results.data());
+  const double sequenceUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / kCirclePoints;
+  for (size_t i = 0; i < kCirclePoints; i++) {
+    solver.solve(circle[i], &truth[(i % count) * kJoints], &independent[i * kJoints]);
+  }
+  size_t exact = 0;
+  for (const IkResult& r : results) exact += r.status != IkStatus::kApproximate;
+  std::printf("trajectory: %zu/%zu solved, %.3f us/solve, largest joint step %.4f rad warm, %.4f rad random seeds\n", exact,
+              kCirclePoints, sequenceUs, maxJump(sequenced), maxJump(independent));
+
+  bool ok = true;
+  for (const Summary* s : {&warmSummary, &coldSummary, &blockedSummary, &unreachableSummary}) {
+    ok = ok && s->outsideLimits == 0 && s->maxPositionError < 1e-3 && s->maxTiltError < 1e-5;
+  }
+  ok = ok && warmSummary.counts[2] == 0 && coldSummary.counts[2] == 0 && unreachableSummary.counts[0] == 0;
+  ok = ok && exact == kCirclePoints && maxJump(sequenced) < 0.05;
+  if (!ok) {
+    std::fprintf(stderr, "inverse kinematics check failed\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,195 @@
+/**
+ * Forward Kinematics Benchmark
+ *
+ * Checks, then times, the RoArm-M3 forward kinematics:
+ *
+ *   firmware   the initial pose from RoArm-M3_example_with_feedback.ino,
+ *              and with recordings given, the x / y / z / tilt the firmware
+ *              reported for each sample against forwardKinematics()
+ *   batch      forwardKinematicsBatch() against forwardKinematics() on
+ *              random joint angles
+ *   jacobian   armJacobian() against central differences of forwardKinematics()
+ *   speed      poses per second of the scalar reference, and of the batch
+ *              on cache-resident columns and on columns streamed from memory
+ *
+ * Usage:
+ *   bench_kinematics [--samples N] [--budget-ms MS] [recording.jsonl ...]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "hardware/kinematics/arm_kinematics.h"
+#include "hardware/telemetry/position_parser.h"
+#include "models/transformer/simd.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t kCachedPoses = 4096;    // 128 KiB of columns, in L2
+
+struct Columns {
+  simd::AlignedFloats base, shoulder, elbow, wrist, x, y, z, tilt;
+
+  explicit Columns(size_t n) : base(n), shoulder(n), elbow(n), wrist(n), x(n), y(n), z(n), tilt(n) {}
+  JointColumns joints() const { return {base.data(), shoulder.data(), elbow.data(), wrist.data()}; }
+  PoseColumns poses() { return {x.data(), y.data(), z.data(), tilt.data()}; }
+};
+
+void randomJoints(Columns& c, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> angle(static_cast<float>(-M_PI), static_cast<float>(M_PI));
+  for (size_t i = 0; i < c.base.size(); i++) {
+    c.base[i] = angle(rng);
+    c.shoulder[i] = angle(rng);
+    c.elbow[i] = angle(rng);
+    c.wrist[i] = angle(rng);
+  }
+}
+
+// Poses per second of fn(), which evaluates posesPerCall poses, over about budgetMs
+template <typename Fn>
+double posesPerSecond(Fn&& fn, size_t posesPerCall, double budgetMs) {
+  fn();
+  size_t calls = 0;
+  const auto start = Clock::now();
+  double elapsed = 0.0;
+  while (elapsed * 1e3 < budgetMs) {
+    fn();
+    calls++;
+    elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  }
+  return static_cast<double>(calls * posesPerCall) / elapsed;
+}
+
+struct PoseErrors {
+  size_t samples = 0;
+  double position = 0.0;      // Max Euclidean distance, mm
+  double tilt = 0.0;          // Max, radians
+};
+
+void compare(PoseErrors& errors, const ArmPose& expected, double x, double y, double z, double tilt) {
+  errors.samples++;
+  errors.position = std::max(errors.position, std::sqrt((expected.x - x) * (expected.x - x) +
+                                                       (expected.y - y) * (expected.y - y) +
+                                                       (expected.z - z) * (expected.z - z)));
+  errors.tilt = std::max(errors.tilt, std::fabs(expected.tilt - tilt));
+}
+
+// Firmware-reported poses of every sample in a .jsonl recording
+PoseErrors checkRecording(const char* path) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "Cannot read %s\n", path);
+    std::exit(1);
+  }
+  PoseErrors errors;
+  std::string line;
+  PositionSample s;
+  while (std::getline(in, line)) {
+    if (!parsePositionLine(line.data(), line.size(), s)) continue;
+    const double joints[] = {s.b, s.s, s.e, s.t};
+    compare(errors, forwardKinematics(joints), s.x, s.y, s.z, s.tilt);
+  }
+  return errors;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t samples = 1 << 20;
+  double budgetMs = 500.0;
+  std::vector<const char*> recordings;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--samples")) samples = static_cast<size_t>(std::atol(next()));
+    else if (!std::strcmp(argv[i], "--budget-ms")) budgetMs = std::atof(next());
+    else recordings.push_back(argv[i]);
+  }
+  if (samples < kCachedPoses) samples = kCachedPoses;
+
+  // The firmware's initial move: RoArmM3_allPosAbsBesselCtrl(l2B + l3A + L4A, 0, l2A - L4B, 0, ...)
+  const double home[] = {0.0, 0.0, M_PI / 2, 0.0};
+  PoseErrors homeErrors;
+  compare(homeErrors, forwardKinematics(home), kArmL2B + kArmL3A + kArmL4A, 0.0, kArmL2A - kArmL4B, 0.0);
+  std::printf("initial pose: %.2e mm, %.2e rad\n", homeErrors.position, homeErrors.tilt);
+  bool ok = homeErrors.position < 1e-9 && homeErrors.tilt < 1e-12;
+
+  for (const char* path : recordings) {
+    const PoseErrors e = checkRecording(path);
+    std::printf("%s: %zu samples, firmware vs reference %.3f mm, %.2e rad\n", path, e.samples, e.position, e.tilt);
+    ok = ok && e.position < 0.01 && e.tilt < 1e-4;  // The firmware reports rounded doubles
+  }
+
+  Columns c(samples);
+  randomJoints(c, 7);
+  forwardKinematicsBatch(c.joints(), samples - 3, c.poses());  // Odd count: exercises the tail
+  PoseErrors batchErrors;
+  for (size_t i = 0; i < samples - 3; i++) {
+    const double joints[] = {c.base[i], c.shoulder[i], c.elbow[i], c.wrist[i]};
+    compare(batchErrors, forwardKinematics(joints), c.x[i], c.y[i], c.z[i], c.tilt[i]);
+  }
+  std::printf("batch (%s) vs reference, %zu poses: %.2e mm, %.2e rad\n", simd::kTargetName, batchErrors.samples,
+              batchErrors.position, batchErrors.tilt);
+  ok = ok && batchErrors.position < 1e-3 && batchErrors.tilt < 4e-6;
+
+  double jacobianError = 0.0;
+  for (size_t i = 0; i < 1000; i++) {
+    double joints[kKinematicJointCount] = {c.base[i], c.shoulder[i], c.elbow[i], c.wrist[i]};
+    double jac[4][kKinematicJointCount];
+    armJacobian(joints, jac);
+    for (size_t j = 0; j < kKinematicJointCount; j++) {
+      const double h = 1e-6;
+      const double q = joints[j];
+      joints[j] = q + h;
+      const ArmPose plus = forwardKinematics(joints);
+      joints[j] = q - h;
+      const ArmPose minus = forwardKinematics(joints);
+      joints[j] = q;
+      const double numeric[4] = {(plus.x - minus.x) / (2 * h), (plus.y - minus.y) / (2 * h),
+                                 (plus.z - minus.z) / (2 * h), (plus.tilt - minus.tilt) / (2 * h)};
+      for (size_t r = 0; r < 4; r++) jacobianError = std::max(jacobianError, std::fabs(numeric[r] - jac[r][j]));
+    }
+  }
+  std::printf("jacobian vs central differences: %.2e\n", jacobianError);
+  ok = ok && jacobianError < 1e-4;
+
+  std::vector<ArmPose> scalarOut(kCachedPoses);
+  const double scalar = posesPerSecond(
+      [&] {
+        for (size_t i = 0; i < kCachedPoses; i++) {
+          const double joints[] = {c.base[i], c.shoulder[i], c.elbow[i], c.wrist[i]};
+          scalarOut[i] = forwardKinematics(joints);
+        }
+      },
+      kCachedPoses, budgetMs);
+  const double cached = posesPerSecond([&] { forwardKinematicsBatch(c.joints(), kCachedPoses, c.poses()); },
+                                       kCachedPoses, budgetMs);
+  const double streamed =
+      posesPerSecond([&] { forwardKinematicsBatch(c.joints(), samples, c.poses()); }, samples, budgetMs);
+  char label[64];
+  std::printf("%-36s %10s\n", "one core", "M poses/s");
+  std::printf("%-36s %10.1f\n", "scalar double reference", scalar * 1e-6);
+  std::snprintf(label, sizeof(label), "batch, %zu poses (L2)", kCachedPoses);
+  std::printf("%-36s %10.1f\n", label, cached * 1e-6);
+  std::snprintf(label, sizeof(label), "batch, %zu poses (%.0f MiB)", samples,
+                static_cast<double>(samples) * 32.0 / (1 << 20));
+  std::printf("%-36s %10.1f\n", label, streamed * 1e-6);
+
+  if (!ok) {
+    std::fprintf(stderr, "forward kinematics check failed\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,89 @@
+/**
+ * Small Symmetric Matrix Routines
+ *
+ * Dense N x N helpers for the damped least-squares steps of the kinematics:
+ * the 4x4 systems (J W J^T + lambda^2 I) of the IK solver (arm_ik.cpp) and
+ * the Cartesian velocity controller (cartesian_velocity.cpp). Both work in
+ * place on stack arrays; N is a compile-time constant, so the loops unroll.
+ */
+
+#ifndef SMALL_LINALG_H
+#define SMALL_LINALG_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace shoplifter {
+
+/**
+ * Solve the symmetric positive definite a x = b in place (Cholesky)
+ *
+ * @param a Overwritten with its Cholesky factor (lower triangle)
+ * @param b Right-hand side; becomes x
+ */
+template <size_t N>
+inline void choleskySolve(double a[][N], double* b) {
+  for (size_t j = 0; j < N; j++) {
+    double d = a[j][j];
+    for (size_t k = 0; k < j; k++) d -= a[j][k] * a[j][k];
+    a[j][j] = std::sqrt(d);
+    for (size_t i = j + 1; i < N; i++) {
+      double s = a[i][j];
+      for (size_t k = 0; k < j; k++) s -= a[i][k] * a[j][k];
+      a[i][j] = s / a[j][j];
+    }
+  }
+  for (size_t i = 0; i < N; i++) {
+    for (size_t k = 0; k < i; k++) b[i] -= a[i][k] * b[k];
+    b[i] /= a[i][i];
+  }
+  for (size_t i = N; i-- > 0;) {
+    for (size_t k = i + 1; k < N; k++) b[i] -= a[k][i] * b[k];
+    b[i] /= a[i][i];
+  }
+}
+
+/**
+ * Smallest eigenvalue of a symmetric matrix (cyclic Jacobi rotations)
+ *
+ * @param a Overwritten; ends up (nearly) diagonal
+ */
+template <size_t N>
+inline double smallestEigenvalue(double a[][N]) {
+  for (int sweep = 0; sweep < 10; sweep++) {
+    double off = 0.0, diag = 0.0;
+    for (size_t p = 0; p < N; p++) {
+      diag += a[p][p] * a[p][p];
+      for (size_t q = p + 1; q < N; q++) off += a[p][q] * a[p][q];
+    }
+    if (off <= 1e-24 * diag) {
+      break;
+    }
+    for (size_t p = 0; p < N; p++) {
+      for (size_t q = p + 1; q < N; q++) {
+        if (a[p][q] == 0.0) continue;
+        const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+        const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+        const double c = 1.0 / std::sqrt(t * t + 1.0), s = t * c;
+        for (size_t k = 0; k < N; k++) {
+          const double kp = a[k][p], kq = a[k][q];
+          a[k][p] = c * kp - s * kq;
+          a[k][q] = s * kp + c * kq;
+        }
+        for (size_t k = 0; k < N; k++) {
+          const double pk = a[p][k], qk = a[q][k];
+          a[p][k] = c * pk - s * qk;
+          a[q][k] = s * pk + c * qk;
+        }
+      }
+    }
+  }
+  double smallest = a[0][0];
+  for (size_t p = 1; p < N; p++) smallest = std::min(smallest, a[p][p]);
+  return smallest;
+}
+
+}  // namespace shoplifter
+
+#endif // SMALL_LINALG_H
@@ -16,7 +16,7 @@ import time
 from datetime import datetime
 
 
-def read_follower_positions(port, output_file=None, duration=None):
+def read_follower_positions(port, output_file=None, duration=None, flush_interval=0.5):
     """
     Read position data from the follower arm via the specified serial port.
     
@@ -24,6 +24,7 @@ def read_follower_positions(port, output_file=None, duration=None):
         port: Serial port device name
         output_file: Optional file to save position data
         duration: Optional duration in seconds to read data (None for indefinite)
+        flush_interval: Seconds between output file flushes (group commit)
     """
     # Open serial port
     ser = serial.Serial(port, 115200, timeout=1)
@@ -37,6 +38,7 @@ def read_follower_positions(port, output_file=None, duration=None):
     
     # Set start time if duration specified
     start_time = time.time()
+    last_flush = start_time
     
     try:
         print("Receiving position data (Ctrl+C to stop)...")
@@ -65,10 +67,12 @@ def read_follower_positions(port, output_file=None, duration=None):
                 # Display data
                 print(f"{data['t']}\t{data['b']:.2f}\t{data['s']:.2f}\t{data['e']:.2f}\t{data['t']:.2f}\t{data['r']:.2f}\t{data['g']:.2f}")
                 
-                # Save data if output file specified
+                # Save data if output file specified; flush in groups, not per sample
                 if out_file:
                     out_file.write(json.dumps(data) + '\n')
-                    out_file.flush()
+                    if data['host_time'] - last_flush >= flush_interval:
+                        out_file.flush()
+                        last_flush = data['host_time']
                 
             except json.JSONDecodeError:
                 print(f"Invalid JSON: {line}")
@@ -92,7 +96,8 @@ if __name__ == "__main__":
     parser.add_argument("--port", default="/dev/ttyUSB0", help="Serial port device")
     parser.add_argument("--output", help="Output file to save position data (JSONL format)")
     parser.add_argument("--duration", type=float, help="Duration in seconds to read data")
+    parser.add_argument("--flush-interval", type=float, default=0.5, help="Seconds between output file flushes")
     args = parser.parse_args()
     
     # Read positions
-    read_follower_positions(args.port, args.output, args.duration)
\ No newline at end of file
+    read_follower_positions(args.port, args.output, args.duration, args.flush_interval)
\ No newline at end of file
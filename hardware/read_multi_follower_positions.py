@@ -6,8 +6,14 @@ This script automatically detects and reads position data from multiple RoArm-M3
 follower arms, distinguishing them by their arm_id. It can handle both follower_left
 and follower_right arms connected to the same computer.
 
+Ports are probed concurrently with an identity query, and the USB serial number
+of each arm is cached. Restarts use the cached entries without probing; only
+uncached ports are probed, plus a cached port that cannot be opened or whose
+telemetry carries a different arm_id, which is re-probed and re-cached.
+--rescan ignores the cache and probes every port.
+
 Usage:
-  python3 read_multi_follower_positions.py [--output folder_path]
+  python3 read_multi_follower_positions.py [--output folder_path] [--rescan]
 """
 
 import argparse
@@ -18,13 +24,52 @@ import serial.tools.list_ports
 import sys
 import threading
 import time
+from concurrent.futures import ThreadPoolExecutor
 from datetime import datetime
 
 
-def detect_arm(port, timeout=2.0):
+# Cache of USB serial number -> arm_id, rewritten after every scan
+DEFAULT_CACHE_PATH = os.path.join(os.path.expanduser("~"), ".cache", "shop-lifter", "arm_ports.json")
+
+# Identity query command understood by the follower firmware (CMD_GET_ARM_IDENTITY)
+IDENTITY_QUERY = b'{"T":401}\n'
+
+# Serializes cache rewrites from reader threads re-probing a port
+_cache_lock = threading.Lock()
+
+
+def open_serial(port, timeout=1):
+    """
+    Open a serial port without toggling DTR/RTS.
+    
+    The ESP32 auto-reset circuit reboots the arm on the DTR/RTS edge that
+    pyserial produces by default, which would cost several seconds of boot
+    time before the arm can answer.
+    
+    Args:
+        port: Serial port device name
+        timeout: Read timeout in seconds
+        
+    Returns:
+        Open serial.Serial instance
+    """
+    ser = serial.Serial()
+    ser.port = port
+    ser.baudrate = 115200
+    ser.timeout = timeout
+    ser.dtr = False
+    ser.rts = False
+    ser.open()
+    return ser
+
+
+def detect_arm(port, timeout=0.25):
     """
     Detect if the specified port has a RoArm-M3 follower arm and identify it.
     
+    Sends an identity query and waits for the reply. Position reports that
+    happen to arrive first are accepted as well, since they carry the arm_id.
+    
     Args:
         port: Serial port to check
         timeout: Time limit for detection in seconds
@@ -34,83 +79,217 @@ def detect_arm(port, timeout=2.0):
     """
     try:
         # Open serial port
-        ser = serial.Serial(port, 115200, timeout=0.1)
-        
-        # Set start time for timeout
-        start_time = time.time()
+        ser = open_serial(port, timeout=0.02)
+    except (serial.SerialException, OSError):
+        # Port couldn't be opened or is not available
+        return None
+    
+    try:
+        # Drop stale bytes and ask the arm who it is
+        ser.reset_input_buffer()
+        ser.write(IDENTITY_QUERY)
         
-        # Try to read data until timeout
-        while time.time() - start_time < timeout:
-            try:
-                line = ser.readline().decode('utf-8').strip()
-                if not line:
-                    time.sleep(0.01)  # Short sleep to avoid busy waiting
+        # Read replies until timeout; a reply can straddle two reads, so only
+        # complete newline-terminated lines are parsed
+        deadline = time.time() + timeout
+        buffer = b""
+        while time.time() < deadline:
+            chunk = ser.read(max(1, ser.in_waiting))
+            if not chunk:
+                continue
+            *lines, buffer = (buffer + chunk).split(b"\n")
+            for raw in lines:
+                try:
+                    data = json.loads(raw.decode('utf-8'))
+                except (ValueError, UnicodeDecodeError):
+                    # Not valid JSON or UTF-8, continue
                     continue
-                    
-                # Try to parse as JSON
-                data = json.loads(line)
                 
                 # Check if it has arm_id field
-                if 'arm_id' in data:
-                    arm_id = data['arm_id']
-                    ser.close()
-                    return arm_id
-                    
-            except json.JSONDecodeError:
-                # Not valid JSON, continue
-                pass
-            except UnicodeDecodeError:
-                # Not valid UTF-8, continue
-                pass
+                if isinstance(data, dict) and 'arm_id' in data:
+                    return data['arm_id']
             
-        # Close port if no arm detected
-        ser.close()
+        # No arm detected
         return None
         
-    except serial.SerialException:
-        # Port couldn't be opened or is not available
+    except (serial.SerialException, OSError):
         return None
+    finally:
+        ser.close()
+
+
+def load_port_cache(cache_path=DEFAULT_CACHE_PATH):
+    """
+    Load the USB serial number to arm_id cache.
+    
+    Args:
+        cache_path: Path of the JSON cache file
+        
+    Returns:
+        Dictionary mapping USB serial numbers to arm IDs (empty if missing)
+    """
+    try:
+        with open(cache_path) as f:
+            cache = json.load(f)
+        return cache if isinstance(cache, dict) else {}
+    except (OSError, ValueError):
+        return {}
+
+
+def save_port_cache(cache, cache_path=DEFAULT_CACHE_PATH):
+    """
+    Save the USB serial number to arm_id cache atomically.
+    
+    Args:
+        cache: Dictionary mapping USB serial numbers to arm IDs
+        cache_path: Path of the JSON cache file
+    """
+    try:
+        os.makedirs(os.path.dirname(cache_path), exist_ok=True)
+        tmp_path = cache_path + ".tmp"
+        with open(tmp_path, 'w') as f:
+            json.dump(cache, f, indent=2, sort_keys=True)
+        os.replace(tmp_path, cache_path)
+    except OSError as e:
+        print(f"Could not write port cache {cache_path}: {e}")
 
 
-def find_follower_arms():
+def port_opens(port):
+    """
+    Check that a serial port can be opened, without waiting for any data.
+    
+    Args:
+        port: Serial port device name
+        
+    Returns:
+        True if the port opened
+    """
+    try:
+        open_serial(port, timeout=0).close()
+        return True
+    except (serial.SerialException, OSError):
+        return False
+
+
+def find_follower_arms(cache_path=DEFAULT_CACHE_PATH, use_cache=True, timeout=0.25):
     """
     Scan all available serial ports and find all connected follower arms.
     
+    A port whose USB serial number is in the cache is taken as that arm
+    without probing, as long as it opens. All other ports are probed
+    concurrently, so discovery takes at most one probe timeout regardless of
+    the port count, and none when every port is cached. Results are always
+    written back, so a rescan replaces a stale cache.
+    
+    Args:
+        cache_path: Path of the USB serial number to arm_id cache
+        use_cache: Set to False to ignore the cached entries and probe every port
+        timeout: Identity query timeout per port in seconds
+    
     Returns:
         Dictionary mapping arm IDs to port names
     """
     print("Scanning for follower arms...")
     
     # Get list of available ports
-    ports = [p.device for p in serial.tools.list_ports.comports()]
-    print(f"Found {len(ports)} serial ports: {', '.join(ports)}")
-    
-    # Check each port for RoArm-M3 follower arms
-    arm_ports = {}
-    for port in ports:
-        print(f"Checking {port}...", end='', flush=True)
-        arm_id = detect_arm(port)
-        if arm_id:
-            print(f" Found {arm_id}!")
-            arm_ports[arm_id] = port
-        else:
-            print(" No arm detected")
+    port_infos = serial.tools.list_ports.comports()
+    print(f"Found {len(port_infos)} serial ports: {', '.join(p.device for p in port_infos)}")
+    
+    with _cache_lock:
+        cache = load_port_cache(cache_path) if use_cache else {}
+        
+        # Use cached ports directly; probe the rest
+        arm_ports = {}
+        to_probe = []
+        for info in port_infos:
+            cached_id = cache.get(info.serial_number) if info.serial_number else None
+            if cached_id and cached_id not in arm_ports and port_opens(info.device):
+                print(f"{info.device}: Found {cached_id} (cached)")
+                arm_ports[cached_id] = info.device
+                continue
+            if cached_id:
+                print(f"{info.device}: cached {cached_id} is not usable, probing")
+                del cache[info.serial_number]
+            to_probe.append(info)
+        
+        results = []
+        if to_probe:
+            with ThreadPoolExecutor(max_workers=len(to_probe)) as pool:
+                results = list(pool.map(lambda info: detect_arm(info.device, timeout), to_probe))
+        
+        for info, arm_id in zip(to_probe, results):
+            if not arm_id:
+                print(f"{info.device}: No arm detected")
+                continue
+            if arm_id in arm_ports:
+                print(f"{info.device}: {arm_id} already on {arm_ports[arm_id]}, ignoring")
+                continue
+            print(f"{info.device}: Found {arm_id}!")
+            arm_ports[arm_id] = info.device
+            if info.serial_number:
+                cache[info.serial_number] = arm_id
+        
+        save_port_cache(cache, cache_path)
     
     return arm_ports
 
 
-def read_arm_data(arm_id, port, output_folder=None, stop_event=None):
+def reprobe_port(port, cache_path=DEFAULT_CACHE_PATH, timeout=0.25):
+    """
+    Probe one port again and replace its cache entry.
+    
+    Used when a port taken from the cache cannot be opened or sends
+    telemetry of a different arm.
+    
+    Args:
+        port: Serial port device name
+        cache_path: Path of the USB serial number to arm_id cache
+        timeout: Identity query timeout in seconds
+        
+    Returns:
+        Arm identity string or None if no arm answered
+    """
+    serial_number = next((p.serial_number for p in serial.tools.list_ports.comports() if p.device == port), None)
+    arm_id = detect_arm(port, timeout)
+    with _cache_lock:
+        cache = load_port_cache(cache_path)
+        if serial_number:
+            cache.pop(serial_number, None)
+            if arm_id:
+                cache[serial_number] = arm_id
+        save_port_cache(cache, cache_path)
+    print(f"{port}: re-probed, {'found ' + arm_id if arm_id else 'no arm detected'}")
+    return arm_id
+
+
+def read_arm_data(arm_id, port, output_folder=None, stop_event=None, flush_interval=0.5, shm_writer=None,
+                  on_wrong_port=None):
     """
     Read position data from a specific arm continuously.
     
+    If the port cannot be opened, or its first report carries another arm_id
+    (a stale cache entry), the reader calls on_wrong_port and stops.
+    
     Args:
         arm_id: Arm identifier string
         port: Serial port connected to this arm
         output_folder: Optional folder to save data files
         stop_event: Threading event to signal when to stop
+        flush_interval: Seconds between output file flushes (group commit)
+        shm_writer: Optional ArmStateWriter publishing the latest state to shared memory
+        on_wrong_port: Optional callback on_wrong_port(arm_id, port)
     """
     print(f"Starting reader for {arm_id} on {port}")
     
+    # Open serial port
+    try:
+        ser = open_serial(port, timeout=1)
+    except (serial.SerialException, OSError) as e:
+        print(f"Cannot open {port} for {arm_id}: {e}")
+        if on_wrong_port:
+            on_wrong_port(arm_id, port)
+        return
+    
     # Open output file if folder specified
     out_file = None
     if output_folder:
@@ -121,10 +300,11 @@ def read_arm_data(arm_id, port, output_folder=None, stop_event=None):
         out_file = open(filepath, 'w')
         print(f"Saving {arm_id} data to {filepath}")
     
+    last_flush = time.time()
+    shm_slot = shm_writer.add_arm(arm_id) if shm_writer else -1
+    confirmed = False
+    
     try:
-        # Open serial port
-        ser = serial.Serial(port, 115200, timeout=1)
-        
         # Read data until stopped
         while not (stop_event and stop_event.is_set()):
             try:
@@ -136,20 +316,33 @@ def read_arm_data(arm_id, port, output_folder=None, stop_event=None):
                 data = json.loads(line)
                 
                 # Validate that this is the correct arm
-                if 'arm_id' not in data or data['arm_id'] != arm_id:
+                if 'arm_id' not in data:
+                    continue
+                if data['arm_id'] != arm_id:
+                    if not confirmed and on_wrong_port:
+                        print(f"{port} reports {data['arm_id']}, not {arm_id}")
+                        on_wrong_port(arm_id, port)
+                        break
                     continue
+                confirmed = True
                 
                 # Add host timestamp
                 data['host_time'] = time.time()
                 data['host_datetime'] = datetime.now().isoformat()
                 
+                # Publish to shared memory for inference and visualization
+                if shm_writer:
+                    shm_writer.publish(shm_slot, data)
+                
                 # Display data
                 print(f"[{arm_id}] t:{data['t']} b:{data['b']:.2f} s:{data['s']:.2f} e:{data['e']:.2f} x:{data['x']:.1f} y:{data['y']:.1f} z:{data['z']:.1f}")
                 
-                # Save data if output file specified
+                # Save data if output file specified; flush in groups, not per sample
                 if out_file:
                     out_file.write(json.dumps(data) + '\n')
-                    out_file.flush()
+                    if data['host_time'] - last_flush >= flush_interval:
+                        out_file.flush()
+                        last_flush = data['host_time']
                 
             except json.JSONDecodeError:
                 # Not valid JSON, continue
@@ -168,7 +361,7 @@ def read_arm_data(arm_id, port, output_folder=None, stop_event=None):
         # Clean up
         if out_file:
             out_file.close()
-        if 'ser' in locals() and ser.is_open:
+        if ser.is_open:
             ser.close()
         
         print(f"Stopped reader for {arm_id}")
@@ -180,10 +373,15 @@ def main():
     parser = argparse.ArgumentParser(description="Read and save position data from multiple RoArm-M3 Pro follower arms")
     parser.add_argument("--output", help="Output folder to save position data (JSONL format)")
     parser.add_argument("--duration", type=float, help="Duration in seconds to read data")
+    parser.add_argument("--flush-interval", type=float, default=0.5, help="Seconds between output file flushes")
+    parser.add_argument("--shm", metavar="NAME", nargs="?", const="/shoplifter_arm_state",
+                        help="Publish the latest arm states to this shared-memory segment")
+    parser.add_argument("--port-cache", default=DEFAULT_CACHE_PATH, help="USB serial number to arm_id cache file")
+    parser.add_argument("--rescan", action="store_true", help="Ignore the cached entries, probe every port and rebuild the port cache")
     args = parser.parse_args()
     
     # Find all connected follower arms
-    arm_ports = find_follower_arms()
+    arm_ports = find_follower_arms(args.port_cache, use_cache=not args.rescan)
     
     if not arm_ports:
         print("No follower arms detected. Make sure they are connected and in follower mode.")
@@ -193,16 +391,45 @@ def main():
     for arm_id, port in arm_ports.items():
         print(f"  {arm_id} on {port}")
     
+    # Shared-memory publisher; arms are registered before the reader threads start
+    shm_writer = None
+    if args.shm:
+        sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+        from hardware.telemetry.arm_state_shm import ArmStateWriter
+        shm_writer = ArmStateWriter(args.shm)
+        for arm_id in arm_ports:
+            shm_writer.add_arm(arm_id)
+        print(f"Publishing arm states to shared memory {args.shm}")
+    
     # Create threads for reading from each arm
     stop_event = threading.Event()
     threads = []
+    threads_lock = threading.Lock()
     
-    for arm_id, port in arm_ports.items():
-        thread = threading.Thread(target=read_arm_data, args=(arm_id, port, args.output, stop_event))
+    def start_reader(arm_id, port):
+        thread = threading.Thread(target=read_arm_data,
+                                  args=(arm_id, port, args.output, stop_event, args.flush_interval, shm_writer,
+                                        on_wrong_port))
         thread.daemon = True
-        threads.append(thread)
+        with threads_lock:
+            threads.append(thread)
         thread.start()
     
+    def on_wrong_port(arm_id, port):
+        # A stale cache entry: probe the port again and read whichever arm answers
+        with threads_lock:
+            if arm_ports.get(arm_id) == port:
+                del arm_ports[arm_id]
+        found = reprobe_port(port, args.port_cache)
+        with threads_lock:
+            if not found or found in arm_ports:
+                return
+            arm_ports[found] = port
+        start_reader(found, port)
+    
+    for arm_id, port in list(arm_ports.items()):
+        start_reader(arm_id, port)
+    
     try:
         # Set timeout if duration specified
         if args.duration:
@@ -217,9 +444,14 @@ def main():
         print("\nStopping all readers...")
         stop_event.set()
     
-    # Wait for all threads to complete
-    for thread in threads:
-        thread.join()
+    # Wait for all threads to complete, including readers started after a re-probe
+    while True:
+        with threads_lock:
+            pending = [t for t in threads if t.is_alive()]
+        if not pending:
+            break
+        for thread in pending:
+            thread.join()
     
     print("All readers stopped.")
 
@@ -0,0 +1,269 @@
+/**
+ * Shared-Memory Arm State
+ */
+
+#include "hardware/telemetry/arm_state_shm.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "training/data/episode_writer.h"
+
+namespace shoplifter {
+
+namespace {
+
+size_t slotBytes(uint32_t historyLength) {
+  return alignEpisode(sizeof(ArmStateSlotHeader) + historyLength * sizeof(ArmStateEntry));
+}
+
+uint64_t toBits(double v) {
+  uint64_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  return bits;
+}
+
+double fromBits(uint64_t bits) {
+  double v;
+  std::memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+}  // namespace
+
+ArmStatePublisher::ArmStatePublisher(const std::string& name, uint32_t maxArms, uint32_t historyLength)
+    : name_(name) {
+  if (maxArms == 0 || historyLength < 2) {
+    throw std::runtime_error("Arm state segment needs at least one slot and two history entries");
+  }
+  const size_t slotSize = slotBytes(historyLength);
+  size_ = sizeof(ArmStateShmHeader) + maxArms * slotSize;
+
+  // Start from a fresh segment so readers never see a half-initialized layout
+  ::shm_unlink(name.c_str());
+  const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot create shared memory " + name + ": " + std::strerror(errno));
+  }
+  if (::ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+    const int err = errno;
+    ::close(fd);
+    throw std::runtime_error("Cannot size shared memory " + name + ": " + std::strerror(err));
+  }
+  void* p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    throw std::runtime_error("Cannot map shared memory " + name + ": " + std::strerror(errno));
+  }
+  base_ = static_cast<uint8_t*>(p);
+
+  // ftruncate() zero-fills, so every seq and count starts at 0
+  auto* header = reinterpret_cast<ArmStateShmHeader*>(base_);
+  header->version = kArmStateShmVersion;
+  header->header_size = sizeof(ArmStateShmHeader);
+  header->max_arms = maxArms;
+  header->history_length = historyLength;
+  header->slot_size = static_cast<uint32_t>(slotSize);
+  header->value_count = kPositionChannelCount;
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header->magic, kArmStateShmMagic, sizeof(header->magic));
+}
+
+ArmStatePublisher::~ArmStatePublisher() {
+  if (base_) {
+    ::munmap(base_, size_);
+  }
+}
+
+int ArmStatePublisher::addArm(const std::string& armId) {
+  auto* header = reinterpret_cast<ArmStateShmHeader*>(base_);
+  const uint32_t used = header->arm_count.load(std::memory_order_relaxed);
+  for (uint32_t i = 0; i < used; i++) {
+    auto* slot = reinterpret_cast<ArmStateSlotHeader*>(base_ + sizeof(ArmStateShmHeader) + i * header->slot_size);
+    if (armId == slot->arm_id) {
+      return static_cast<int>(i);
+    }
+  }
+  if (used == header->max_arms) {
+    throw std::runtime_error("No free arm state slot for " + armId);
+  }
+  if (armId.size() >= kArmStateIdLength) {
+    throw std::runtime_error("Arm ID too long: " + armId);
+  }
+  auto* slot = reinterpret_cast<ArmStateSlotHeader*>(base_ + sizeof(ArmStateShmHeader) + used * header->slot_size);
+  std::memcpy(slot->arm_id, armId.c_str(), armId.size() + 1);
+  header->arm_count.store(used + 1, std::memory_order_release);
+  return static_cast<int>(used);
+}
+
+void ArmStatePublisher::publish(int arm, const double* values) {
+  const auto* header = reinterpret_cast<const ArmStateShmHeader*>(base_);
+  uint8_t* slotBase = base_ + sizeof(ArmStateShmHeader) + static_cast<size_t>(arm) * header->slot_size;
+  auto* slot = reinterpret_cast<ArmStateSlotHeader*>(slotBase);
+  const uint64_t n = slot->count.load(std::memory_order_relaxed);
+  auto* entry = reinterpret_cast<ArmStateEntry*>(slotBase + sizeof(ArmStateSlotHeader)) +
+                n % header->history_length;
+
+  entry->seq.store(2 * n + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t i = 0; i < kPositionChannelCount; i++) {
+    entry->values[i].store(toBits(values[i]), std::memory_order_relaxed);
+  }
+  entry->seq.store(2 * n + 2, std::memory_order_release);
+  slot->count.store(n + 1, std::memory_order_release);
+}
+
+void ArmStatePublisher::publish(int arm, const PositionSample& sample) {
+  double values[kPositionChannelCount];
+  positionSampleValues(sample, values);
+  publish(arm, values);
+}
+
+void ArmStatePublisher::unlink(const std::string& name) {
+  ::shm_unlink(name.c_str());
+}
+
+ArmStateReader::ArmStateReader(const std::string& name) {
+  const int fd = ::shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open shared memory " + name + ": " + std::strerror(errno));
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ArmStateShmHeader)) {
+    ::close(fd);
+    throw std::runtime_error("Shared memory " + name + " is not an arm state segment");
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    throw std::runtime_error("Cannot map shared memory " + name + ": " + std::strerror(errno));
+  }
+  base_ = static_cast<const uint8_t*>(p);
+
+  const auto* header = reinterpret_cast<const ArmStateShmHeader*>(base_);
+  const bool valid = std::memcmp(header->magic, kArmStateShmMagic, sizeof(header->magic)) == 0 &&
+                     header->version == kArmStateShmVersion &&
+                     header->header_size == sizeof(ArmStateShmHeader) &&
+                     header->value_count == kPositionChannelCount &&
+                     header->slot_size == slotBytes(header->history_length) &&
+                     sizeof(ArmStateShmHeader) + size_t(header->max_arms) * header->slot_size <= size_;
+  if (!valid) {
+    ::munmap(const_cast<uint8_t*>(base_), size_);
+    base_ = nullptr;
+    throw std::runtime_error("Shared memory " + name + " has an unsupported arm state layout");
+  }
+  maxArms_ = header->max_arms;
+  history_ = header->history_length;
+  slotSize_ = header->slot_size;
+}
+
+ArmStateReader::~ArmStateReader() {
+  if (base_) {
+    ::munmap(const_cast<uint8_t*>(base_), size_);
+  }
+}
+
+uint32_t ArmStateReader::armCount() const {
+  const auto* header = reinterpret_cast<const ArmStateShmHeader*>(base_);
+  return std::min(header->arm_count.load(std::memory_order_acquire), maxArms_);
+}
+
+const ArmStateSlotHeader& ArmStateReader::slot(int arm) const {
+  return *reinterpret_cast<const ArmStateSlotHeader*>(
+      base_ + sizeof(ArmStateShmHeader) + static_cast<size_t>(arm) * slotSize_);
+}
+
+const ArmStateEntry& ArmStateReader::entry(int arm, uint64_t n) const {
+  const uint8_t* slotBase = base_ + sizeof(ArmStateShmHeader) + static_cast<size_t>(arm) * slotSize_;
+  return reinterpret_cast<const ArmStateEntry*>(slotBase + sizeof(ArmStateSlotHeader))[n % history_];
+}
+
+bool ArmStateReader::validArm(int arm) const {
+  return arm >= 0 && static_cast<uint32_t>(arm) < armCount();
+}
+
+std::string ArmStateReader::armId(int arm) const {
+  if (!validArm(arm)) {
+    return std::string();
+  }
+  const char* id = slot(arm).arm_id;
+  return std::string(id, strnlen(id, kArmStateIdLength));
+}
+
+int ArmStateReader::findArm(const std::string& armId) const {
+  const uint32_t n = armCount();
+  for (uint32_t i = 0; i < n; i++) {
+    if (armId == this->armId(static_cast<int>(i))) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+uint64_t ArmStateReader::count(int arm) const {
+  // Every read goes through count(), so a slot that is not registered is never touched
+  if (!validArm(arm)) {
+    return 0;
+  }
+  return slot(arm).count.load(std::memory_order_acquire);
+}
+
+bool ArmStateReader::readEntry(int arm, uint64_t n, ArmState& out) const {
+  const ArmStateEntry& e = entry(arm, n);
+  const uint64_t expected = 2 * n + 2;
+  if (e.seq.load(std::memory_order_acquire) != expected) {
+    return false;
+  }
+  for (size_t i = 0; i < kPositionChannelCount; i++) {
+    out.values[i] = fromBits(e.values[i].load(std::memory_order_relaxed));
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (e.seq.load(std::memory_order_relaxed) != expected) {
+    return false;
+  }
+  out.sequence = n;
+  return true;
+}
+
+bool ArmStateReader::latest(int arm, ArmState& out) const {
+  for (;;) {
+    const uint64_t c = count(arm);
+    if (c == 0) {
+      return false;
+    }
+    if (readEntry(arm, c - 1, out)) {
+      return true;
+    }
+    retries_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+size_t ArmStateReader::history(int arm, ArmState* out, size_t maxCount) const {
+  const uint64_t c = count(arm);
+  // Leave one entry of slack for the sample being written right now
+  const size_t want = static_cast<size_t>(std::min<uint64_t>({c, maxCount, history_ - 1}));
+
+  // Copy newest first into the tail of out, stop at the first overwritten entry
+  size_t got = 0;
+  while (got < want) {
+    if (!readEntry(arm, c - 1 - got, out[want - 1 - got])) {
+      retries_.fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+    got++;
+  }
+  if (got < want) {
+    std::memmove(out, out + (want - got), got * sizeof(ArmState));
+  }
+  return got;
+}
+
+}  // namespace shoplifter
@@ -0,0 +1,198 @@
+/**
+ * Shared-Memory Arm State
+ *
+ * The telemetry daemon publishes every arm's most recent position report,
+ * plus a short history, into a POSIX shared-memory segment. Inference and
+ * visualization processes map the segment read-only and take consistent
+ * snapshots without syscalls or locks.
+ *
+ * Segment layout (all little-endian, 64-byte aligned):
+ *
+ *   ArmStateShmHeader                       64 bytes
+ *   slot 0 .. max_arms-1, each slot_size bytes:
+ *     ArmStateSlotHeader                    64 bytes: arm_id, publish count
+ *     ArmStateEntry[history_length]         128 bytes each, a ring
+ *
+ * Every ring entry is its own seqlock. Publishing sample n writes entry
+ * n % history_length with seq = 2n+1, stores the values, sets seq = 2n+2 and
+ * then bumps the slot count to n+1. A reader that wants sample n accepts the
+ * entry only if seq reads 2n+2 both before and after copying the values.
+ * Because the newest sample sits in a different entry than the one being
+ * overwritten next, readers of the latest state almost never retry.
+ *
+ * Values are stored in PositionChannel order (training/data/episode_format.h).
+ * hardware/telemetry/arm_state_shm.py is the Python binding of this layout.
+ */
+
+#ifndef ARM_STATE_SHM_H
+#define ARM_STATE_SHM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "training/data/episode_format.h"
+
+namespace shoplifter {
+
+struct PositionSample;
+
+constexpr char kArmStateShmMagic[8] = {'S', 'L', 'A', 'R', 'M', 'S', 'H', 'M'};
+constexpr uint32_t kArmStateShmVersion = 1;
+constexpr const char* kDefaultArmStateShmName = "/shoplifter_arm_state";
+constexpr uint32_t kDefaultArmStateSlots = 16;
+constexpr uint32_t kDefaultArmStateHistory = 256;   // ~0.5 s at 500 Hz
+constexpr size_t kArmStateIdLength = 32;
+
+struct ArmStateShmHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t max_arms;
+  uint32_t history_length;
+  uint32_t slot_size;
+  uint32_t value_count;            // kPositionChannelCount
+  std::atomic<uint32_t> arm_count; // slots in use; bumped after the slot is named
+  uint8_t reserved[28];
+};
+
+struct ArmStateSlotHeader {
+  char arm_id[kArmStateIdLength];  // NUL-padded
+  std::atomic<uint64_t> count;     // samples published so far
+  uint8_t reserved[24];
+};
+
+struct ArmStateEntry {
+  std::atomic<uint64_t> seq;       // 2n+1 while sample n is written, 2n+2 once complete
+  std::atomic<uint64_t> values[kPositionChannelCount];  // double bit patterns
+  uint64_t reserved[3];
+};
+
+static_assert(sizeof(ArmStateShmHeader) == 64, "ArmStateShmHeader layout");
+static_assert(sizeof(ArmStateSlotHeader) == 64, "ArmStateSlotHeader layout");
+static_assert(sizeof(ArmStateEntry) == 128, "ArmStateEntry layout");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared atomics must be lock-free");
+
+/**
+ * One consistent snapshot of an arm
+ */
+struct ArmState {
+  uint64_t sequence;               // publish index of this sample, from 0
+  double values[kPositionChannelCount];
+};
+
+/**
+ * Writer side, owned by the telemetry daemon (one publishing thread per arm)
+ */
+class ArmStatePublisher {
+ public:
+  /**
+   * Create (or replace) the shared-memory segment
+   *
+   * @param name shm_open() name, e.g. "/shoplifter_arm_state"
+   * @param maxArms Number of arm slots
+   * @param historyLength Ring entries per arm
+   * @throws std::runtime_error if the segment cannot be created
+   */
+  explicit ArmStatePublisher(const std::string& name = kDefaultArmStateShmName,
+                             uint32_t maxArms = kDefaultArmStateSlots,
+                             uint32_t historyLength = kDefaultArmStateHistory);
+  ~ArmStatePublisher();
+
+  ArmStatePublisher(const ArmStatePublisher&) = delete;
+  ArmStatePublisher& operator=(const ArmStatePublisher&) = delete;
+
+  /**
+   * Register an arm; returns its existing slot if already registered
+   *
+   * @return Slot index for publish()
+   * @throws std::runtime_error if all slots are taken
+   */
+  int addArm(const std::string& armId);
+
+  /**
+   * Publish one sample (kPositionChannelCount values in PositionChannel order)
+   */
+  void publish(int arm, const double* values);
+  void publish(int arm, const PositionSample& sample);
+
+  /**
+   * Remove the segment name; mapped readers keep working
+   */
+  static void unlink(const std::string& name = kDefaultArmStateShmName);
+
+ private:
+  uint8_t* base_ = nullptr;
+  size_t size_ = 0;
+  std::string name_;
+};
+
+/**
+ * Reader side; any number of readers in any number of processes
+ */
+class ArmStateReader {
+ public:
+  /**
+   * Map an existing segment read-only
+   *
+   * @throws std::runtime_error if it does not exist or has the wrong layout
+   */
+  explicit ArmStateReader(const std::string& name = kDefaultArmStateShmName);
+  ~ArmStateReader();
+
+  ArmStateReader(const ArmStateReader&) = delete;
+  ArmStateReader& operator=(const ArmStateReader&) = delete;
+
+  // Number of registered arms
+  uint32_t armCount() const;
+
+  // Arm ID of a slot; empty if the slot is not registered
+  std::string armId(int arm) const;
+
+  /**
+   * @return Slot of an arm ID, or -1 if it is not registered
+   */
+  int findArm(const std::string& armId) const;
+
+  /**
+   * Snapshot the most recent sample of an arm
+   *
+   * @param arm Slot from findArm(); -1 or an unregistered slot is accepted
+   * @return false if the slot is not registered or nothing has been published yet
+   */
+  bool latest(int arm, ArmState& out) const;
+
+  /**
+   * Copy up to maxCount of the most recent samples, oldest first
+   *
+   * Entries overwritten while copying are skipped, so the result is always a
+   * run of consistent samples ending at the newest one.
+   *
+   * @return Number of samples written to out; 0 if the slot is not registered
+   */
+  size_t history(int arm, ArmState* out, size_t maxCount) const;
+
+  // Total samples published for an arm (cheap change detection); 0 if the slot is not registered
+  uint64_t count(int arm) const;
+
+  // Number of snapshots that had to be retried because of a concurrent write
+  uint64_t retries() const { return retries_.load(std::memory_order_relaxed); }
+
+ private:
+  bool validArm(int arm) const;
+  const ArmStateSlotHeader& slot(int arm) const;
+  const ArmStateEntry& entry(int arm, uint64_t n) const;
+  bool readEntry(int arm, uint64_t n, ArmState& out) const;
+
+  const uint8_t* base_ = nullptr;
+  size_t size_ = 0;
+  uint32_t maxArms_ = 0;
+  uint32_t history_ = 0;
+  uint32_t slotSize_ = 0;
+  mutable std::atomic<uint64_t> retries_{0};
+};
+
+}  // namespace shoplifter
+
+#endif // ARM_STATE_SHM_H
@@ -0,0 +1,239 @@
+"""
+Python binding for the shared-memory arm state segment.
+
+Mirrors the layout in hardware/telemetry/arm_state_shm.h. Readers map the
+segment read-only and take seqlock-validated snapshots of the latest state and
+recent history of any arm, without talking to the telemetry daemon.
+
+Usage:
+    reader = ArmStateReader()
+    state = reader.latest("follower_left")   # dict of channel -> value, or None
+    recent = reader.history("follower_left", 100)  # (n, 12) numpy array, oldest first
+"""
+
+import math
+import mmap
+import os
+import struct
+from typing import Dict, List, Optional
+
+import numpy as np
+
+
+SHM_MAGIC = b"SLARMSHM"
+SHM_VERSION = 1
+DEFAULT_SHM_NAME = "/shoplifter_arm_state"
+DEFAULT_SLOTS = 16
+DEFAULT_HISTORY = 256
+HEADER_SIZE = 64
+SLOT_HEADER_SIZE = 64
+ENTRY_SIZE = 128
+ARM_ID_LENGTH = 32
+
+# PositionChannel order from training/data/episode_format.h
+CHANNELS = ["host_time", "device_ms", "b", "s", "e", "t", "r", "g", "x", "y", "z", "tilt"]
+
+_VALUES = struct.Struct(f"<{len(CHANNELS)}d")
+
+
+def _shm_path(name: str) -> str:
+    return os.path.join("/dev/shm", name.lstrip("/"))
+
+
+def _slot_size(history_length: int) -> int:
+    return (SLOT_HEADER_SIZE + history_length * ENTRY_SIZE + 63) & ~63
+
+
+class _Segment:
+    """Shared layout arithmetic for readers and writers."""
+
+    def _parse_header(self):
+        magic, version, header_size, max_arms, history, slot_size, value_count = struct.unpack_from(
+            "<8sIIIIII", self._map, 0)
+        if magic != SHM_MAGIC or version != SHM_VERSION or header_size != HEADER_SIZE:
+            raise ValueError(f"{self.name} is not an arm state segment")
+        if value_count != len(CHANNELS) or slot_size != _slot_size(history):
+            raise ValueError(f"{self.name} has an unsupported arm state layout")
+        self.max_arms = max_arms
+        self.history_length = history
+        self._slot_size = slot_size
+
+    def _slot_offset(self, slot: int) -> int:
+        return HEADER_SIZE + slot * self._slot_size
+
+    def _entry_offset(self, slot: int, n: int) -> int:
+        return self._slot_offset(slot) + SLOT_HEADER_SIZE + (n % self.history_length) * ENTRY_SIZE
+
+    def arm_count(self) -> int:
+        return min(struct.unpack_from("<I", self._map, 32)[0], self.max_arms)
+
+    def arm_ids(self) -> List[str]:
+        ids = []
+        for slot in range(self.arm_count()):
+            raw = self._map[self._slot_offset(slot):self._slot_offset(slot) + ARM_ID_LENGTH]
+            ids.append(raw.split(b"\0", 1)[0].decode("utf-8", "replace"))
+        return ids
+
+    def find_arm(self, arm_id: str) -> int:
+        try:
+            return self.arm_ids().index(arm_id)
+        except ValueError:
+            return -1
+
+    def close(self):
+        self._map.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+class ArmStateReader(_Segment):
+    """Read-only view of the arm state segment."""
+
+    def __init__(self, name: str = DEFAULT_SHM_NAME):
+        """
+        Map an existing segment.
+
+        Args:
+            name: shm_open() name used by the publisher
+
+        Raises:
+            FileNotFoundError: If no publisher has created the segment
+            ValueError: If the segment layout is not supported
+        """
+        self.name = name
+        with open(_shm_path(name), "rb") as f:
+            self._map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        self._parse_header()
+
+    def count(self, arm_id: str) -> int:
+        """Number of samples published for an arm (0 if unknown)."""
+        slot = self.find_arm(arm_id)
+        return self._count(slot) if slot >= 0 else 0
+
+    def _count(self, slot: int) -> int:
+        return struct.unpack_from("<Q", self._map, self._slot_offset(slot) + ARM_ID_LENGTH)[0]
+
+    def _read_entry(self, slot: int, n: int) -> Optional[tuple]:
+        offset = self._entry_offset(slot, n)
+        expected = 2 * n + 2
+        if struct.unpack_from("<Q", self._map, offset)[0] != expected:
+            return None
+        values = _VALUES.unpack_from(self._map, offset + 8)
+        if struct.unpack_from("<Q", self._map, offset)[0] != expected:
+            return None
+        return values
+
+    def latest(self, arm_id: str) -> Optional[Dict[str, float]]:
+        """
+        Snapshot the most recent sample of an arm.
+
+        Returns:
+            Dict of channel name to value plus "sequence", or None if the arm
+            is unknown or has not published yet
+        """
+        slot = self.find_arm(arm_id)
+        if slot < 0:
+            return None
+        while True:
+            c = self._count(slot)
+            if c == 0:
+                return None
+            values = self._read_entry(slot, c - 1)
+            if values is not None:
+                state = dict(zip(CHANNELS, values))
+                state["sequence"] = c - 1
+                return state
+
+    def history(self, arm_id: str, max_count: int = DEFAULT_HISTORY) -> np.ndarray:
+        """
+        Copy the most recent samples of an arm, oldest first.
+
+        Returns:
+            Array of shape (n, len(CHANNELS)); n may be smaller than max_count
+        """
+        slot = self.find_arm(arm_id)
+        if slot < 0:
+            return np.empty((0, len(CHANNELS)))
+        c = self._count(slot)
+        want = min(c, max_count, self.history_length - 1)
+        rows = []
+        for i in range(want):
+            values = self._read_entry(slot, c - 1 - i)
+            if values is None:
+                break
+            rows.append(values)
+        rows.reverse()
+        return np.array(rows, dtype=np.float64).reshape(len(rows), len(CHANNELS))
+
+
+class ArmStateWriter(_Segment):
+    """
+    Publisher for the Python telemetry readers.
+
+    Publishes with the same seqlock protocol as ArmStatePublisher. Python has
+    no memory fences, so this relies on the store ordering of x86 hosts; on
+    ARM hosts publish from the C++ ArmStatePublisher instead.
+    """
+
+    def __init__(self, name: str = DEFAULT_SHM_NAME, max_arms: int = DEFAULT_SLOTS,
+                 history_length: int = DEFAULT_HISTORY):
+        """
+        Create (or replace) the segment.
+
+        Args:
+            name: shm_open() name
+            max_arms: Number of arm slots
+            history_length: Ring entries per arm
+        """
+        self.name = name
+        path = _shm_path(name)
+        if os.path.exists(path):
+            os.unlink(path)
+        size = HEADER_SIZE + max_arms * _slot_size(history_length)
+        fd = os.open(path, os.O_RDWR | os.O_CREAT | os.O_EXCL, 0o644)
+        try:
+            os.ftruncate(fd, size)
+            self._map = mmap.mmap(fd, size)
+        finally:
+            os.close(fd)
+        struct.pack_into("<IIIIII", self._map, 8, SHM_VERSION, HEADER_SIZE, max_arms, history_length,
+                         _slot_size(history_length), len(CHANNELS))
+        self._map[0:8] = SHM_MAGIC
+        self._parse_header()
+        self._counts: Dict[int, int] = {}
+
+    def add_arm(self, arm_id: str) -> int:
+        """Register an arm and return its slot (call before publishing threads start)."""
+        slot = self.find_arm(arm_id)
+        if slot >= 0:
+            return slot
+        slot = self.arm_count()
+        encoded = arm_id.encode("utf-8")
+        if slot == self.max_arms:
+            raise ValueError(f"No free arm state slot for {arm_id}")
+        if len(encoded) >= ARM_ID_LENGTH:
+            raise ValueError(f"Arm ID too long: {arm_id}")
+        offset = self._slot_offset(slot)
+        self._map[offset:offset + len(encoded)] = encoded
+        struct.pack_into("<I", self._map, 32, slot + 1)
+        self._counts[slot] = 0
+        return slot
+
+    def publish(self, slot: int, data: Dict[str, float]):
+        """
+        Publish one position report (the dict written to the .jsonl recordings).
+
+        Missing channels are stored as NaN.
+        """
+        n = self._counts[slot]
+        offset = self._entry_offset(slot, n)
+        values = [data.get(channel, math.nan) for channel in CHANNELS]
+        struct.pack_into("<Q", self._map, offset, 2 * n + 1)
+        _VALUES.pack_into(self._map, offset + 8, *values)
+        struct.pack_into("<Q", self._map, offset, 2 * n + 2)
+        self._counts[slot] = n + 1
+        struct.pack_into("<Q", self._map, self._slot_offset(slot) + ARM_ID_LENGTH, n + 1)
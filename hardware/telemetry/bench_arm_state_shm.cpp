@@ -0,0 +1,163 @@
+/**
+ * Shared-Memory Arm State Benchmark
+ *
+ * One publisher thread writes every arm's state while reader threads, each
+ * with its own mapping of the segment (as separate processes would have),
+ * snapshot the latest state of random arms as fast as they can. Reports
+ * snapshot latency, retry rate under contention and publish cost.
+ *
+ * Usage:
+ *   bench_arm_state_shm [--arms N] [--readers N] [--seconds S] [--rate HZ] [--history N]
+ *
+ * --rate is per arm; 0 (default) publishes unpaced to maximize contention.
+ */
+
+#include "hardware/telemetry/arm_state_shm.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr const char* kBenchShmName = "/shoplifter_arm_state_bench";
+constexpr int kBatch = 256;   // snapshots per timed batch
+
+struct ReaderResult {
+  std::vector<double> batchNs;   // mean ns per snapshot, one entry per batch
+  uint64_t snapshots = 0;
+  uint64_t retries = 0;
+  uint64_t torn = 0;             // snapshots whose values disagree (must stay 0)
+};
+
+double percentile(std::vector<double>& v, double q) {
+  if (v.empty()) {
+    return 0.0;
+  }
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, static_cast<size_t>(q * v.size()))];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int arms = 4;
+  int readers = 4;
+  double seconds = 3.0;
+  double rate = 0.0;
+  uint32_t history = kDefaultArmStateHistory;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--arms")) arms = std::max(1, std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--readers")) readers = std::max(1, std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--seconds")) seconds = std::atof(next());
+    else if (!std::strcmp(argv[i], "--rate")) rate = std::atof(next());
+    else if (!std::strcmp(argv[i], "--history")) history = static_cast<uint32_t>(std::atoi(next()));
+  }
+
+  ArmStatePublisher publisher(kBenchShmName, static_cast<uint32_t>(arms), history);
+  for (int a = 0; a < arms; a++) {
+    publisher.addArm("bench_arm" + std::to_string(a));
+  }
+
+  std::atomic<bool> stop{false};
+  uint64_t published = 0;
+  double publishNs = 0.0;
+
+  // Every value of sample n equals n, so a torn snapshot is detectable
+  std::thread writer([&] {
+    double values[kPositionChannelCount];
+    const auto period = rate > 0 ? std::chrono::nanoseconds(static_cast<int64_t>(1e9 / rate))
+                                 : std::chrono::nanoseconds(0);
+    auto next = Clock::now();
+    const auto t0 = Clock::now();
+    uint64_t n = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      std::fill(values, values + kPositionChannelCount, static_cast<double>(n));
+      for (int a = 0; a < arms; a++) {
+        publisher.publish(a, values);
+      }
+      n++;
+      if (period.count() > 0) {
+        next += period;
+        std::this_thread::sleep_until(next);
+      }
+    }
+    published = n * static_cast<uint64_t>(arms);
+    if (period.count() == 0 && published > 0) {
+      publishNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / published;
+    }
+  });
+
+  std::vector<ReaderResult> results(static_cast<size_t>(readers));
+  std::vector<std::thread> threads;
+  for (int r = 0; r < readers; r++) {
+    threads.emplace_back([&, r] {
+      ArmStateReader reader(kBenchShmName);
+      ReaderResult& out = results[static_cast<size_t>(r)];
+      out.batchNs.reserve(1 << 20);
+      ArmState state;
+      uint32_t rng = 0x9E3779B9u * static_cast<uint32_t>(r + 1);
+      while (!stop.load(std::memory_order_relaxed)) {
+        const auto t0 = Clock::now();
+        for (int i = 0; i < kBatch; i++) {
+          rng = rng * 1664525u + 1013904223u;
+          const int arm = static_cast<int>((rng >> 16) % static_cast<uint32_t>(arms));
+          if (reader.latest(arm, state)) {
+            out.torn += state.values[0] != state.values[kPositionChannelCount - 1] ||
+                        state.values[0] != static_cast<double>(state.sequence);
+          }
+        }
+        const auto t1 = Clock::now();
+        if (out.batchNs.size() < out.batchNs.capacity()) {
+          out.batchNs.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count() / kBatch);
+        }
+        out.snapshots += kBatch;
+      }
+      out.retries = reader.retries();
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+  stop = true;
+  writer.join();
+  for (auto& t : threads) {
+    t.join();
+  }
+  ArmStatePublisher::unlink(kBenchShmName);
+
+  std::vector<double> latency;
+  uint64_t snapshots = 0;
+  uint64_t retries = 0;
+  uint64_t torn = 0;
+  for (auto& r : results) {
+    latency.insert(latency.end(), r.batchNs.begin(), r.batchNs.end());
+    snapshots += r.snapshots;
+    retries += r.retries;
+    torn += r.torn;
+  }
+
+  std::printf("setup:     %d arms, %d readers, history %u, publish %s\n", arms, readers, history,
+              rate > 0 ? (std::to_string(static_cast<int>(rate)) + " Hz per arm").c_str() : "unpaced");
+  std::printf("published: %llu samples", static_cast<unsigned long long>(published));
+  if (publishNs > 0) {
+    std::printf(", %.1f ns per publish", publishNs);
+  }
+  std::printf("\n");
+  std::printf("snapshots: %llu (%.1f M/s total), retry rate %.4f%%, torn %llu\n",
+              static_cast<unsigned long long>(snapshots), snapshots / seconds / 1e6,
+              snapshots ? 100.0 * retries / snapshots : 0.0, static_cast<unsigned long long>(torn));
+  std::printf("latest():  p50 %.1f ns, p99 %.1f ns, p99.9 %.1f ns (mean of %d-snapshot batches)\n",
+              percentile(latency, 0.5), percentile(latency, 0.99), percentile(latency, 0.999), kBatch);
+  return torn == 0 ? 0 : 1;
+}
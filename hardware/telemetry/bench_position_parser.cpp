@@ -0,0 +1,239 @@
+/**
+ * Position Parser Benchmark
+ *
+ * Measures parsePositionLine() throughput in lines per second on one core and
+ * compares it with the generic JSON libraries available at build time
+ * (nlohmann/json, simdjson, JsonCpp). Every parser decodes the whole report
+ * (arm id and all ten numbers) into a PositionSample, so all do the same work.
+ *
+ * Usage:
+ *   bench_position_parser [recording.jsonl ...]
+ *
+ * Without arguments a synthetic stream in the firmware format is generated.
+ */
+
+#include "hardware/telemetry/position_parser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if __has_include(<nlohmann/json.hpp>)
+#include <nlohmann/json.hpp>
+#define HAVE_NLOHMANN_JSON 1
+#endif
+
+#if __has_include(<simdjson.h>)
+#include <simdjson.h>
+#define HAVE_SIMDJSON 1
+#endif
+
+#if __has_include(<json/json.h>)
+#include <json/json.h>
+#define HAVE_JSONCPP 1
+#endif
+
+using shoplifter::PositionSample;
+
+namespace {
+
+std::string syntheticStream(size_t lines) {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> angle(-3.14159, 3.14159);
+  std::uniform_real_distribution<double> coord(-400.0, 400.0);
+  std::string out;
+  char buf[512];
+  for (size_t i = 0; i < lines; i++) {
+    // Same layout and precision as ArduinoJson serializing sendPositionData()
+    int n = std::snprintf(buf, sizeof(buf),
+        "{\"arm_id\":\"%s\",\"t\":%.9g,\"b\":%.9g,\"s\":%.9g,\"e\":%.9g,\"r\":%.9g,"
+        "\"g\":%.9g,\"x\":%.9g,\"y\":%.9g,\"z\":%.9g,\"tilt\":%.9g}\n",
+        (i & 1) ? "follower_right" : "follower_left",
+        angle(rng), angle(rng), angle(rng), angle(rng), angle(rng), angle(rng),
+        coord(rng), coord(rng), coord(rng), angle(rng));
+    out.append(buf, static_cast<size_t>(n));
+  }
+  return out;
+}
+
+#if defined(HAVE_NLOHMANN_JSON) || defined(HAVE_SIMDJSON) || defined(HAVE_JSONCPP)
+// Store one decoded member the way parsePositionLine() does
+void setField(PositionSample& s, std::string_view key, double v) {
+  if (key == "t") s.t = v;
+  else if (key == "b") s.b = v;
+  else if (key == "s") s.s = v;
+  else if (key == "e") s.e = v;
+  else if (key == "r") s.r = v;
+  else if (key == "g") s.g = v;
+  else if (key == "x") s.x = v;
+  else if (key == "y") s.y = v;
+  else if (key == "z") s.z = v;
+  else if (key == "tilt") s.tilt = v;
+}
+
+void setArmId(PositionSample& s, std::string_view id) {
+  s.arm_id_length = static_cast<uint32_t>(std::min(id.size(), sizeof(s.arm_id) - 1));
+  std::memcpy(s.arm_id, id.data(), s.arm_id_length);
+  s.arm_id[s.arm_id_length] = '\0';
+}
+#endif
+
+double sampleSum(const PositionSample& s) {
+  return s.t + s.b + s.s + s.e + s.r + s.g + s.x + s.y + s.z + s.tilt + s.arm_id_length;
+}
+
+std::string readFile(const char* path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+template <typename Fn>
+void run(const char* name, const std::string& stream, size_t lines, Fn&& parseAll) {
+  // Warm up, then take the best of several passes
+  double checksum = parseAll();
+  double best = 1e30;
+  for (int pass = 0; pass < 5; pass++) {
+    auto start = std::chrono::steady_clock::now();
+    checksum += parseAll();
+    auto stop = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(stop - start).count());
+  }
+  std::printf("%-22s %8.2f Mlines/s %8.1f MB/s  (checksum %.3f)\n", name,
+              lines / best / 1e6, stream.size() / best / 1e6, checksum);
+}
+
+void benchStream(const char* label, const std::string& stream) {
+  size_t lines = 0;
+  for (char c : stream) {
+    lines += (c == '\n');
+  }
+  std::printf("%s: %zu lines, %zu bytes\n", label, lines, stream.size());
+
+  uint64_t rejected = 0;
+  run("specialized", stream, lines, [&] {
+    double sum = 0.0;
+    shoplifter::parsePositionBuffer(stream.data(), stream.size(),
+        [&](const PositionSample& s) { sum += sampleSum(s); }, &rejected);
+    return sum;
+  });
+  if (rejected) {
+    std::printf("  (%llu lines rejected)\n", static_cast<unsigned long long>(rejected));
+  }
+
+#ifdef HAVE_NLOHMANN_JSON
+  run("nlohmann::json", stream, lines, [&] {
+    double sum = 0.0;
+    std::istringstream in(stream);
+    std::string line;
+    while (std::getline(in, line)) {
+      auto j = nlohmann::json::parse(line, nullptr, false);
+      if (j.is_discarded() || !j.is_object()) {
+        continue;
+      }
+      PositionSample s = {};
+      for (auto it = j.begin(); it != j.end(); ++it) {
+        if (it.value().is_number()) {
+          setField(s, it.key(), it.value().get<double>());
+        } else if (it.key() == "arm_id" && it.value().is_string()) {
+          setArmId(s, it.value().get_ref<const std::string&>());
+        }
+      }
+      sum += sampleSum(s);
+    }
+    return sum;
+  });
+#endif
+
+#ifdef HAVE_SIMDJSON
+  run("simdjson on-demand", stream, lines, [&] {
+    double sum = 0.0;
+    simdjson::ondemand::parser parser;
+    simdjson::padded_string padded(stream);
+    simdjson::ondemand::document_stream docs;
+    if (parser.iterate_many(padded).get(docs)) {
+      return sum;
+    }
+    for (auto doc : docs) {
+      simdjson::ondemand::object object;
+      if (doc.get_object().get(object)) {
+        continue;
+      }
+      PositionSample s = {};
+      for (auto field : object) {
+        std::string_view key, id;
+        double v;
+        if (field.unescaped_key().get(key)) {
+          break;
+        }
+        if (key == "arm_id") {
+          if (!field.value().get_string().get(id)) setArmId(s, id);
+        } else if (!field.value().get_double().get(v)) {
+          setField(s, key, v);
+        }
+      }
+      sum += sampleSum(s);
+    }
+    return sum;
+  });
+#endif
+
+#ifdef HAVE_JSONCPP
+  run("JsonCpp", stream, lines, [&] {
+    double sum = 0.0;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value root;
+    const char* p = stream.data();
+    const char* end = p + stream.size();
+    while (p < end) {
+      const char* nl = shoplifter::detail::findNewline(p, end);
+      if (reader->parse(p, nl, &root, nullptr) && root.isObject()) {
+        PositionSample s = {};
+        for (auto it = root.begin(); it != root.end(); ++it) {
+          if (it->isNumeric()) {
+            setField(s, it.name(), it->asDouble());
+          } else if (it.name() == "arm_id" && it->isString()) {
+            setArmId(s, it->asString());
+          }
+        }
+        sum += sampleSum(s);
+      }
+      p = nl + 1;
+    }
+    return sum;
+  });
+#endif
+
+#if !defined(HAVE_NLOHMANN_JSON) && !defined(HAVE_SIMDJSON) && !defined(HAVE_JSONCPP)
+  std::printf("  (no generic JSON library found; install nlohmann/json, simdjson or JsonCpp to compare)\n");
+#endif
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    benchStream("synthetic firmware stream", syntheticStream(1000000));
+    return 0;
+  }
+  for (int i = 1; i < argc; i++) {
+    std::string stream = readFile(argv[i]);
+    if (stream.empty()) {
+      std::fprintf(stderr, "Could not read %s\n", argv[i]);
+      return 1;
+    }
+    benchStream(argv[i], stream);
+  }
+  return 0;
+}
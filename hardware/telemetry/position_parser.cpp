@@ -0,0 +1,534 @@
+/**
+ * Position Telemetry Parser
+ *
+ * See position_parser.h for the accepted format and the "t" key rules.
+ */
+
+#include "hardware/telemetry/position_parser.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace shoplifter {
+
+namespace detail {
+
+const char* findNewline(const char* begin, const char* end) {
+  // memchr is already vectorized by every libc we target
+  const void* nl = std::memchr(begin, '\n', static_cast<size_t>(end - begin));
+  return nl ? static_cast<const char*>(nl) : end;
+}
+
+}  // namespace detail
+
+namespace {
+
+constexpr size_t kBlockSize = 64;
+constexpr size_t kMaxBlocks = kMaxPositionLineLength / kBlockSize;
+
+/**
+ * Bit i set where block[i] == c, for a full 64-byte block
+ */
+inline uint64_t matchBlock(const char* block, char c) {
+#if defined(__AVX2__)
+  const __m256i needle = _mm256_set1_epi8(c);
+  const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+  const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+  const uint32_t mlo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle)));
+  const uint32_t mhi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle)));
+  return static_cast<uint64_t>(mlo) | (static_cast<uint64_t>(mhi) << 32);
+#elif defined(__SSE2__)
+  const __m128i needle = _mm_set1_epi8(c);
+  uint64_t mask = 0;
+  for (int i = 0; i < 4; i++) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+    mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)))) << (16 * i);
+  }
+  return mask;
+#elif defined(__ARM_NEON)
+  const uint8x16_t needle = vdupq_n_u8(static_cast<uint8_t>(c));
+  const uint8x16_t bits = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+  uint64_t mask = 0;
+  for (int i = 0; i < 4; i++) {
+    const uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(block + 16 * i));
+    const uint8x16_t m = vandq_u8(vceqq_u8(v, needle), bits);
+    const uint8x8_t folded = vpadd_u8(vget_low_u8(m), vget_high_u8(m));
+    const uint8x8_t f2 = vpadd_u8(folded, folded);
+    const uint8x8_t f3 = vpadd_u8(f2, f2);
+    mask |= static_cast<uint64_t>(vget_lane_u16(vreinterpret_u16_u8(f3), 0)) << (16 * i);
+  }
+  return mask;
+#else
+  uint64_t mask = 0;
+  for (size_t i = 0; i < kBlockSize; i++) {
+    mask |= static_cast<uint64_t>(block[i] == c) << i;
+  }
+  return mask;
+#endif
+}
+
+/**
+ * Quote bitmap of a whole line
+ *
+ * The line must be followed by a block of zero padding, so the tail block is
+ * loaded in place.
+ */
+struct QuoteIndex {
+  uint64_t quotes[kMaxBlocks];
+  size_t blocks;
+  bool hasBackslash;
+
+  void build(const char* line, size_t length) {
+    blocks = (length + kBlockSize - 1) / kBlockSize;
+    uint64_t backslashes = 0;
+    for (size_t i = 0; i < blocks; i++) {
+      quotes[i] = matchBlock(line + i * kBlockSize, '"');
+      backslashes |= matchBlock(line + i * kBlockSize, '\\');
+    }
+    hasBackslash = backslashes != 0;
+  }
+
+  /**
+   * Position of the first quote at or after pos, or SIZE_MAX
+   */
+  size_t next(size_t pos) const {
+    size_t block = pos / kBlockSize;
+    if (block >= blocks) {
+      return SIZE_MAX;
+    }
+    uint64_t m = quotes[block] & (~0ull << (pos % kBlockSize));
+    while (m == 0) {
+      if (++block >= blocks) {
+        return SIZE_MAX;
+      }
+      m = quotes[block];
+    }
+    return block * kBlockSize + static_cast<size_t>(__builtin_ctzll(m));
+  }
+};
+
+inline bool isEscaped(const char* line, size_t quotePos) {
+  size_t n = 0;
+  while (quotePos > n && line[quotePos - 1 - n] == '\\') {
+    n++;
+  }
+  return (n & 1) != 0;
+}
+
+/**
+ * Closing quote of a string that starts after openPos
+ */
+inline size_t closingQuote(const QuoteIndex& index, const char* line, size_t openPos) {
+  size_t q = index.next(openPos + 1);
+  if (index.hasBackslash) {
+    while (q != SIZE_MAX && isEscaped(line, q)) {
+      q = index.next(q + 1);
+    }
+  }
+  return q;
+}
+
+inline size_t skipSpace(const char* line, size_t pos, size_t length) {
+  while (pos < length && (line[pos] == ' ' || line[pos] == '\t')) {
+    pos++;
+  }
+  return pos;
+}
+
+// Exact powers of ten representable as doubles
+constexpr double kPow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+inline uint64_t load8(const char* p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline bool isEightDigits(uint64_t v) {
+  return (((v & 0xF0F0F0F0F0F0F0F0ull) |
+           (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ==
+          0x3333333333333333ull);
+}
+
+inline uint32_t parseEightDigits(uint64_t v) {
+  const uint64_t mask = 0x000000FF000000FFull;
+  const uint64_t mul1 = 0x000F424000000064ull;  // 100 + (1000000 << 32)
+  const uint64_t mul2 = 0x0000271000000001ull;  // 1 + (10000 << 32)
+  v -= 0x3030303030303030ull;
+  v = (v * 10) + (v >> 8);
+  v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+  return static_cast<uint32_t>(v);
+}
+
+inline bool isDigit(char c) {
+  return static_cast<unsigned>(c - '0') < 10u;
+}
+
+// Index of the first byte of v that is not an ASCII digit, 8 if all are
+inline unsigned firstNonDigit(uint64_t v) {
+  // A carry out of a non-digit byte can only disturb later bytes, never the first non-digit
+  const uint64_t bad = ((v & 0xF0F0F0F0F0F0F0F0ull) ^ 0x3030303030303030ull) |
+                       (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) ^ 0x3030303030303030ull);
+  return bad ? static_cast<unsigned>(__builtin_ctzll(bad)) / 8 : 8;
+}
+
+// Value of the first n (1 .. 8) digit bytes of v, shifted up behind '0' padding
+inline uint32_t parseLeadingDigits(uint64_t v, unsigned n) {
+  if (n < 8) {
+    v = (v << (8 * (8 - n))) | (0x3030303030303030ull >> (8 * n));
+  }
+  return parseEightDigits(v);
+}
+
+/**
+ * Numbers of the form -?D{1,8}(.D{1,16})? from a buffer with at least 24
+ * readable bytes past begin; anything else returns nullptr for the general path
+ */
+inline const char* parsePaddedDouble(const char* begin, double& out) {
+  const char* p = begin;
+  const bool negative = *p == '-';
+  p += negative;
+  uint64_t w = load8(p);
+  const unsigned intDigits = firstNonDigit(w);
+  if (intDigits == 0 || intDigits == 8) {
+    return nullptr;
+  }
+  uint64_t mantissa = parseLeadingDigits(w, intDigits);
+  p += intDigits;
+  unsigned fracDigits = 0;
+  if (*p == '.') {
+    p++;
+    w = load8(p);
+    fracDigits = firstNonDigit(w);
+    if (fracDigits == 0) {
+      return nullptr;
+    }
+    if (fracDigits < 8) {
+      mantissa = mantissa * static_cast<uint64_t>(kPow10[fracDigits]) + parseLeadingDigits(w, fracDigits);
+    } else {
+      const uint64_t w2 = load8(p + 8);
+      const unsigned more = firstNonDigit(w2);
+      if (more == 8 || intDigits + 8 + more > 19) {
+        return nullptr;
+      }
+      mantissa = mantissa * 100000000ull + parseEightDigits(w);
+      if (more > 0) {
+        mantissa = mantissa * static_cast<uint64_t>(kPow10[more]) + parseLeadingDigits(w2, more);
+      }
+      fracDigits += more;
+    }
+    p += fracDigits;
+  }
+  if (*p == 'e' || *p == 'E' || mantissa > (1ull << 53)) {
+    return nullptr;
+  }
+  // Clinger: exact mantissa over an exact power of ten rounds correctly
+  const double v = static_cast<double>(mantissa) / kPow10[fracDigits];
+  out = negative ? -v : v;
+  return p;
+}
+
+double slowParse(const char* begin, const char* end) {
+  char buf[64];
+  size_t n = static_cast<size_t>(end - begin);
+  if (n >= sizeof(buf)) {
+    n = sizeof(buf) - 1;
+  }
+  std::memcpy(buf, begin, n);
+  buf[n] = '\0';
+  return std::strtod(buf, nullptr);
+}
+
+enum FieldKey {
+  kKeyUnknown,
+  kKeyArmId,
+  kKeyT,
+  kKeyB,
+  kKeyS,
+  kKeyE,
+  kKeyR,
+  kKeyG,
+  kKeyX,
+  kKeyY,
+  kKeyZ,
+  kKeyTilt,
+  kKeyHostTime,
+};
+
+inline FieldKey classifyKey(const char* key, size_t length) {
+  switch (length) {
+    case 1:
+      switch (key[0]) {
+        case 't': return kKeyT;
+        case 'b': return kKeyB;
+        case 's': return kKeyS;
+        case 'e': return kKeyE;
+        case 'r': return kKeyR;
+        case 'g': return kKeyG;
+        case 'x': return kKeyX;
+        case 'y': return kKeyY;
+        case 'z': return kKeyZ;
+        default: return kKeyUnknown;
+      }
+    case 4:
+      return std::memcmp(key, "tilt", 4) == 0 ? kKeyTilt : kKeyUnknown;
+    case 6:
+      return std::memcmp(key, "arm_id", 6) == 0 ? kKeyArmId : kKeyUnknown;
+    case 9:
+      return std::memcmp(key, "host_time", 9) == 0 ? kKeyHostTime : kKeyUnknown;
+    default:
+      return kKeyUnknown;
+  }
+}
+
+/**
+ * Skip a non-string value of an unknown key (number or literal)
+ */
+inline size_t skipScalar(const char* line, size_t pos, size_t length) {
+  while (pos < length && line[pos] != ',' && line[pos] != '}') {
+    if (line[pos] == '{' || line[pos] == '[') {
+      return SIZE_MAX;  // nested values are never part of position reports
+    }
+    pos++;
+  }
+  return pos;
+}
+
+}  // namespace
+
+const char* parseTelemetryDouble(const char* begin, const char* end, double& out) {
+  const char* p = begin;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    p++;
+  }
+
+  const char* digitsStart = p;
+  uint64_t mantissa = 0;
+  int exponent = 0;
+  int digits = 0;
+
+  // Integer part, eight digits at a time
+  while (end - p >= 8 && isEightDigits(load8(p)) && digits + 8 <= 19) {
+    mantissa = mantissa * 100000000ull + parseEightDigits(load8(p));
+    digits += (mantissa != 0) ? 8 : 0;
+    p += 8;
+  }
+  while (p < end && isDigit(*p)) {
+    if (digits < 19) {
+      mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+      digits += (mantissa != 0) ? 1 : 0;
+    } else {
+      exponent++;
+      digits++;
+    }
+    p++;
+  }
+  bool anyDigit = p != digitsStart;
+
+  // Fraction
+  if (p < end && *p == '.') {
+    p++;
+    const char* fracStart = p;
+    while (end - p >= 8 && digits + 8 <= 19 && isEightDigits(load8(p))) {
+      mantissa = mantissa * 100000000ull + parseEightDigits(load8(p));
+      exponent -= 8;
+      digits += (mantissa != 0) ? 8 : 0;
+      p += 8;
+    }
+    while (p < end && isDigit(*p)) {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+        exponent--;
+        digits += (mantissa != 0) ? 1 : 0;
+      } else {
+        digits++;
+      }
+      p++;
+    }
+    anyDigit = anyDigit || p != fracStart;
+  }
+  if (!anyDigit) {
+    return nullptr;
+  }
+
+  // Exponent
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char* expStart = p;
+    p++;
+    bool expNegative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+      expNegative = (*p == '-');
+      p++;
+    }
+    if (p >= end || !isDigit(*p)) {
+      p = expStart;  // "1e" is a number followed by garbage; let the caller reject it
+    } else {
+      int e = 0;
+      while (p < end && isDigit(*p)) {
+        if (e < 10000) {
+          e = e * 10 + (*p - '0');
+        }
+        p++;
+      }
+      exponent += expNegative ? -e : e;
+    }
+  }
+
+  // Clinger fast path: exact mantissa and exact power of ten give a correctly rounded result
+  if (digits <= 19 && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+    double v = static_cast<double>(mantissa);
+    v = exponent < 0 ? v / kPow10[-exponent] : v * kPow10[exponent];
+    out = negative ? -v : v;
+    return p;
+  }
+
+  out = slowParse(begin, p);
+  return p;
+}
+
+bool parsePositionLine(const char* input, size_t length, PositionSample& out) {
+  if (length == 0 || length > kMaxPositionLineLength) {
+    return false;
+  }
+
+  // Zero-padded copy: whole-block and whole-word loads never leave it, and never see digits past the end
+  alignas(64) char line[kMaxPositionLineLength + kBlockSize];
+  std::memcpy(line, input, length);
+  std::memset(line + length, 0, kBlockSize);
+
+  size_t pos = skipSpace(line, 0, length);
+  if (pos >= length || line[pos] != '{') {
+    return false;
+  }
+  pos++;
+
+  QuoteIndex index;
+  index.build(line, length);
+
+  uint32_t fields = 0;
+  int tCount = 0;
+  double firstT = 0.0;
+
+
+  for (;;) {
+    // Key; single-character keys are checked directly, longer ones use the quote index
+    pos = skipSpace(line, pos, length);
+    if (pos + 2 >= length || line[pos] != '"') {
+      return false;
+    }
+    const size_t keyOpen = pos;
+    const size_t keyClose = line[pos + 2] == '"' && line[pos + 1] != '\\'
+                                ? pos + 2
+                                : closingQuote(index, line, keyOpen);
+    if (keyClose == SIZE_MAX) {
+      return false;
+    }
+    const FieldKey key = classifyKey(line + keyOpen + 1, keyClose - keyOpen - 1);
+
+    pos = skipSpace(line, keyClose + 1, length);
+    if (pos >= length || line[pos] != ':') {
+      return false;
+    }
+    pos = skipSpace(line, pos + 1, length);
+    if (pos >= length) {
+      return false;
+    }
+
+    // Value
+    if (line[pos] == '"') {
+      const size_t valueClose = closingQuote(index, line, pos);
+      if (valueClose == SIZE_MAX) {
+        return false;
+      }
+      if (key == kKeyArmId) {
+        const size_t n = valueClose - pos - 1;
+        if (n > kMaxArmIdLength) {
+          return false;
+        }
+        std::memcpy(out.arm_id, line + pos + 1, n);
+        out.arm_id[n] = '\0';
+        out.arm_id_length = static_cast<uint32_t>(n);
+        fields |= kFieldArmId;
+      } else if (key != kKeyUnknown) {
+        return false;  // numeric field sent as a string
+      }
+      pos = valueClose + 1;
+    } else if (key == kKeyUnknown) {
+      pos = skipScalar(line, pos, length);
+      if (pos == SIZE_MAX) {
+        return false;
+      }
+    } else {
+      double v;
+      const char* next = parsePaddedDouble(line + pos, v);
+      if (!next || next > line + length) {
+        next = parseTelemetryDouble(line + pos, line + length, v);
+      }
+      if (!next) {
+        return false;
+      }
+      pos = static_cast<size_t>(next - line);
+      switch (key) {
+        case kKeyT:
+          if (tCount++ == 0) {
+            firstT = v;
+          } else {
+            // Two "t" keys: the earlier one is the device timestamp
+            out.device_ms = firstT;
+            firstT = v;
+            fields |= kFieldDeviceMs;
+          }
+          out.t = v;
+          fields |= kFieldWrist;
+          break;
+        case kKeyB: out.b = v; fields |= kFieldBase; break;
+        case kKeyS: out.s = v; fields |= kFieldShoulder; break;
+        case kKeyE: out.e = v; fields |= kFieldElbow; break;
+        case kKeyR: out.r = v; fields |= kFieldRoll; break;
+        case kKeyG: out.g = v; fields |= kFieldGripper; break;
+        case kKeyX: out.x = v; fields |= kFieldX; break;
+        case kKeyY: out.y = v; fields |= kFieldY; break;
+        case kKeyZ: out.z = v; fields |= kFieldZ; break;
+        case kKeyTilt: out.tilt = v; fields |= kFieldTilt; break;
+        case kKeyHostTime: out.host_time = v; fields |= kFieldHostTime; break;
+        default: return false;
+      }
+    }
+
+    // Separator
+    pos = skipSpace(line, pos, length);
+    if (pos >= length) {
+      return false;
+    }
+    if (line[pos] == ',') {
+      pos++;
+      continue;
+    }
+    if (line[pos] == '}') {
+      pos = skipSpace(line, pos + 1, length);
+      if (pos != length) {
+        return false;
+      }
+      break;
+    }
+    return false;
+  }
+
+  out.fields = fields;
+  return (fields & kRequiredPositionFields) == kRequiredPositionFields;
+}
+
+}  // namespace shoplifter
@@ -0,0 +1,253 @@
+/**
+ * Position Telemetry Parser
+ *
+ * Parser specialized for the fixed-shape JSON objects emitted by
+ * sendPositionData() in follower_position_feedback.h, and for the .jsonl
+ * recordings written by read_follower_positions.py (which add host_time and
+ * host_datetime and use ", " / ": " separators).
+ *
+ * Quote positions are located with SIMD compares (AVX2, SSE2 or NEON) in
+ * 64-byte blocks, and numbers go through a Clinger fast path with SWAR digit
+ * conversion, falling back to strtod only for long mantissas or large exponents.
+ *
+ * Duplicated "t" key:
+ * sendPositionData() assigns "t" twice (millis() then radT). ArduinoJson
+ * overwrites the value in place, so current firmware sends a single "t" that
+ * holds the wrist tilt. The parser resolves the key deterministically:
+ * the LAST "t" is always the wrist tilt, and when two are present the FIRST
+ * one is reported as the device timestamp in milliseconds.
+ */
+
+#ifndef POSITION_PARSER_H
+#define POSITION_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace shoplifter {
+
+// Maximum arm_id length kept by the parser (longer IDs are rejected)
+constexpr size_t kMaxArmIdLength = 31;
+
+// Lines longer than this are rejected
+constexpr size_t kMaxPositionLineLength = 1024;
+
+/**
+ * Field presence bits for PositionSample::fields
+ */
+enum PositionField : uint32_t {
+  kFieldArmId    = 1u << 0,
+  kFieldBase     = 1u << 1,
+  kFieldShoulder = 1u << 2,
+  kFieldElbow    = 1u << 3,
+  kFieldWrist    = 1u << 4,
+  kFieldRoll     = 1u << 5,
+  kFieldGripper  = 1u << 6,
+  kFieldX        = 1u << 7,
+  kFieldY        = 1u << 8,
+  kFieldZ        = 1u << 9,
+  kFieldTilt     = 1u << 10,
+  kFieldDeviceMs = 1u << 11,  // first of two "t" keys
+  kFieldHostTime = 1u << 12,  // added by the Python recorder
+
+  // Everything sendPositionData() always sends
+  kRequiredPositionFields = kFieldArmId | kFieldBase | kFieldShoulder | kFieldElbow |
+                            kFieldWrist | kFieldRoll | kFieldGripper |
+                            kFieldX | kFieldY | kFieldZ | kFieldTilt,
+};
+
+/**
+ * One decoded position report
+ *
+ * Joint angles are in radians, end-effector coordinates in millimeters.
+ */
+struct PositionSample {
+  char arm_id[kMaxArmIdLength + 1];
+  uint32_t arm_id_length;
+  uint32_t fields;          // PositionField bits that were present
+
+  double device_ms;         // valid if fields & kFieldDeviceMs
+  double host_time;         // valid if fields & kFieldHostTime (Unix seconds)
+
+  double b;                 // Base
+  double s;                 // Shoulder
+  double e;                 // Elbow
+  double t;                 // Wrist tilt
+  double r;                 // Wrist roll
+  double g;                 // Gripper
+
+  double x;                 // End-effector position
+  double y;
+  double z;
+  double tilt;              // End-effector tilt
+};
+
+/**
+ * Parse one position line
+ *
+ * @param line Start of the line (need not be NUL-terminated)
+ * @param length Line length in bytes, without the trailing newline
+ * @param out Sample to fill
+ * @return true if the line is a JSON object containing all required fields
+ */
+bool parsePositionLine(const char* line, size_t length, PositionSample& out);
+
+/**
+ * Parse a number with the fast float path used by parsePositionLine()
+ *
+ * @param begin First character of the number
+ * @param end End of the readable buffer
+ * @param out Parsed value
+ * @return Pointer one past the number, or nullptr if no number was found
+ */
+const char* parseTelemetryDouble(const char* begin, const char* end, double& out);
+
+/**
+ * Incremental parser for a byte stream of newline-terminated position lines
+ *
+ * Feed raw serial reads or file chunks; complete lines are parsed and handed
+ * to the callback, partial lines are buffered until the next feed(). A line
+ * longer than kMaxPositionLineLength is counted as rejected once, however
+ * many feeds it spans.
+ */
+class PositionStreamParser {
+ public:
+  /**
+   * Feed bytes and parse every complete line
+   *
+   * @param data Bytes received
+   * @param length Number of bytes
+   * @param onSample Called as onSample(const PositionSample&) for each valid line
+   * @return Number of valid samples emitted
+   */
+  template <typename Callback>
+  size_t feed(const char* data, size_t length, Callback&& onSample);
+
+  // Lines that were not valid position reports
+  uint64_t rejectedLines() const { return rejected_; }
+
+ private:
+  template <typename Callback>
+  bool handleLine(const char* line, size_t length, Callback& onSample);
+
+  std::string partial_;
+  PositionSample sample_;
+  uint64_t rejected_ = 0;
+  bool discarding_ = false;   // Inside a line counted as rejected for its length
+};
+
+/**
+ * Parse every complete line in a buffer
+ *
+ * @param data Buffer with newline-terminated lines (a final unterminated line is parsed too)
+ * @param length Buffer length
+ * @param onSample Called as onSample(const PositionSample&) for each valid line
+ * @param rejected Optional counter of invalid lines
+ * @return Number of valid samples emitted
+ */
+template <typename Callback>
+size_t parsePositionBuffer(const char* data, size_t length, Callback&& onSample, uint64_t* rejected = nullptr);
+
+// Template implementations
+
+namespace detail {
+const char* findNewline(const char* begin, const char* end);
+}  // namespace detail
+
+template <typename Callback>
+size_t parsePositionBuffer(const char* data, size_t length, Callback&& onSample, uint64_t* rejected) {
+  PositionSample sample;
+  size_t count = 0;
+  const char* p = data;
+  const char* end = data + length;
+  while (p < end) {
+    const char* nl = detail::findNewline(p, end);
+    size_t lineLength = static_cast<size_t>(nl - p);
+    if (lineLength > 0 && p[lineLength - 1] == '\r') {
+      lineLength--;
+    }
+    if (lineLength > 0) {
+      if (parsePositionLine(p, lineLength, sample)) {
+        onSample(static_cast<const PositionSample&>(sample));
+        count++;
+      } else if (rejected) {
+        (*rejected)++;
+      }
+    }
+    p = nl + 1;
+  }
+  return count;
+}
+
+template <typename Callback>
+bool PositionStreamParser::handleLine(const char* line, size_t length, Callback& onSample) {
+  if (length > 0 && line[length - 1] == '\r') {
+    length--;
+  }
+  if (length == 0) {
+    return false;
+  }
+  if (!parsePositionLine(line, length, sample_)) {
+    rejected_++;
+    return false;
+  }
+  onSample(static_cast<const PositionSample&>(sample_));
+  return true;
+}
+
+template <typename Callback>
+size_t PositionStreamParser::feed(const char* data, size_t length, Callback&& onSample) {
+  size_t count = 0;
+  const char* p = data;
+  const char* end = data + length;
+
+  // Drop the rest of a line already rejected as too long
+  if (discarding_) {
+    const char* nl = detail::findNewline(p, end);
+    if (nl == end) {
+      return 0;
+    }
+    discarding_ = false;
+    p = nl + 1;
+  }
+
+  // Complete a line left over from the previous feed
+  if (!partial_.empty()) {
+    const char* nl = detail::findNewline(p, end);
+    if (nl == end) {
+      partial_.append(p, static_cast<size_t>(end - p));
+      if (partial_.size() > kMaxPositionLineLength) {
+        partial_.clear();
+        rejected_++;
+        discarding_ = true;
+      }
+      return 0;
+    }
+    partial_.append(p, static_cast<size_t>(nl - p));
+    count += handleLine(partial_.data(), partial_.size(), onSample) ? 1 : 0;
+    partial_.clear();
+    p = nl + 1;
+  }
+
+  while (p < end) {
+    const char* nl = detail::findNewline(p, end);
+    if (nl == end) {
+      // Keep the unterminated tail for the next feed
+      if (static_cast<size_t>(end - p) <= kMaxPositionLineLength) {
+        partial_.assign(p, static_cast<size_t>(end - p));
+      } else {
+        rejected_++;
+        discarding_ = true;
+      }
+      break;
+    }
+    count += handleLine(p, static_cast<size_t>(nl - p), onSample) ? 1 : 0;
+    p = nl + 1;
+  }
+  return count;
+}
+
+}  // namespace shoplifter
+
+#endif // POSITION_PARSER_H
@@ -2,7 +2,8 @@
  * UART Control with Arm Identity Support
  * 
  * This is a modified version of the original uart_ctrl.h that adds
- * support for the arm identity command (CMD_SET_ARM_IDENTITY).
+ * support for the arm identity commands (CMD_SET_ARM_IDENTITY and
+ * CMD_GET_ARM_IDENTITY) and joint velocity streaming (CMD_JOINTS_VEL_CTRL).
  */
 
 // Command handler for incoming JSON commands
@@ -20,6 +21,21 @@ void jsonCmdReceiveHandler() {
       jsonInfoHttp["arm_id"] = armIdentity;
       break;
       
+    // Query arm identity; answered directly on Serial for port discovery
+    // {"T":401}
+    case CMD_GET_ARM_IDENTITY:
+      sendArmIdentity();
+      jsonInfoHttp.clear();
+      jsonInfoHttp["status"] = "ok";
+      jsonInfoHttp["arm_id"] = armIdentity;
+      break;
+      
+    // Stream joint velocities, integrated on the arm until ttl ms pass
+    // {"T":410,"v":[0,0.1,-0.1,0,0,0],"ttl":50}
+    case CMD_JOINTS_VEL_CTRL:
+      setJointVelocities(jsonCmdReceive);
+      break;
+
     // ... other commands remain the same ...
   }
 }
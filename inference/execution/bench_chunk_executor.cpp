@@ -0,0 +1,196 @@
+/**
+ * Action-Chunk Executor Benchmark
+ *
+ * 1. setpoint() cost with every chunk slot covering the tick, and the heap
+ *    allocations made by submit() and setpoint() (should be none).
+ * 2. A live run: a policy thread submits noisy chunks of a smooth reference
+ *    trajectory at --policy-rate while run() commands the channel at --rate.
+ *    Reports deadline statistics, tracking error against the reference and
+ *    the largest setpoint jump between ticks (chunk-boundary discontinuities),
+ *    for the given ensembling decay and for the newest chunk alone.
+ *
+ * Usage:
+ *   bench_chunk_executor [--channel null] [--rate 100] [--policy-rate 10] [--horizon 50]
+ *                        [--decay 0.01] [--seconds 3]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "inference/execution/chunk_executor.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+
+// Smooth reference motion, radians
+void reference(int64_t timeNs, double* joints) {
+  const double t = timeNs * 1e-9;
+  for (size_t j = 0; j < kArmJointCount; j++) {
+    joints[j] = 0.5 * std::sin(0.7 * t * (j + 1) + j) + 0.1 * std::sin(3.0 * t + 2 * j);
+  }
+}
+
+// Chunk predicted at `now`: the reference plus a per-chunk offset and noise
+void predict(int64_t now, int64_t stepNs, size_t horizon, uint64_t& rng, double* chunk) {
+  auto uniform = [&]() {
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<double>(rng >> 11) * 0x1p-53 - 0.5;
+  };
+  const double bias = 0.04 * uniform();
+  for (size_t i = 0; i < horizon; i++) {
+    reference(now + static_cast<int64_t>(i) * stepNs, chunk + i * kArmJointCount);
+    for (size_t j = 0; j < kArmJointCount; j++) {
+      chunk[i * kArmJointCount + j] += bias + 0.01 * uniform();
+    }
+  }
+}
+
+void measureSetpoint(size_t horizon) {
+  ChunkExecutorOptions options;
+  options.horizon = horizon;
+  ChunkExecutor executor(options);
+  const int64_t stepNs = 10000000;
+  std::vector<double> chunk(horizon * kArmJointCount);
+  uint64_t rng = 1;
+  for (size_t c = 0; c < options.maxChunks; c++) {
+    predict(0, stepNs, horizon, rng, chunk.data());
+    executor.submit(static_cast<int64_t>(c) * stepNs, stepNs, chunk.data(), horizon);
+  }
+
+  const int iterations = 200000;
+  double joints[kArmJointCount];
+  const int64_t t = static_cast<int64_t>(options.maxChunks) * stepNs;
+  const uint64_t before = allocations.load();
+  size_t blended = 0;
+  const auto begin = Clock::now();
+  for (int i = 0; i < iterations; i++) {
+    blended += executor.setpoint(t + i % 1000 * 1000, joints);
+  }
+  const double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / iterations;
+  for (size_t c = 0; c < options.maxChunks; c++) {
+    executor.submit(t + static_cast<int64_t>(c) * stepNs, stepNs, chunk.data(), horizon);
+  }
+  std::printf("setpoint(): %.0f ns with %zu chunks blended, %llu allocations in the hot path\n", ns,
+              blended / iterations, static_cast<unsigned long long>(allocations.load() - before));
+}
+
+void liveRun(const std::string& spec, const ChunkExecutorOptions& options, double policyRate, double seconds,
+             const char* label) {
+  std::unique_ptr<ArmCommandChannel> channel = openCommandChannel(spec);
+  ChunkExecutor executor(options);
+  const int64_t stepNs = static_cast<int64_t>(1e9 / options.rate);
+
+  std::atomic<bool> done{false};
+  std::thread policy([&]() {
+    std::vector<double> chunk(options.horizon * kArmJointCount);
+    uint64_t rng = 7;
+    const int64_t periodNs = static_cast<int64_t>(1e9 / policyRate);
+    for (int64_t next = ChunkExecutor::nowNs(); !done.load(std::memory_order_relaxed); next += periodNs) {
+      predict(next, stepNs, options.horizon, rng, chunk.data());
+      executor.submit(next, stepNs, chunk.data(), options.horizon);
+      const int64_t wait = next + periodNs - ChunkExecutor::nowNs();
+      if (wait > 0) std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+    }
+  });
+  std::thread timer([&]() {
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    executor.stop();
+  });
+
+  double squaredError = 0.0, maxJump = 0.0;
+  double last[kArmJointCount];
+  bool haveLast = false;
+  uint64_t tracked = 0;
+  const ExecutorStats stats = executor.run(*channel, [&](const ExecutorTick& tick) {
+    if (!tick.chunks) {
+      haveLast = false;
+      return;
+    }
+    double expected[kArmJointCount];
+    reference(tick.timeNs, expected);
+    for (size_t j = 0; j < kArmJointCount; j++) {
+      squaredError += (tick.joints[j] - expected[j]) * (tick.joints[j] - expected[j]);
+      if (haveLast) maxJump = std::max(maxJump, std::fabs(tick.joints[j] - last[j]));
+      last[j] = tick.joints[j];
+    }
+    haveLast = true;
+    tracked++;
+  });
+  timer.join();
+  done.store(true);
+  policy.join();
+
+  std::printf("%-16s %7llu %7llu %7llu %7llu %9.3f %9.3f %9.4f %9.4f\n", label,
+              static_cast<unsigned long long>(stats.ticks), static_cast<unsigned long long>(stats.uncovered),
+              static_cast<unsigned long long>(stats.refused), static_cast<unsigned long long>(stats.readRetries),
+              stats.latenessP50 * 1e3, stats.latenessP99 * 1e3,
+              tracked ? std::sqrt(squaredError / (tracked * kArmJointCount)) : 0.0, maxJump);
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char** argv) {
+  std::string spec = "null";
+  ChunkExecutorOptions options;
+  options.horizon = 50;
+  double policyRate = 10.0;
+  double seconds = 3.0;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--channel")) spec = next();
+    else if (!std::strcmp(argv[i], "--rate")) options.rate = std::atof(next());
+    else if (!std::strcmp(argv[i], "--policy-rate")) policyRate = std::atof(next());
+    else if (!std::strcmp(argv[i], "--horizon")) options.horizon = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--decay")) options.ensembleDecay = std::atof(next());
+    else if (!std::strcmp(argv[i], "--seconds")) seconds = std::atof(next());
+    else {
+      std::fprintf(stderr,
+                   "Usage: %s [--channel null] [--rate 100] [--policy-rate 10] [--horizon 50] [--decay 0.01] "
+                   "[--seconds 3]\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+
+  try {
+    measureSetpoint(options.horizon);
+    std::printf("\n%s, control %.0f Hz, policy %.0f Hz, horizon %zu\n", spec.c_str(), options.rate, policyRate,
+                options.horizon);
+    std::printf("%-16s %7s %7s %7s %7s %9s %9s %9s %9s\n", "blend", "ticks", "uncov", "refused", "retries",
+                "p50 ms", "p99 ms", "rms rad", "max jump");
+    liveRun(spec, options, policyRate, seconds, "ensemble");
+    // The newest chunk alone: one slot, so every submit replaces the previous chunk
+    ChunkExecutorOptions latest = options;
+    latest.maxChunks = 1;
+    liveRun(spec, latest, policyRate, seconds, "newest chunk");
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
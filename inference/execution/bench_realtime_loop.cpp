@@ -0,0 +1,181 @@
+/**
+ * Real-Time Control Loop Benchmark
+ *
+ * Runs the full control path in a RealtimeLoop for --seconds:
+ *
+ *   telemetry in   ArmStateReader::latest() of an arm published at 500 Hz
+ *   policy         a 10 Hz thread submitting action chunks to a ChunkExecutor
+ *   command out    ChunkExecutor::setpoint() sent through an ArmCommandChannel
+ *
+ * while --load threads stand in for recording and visualization: each
+ * streams through a 32 MiB buffer, evicting the caches, and yields now and
+ * then. Prints what real-time setup was applied, wakeup latency and compute
+ * percentiles and overruns, and fails if the p99.9 wakeup latency (tick
+ * jitter) is above --max-jitter-ms. --trace writes the ticks as Chrome
+ * trace JSON.
+ *
+ * Usage:
+ *   bench_realtime_loop [--rate 500] [--cpu N] [--priority 80] [--no-lock] [--seconds 10]
+ *                       [--load 4] [--channel null] [--max-jitter-ms 1] [--trace ticks.json]
+ */
+
+#include <sched.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hardware/telemetry/arm_state_shm.h"
+#include "inference/execution/chunk_executor.h"
+#include "inference/execution/realtime_loop.h"
+
+using namespace shoplifter;
+
+namespace {
+
+constexpr const char* kShmName = "/shoplifter_realtime_bench";
+constexpr double kTelemetryRate = 500.0;
+constexpr double kPolicyRate = 10.0;
+constexpr size_t kHorizon = 50;
+constexpr size_t kLoadBytes = 32u << 20;
+
+// Smooth joint motion, radians
+void reference(int64_t timeNs, double* joints) {
+  const double t = static_cast<double>(timeNs) * 1e-9;
+  for (size_t j = 0; j < kArmJointCount; j++) {
+    joints[j] = 0.5 * std::sin(0.7 * t * static_cast<double>(j + 1) + static_cast<double>(j));
+  }
+}
+
+void printStats(const TickStats& s) {
+  std::printf("%-10s %9s %9s %9s %9s\n", "ms", "p50", "p99", "p99.9", "max");
+  std::printf("%-10s %9.3f %9.3f %9.3f %9.3f\n", "wakeup", s.wakeupP50 * 1e3, s.wakeupP99 * 1e3,
+              s.wakeupP999 * 1e3, s.wakeupMax * 1e3);
+  std::printf("%-10s %9.3f %9.3f %9.3f %9.3f\n", "compute", s.computeP50 * 1e3, s.computeP99 * 1e3,
+              s.computeP999 * 1e3, s.computeMax * 1e3);
+  std::printf("%llu ticks, %llu overruns, %llu skipped\n", static_cast<unsigned long long>(s.ticks),
+              static_cast<unsigned long long>(s.overruns), static_cast<unsigned long long>(s.skipped));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  RealtimeOptions options;
+  double seconds = 10.0;
+  size_t loadThreads = 4;
+  std::string spec = "null";
+  double maxJitterMs = 1.0;
+  std::string tracePath;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--rate")) options.rate = std::atof(next());
+    else if (!std::strcmp(argv[i], "--cpu")) options.cpu = std::atoi(next());
+    else if (!std::strcmp(argv[i], "--priority")) options.priority = std::atoi(next());
+    else if (!std::strcmp(argv[i], "--no-lock")) options.lockMemory = false;
+    else if (!std::strcmp(argv[i], "--seconds")) seconds = std::atof(next());
+    else if (!std::strcmp(argv[i], "--load")) loadThreads = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--channel")) spec = next();
+    else if (!std::strcmp(argv[i], "--max-jitter-ms")) maxJitterMs = std::atof(next());
+    else if (!std::strcmp(argv[i], "--trace")) tracePath = next();
+    else {
+      std::fprintf(stderr,
+                   "Usage: %s [--rate 500] [--cpu N] [--priority 80] [--no-lock] [--seconds 10] [--load 4] "
+                   "[--channel null] [--max-jitter-ms 1] [--trace ticks.json]\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+
+  try {
+    ArmStatePublisher publisher(kShmName, 1, 64);
+    const int arm = publisher.addArm("follower");
+    ArmStateReader reader(kShmName);
+    std::unique_ptr<ArmCommandChannel> channel = openCommandChannel(spec);
+    ChunkExecutorOptions executorOptions;
+    executorOptions.horizon = kHorizon;
+    executorOptions.rate = options.rate;
+    ChunkExecutor executor(executorOptions);
+    options.traceTicks = std::max<size_t>(options.traceTicks, static_cast<size_t>(seconds * options.rate) + 1);
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]() {
+      double values[kPositionChannelCount] = {};
+      const int64_t periodNs = static_cast<int64_t>(1e9 / kTelemetryRate);
+      for (int64_t t = ChunkExecutor::nowNs(); !done.load(std::memory_order_relaxed); t += periodNs) {
+        values[kChannelHostTime] = static_cast<double>(t) * 1e-9;  // Monotonic here, so ticks can age it
+        reference(t, values + kChannelBase);
+        publisher.publish(arm, values);
+        std::this_thread::sleep_for(std::chrono::nanoseconds(std::max<int64_t>(0, t + periodNs - ChunkExecutor::nowNs())));
+      }
+    });
+    threads.emplace_back([&]() {
+      std::vector<double> chunk(kHorizon * kArmJointCount);
+      const int64_t stepNs = static_cast<int64_t>(1e9 / options.rate);
+      const int64_t periodNs = static_cast<int64_t>(1e9 / kPolicyRate);
+      for (int64_t t = ChunkExecutor::nowNs(); !done.load(std::memory_order_relaxed); t += periodNs) {
+        for (size_t i = 0; i < kHorizon; i++) reference(t + static_cast<int64_t>(i) * stepNs, chunk.data() + i * kArmJointCount);
+        executor.submit(t, stepNs, chunk.data(), kHorizon);
+        std::this_thread::sleep_for(std::chrono::nanoseconds(std::max<int64_t>(0, t + periodNs - ChunkExecutor::nowNs())));
+      }
+    });
+    for (size_t l = 0; l < loadThreads; l++) {
+      threads.emplace_back([&, l]() {
+        std::vector<uint8_t> buffer(kLoadBytes);
+        for (uint64_t pass = 0; !done.load(std::memory_order_relaxed); pass++) {
+          for (size_t i = 0; i < buffer.size(); i += 64) buffer[i] = static_cast<uint8_t>(buffer[i] + pass + l);
+          if (pass % 4 == 0) sched_yield();
+        }
+      });
+    }
+
+    RealtimeLoop loop(options);
+    double maxAge = 0.0;
+    loop.start([&](uint64_t, int64_t deadlineNs) {
+      ArmState state;
+      if (reader.latest(arm, state)) {
+        maxAge = std::max(maxAge, static_cast<double>(deadlineNs) * 1e-9 - state.values[kChannelHostTime]);
+      }
+      double joints[kArmJointCount];
+      if (executor.setpoint(deadlineNs, joints)) {
+        channel->sendJoints(joints);
+      }
+    });
+    const RealtimeStatus& status = loop.status();
+    std::printf("%s, %.0f Hz, %zu load threads\n", spec.c_str(), options.rate, loadThreads);
+    std::printf("SCHED_FIFO %s, mlockall %s, pinned %s%s\n", status.fifo ? "yes" : "no",
+                status.memoryLocked ? "yes" : "no", status.pinned ? "yes" : "no",
+                status.pinned ? (status.isolated ? " (isolated core)" : " (core not isolated)") : "");
+    if (!status.problems.empty()) std::printf("%s", status.problems.c_str());
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    loop.stop();
+    done.store(true);
+    for (std::thread& t : threads) t.join();
+    ArmStatePublisher::unlink(kShmName);
+
+    const TickStats stats = loop.stats();
+    printStats(stats);
+    std::printf("oldest telemetry sample a tick used: %.3f ms\n", maxAge * 1e3);
+    if (!tracePath.empty()) {
+      loop.dumpChromeTrace(tracePath);
+      std::printf("Wrote %s\n", tracePath.c_str());
+    }
+    const bool ok = stats.wakeupP999 * 1e3 < maxJitterMs;
+    std::printf("p99.9 tick jitter %.3f ms %s %.3f ms: %s\n", stats.wakeupP999 * 1e3, ok ? "<" : ">=", maxJitterMs,
+                ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    ArmStatePublisher::unlink(kShmName);
+    return 1;
+  }
+}
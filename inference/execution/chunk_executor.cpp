@@ -0,0 +1,201 @@
+/**
+ * Action-Chunk Executor
+ */
+
+#include "inference/execution/chunk_executor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "utils/deadline_clock.h"
+
+namespace shoplifter {
+
+namespace {
+
+constexpr int kReadAttempts = 3;
+
+double percentile(std::vector<double>& values, size_t n, double p) {
+  if (n == 0) {
+    return 0.0;
+  }
+  const size_t k = std::min(n - 1, static_cast<size_t>(p * n));
+  std::nth_element(values.begin(), values.begin() + k, values.begin() + n);
+  return values[k];
+}
+
+}  // namespace
+
+ChunkExecutor::ChunkExecutor(const ChunkExecutorOptions& options) : options_(options) {
+  if (options_.horizon == 0 || options_.maxChunks == 0 || !(options_.rate > 0.0)) {
+    throw std::invalid_argument("Chunk executor needs a positive horizon, chunk count and rate");
+  }
+  slots_.reset(new Slot[options_.maxChunks]);
+  for (size_t s = 0; s < options_.maxChunks; s++) {
+    slots_[s].targets.reset(new std::atomic<double>[options_.horizon * kArmJointCount]);
+    for (size_t i = 0; i < options_.horizon * kArmJointCount; i++) {
+      slots_[s].targets[i].store(0.0, std::memory_order_relaxed);
+    }
+  }
+  weights_.resize(options_.maxChunks);
+  for (size_t i = 0; i < options_.maxChunks; i++) {
+    weights_[i] = std::exp(-options_.ensembleDecay * static_cast<double>(i));
+  }
+  samples_.assign(options_.maxChunks * kArmJointCount, 0.0);
+  ids_.assign(options_.maxChunks, 0);
+  order_.assign(options_.maxChunks, 0);
+  lateness_.assign(std::max<size_t>(options_.latencyHistory, 1), 0.0);
+}
+
+int64_t ChunkExecutor::nowNs() { return monotonicNs(); }
+
+bool ChunkExecutor::submit(int64_t startNs, int64_t stepNs, const double* targets, size_t count) {
+  if (count == 0 || count > options_.horizon || stepNs <= 0) {
+    return false;
+  }
+  const uint64_t n = submitted_.load(std::memory_order_relaxed);
+  Slot& slot = slots_[n % options_.maxChunks];
+
+  slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.startNs.store(startNs, std::memory_order_relaxed);
+  slot.stepNs.store(stepNs, std::memory_order_relaxed);
+  slot.count.store(count, std::memory_order_relaxed);
+  for (size_t i = 0; i < count * kArmJointCount; i++) {
+    slot.targets[i].store(targets[i], std::memory_order_relaxed);
+  }
+  slot.seq.store(2 * n + 2, std::memory_order_release);
+  submitted_.store(n + 1, std::memory_order_release);
+  return true;
+}
+
+bool ChunkExecutor::sample(const Slot& slot, int64_t timeNs, uint64_t& id, double* joints) const {
+  for (int attempt = 0; attempt < kReadAttempts; attempt++) {
+    const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq == 0) {
+      return false;                    // never written
+    }
+    if (seq & 1) {
+      retries_++;
+      continue;
+    }
+    const int64_t start = slot.startNs.load(std::memory_order_relaxed);
+    const int64_t step = slot.stepNs.load(std::memory_order_relaxed);
+    const uint64_t count = slot.count.load(std::memory_order_relaxed);
+    const int64_t offset = timeNs - start;
+    bool covered = step > 0 && count > 0 && offset >= 0 && offset <= static_cast<int64_t>(count - 1) * step;
+    if (covered) {
+      const uint64_t i = static_cast<uint64_t>(offset / step);
+      const double frac = static_cast<double>(offset - static_cast<int64_t>(i) * step) / static_cast<double>(step);
+      const std::atomic<double>* a = &slot.targets[i * kArmJointCount];
+      const std::atomic<double>* b = i + 1 < count ? a + kArmJointCount : a;
+      for (size_t j = 0; j < kArmJointCount; j++) {
+        const double va = a[j].load(std::memory_order_relaxed);
+        joints[j] = va + frac * (b[j].load(std::memory_order_relaxed) - va);
+      }
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq) {
+      retries_++;
+      continue;
+    }
+    id = seq / 2 - 1;
+    return covered;
+  }
+  return false;                        // being rewritten with a newer chunk; skip it this tick
+}
+
+size_t ChunkExecutor::setpoint(int64_t timeNs, double* joints) {
+  size_t n = 0;
+  for (size_t s = 0; s < options_.maxChunks; s++) {
+    if (sample(slots_[s], timeNs, ids_[n], &samples_[n * kArmJointCount])) {
+      order_[n] = static_cast<uint32_t>(n);
+      n++;
+    }
+  }
+  if (n == 0) {
+    return 0;
+  }
+
+  // Oldest chunk first; at most maxChunks entries
+  for (size_t i = 1; i < n; i++) {
+    const uint32_t k = order_[i];
+    size_t j = i;
+    for (; j > 0 && ids_[order_[j - 1]] > ids_[k]; j--) {
+      order_[j] = order_[j - 1];
+    }
+    order_[j] = k;
+  }
+
+  double acc[kArmJointCount] = {};
+  double total = 0.0;
+  for (size_t r = 0; r < n; r++) {
+    const double w = weights_[r];
+    const double* x = &samples_[order_[r] * kArmJointCount];
+    for (size_t j = 0; j < kArmJointCount; j++) {
+      acc[j] += w * x[j];
+    }
+    total += w;
+  }
+  for (size_t j = 0; j < kArmJointCount; j++) {
+    joints[j] = acc[j] / total;
+  }
+  return n;
+}
+
+void ChunkExecutor::clear() {
+  for (size_t s = 0; s < options_.maxChunks; s++) {
+    slots_[s].seq.store(0, std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+ExecutorStats ChunkExecutor::run(ArmCommandChannel& channel, const std::function<void(const ExecutorTick&)>& onTick) {
+  ExecutorStats stats;
+  stop_.store(false, std::memory_order_relaxed);
+  const int64_t periodNs = static_cast<int64_t>(1e9 / options_.rate);
+  const uint64_t retriesBefore = retries_;
+  const size_t history = lateness_.size();
+
+  const int64_t start = nowNs();
+  ExecutorTick tick;
+  for (uint64_t k = 0; !stop_.load(std::memory_order_relaxed);) {
+    int64_t deadline = start + static_cast<int64_t>(k) * periodNs;
+    sleepUntilNs(deadline);
+    int64_t now = nowNs();
+    if (options_.skipLate && now - deadline > periodNs) {
+      const uint64_t due = static_cast<uint64_t>((now - start) / periodNs);
+      stats.skipped += due - k;
+      k = due;
+      deadline = start + static_cast<int64_t>(k) * periodNs;
+    }
+
+    tick.index = k;
+    tick.timeNs = deadline;
+    tick.chunks = setpoint(deadline, tick.joints);
+    tick.sent = tick.chunks > 0 && channel.sendJoints(tick.joints);
+    now = nowNs();
+    tick.lateness = (now - deadline) * 1e-9;
+
+    stats.uncovered += tick.chunks == 0;
+    stats.refused += tick.chunks > 0 && !tick.sent;
+    stats.missedDeadlines += (now - deadline) * 2 > periodNs;
+    stats.latenessMax = std::max(stats.latenessMax, tick.lateness);
+    lateness_[stats.ticks % history] = tick.lateness;
+    stats.ticks++;
+    if (onTick) {
+      onTick(tick);
+    }
+    k++;
+  }
+
+  const size_t kept = static_cast<size_t>(std::min<uint64_t>(stats.ticks, history));
+  stats.latenessP50 = percentile(lateness_, kept, 0.50);
+  stats.latenessP99 = percentile(lateness_, kept, 0.99);
+  stats.readRetries = retries_ - retriesBefore;
+  return stats;
+}
+
+}  // namespace shoplifter
@@ -0,0 +1,157 @@
+/**
+ * Action-Chunk Executor
+ *
+ * Turns action chunks from a slow policy into a fast, smooth stream of joint
+ * setpoints. Every policy step predicts a chunk of K future joint targets,
+ * one per chunk step, starting at a given time:
+ *
+ *   target(i) at startNs + i * stepNs, i < K
+ *
+ * Chunks from consecutive policy steps overlap in time. Each control tick,
+ * every chunk that covers the tick time is interpolated linearly between its
+ * two neighbouring targets, and the results are blended with the temporal
+ * ensembling weights of ACT (Zhao et al., 2023):
+ *
+ *   w_i = exp(-m * i), i = 0 for the oldest covering chunk
+ *
+ * normalized to sum to one. m > 0 favours older predictions (smoother, the
+ * ACT default), m < 0 newer ones (more reactive), m = 0 is a plain average.
+ * The blend goes out through an ArmCommandChannel on absolute deadlines, so
+ * a 10 Hz policy can command the arm at 100 Hz or more. Ticks that no chunk
+ * covers send nothing and the arm holds its last target.
+ *
+ * submit() (policy thread) and setpoint() / run() (control thread) share a
+ * ring of preallocated chunk slots, each guarded by a seqlock like the
+ * entries of hardware/telemetry/arm_state_shm.h: the writer never waits and
+ * the reader retries or skips a slot caught mid-write. Neither side locks or
+ * allocates after construction. There is one writer; callers with several
+ * policy threads must serialize submit().
+ */
+
+#ifndef CHUNK_EXECUTOR_H
+#define CHUNK_EXECUTOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "hardware/arm_interface/arm_command_channel.h"
+
+namespace shoplifter {
+
+struct ChunkExecutorOptions {
+  size_t horizon = 100;                // K: most targets in a chunk
+  size_t maxChunks = 16;               // chunks kept; the oldest is overwritten
+  double ensembleDecay = 0.01;         // m in w_i = exp(-m * i)
+  double rate = 100.0;                 // run(): control ticks per second
+  bool skipLate = true;                // run(): skip to the due tick when behind by more than a period
+  size_t latencyHistory = 4096;        // run(): ticks kept for the lateness percentiles
+};
+
+/**
+ * One control tick of run()
+ */
+struct ExecutorTick {
+  uint64_t index;                      // tick since run() started
+  int64_t timeNs;                      // deadline, CLOCK_MONOTONIC
+  double lateness;                     // send time minus deadline, seconds
+  size_t chunks;                       // chunks blended (0 = no chunk covered the tick)
+  bool sent;                           // false if nothing was sent or the channel refused it
+  double joints[kArmJointCount];       // setpoint, valid if chunks > 0
+};
+
+struct ExecutorStats {
+  uint64_t ticks = 0;
+  uint64_t skipped = 0;                // ticks skipped because the loop was late
+  uint64_t uncovered = 0;              // ticks no chunk covered (arm held its target)
+  uint64_t refused = 0;                // setpoints the channel did not accept
+  uint64_t missedDeadlines = 0;        // ticks sent more than half a period late
+  uint64_t readRetries = 0;            // chunk slots re-read because submit() was writing them
+  double latenessP50 = 0.0;            // over the last latencyHistory ticks
+  double latenessP99 = 0.0;
+  double latenessMax = 0.0;
+};
+
+class ChunkExecutor {
+ public:
+  /**
+   * @throws std::invalid_argument if horizon, maxChunks or rate is not positive
+   */
+  explicit ChunkExecutor(const ChunkExecutorOptions& options = ChunkExecutorOptions());
+
+  ChunkExecutor(const ChunkExecutor&) = delete;
+  ChunkExecutor& operator=(const ChunkExecutor&) = delete;
+
+  // CLOCK_MONOTONIC in nanoseconds, the time base of chunks and ticks
+  static int64_t nowNs();
+
+  /**
+   * Publish a chunk (policy thread)
+   *
+   * @param startNs Time of the first target, CLOCK_MONOTONIC
+   * @param stepNs Time between targets
+   * @param targets count x kArmJointCount joint targets in radians, step-major
+   * @param count Targets in the chunk, 1..horizon
+   * @return false (chunk dropped) if count or stepNs is out of range
+   */
+  bool submit(int64_t startNs, int64_t stepNs, const double* targets, size_t count);
+
+  /**
+   * Blend the chunks covering a time (control thread)
+   *
+   * @param timeNs CLOCK_MONOTONIC time
+   * @param joints Receives kArmJointCount setpoints if any chunk covers timeNs
+   * @return Chunks blended; 0 leaves joints untouched
+   */
+  size_t setpoint(int64_t timeNs, double* joints);
+
+  // Drop every chunk; not safe while submit() runs
+  void clear();
+
+  /**
+   * Send setpoints on absolute deadlines until stop() is called
+   *
+   * @param channel Arm to command
+   * @param onTick Called after every tick (may be empty)
+   */
+  ExecutorStats run(ArmCommandChannel& channel, const std::function<void(const ExecutorTick&)>& onTick = {});
+
+  // Ask run() to return after the current tick; safe from other threads and signal handlers
+  void stop() { stop_.store(true, std::memory_order_relaxed); }
+
+  const ChunkExecutorOptions& options() const { return options_; }
+  uint64_t submitted() const { return submitted_.load(std::memory_order_relaxed); }
+  uint64_t readRetries() const { return retries_; }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> seq{0};      // 2n+1 while chunk n is being written, 2n+2 when done
+    std::atomic<int64_t> startNs{0};
+    std::atomic<int64_t> stepNs{0};
+    std::atomic<uint64_t> count{0};
+    std::unique_ptr<std::atomic<double>[]> targets;  // [horizon][kArmJointCount]
+  };
+
+  // Interpolated target of one slot; false if it does not cover timeNs or was overwritten
+  bool sample(const Slot& slot, int64_t timeNs, uint64_t& id, double* joints) const;
+
+  ChunkExecutorOptions options_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<uint64_t> submitted_{0};
+  std::atomic<bool> stop_{false};
+
+  // Control-thread workspace
+  std::vector<double> weights_;        // exp(-m * i) per rank
+  std::vector<double> samples_;        // [maxChunks][kArmJointCount]
+  std::vector<uint64_t> ids_;          // chunk number per sample
+  std::vector<uint32_t> order_;        // samples, oldest first
+  std::vector<double> lateness_;       // ring of latencyHistory ticks
+  mutable uint64_t retries_ = 0;
+};
+
+}  // namespace shoplifter
+
+#endif // CHUNK_EXECUTOR_H
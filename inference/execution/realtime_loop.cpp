@@ -0,0 +1,328 @@
+/**
+ * Real-Time Control Loop
+ */
+
+#include "inference/execution/realtime_loop.h"
+
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "utils/deadline_clock.h"
+
+namespace shoplifter {
+
+namespace {
+
+constexpr size_t kPageBytes = 4096;
+constexpr size_t kStackMargin = 16 * 1024;  // Left untouched above the guard page
+
+// Touch every page of the calling thread's stack below this frame, so later ticks never fault on it
+__attribute__((noinline)) void prefaultStack() {
+  pthread_attr_t attr;
+  void* low = nullptr;
+  size_t size = 0;
+  if (::pthread_getattr_np(::pthread_self(), &attr) != 0) {
+    return;
+  }
+  ::pthread_attr_getstack(&attr, &low, &size);
+  ::pthread_attr_destroy(&attr);
+  // The stack grows down; TLS and the frames above us sit at the top
+  char here;
+  const size_t below = static_cast<size_t>(&here - static_cast<char*>(low));
+  if (below <= 2 * kStackMargin) {
+    return;
+  }
+  const size_t bytes = below - 2 * kStackMargin;
+  volatile char* frame = static_cast<volatile char*>(__builtin_alloca(bytes));
+  for (size_t i = 0; i < bytes; i += kPageBytes) frame[i] = 0;
+}
+
+double percentile(std::vector<int64_t>& values, double p) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  const size_t k = std::min(values.size() - 1, static_cast<size_t>(p * static_cast<double>(values.size())));
+  std::nth_element(values.begin(), values.begin() + k, values.end());
+  return static_cast<double>(values[k]) * 1e-9;
+}
+
+// "0-2,5" -> {0, 1, 2, 5}
+std::vector<int> parseCpuList(const std::string& list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    int first = 0, last = 0;
+    const int fields = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+    if (fields < 1) continue;
+    if (fields == 1) last = first;
+    for (int c = first; c <= last; c++) cpus.push_back(c);
+  }
+  return cpus;
+}
+
+void addProblem(RealtimeStatus& status, const std::string& what, int error) {
+  status.problems += what + ": " + std::strerror(error) + "\n";
+}
+
+}  // namespace
+
+TickTrace::TickTrace(size_t capacity) : capacity_(capacity), entries_(new Entry[capacity]) {}
+
+void TickTrace::record(const TickRecord& tick) {
+  const uint64_t n = count_.load(std::memory_order_relaxed);
+  Entry& e = entries_[n % capacity_];
+  e.seq.store(2 * n + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  e.index.store(tick.index, std::memory_order_relaxed);
+  e.deadlineNs.store(tick.deadlineNs, std::memory_order_relaxed);
+  e.wakeNs.store(tick.wakeNs, std::memory_order_relaxed);
+  e.doneNs.store(tick.doneNs, std::memory_order_relaxed);
+  e.seq.store(2 * n + 2, std::memory_order_release);
+  count_.store(n + 1, std::memory_order_release);
+}
+
+void TickTrace::snapshot(std::vector<TickRecord>& out) const {
+  out.clear();
+  const uint64_t end = count_.load(std::memory_order_acquire);
+  const uint64_t begin = end > capacity_ ? end - capacity_ : 0;
+  out.reserve(static_cast<size_t>(end - begin));
+  for (uint64_t n = begin; n < end; n++) {
+    const Entry& e = entries_[n % capacity_];
+    if (e.seq.load(std::memory_order_acquire) != 2 * n + 2) continue;
+    TickRecord tick;
+    tick.index = e.index.load(std::memory_order_relaxed);
+    tick.deadlineNs = e.deadlineNs.load(std::memory_order_relaxed);
+    tick.wakeNs = e.wakeNs.load(std::memory_order_relaxed);
+    tick.doneNs = e.doneNs.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (e.seq.load(std::memory_order_relaxed) == 2 * n + 2) {
+      out.push_back(tick);
+    }
+  }
+}
+
+void TickTrace::clear() {
+  for (size_t i = 0; i < capacity_; i++) {
+    entries_[i].seq.store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_release);
+}
+
+TickStats summarizeTicks(const std::vector<TickRecord>& ticks, int64_t periodNs) {
+  TickStats stats;
+  stats.ticks = ticks.size();
+  std::vector<int64_t> wakeup, compute;
+  wakeup.reserve(ticks.size());
+  compute.reserve(ticks.size());
+  for (size_t i = 0; i < ticks.size(); i++) {
+    const TickRecord& t = ticks[i];
+    wakeup.push_back(t.wakeNs - t.deadlineNs);
+    compute.push_back(t.doneNs - t.wakeNs);
+    stats.overruns += t.doneNs > t.deadlineNs + periodNs;
+    if (i > 0 && t.index > ticks[i - 1].index + 1) {
+      stats.skipped += t.index - ticks[i - 1].index - 1;
+    }
+  }
+  stats.wakeupMax = wakeup.empty() ? 0.0 : static_cast<double>(*std::max_element(wakeup.begin(), wakeup.end())) * 1e-9;
+  stats.computeMax =
+      compute.empty() ? 0.0 : static_cast<double>(*std::max_element(compute.begin(), compute.end())) * 1e-9;
+  stats.wakeupP50 = percentile(wakeup, 0.50);
+  stats.wakeupP99 = percentile(wakeup, 0.99);
+  stats.wakeupP999 = percentile(wakeup, 0.999);
+  stats.computeP50 = percentile(compute, 0.50);
+  stats.computeP99 = percentile(compute, 0.99);
+  stats.computeP999 = percentile(compute, 0.999);
+  return stats;
+}
+
+void writeChromeTrace(const std::string& path, const std::vector<TickRecord>& ticks, int64_t periodNs) {
+  std::ofstream out(path);
+  if (!out) {
+    throw std::runtime_error("Cannot write trace: " + path);
+  }
+  const int64_t origin = ticks.empty() ? 0 : ticks.front().deadlineNs;
+  auto us = [&](int64_t ns) { return static_cast<double>(ns - origin) * 1e-3; };
+  char line[256];
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"control loop\"}}";
+  for (const TickRecord& t : ticks) {
+    std::snprintf(line, sizeof(line),
+                  ",\n{\"name\":\"wakeup\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}", us(t.deadlineNs),
+                  static_cast<double>(t.wakeNs - t.deadlineNs) * 1e-3);
+    out << line;
+    std::snprintf(line, sizeof(line),
+                  ",\n{\"name\":\"tick\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,"
+                  "\"args\":{\"index\":%llu}}",
+                  us(t.wakeNs), static_cast<double>(t.doneNs - t.wakeNs) * 1e-3,
+                  static_cast<unsigned long long>(t.index));
+    out << line;
+    std::snprintf(line, sizeof(line),
+                  ",\n{\"name\":\"wakeup latency\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"us\":%.3f}}",
+                  us(t.deadlineNs), static_cast<double>(t.wakeNs - t.deadlineNs) * 1e-3);
+    out << line;
+    if (t.doneNs > t.deadlineNs + periodNs) {
+      std::snprintf(line, sizeof(line),
+                    ",\n{\"name\":\"overrun\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":1,\"ts\":%.3f}", us(t.doneNs));
+      out << line;
+    }
+  }
+  out << "\n]}\n";
+  if (!out) {
+    throw std::runtime_error("Cannot write trace: " + path);
+  }
+}
+
+RealtimeLoop::RealtimeLoop(const RealtimeOptions& options)
+    : options_(options),
+      periodNs_(options.rate > 0.0 ? static_cast<int64_t>(1e9 / options.rate) : 0),
+      trace_(options.traceTicks > 0 ? options.traceTicks : 1) {
+  if (periodNs_ <= 0) {
+    throw std::invalid_argument("Real-time loop rate must be positive");
+  }
+  if (options.traceTicks == 0) {
+    throw std::invalid_argument("Real-time loop trace needs at least one tick");
+  }
+  if (options.stackBytes < 4 * kStackMargin) {
+    throw std::invalid_argument("Real-time loop stack must be at least 64 KiB");
+  }
+  if (options.priority < 0 || options.priority > 99) {
+    throw std::invalid_argument("SCHED_FIFO priority must be in 0..99");
+  }
+}
+
+RealtimeLoop::~RealtimeLoop() { stop(); }
+
+void RealtimeLoop::start(TickFn tick) {
+  if (running_) {
+    throw std::logic_error("Real-time loop is already running");
+  }
+  tick_ = std::move(tick);
+  status_ = RealtimeStatus();
+  stop_.store(false, std::memory_order_relaxed);
+  ready_.store(false, std::memory_order_relaxed);
+  trace_.clear();
+
+  // Before the thread exists, so MCL_FUTURE also locks its stack as it is mapped
+  if (options_.lockMemory) {
+    if (::mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+      status_.memoryLocked = true;
+    } else {
+      addProblem(status_, "mlockall", errno);
+    }
+  }
+
+  pthread_attr_t attr;
+  ::pthread_attr_init(&attr);
+  ::pthread_attr_setstacksize(&attr, options_.stackBytes);
+  const int error = ::pthread_create(&thread_, &attr, &RealtimeLoop::threadMain, this);
+  ::pthread_attr_destroy(&attr);
+  if (error != 0) {
+    throw std::runtime_error(std::string("Cannot start the real-time loop: ") + std::strerror(error));
+  }
+  running_ = true;
+  while (!ready_.load(std::memory_order_acquire)) {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  if (options_.strict && !status_.problems.empty()) {
+    stop();
+    throw std::runtime_error("Real-time setup failed:\n" + status_.problems);
+  }
+}
+
+void RealtimeLoop::stop() {
+  if (!running_) {
+    return;
+  }
+  stop_.store(true, std::memory_order_relaxed);
+  ::pthread_join(thread_, nullptr);
+  running_ = false;
+}
+
+TickStats RealtimeLoop::stats() const {
+  std::vector<TickRecord> ticks;
+  trace_.snapshot(ticks);
+  return summarizeTicks(ticks, periodNs_);
+}
+
+void RealtimeLoop::dumpChromeTrace(const std::string& path) const {
+  std::vector<TickRecord> ticks;
+  trace_.snapshot(ticks);
+  writeChromeTrace(path, ticks, periodNs_);
+}
+
+std::vector<int> RealtimeLoop::isolatedCpus() {
+  std::ifstream in("/sys/devices/system/cpu/isolated");
+  std::string list;
+  std::getline(in, list);
+  return parseCpuList(list);
+}
+
+void* RealtimeLoop::threadMain(void* self) {
+  RealtimeLoop& loop = *static_cast<RealtimeLoop*>(self);
+  loop.setUp();
+  const bool proceed = !(loop.options_.strict && !loop.status_.problems.empty());
+  loop.ready_.store(true, std::memory_order_release);
+  if (proceed) {
+    loop.loop();
+  }
+  return nullptr;
+}
+
+void RealtimeLoop::setUp() {
+  if (options_.cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(options_.cpu, &set);
+    const int error = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+    if (error == 0) {
+      status_.pinned = true;
+      const std::vector<int> isolated = isolatedCpus();
+      status_.isolated = std::find(isolated.begin(), isolated.end(), options_.cpu) != isolated.end();
+    } else {
+      addProblem(status_, "pin to CPU " + std::to_string(options_.cpu), error);
+    }
+  }
+  if (options_.priority > 0) {
+    sched_param param{};
+    param.sched_priority = options_.priority;
+    const int error = ::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &param);
+    if (error == 0) {
+      status_.fifo = true;
+    } else {
+      addProblem(status_, "SCHED_FIFO priority " + std::to_string(options_.priority), error);
+    }
+  }
+  prefaultStack();
+}
+
+void RealtimeLoop::loop() {
+  const int64_t start = monotonicNs() + periodNs_;
+  for (uint64_t k = 0; !stop_.load(std::memory_order_relaxed);) {
+    TickRecord tick;
+    tick.index = k;
+    tick.deadlineNs = start + static_cast<int64_t>(k) * periodNs_;
+    sleepUntilNs(tick.deadlineNs);
+    tick.wakeNs = monotonicNs();
+    tick_(k, tick.deadlineNs);
+    tick.doneNs = monotonicNs();
+    trace_.record(tick);
+
+    k++;
+    if (options_.skipLate && tick.doneNs > tick.deadlineNs + periodNs_) {
+      k = static_cast<uint64_t>((tick.doneNs - start) / periodNs_) + 1;
+    }
+  }
+}
+
+}  // namespace shoplifter
@@ -0,0 +1,215 @@
+/**
+ * Real-Time Control Loop
+ *
+ * Runs a periodic control tick (telemetry in, policy or chunk executor,
+ * command out) on its own thread, set up to keep its deadlines while
+ * recording and visualization share the box:
+ *
+ *   - pinned to one core, ideally one removed from the scheduler with
+ *     isolcpus= / nohz_full= (status() says whether it is)
+ *   - SCHED_FIFO, so ordinary threads never preempt it
+ *   - mlockall(MCL_CURRENT | MCL_FUTURE) and a pre-faulted stack, so a tick
+ *     never waits on a page fault
+ *   - absolute deadlines with clock_nanosleep(TIMER_ABSTIME), so lateness
+ *     does not accumulate
+ *
+ * Every tick is traced: deadline, wakeup and end time. The trace is a ring
+ * of seqlocked entries with one writer (the loop), the same scheme as
+ * hardware/telemetry/arm_state_shm.h: recording never blocks the loop and
+ * any thread can snapshot it or dump it as Chrome trace JSON
+ * (chrome://tracing, ui.perfetto.dev) while the loop runs.
+ *
+ *   wakeup latency  wake - deadline: the jitter the OS adds
+ *   compute         end - wake: the tick function
+ *   overrun         end > next deadline; with skipLate the loop skips to
+ *                   the next deadline that is still ahead
+ *
+ * Without the privileges for SCHED_FIFO, affinity or mlockall the loop
+ * still runs, and status() lists what was not applied. With strict set,
+ * start() throws instead.
+ */
+
+#ifndef REALTIME_LOOP_H
+#define REALTIME_LOOP_H
+
+#include <pthread.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace shoplifter {
+
+struct RealtimeOptions {
+  double rate = 500.0;                 // Ticks per second
+  int cpu = -1;                        // Core to pin the loop to (-1 = any)
+  int priority = 80;                   // SCHED_FIFO priority, 1..99 (0 = stay SCHED_OTHER)
+  bool lockMemory = true;              // mlockall() the whole process
+  size_t stackBytes = 512 * 1024;      // Loop thread stack, all pre-faulted
+  size_t traceTicks = 1 << 16;         // Ticks kept in the trace ring
+  bool skipLate = true;                // After an overrun, skip deadlines already past
+  bool strict = false;                 // start() throws if any setting cannot be applied
+};
+
+/**
+ * What start() managed to apply
+ */
+struct RealtimeStatus {
+  bool fifo = false;
+  bool memoryLocked = false;
+  bool pinned = false;
+  bool isolated = false;               // the pinned core is in /sys/devices/system/cpu/isolated
+  std::string problems;                // one line per setting not applied, with the reason
+};
+
+/**
+ * One traced tick, CLOCK_MONOTONIC nanoseconds
+ */
+struct TickRecord {
+  uint64_t index;                      // Tick number; gaps are skipped ticks
+  int64_t deadlineNs;
+  int64_t wakeNs;                      // Return from clock_nanosleep()
+  int64_t doneNs;                      // Return from the tick function
+};
+
+struct TickStats {
+  uint64_t ticks = 0;
+  uint64_t overruns = 0;               // Ticks that ended after the next deadline
+  uint64_t skipped = 0;                // Deadlines skipped after overruns
+  double wakeupP50 = 0.0;              // Wakeup latency, seconds
+  double wakeupP99 = 0.0;
+  double wakeupP999 = 0.0;
+  double wakeupMax = 0.0;
+  double computeP50 = 0.0;             // Tick function time, seconds
+  double computeP99 = 0.0;
+  double computeP999 = 0.0;
+  double computeMax = 0.0;
+};
+
+/**
+ * Lock-free ring of the most recent ticks; one writer, any number of readers
+ */
+class TickTrace {
+ public:
+  explicit TickTrace(size_t capacity);
+
+  TickTrace(const TickTrace&) = delete;
+  TickTrace& operator=(const TickTrace&) = delete;
+
+  // Append a tick (writer thread only); wait-free
+  void record(const TickRecord& tick);
+
+  // Ticks recorded since construction or clear()
+  uint64_t recorded() const { return count_.load(std::memory_order_acquire); }
+
+  size_t capacity() const { return capacity_; }
+
+  /**
+   * Copy the retained ticks, oldest first
+   *
+   * Entries overwritten while copying are dropped, so the result is always
+   * consistent. Allocates; call from a non-real-time thread.
+   */
+  void snapshot(std::vector<TickRecord>& out) const;
+
+  // Forget every tick; not safe while record() runs
+  void clear();
+
+ private:
+  struct alignas(64) Entry {
+    std::atomic<uint64_t> seq{0};      // 2n+1 while tick n is written, 2n+2 when done
+    std::atomic<uint64_t> index{0};
+    std::atomic<int64_t> deadlineNs{0};
+    std::atomic<int64_t> wakeNs{0};
+    std::atomic<int64_t> doneNs{0};
+  };
+
+  size_t capacity_;
+  std::unique_ptr<Entry[]> entries_;
+  std::atomic<uint64_t> count_{0};
+};
+
+/**
+ * Percentiles of wakeup latency and compute time, and overruns
+ *
+ * @param periodNs Tick period, for overrun and skip counts
+ */
+TickStats summarizeTicks(const std::vector<TickRecord>& ticks, int64_t periodNs);
+
+/**
+ * Write ticks as Chrome trace JSON: per tick a "wakeup" slice (deadline to
+ * wake), a "tick" slice (wake to done), an "overrun" marker, and a wakeup
+ * latency counter track. Times are microseconds from the first deadline.
+ *
+ * @throws std::runtime_error if the file cannot be written
+ */
+void writeChromeTrace(const std::string& path, const std::vector<TickRecord>& ticks, int64_t periodNs);
+
+class RealtimeLoop {
+ public:
+  using TickFn = std::function<void(uint64_t index, int64_t deadlineNs)>;
+
+  /**
+   * @throws std::invalid_argument if rate, stackBytes, traceTicks or priority is out of range
+   */
+  explicit RealtimeLoop(const RealtimeOptions& options = RealtimeOptions());
+  ~RealtimeLoop();
+
+  RealtimeLoop(const RealtimeLoop&) = delete;
+  RealtimeLoop& operator=(const RealtimeLoop&) = delete;
+
+  /**
+   * Start the loop thread; returns once it is set up
+   *
+   * The first deadline is one period after setup. tick runs on the loop
+   * thread and should neither block nor allocate.
+   *
+   * @throws std::logic_error if the loop is already running
+   * @throws std::runtime_error if the thread cannot be created, or with strict
+   *         set if a setting cannot be applied
+   */
+  void start(TickFn tick);
+
+  // Finish the current tick and join the loop thread
+  void stop();
+
+  bool running() const { return running_; }
+  const RealtimeStatus& status() const { return status_; }
+  const RealtimeOptions& options() const { return options_; }
+  int64_t periodNs() const { return periodNs_; }
+
+  // The loop's trace; snapshot() it from any thread
+  const TickTrace& trace() const { return trace_; }
+
+  // summarizeTicks() of a trace snapshot
+  TickStats stats() const;
+
+  // writeChromeTrace() of a trace snapshot
+  void dumpChromeTrace(const std::string& path) const;
+
+  // Core numbers in /sys/devices/system/cpu/isolated
+  static std::vector<int> isolatedCpus();
+
+ private:
+  static void* threadMain(void* self);
+  void setUp();
+  void loop();
+
+  RealtimeOptions options_;
+  int64_t periodNs_;
+  TickTrace trace_;
+  TickFn tick_;
+  RealtimeStatus status_;
+  pthread_t thread_{};
+  bool running_ = false;
+  std::atomic<bool> stop_{false};
+  std::atomic<bool> ready_{false};
+};
+
+}  // namespace shoplifter
+
+#endif // REALTIME_LOOP_H
@@ -0,0 +1,101 @@
+/**
+ * Rollout Engine Scaling Benchmark
+ *
+ * Rolls the same random candidate action sequences out with 1 .. N worker
+ * threads and reports rollouts per second, speedup and parallel efficiency
+ * (speedup / threads) against one thread, and whether the trajectories are
+ * bitwise identical to the single-threaded result.
+ *
+ * Usage:
+ *   bench_rollout_engine [--candidates 1024] [--horizon 20] [--shard 16] [--max-threads N] forward.tensors
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "inference/planner/rollout_engine.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+std::vector<float> randomActions(size_t n) {
+  std::vector<float> actions(n);
+  uint64_t rng = 3;
+  for (float& a : actions) {
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    a = static_cast<float>(static_cast<double>(rng >> 11) * 0x1p-53 - 0.5);
+  }
+  return actions;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t candidates = 1024;
+  size_t horizon = 20;
+  size_t shard = 16;
+  size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  std::string path;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--candidates")) candidates = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--horizon")) horizon = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--shard")) shard = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--max-threads")) maxThreads = static_cast<size_t>(std::atoi(next()));
+    else path = argv[i];
+  }
+  if (path.empty() || maxThreads == 0) {
+    std::fprintf(stderr,
+                 "Usage: %s [--candidates 1024] [--horizon 20] [--shard 16] [--max-threads N] forward.tensors\n",
+                 argv[0]);
+    return 1;
+  }
+
+  try {
+    TensorArchive archive(path);
+    ForwardModel model(archive);
+    const ForwardModelConfig& c = model.config();
+    const std::vector<float> actions = randomActions(candidates * horizon * c.actionDim);
+    const std::vector<float> state(c.stateDim, 0.1f);
+    std::vector<float> reference(candidates * horizon * c.stateDim);
+    std::vector<float> trajectories(reference.size());
+
+    std::printf("%s: %zu candidates x %zu steps, shard %zu, %u hardware threads (%s)\n", path.c_str(), candidates,
+                horizon, shard, std::thread::hardware_concurrency(), simd::kTargetName);
+    std::printf("%-8s %12s %14s %9s %11s %8s %10s\n", "threads", "ms", "rollouts/s", "speedup", "efficiency",
+                "steals", "identical");
+    double baseMs = 0.0;
+    for (size_t threads = 1; threads <= maxThreads; threads++) {
+      RolloutOptions options;
+      options.threads = threads;
+      options.shard = shard;
+      RolloutEngine engine(model, horizon, options);
+      float* out = threads == 1 ? reference.data() : trajectories.data();
+      double ms = 1e30;
+      for (int rep = 0; rep < 5; rep++) {
+        const auto start = Clock::now();
+        engine.rollout(state.data(), 0, actions.data(), candidates, out);
+        ms = std::min(ms, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+      }
+      if (threads == 1) baseMs = ms;
+      const bool identical =
+          threads == 1 || std::memcmp(reference.data(), trajectories.data(), sizeof(float) * reference.size()) == 0;
+      std::printf("%-8zu %12.3f %14.0f %9.2f %10.0f%% %8llu %10s\n", threads, ms, candidates / ms * 1e3,
+                  baseMs / ms, 100.0 * baseMs / ms / threads, static_cast<unsigned long long>(engine.steals()),
+                  identical ? "yes" : "NO");
+    }
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,54 @@
+/**
+ * Parallel Forward-Model Rollouts
+ */
+
+#include "inference/planner/rollout_engine.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace shoplifter {
+
+RolloutEngine::RolloutEngine(const ForwardModel& model, size_t horizon, const RolloutOptions& options)
+    : model_(model), horizon_(horizon), options_(options), pool_(options.threads) {
+  if (horizon == 0 || options.shard == 0) {
+    throw std::invalid_argument("Rollouts need a positive horizon and shard size");
+  }
+  arenas_.assign(pool_.threads(), simd::AlignedFloats(model.workspaceSize(options.shard), 0.0f));
+}
+
+void RolloutEngine::rollout(const float* initial, size_t lds, const float* actions, size_t candidates,
+                            float* trajectories, const RolloutShardDone& onShard) {
+  initial_ = initial;
+  lds_ = lds;
+  actions_ = actions;
+  candidates_ = candidates;
+  trajectories_ = trajectories;
+  onShard_ = &onShard;
+  const size_t shards = (candidates + options_.shard - 1) / options_.shard;
+  pool_.parallelFor(shards, [this](size_t shard, size_t worker) { rolloutShard(shard, worker); });
+}
+
+void RolloutEngine::rolloutShard(size_t shard, size_t worker) {
+  const ForwardModelConfig& c = model_.config();
+  const size_t s = c.stateDim;
+  const size_t a = c.actionDim;
+  const size_t first = shard * options_.shard;
+  const size_t rows = std::min(options_.shard, candidates_ - first);
+  const size_t ldt = horizon_ * s;               // stride between candidates
+  const size_t lda = horizon_ * a;
+  float* out = trajectories_ + first * ldt;
+  const float* act = actions_ + first * lda;
+  float* workspace = arenas_[worker].data();
+
+  // Step t reads the states of step t - 1 straight from the output rows
+  model_.step(initial_ + first * lds_, lds_, act, lda, rows, out, ldt, workspace);
+  for (size_t t = 1; t < horizon_; t++) {
+    model_.step(out + (t - 1) * s, ldt, act + t * a, lda, rows, out + t * s, ldt, workspace);
+  }
+  if (*onShard_) {
+    (*onShard_)(first, rows, out, worker);
+  }
+}
+
+}  // namespace shoplifter
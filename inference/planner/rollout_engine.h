@@ -0,0 +1,94 @@
+/**
+ * Parallel Forward-Model Rollouts
+ *
+ * Rolls N candidate action sequences of H steps through the forward model
+ * (models/forward_model/forward_model.h) on a work-stealing pool:
+ *
+ *   s_0 = initial state, s_t = model(s_{t-1}, a_t), t = 1 .. H
+ *
+ * Candidates are cut into shards of `shard` rows, and every shard is one
+ * task: H batched model steps over its rows, reading and writing the
+ * shard's rows of the output. Each worker owns an activation arena (the
+ * model workspace for one shard) allocated at construction, so rollouts
+ * allocate nothing and workers write only their own arena and shards.
+ *
+ * Shard boundaries depend only on the shard size, never on the thread
+ * count or on which worker runs or steals a shard. Every row goes through
+ * the same sequence of floating-point operations, so the trajectories are
+ * bitwise identical for any number of threads.
+ */
+
+#ifndef ROLLOUT_ENGINE_H
+#define ROLLOUT_ENGINE_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "inference/planner/work_stealing_pool.h"
+#include "models/forward_model/forward_model.h"
+#include "models/transformer/simd.h"
+
+namespace shoplifter {
+
+struct RolloutOptions {
+  size_t threads = 0;                  // workers including the caller (0 = hardware concurrency)
+  size_t shard = 16;                   // candidates per task
+};
+
+/**
+ * Called on a worker after a shard is rolled out
+ *
+ * @param first First candidate of the shard
+ * @param count Candidates in the shard
+ * @param trajectories Their [count][horizon][stateDim] states
+ * @param worker Worker index, for per-worker accumulators
+ */
+using RolloutShardDone = std::function<void(size_t first, size_t count, const float* trajectories, size_t worker)>;
+
+class RolloutEngine {
+ public:
+  /**
+   * @param model Loaded forward model; must outlive this object
+   * @param horizon Steps per candidate
+   * @throws std::invalid_argument if horizon or shard is zero
+   */
+  RolloutEngine(const ForwardModel& model, size_t horizon, const RolloutOptions& options = RolloutOptions());
+
+  /**
+   * Roll out every candidate
+   *
+   * @param initial Initial states, [candidates][stateDim] with row stride lds;
+   *                lds = 0 starts every candidate from the same state
+   * @param actions [candidates][horizon][actionDim]
+   * @param trajectories [candidates][horizon][stateDim] predicted states
+   * @param onShard Called per finished shard on its worker (may be empty), e.g. to score it
+   */
+  void rollout(const float* initial, size_t lds, const float* actions, size_t candidates, float* trajectories,
+               const RolloutShardDone& onShard = {});
+
+  size_t threads() const { return pool_.threads(); }
+  size_t horizon() const { return horizon_; }
+  uint64_t steals() const { return pool_.steals(); }
+
+ private:
+  void rolloutShard(size_t shard, size_t worker);
+
+  const ForwardModel& model_;
+  size_t horizon_;
+  RolloutOptions options_;
+  WorkStealingPool pool_;
+  std::vector<simd::AlignedFloats> arenas_;  // Per worker model workspace for one shard
+
+  // Arguments of the rollout() in flight
+  const float* initial_ = nullptr;
+  size_t lds_ = 0;
+  const float* actions_ = nullptr;
+  size_t candidates_ = 0;
+  float* trajectories_ = nullptr;
+  const RolloutShardDone* onShard_ = nullptr;
+};
+
+}  // namespace shoplifter
+
+#endif // ROLLOUT_ENGINE_H
@@ -0,0 +1,126 @@
+/**
+ * Work-Stealing Thread Pool
+ */
+
+#include "inference/planner/work_stealing_pool.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace shoplifter {
+
+namespace {
+
+uint64_t pack(uint64_t begin, uint64_t end) { return begin << 32 | end; }
+uint64_t rangeBegin(uint64_t bounds) { return bounds >> 32; }
+uint64_t rangeEnd(uint64_t bounds) { return bounds & 0xFFFFFFFFu; }
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(size_t threads) : workers_(threads) {
+  if (workers_ == 0) {
+    workers_ = std::max(1u, std::thread::hardware_concurrency());
+  }
+  ranges_.reset(new Range[workers_]);
+  for (size_t w = 1; w < workers_; w++) {
+    threads_.emplace_back(&WorkStealingPool::workerLoop, this, w);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  start_.notify_all();
+  for (std::thread& t : threads_) {
+    t.join();
+  }
+}
+
+bool WorkStealingPool::pop(size_t worker, size_t& task) {
+  std::atomic<uint64_t>& bounds = ranges_[worker].bounds;
+  uint64_t r = bounds.load(std::memory_order_acquire);
+  while (rangeBegin(r) < rangeEnd(r)) {
+    if (bounds.compare_exchange_weak(r, pack(rangeBegin(r) + 1, rangeEnd(r)), std::memory_order_acq_rel)) {
+      task = static_cast<size_t>(rangeBegin(r));
+      return true;
+    }
+  }
+  return false;
+}
+
+bool WorkStealingPool::steal(size_t worker, size_t& task) {
+  for (size_t i = 1; i < workers_; i++) {
+    std::atomic<uint64_t>& victim = ranges_[(worker + i) % workers_].bounds;
+    uint64_t r = victim.load(std::memory_order_acquire);
+    while (rangeBegin(r) < rangeEnd(r)) {
+      const uint64_t take = (rangeEnd(r) - rangeBegin(r) + 1) / 2;
+      const uint64_t split = rangeEnd(r) - take;
+      if (victim.compare_exchange_weak(r, pack(rangeBegin(r), split), std::memory_order_acq_rel)) {
+        // Run the first stolen task now and publish the rest as our own range
+        task = static_cast<size_t>(split);
+        ranges_[worker].bounds.store(pack(split + 1, rangeEnd(r)), std::memory_order_release);
+        steals_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::work(size_t worker) {
+  size_t task;
+  while (pop(worker, task) || steal(worker, task)) {
+    (*fn_)(task, worker);
+  }
+}
+
+void WorkStealingPool::workerLoop(size_t worker) {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [&]() { return stopping_ || generation_ != seen; });
+      if (stopping_) {
+        return;
+      }
+      seen = generation_;
+    }
+    work(worker);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--pending_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+}
+
+void WorkStealingPool::parallelFor(size_t tasks, const std::function<void(size_t task, size_t worker)>& fn) {
+  if (tasks >= std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument("Too many tasks for one parallelFor()");
+  }
+  if (tasks == 0) {
+    return;
+  }
+  for (size_t w = 0; w < workers_; w++) {
+    ranges_[w].bounds.store(pack(tasks * w / workers_, tasks * (w + 1) / workers_), std::memory_order_relaxed);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fn_ = &fn;
+    pending_ = workers_ - 1;
+    generation_++;
+  }
+  start_.notify_all();
+
+  work(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [&]() { return pending_ == 0; });
+  fn_ = nullptr;
+}
+
+}  // namespace shoplifter
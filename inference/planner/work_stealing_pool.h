@@ -0,0 +1,86 @@
+/**
+ * Work-Stealing Thread Pool
+ *
+ * A fixed set of worker threads for parallel loops over task indices.
+ * parallelFor() splits [0, tasks) into one contiguous range per worker.
+ * A worker takes tasks from the front of its own range; once that is empty
+ * it steals the back half of another worker's range. Candidate rollouts
+ * vary in cost (early exits, cache misses, a worker descheduled by the OS),
+ * and stealing keeps every core busy until the loop is done instead of
+ * waiting on the slowest static share.
+ *
+ * Each range is a single 64-bit atomic (begin << 32 | end). Pops and steals
+ * are one compare-and-swap, and tasks are never queued, so a loop allocates
+ * nothing. The calling thread is worker 0. Threads only block between
+ * loops, on a condition variable.
+ */
+
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace shoplifter {
+
+class WorkStealingPool {
+ public:
+  /**
+   * @param threads Workers including the calling thread (0 = hardware concurrency)
+   */
+  explicit WorkStealingPool(size_t threads = 0);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  size_t threads() const { return workers_; }
+
+  /**
+   * Run fn(task, worker) for every task in [0, tasks); blocks until all are done
+   *
+   * worker is in [0, threads()) and unique among concurrently running calls,
+   * so it can index per-worker state. fn must not throw. Not reentrant:
+   * one loop at a time.
+   *
+   * @throws std::invalid_argument if tasks does not fit in 32 bits
+   */
+  void parallelFor(size_t tasks, const std::function<void(size_t task, size_t worker)>& fn);
+
+  // Ranges stolen since construction
+  uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+ private:
+  struct alignas(64) Range {
+    std::atomic<uint64_t> bounds{0};   // begin << 32 | end
+  };
+
+  bool pop(size_t worker, size_t& task);
+  bool steal(size_t worker, size_t& task);
+  void work(size_t worker);
+  void workerLoop(size_t worker);
+
+  size_t workers_;
+  std::unique_ptr<Range[]> ranges_;
+  std::vector<std::thread> threads_;
+  std::atomic<uint64_t> steals_{0};
+
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  uint64_t generation_ = 0;            // loops started
+  size_t pending_ = 0;                 // helper threads still in the current loop
+  bool stopping_ = false;
+  const std::function<void(size_t, size_t)>* fn_ = nullptr;
+};
+
+}  // namespace shoplifter
+
+#endif // WORK_STEALING_POOL_H
@@ -0,0 +1,143 @@
+/**
+ * Free-Energy Evaluation Benchmark
+ *
+ * Checks the native forward model against the reference vectors in the
+ * archive, then scores random smooth candidate action sequences:
+ *
+ *   - one candidate at a time (batch 1, the naive loop) and in batches,
+ *     reporting candidates/s and that every batch size picks the same argmin
+ *   - select() under a time budget in anytime mode
+ *
+ * Usage:
+ *   bench_free_energy [--candidates 512] [--horizon 20] [--budget-ms 2] forward.tensors
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "models/active_inference/free_energy.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double checkReference(const TensorArchive& archive, const ForwardModel& model) {
+  const ForwardModelConfig& c = model.config();
+  const Tensor& state = archive.require("test.state", TensorType::kFloat32);
+  const size_t rows = state.shape[0];
+  archive.require("test.state", TensorType::kFloat32, {rows, c.stateDim});
+  const Tensor& action = archive.require("test.action", TensorType::kFloat32, {rows, c.actionDim});
+  const Tensor& expected = archive.require("test.next", TensorType::kFloat32, {rows, c.stateDim});
+  std::vector<float> next(rows * c.stateDim), workspace(model.workspaceSize(rows));
+  model.step(state.floats(), c.stateDim, action.floats(), c.actionDim, rows, next.data(), c.stateDim,
+             workspace.data());
+  double err = 0.0;
+  for (size_t i = 0; i < next.size(); i++) {
+    err = std::max(err, std::fabs(double(next[i]) - expected.floats()[i]));
+  }
+  return err;
+}
+
+// Random walks in action space, so candidates look like smooth joint motions
+std::vector<float> candidateActions(size_t candidates, size_t horizon, size_t dim) {
+  std::vector<float> actions(candidates * horizon * dim);
+  uint64_t rng = 11;
+  auto uniform = [&]() {
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<float>(static_cast<double>(rng >> 11) * 0x1p-53 - 0.5);
+  };
+  for (size_t n = 0; n < candidates; n++) {
+    for (size_t j = 0; j < dim; j++) {
+      float a = uniform();
+      for (size_t t = 0; t < horizon; t++) {
+        a += 0.2f * uniform();
+        actions[(n * horizon + t) * dim + j] = a;
+      }
+    }
+  }
+  return actions;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t candidates = 512;
+  size_t horizon = 20;
+  double budgetMs = 2.0;
+  std::string path;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--candidates")) candidates = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--horizon")) horizon = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--budget-ms")) budgetMs = std::atof(next());
+    else path = argv[i];
+  }
+  if (path.empty() || candidates == 0 || horizon == 0) {
+    std::fprintf(stderr, "Usage: %s [--candidates 512] [--horizon 20] [--budget-ms 2] forward.tensors\n", argv[0]);
+    return 1;
+  }
+
+  try {
+    TensorArchive archive(path);
+    ForwardModel model(archive);
+    const ForwardModelConfig& c = model.config();
+    std::printf("%s: state %zu, action %zu, hidden %zu x %zu (%s)\n", path.c_str(), c.stateDim, c.actionDim,
+                c.hidden, c.layers, simd::kTargetName);
+    std::printf("reference max abs error %.2e\n\n", checkReference(archive, model));
+
+    const std::vector<float> actions = candidateActions(candidates, horizon, c.actionDim);
+    std::vector<float> state(c.stateDim, 0.0f), goal(c.stateDim), precision(c.stateDim, 4.0f);
+    for (size_t d = 0; d < c.stateDim; d++) goal[d] = 0.5f * std::sin(float(d));
+
+    std::printf("%zu candidates x %zu steps\n", candidates, horizon);
+    std::printf("%-10s %10s %14s %8s %12s\n", "batch", "ms", "candidates/s", "best", "free energy");
+    size_t reference = 0;
+    double naiveMs = 0.0;
+    for (size_t batch : {size_t(1), size_t(16), size_t(64), size_t(256)}) {
+      FreeEnergyOptions options;
+      options.batch = batch;
+      options.actionPrecision = 0.1f;
+      FreeEnergyEvaluator evaluator(model, horizon, options);
+      evaluator.setPreference(goal.data(), precision.data());
+      FreeEnergySelection best;
+      double ms = 1e30;
+      for (int rep = 0; rep < 5; rep++) {
+        const auto start = Clock::now();
+        best = evaluator.select(state.data(), actions.data(), candidates);
+        ms = std::min(ms, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+      }
+      if (batch == 1) {
+        reference = best.best;
+        naiveMs = ms;
+      }
+      std::printf("%-10zu %10.3f %14.0f %8zu %12.4f%s\n", batch, ms, candidates / ms * 1e3, best.best,
+                  best.freeEnergy, best.best == reference ? "" : "  (differs from batch 1)");
+      if (batch == 256) {
+        std::printf("speedup over batch 1: %.1fx\n", naiveMs / ms);
+      }
+    }
+
+    FreeEnergyOptions options;
+    options.actionPrecision = 0.1f;
+    options.budget = budgetMs * 1e-3;
+    FreeEnergyEvaluator evaluator(model, horizon, options);
+    evaluator.setPreference(goal.data(), precision.data());
+    const FreeEnergySelection best = evaluator.select(state.data(), actions.data(), candidates);
+    std::printf("\nanytime, budget %.2f ms: %zu/%zu scored in %.3f ms, best %zu (free energy %.4f, "
+                "expected surprise %.4f)%s\n",
+                budgetMs, best.evaluated, candidates, best.elapsed * 1e3, best.best, best.freeEnergy,
+                best.expectedSurprise, best.complete ? "" : ", stopped at the deadline");
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,156 @@
+/**
+ * Batched Free-Energy Evaluation
+ */
+
+#include "models/active_inference/free_energy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace shoplifter {
+
+namespace {
+
+using namespace simd;
+using Clock = std::chrono::steady_clock;
+
+constexpr double kTwoPi = 6.283185307179586;
+
+// sum_i p[i] (x[i] - g[i])^2
+float weightedDistance(const float* x, const float* g, const float* p, size_t n) {
+  const size_t body = n / kFloatLanes * kFloatLanes;
+  VecF acc = zero();
+  size_t i = 0;
+  for (; i < body; i += kFloatLanes) {
+    const VecF d = sub(load(x + i), load(g + i));
+    acc = fma(mul(load(p + i), d), d, acc);
+  }
+  float sum = reduceAdd(acc);
+  for (; i < n; i++) sum += p[i] * (x[i] - g[i]) * (x[i] - g[i]);
+  return sum;
+}
+
+float squaredNorm(const float* x, size_t n) {
+  const size_t body = n / kFloatLanes * kFloatLanes;
+  VecF acc = zero();
+  size_t i = 0;
+  for (; i < body; i += kFloatLanes) {
+    const VecF v = load(x + i);
+    acc = fma(v, v, acc);
+  }
+  float sum = reduceAdd(acc);
+  for (; i < n; i++) sum += x[i] * x[i];
+  return sum;
+}
+
+}  // namespace
+
+FreeEnergyEvaluator::FreeEnergyEvaluator(const ForwardModel& model, size_t horizon, const FreeEnergyOptions& options)
+    : model_(model), horizon_(horizon), options_(options) {
+  if (horizon == 0 || options.batch == 0) {
+    throw std::invalid_argument("Free-energy evaluation needs a positive horizon and batch size");
+  }
+  const size_t s = model.config().stateDim;
+  const std::vector<float> goal(s, 0.0f), precision(s, 1.0f);
+  setPreference(goal.data(), precision.data());
+  states_.assign(options.batch * s, 0.0f);
+  workspace_.assign(model.workspaceSize(options.batch), 0.0f);
+}
+
+void FreeEnergyEvaluator::setPreference(const float* goal, const float* precision) {
+  const size_t s = model_.config().stateDim;
+  double constant = 0.0;
+  for (size_t d = 0; d < s; d++) {
+    if (!(precision[d] > 0.0f)) {
+      throw std::invalid_argument("Preference precision must be positive");
+    }
+    constant += 0.5 * std::log(kTwoPi / precision[d]);
+  }
+  goal_.assign(goal, goal + s);
+  precision_.assign(precision, precision + s);
+  surpriseConstant_ = static_cast<float>(constant);
+}
+
+void FreeEnergyEvaluator::reserve(size_t candidates) {
+  if (freeEnergy_.size() < candidates) {
+    freeEnergy_.resize(candidates);
+    surprise_.resize(candidates);
+  }
+}
+
+void FreeEnergyEvaluator::evaluate(const float* state, const float* actions, size_t first, size_t count) {
+  const ForwardModelConfig& c = model_.config();
+  const size_t s = c.stateDim;
+  const size_t a = c.actionDim;
+  const size_t lda = horizon_ * a;               // stride between candidates
+  reserve(first + count);
+
+  for (size_t b0 = first; b0 < first + count; b0 += options_.batch) {
+    const size_t rows = std::min(options_.batch, first + count - b0);
+    const float* batchActions = actions + b0 * lda;
+    float* surprise = &surprise_[b0];
+    for (size_t r = 0; r < rows; r++) {
+      std::copy(state, state + s, &states_[r * s]);
+      surprise[r] = 0.0f;
+    }
+
+    // One batched model step per horizon step, then a reduction per row
+    for (size_t t = 0; t < horizon_; t++) {
+      model_.step(states_.data(), s, batchActions + t * a, lda, rows, states_.data(), s, workspace_.data());
+      for (size_t r = 0; r < rows; r++) {
+        surprise[r] += weightedDistance(&states_[r * s], goal_.data(), precision_.data(), s);
+      }
+    }
+
+    for (size_t r = 0; r < rows; r++) {
+      surprise[r] = 0.5f * surprise[r] + static_cast<float>(horizon_) * surpriseConstant_;
+      float energy = surprise[r];
+      if (options_.actionPrecision > 0.0f) {
+        energy += 0.5f * options_.actionPrecision * squaredNorm(batchActions + r * lda, lda);
+      }
+      freeEnergy_[b0 + r] = energy;
+    }
+  }
+}
+
+FreeEnergySelection FreeEnergyEvaluator::select(const float* state, const float* actions, size_t candidates) {
+  if (candidates == 0) {
+    throw std::invalid_argument("Free-energy selection needs at least one candidate");
+  }
+  reserve(candidates);
+  std::fill(freeEnergy_.begin(), freeEnergy_.begin() + candidates, std::numeric_limits<float>::infinity());
+  std::fill(surprise_.begin(), surprise_.begin() + candidates, std::numeric_limits<float>::infinity());
+
+  const auto start = Clock::now();
+  const bool bounded = options_.anytime && options_.budget > 0.0;
+  double slowestBatch = 0.0;
+  FreeEnergySelection result;
+  for (size_t first = 0; first < candidates; first += options_.batch) {
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    if (bounded && first > 0 && elapsed + slowestBatch > options_.budget) {
+      break;
+    }
+    const size_t count = std::min(options_.batch, candidates - first);
+    evaluate(state, actions, first, count);
+    slowestBatch = std::max(slowestBatch, std::chrono::duration<double>(Clock::now() - start).count() - elapsed);
+
+    // Lowest index wins ties, so the result does not depend on the batch size
+    for (size_t i = first; i < first + count; i++) {
+      if (i == 0 || freeEnergy_[i] < freeEnergy_[result.best]) {
+        result.best = i;
+      }
+    }
+    result.evaluated = first + count;
+  }
+
+  result.freeEnergy = freeEnergy_[result.best];
+  result.expectedSurprise = surprise_[result.best];
+  result.complete = result.evaluated == candidates;
+  result.elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  return result;
+}
+
+}  // namespace shoplifter
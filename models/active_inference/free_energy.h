@@ -0,0 +1,116 @@
+/**
+ * Batched Free-Energy Evaluation
+ *
+ * Action selection for the active-inference loop: given the current state
+ * and N candidate action sequences of H steps, roll each candidate through
+ * the forward model and pick the one with the lowest expected free energy.
+ *
+ * Preferences over states are a Gaussian prior with mean `goal` and
+ * per-feature precision pi. For a candidate with predicted states s_1..s_H
+ * and actions a_1..a_H:
+ *
+ *   surprise(s)       = 0.5 * sum_d pi_d (s_d - goal_d)^2 + 0.5 * sum_d log(2 pi / pi_d)
+ *   expected surprise = sum_t surprise(s_t)
+ *   free energy       = expected surprise + 0.5 * lambda * sum_t |a_t|^2
+ *
+ * The second term is the complexity cost of leaving a zero-mean action
+ * prior of precision lambda (0 disables it). The forward model is
+ * deterministic, so there is no ambiguity term.
+ *
+ * Candidates are rolled out in batches of `batch` rows: one forward-model
+ * step of the whole batch per horizon step (a GEMM instead of N matrix-vector
+ * products), then the precision-weighted distances of the batch are reduced
+ * with SIMD. select() keeps the running argmin across batches. With a time
+ * budget and anytime mode it skips the remaining batches once the next one
+ * would finish past the deadline and returns the best candidate so far.
+ * Candidates are evaluated in the order given, so put the most promising
+ * ones (e.g. the previous plan, shifted by one step) first.
+ */
+
+#ifndef FREE_ENERGY_H
+#define FREE_ENERGY_H
+
+#include <cstddef>
+#include <vector>
+
+#include "models/forward_model/forward_model.h"
+#include "models/transformer/simd.h"
+
+namespace shoplifter {
+
+struct FreeEnergyOptions {
+  size_t batch = 64;             // candidates rolled out together
+  float actionPrecision = 0.0f;  // lambda, precision of the zero-mean action prior
+  double budget = 0.0;           // select(): seconds (0 = no limit)
+  bool anytime = true;           // select(): stop at the budget with the best candidate so far
+};
+
+struct FreeEnergySelection {
+  size_t best = 0;               // candidate index with the lowest free energy
+  float freeEnergy = 0.0f;
+  float expectedSurprise = 0.0f;
+  size_t evaluated = 0;          // candidates scored, a prefix of the input
+  bool complete = false;         // every candidate was scored
+  double elapsed = 0.0;          // seconds
+};
+
+class FreeEnergyEvaluator {
+ public:
+  /**
+   * @param model Loaded forward model; must outlive this object
+   * @param horizon Steps per candidate action sequence
+   * @throws std::invalid_argument if horizon or batch is zero
+   */
+  FreeEnergyEvaluator(const ForwardModel& model, size_t horizon,
+                      const FreeEnergyOptions& options = FreeEnergyOptions());
+
+  /**
+   * Set the preferred state
+   *
+   * @param goal stateDim preferred values
+   * @param precision stateDim positive precisions (inverse variances)
+   * @throws std::invalid_argument if a precision is not positive
+   */
+  void setPreference(const float* goal, const float* precision);
+
+  /**
+   * Score candidates and return the argmin of the free energy
+   *
+   * @param state stateDim current state
+   * @param actions [candidates][horizon][actionDim]
+   * @param candidates At least 1
+   * @throws std::invalid_argument if candidates is zero
+   */
+  FreeEnergySelection select(const float* state, const float* actions, size_t candidates);
+
+  /**
+   * Score candidates [first, first + count) into freeEnergy() and expectedSurprise()
+   */
+  void evaluate(const float* state, const float* actions, size_t first, size_t count);
+
+  // Per candidate; after select(), +inf for the candidates it did not reach
+  const std::vector<float>& freeEnergy() const { return freeEnergy_; }
+  const std::vector<float>& expectedSurprise() const { return surprise_; }
+
+  size_t horizon() const { return horizon_; }
+  const FreeEnergyOptions& options() const { return options_; }
+
+ private:
+  void reserve(size_t candidates);
+
+  const ForwardModel& model_;
+  size_t horizon_;
+  FreeEnergyOptions options_;
+  simd::AlignedFloats goal_;
+  simd::AlignedFloats precision_;
+  float surpriseConstant_ = 0.0f;  // 0.5 * sum_d log(2 pi / pi_d)
+
+  std::vector<float> freeEnergy_;
+  std::vector<float> surprise_;
+  simd::AlignedFloats states_;     // [batch][stateDim]
+  simd::AlignedFloats workspace_;
+};
+
+}  // namespace shoplifter
+
+#endif // FREE_ENERGY_H
@@ -0,0 +1,135 @@
+"""
+Export ForwardModel weights to a tensor archive for the C++ runtime.
+
+Uses the archive format of models/transformer/export_weights.py. Besides
+the state_dict tensors it carries:
+
+    config       int64 [state_dim, action_dim, hidden, layers]
+    test.state   a batch of random states
+    test.action  a batch of random actions
+    test.next    their next states from the numpy reference below
+
+--pack-nr adds pre-packed GEMM panels, as in export_weights.py.
+
+Usage:
+    python models/forward_model/export_forward_model.py --checkpoint forward.pt --out forward.tensors
+    python models/forward_model/export_forward_model.py --random --state-dim 12 --out random_forward.tensors
+"""
+
+import argparse
+import os
+import sys
+from typing import Dict, List, Optional, Tuple
+
+import numpy as np
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+from models.transformer.export_weights import add_packed, write_archive  # noqa: E402
+
+
+TEST_BATCH = 16
+
+
+def infer_config(tensors: Dict[str, np.ndarray]) -> Tuple[int, int, int, int]:
+    """Derive (state_dim, action_dim, hidden, layers) from a ForwardModel state_dict."""
+    layers = 0
+    while f"layers.{layers}.weight" in tensors:
+        layers += 1
+    if layers == 0 or "out.weight" not in tensors:
+        raise ValueError("Not a ForwardModel state_dict")
+    state_dim, hidden = tensors["out.weight"].shape
+    action_dim = tensors["layers.0.weight"].shape[1] - state_dim
+    return state_dim, action_dim, hidden, layers
+
+
+def reference_step(tensors: Dict[str, np.ndarray], config: Tuple[int, ...], state: np.ndarray,
+                   action: np.ndarray) -> np.ndarray:
+    """
+    Numpy forward pass of ForwardModel in float64.
+
+    Args:
+        state: [batch, state_dim]
+        action: [batch, action_dim]
+
+    Returns:
+        [batch, state_dim] next states
+    """
+    t = {k: v.astype(np.float64) for k, v in tensors.items()}
+    h = np.concatenate([state, action], axis=-1).astype(np.float64)
+    for i in range(config[3]):
+        h = np.maximum(h @ t[f"layers.{i}.weight"].T + t[f"layers.{i}.bias"], 0.0)
+    return state + h @ t["out.weight"].T + t["out.bias"]
+
+
+def random_state_dict(state_dim: int, action_dim: int, hidden: int, layers: int,
+                      seed: int = 0) -> Dict[str, np.ndarray]:
+    """State dict with PyTorch-like initial weights, for benchmarks and tests."""
+    rng = np.random.default_rng(seed)
+    sd: Dict[str, np.ndarray] = {}
+
+    def linear(prefix: str, out: int, inp: int):
+        bound = 1.0 / np.sqrt(inp)
+        sd[prefix + "weight"] = rng.uniform(-bound, bound, (out, inp)).astype(np.float32)
+        sd[prefix + "bias"] = rng.uniform(-bound, bound, out).astype(np.float32)
+
+    linear("layers.0.", hidden, state_dim + action_dim)
+    for i in range(1, layers):
+        linear(f"layers.{i}.", hidden, hidden)
+    linear("out.", state_dim, hidden)
+    return sd
+
+
+def export(path: str, state_dict: Dict[str, np.ndarray], seed: int = 0,
+           pack_nrs: Optional[List[int]] = None) -> Tuple[int, ...]:
+    """
+    Write a forward-model archive with its config and a reference test vector.
+
+    Args:
+        pack_nrs: GEMM panel widths to add pre-packed layers for
+
+    Returns:
+        The exported config tuple
+    """
+    config = infer_config(state_dict)
+    rng = np.random.default_rng(seed + 1)
+    state = rng.standard_normal((TEST_BATCH, config[0])).astype(np.float32)
+    action = rng.standard_normal((TEST_BATCH, config[1])).astype(np.float32)
+    tensors = dict(state_dict)
+    tensors["config"] = np.array(config, dtype=np.int64)
+    tensors["test.state"] = state
+    tensors["test.action"] = action
+    tensors["test.next"] = reference_step(state_dict, config, state, action).astype(np.float32)
+    layers = [(f"layers.{i}.weight", f"layers.{i}.bias") for i in range(config[3])] + [("out.weight", "out.bias")]
+    add_packed(tensors, layers, pack_nrs or [])
+    write_archive(path, tensors)
+    return config
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Export forward-model weights for the C++ runtime")
+    parser.add_argument("--out", required=True, help="Output .tensors file")
+    parser.add_argument("--checkpoint", help="torch.save()d ForwardModel state_dict")
+    parser.add_argument("--random", action="store_true", help="Export random weights (benchmarks)")
+    parser.add_argument("--state-dim", type=int, default=12)
+    parser.add_argument("--action-dim", type=int, default=6)
+    parser.add_argument("--hidden", type=int, default=256)
+    parser.add_argument("--layers", type=int, default=2)
+    parser.add_argument("--pack-nr", help="Comma-separated GEMM panel widths to pre-pack for (32 AVX-512, 16 AVX2, 8)")
+    args = parser.parse_args()
+
+    if args.checkpoint:
+        import torch
+        state = torch.load(args.checkpoint, map_location="cpu")
+        state_dict = {k: v.detach().float().numpy() for k, v in state.items()}
+    elif args.random:
+        state_dict = random_state_dict(args.state_dim, args.action_dim, args.hidden, args.layers)
+    else:
+        parser.error("one of --checkpoint or --random is required")
+
+    pack_nrs = [int(nr) for nr in args.pack_nr.split(",")] if args.pack_nr else None
+    config = export(args.out, state_dict, pack_nrs=pack_nrs)
+    print(f"Wrote {args.out}: state_dim={config[0]} action_dim={config[1]} hidden={config[2]} layers={config[3]}")
+
+
+if __name__ == "__main__":
+    main()
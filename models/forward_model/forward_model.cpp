@@ -0,0 +1,89 @@
+/**
+ * Forward Model Inference
+ */
+
+#include "models/forward_model/forward_model.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "models/transformer/simd.h"
+
+namespace shoplifter {
+
+namespace {
+
+void loadLayer(const TensorArchive& archive, const std::string& prefix, size_t out, size_t in, WeightFormat format,
+               PackedLinear& packed) {
+  loadLinear(archive, prefix + "weight", prefix + "bias", out, in, packed, format);
+}
+
+}  // namespace
+
+ForwardModelConfig readForwardModelConfig(const TensorArchive& archive) {
+  const int64_t* v = archive.require("config", TensorType::kInt64, {4}).ints();
+  for (size_t i = 0; i < 4; i++) {
+    if (v[i] <= 0) {
+      throw std::runtime_error("Forward model config in " + archive.path() + " has a non-positive entry");
+    }
+  }
+  ForwardModelConfig config;
+  config.stateDim = static_cast<size_t>(v[0]);
+  config.actionDim = static_cast<size_t>(v[1]);
+  config.hidden = static_cast<size_t>(v[2]);
+  config.layers = static_cast<size_t>(v[3]);
+  return config;
+}
+
+ForwardModel::ForwardModel(const TensorArchive& archive, WeightFormat format)
+    : config_(readForwardModelConfig(archive)) {
+  layers_.resize(config_.layers);
+  for (size_t i = 0; i < config_.layers; i++) {
+    const size_t in = i == 0 ? config_.stateDim + config_.actionDim : config_.hidden;
+    loadLayer(archive, "layers." + std::to_string(i) + ".", config_.hidden, in, format, layers_[i]);
+  }
+  loadLayer(archive, "out.", config_.stateDim, config_.hidden, format, out_);
+}
+
+size_t ForwardModel::workspaceSize(size_t rows) const {
+  const ForwardModelConfig& c = config_;
+  return rows * (c.stateDim + c.actionDim + 2 * std::max(c.hidden, c.stateDim));
+}
+
+void ForwardModel::step(const float* state, size_t lds, const float* action, size_t lda, size_t rows, float* next,
+                        size_t ldn, float* workspace) const {
+  const size_t s = config_.stateDim;
+  const size_t a = config_.actionDim;
+  const size_t h = config_.hidden;
+  const size_t wide = std::max(h, s);
+  float* input = workspace;                       // [rows][s + a]
+  float* ping = input + rows * (s + a);           // [rows][wide]
+  float* pong = ping + rows * wide;
+
+  for (size_t r = 0; r < rows; r++) {
+    std::memcpy(input + r * (s + a), state + r * lds, sizeof(float) * s);
+    std::memcpy(input + r * (s + a) + s, action + r * lda, sizeof(float) * a);
+  }
+  linear(input, rows, s + a, layers_[0], ping, h, Activation::kRelu);
+  for (size_t i = 1; i < layers_.size(); i++) {
+    linear(ping, rows, h, layers_[i], pong, h, Activation::kRelu);
+    std::swap(ping, pong);
+  }
+  // The delta goes to the workspace first so next may alias state
+  linear(ping, rows, h, out_, pong, s);
+
+  using namespace simd;
+  const size_t body = s / kFloatLanes * kFloatLanes;
+  for (size_t r = 0; r < rows; r++) {
+    const float* x = state + r * lds;
+    const float* d = pong + r * s;
+    float* y = next + r * ldn;
+    size_t j = 0;
+    for (; j < body; j += kFloatLanes) store(y + j, add(load(x + j), load(d + j)));
+    for (; j < s; j++) y[j] = x[j] + d[j];
+  }
+}
+
+}  // namespace shoplifter
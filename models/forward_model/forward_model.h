@@ -0,0 +1,80 @@
+/**
+ * Forward Model Inference
+ *
+ * CPU forward pass of the residual MLP in forward_model.py, with weights
+ * loaded from a tensor archive written by export_forward_model.py:
+ *
+ *   h = relu(layers.0([state, action]))
+ *   h = relu(layers.i(h)), i = 1 .. layers - 1
+ *   next = state + out(h)
+ *
+ * Every call steps a batch of rows at once, so planners roll out many
+ * candidate action sequences through the packed GEMM (gemm.h) instead of
+ * one matrix-vector product per candidate. step() is const and takes its
+ * workspace from the caller: one loaded model can serve several threads,
+ * each with its own workspace.
+ */
+
+#ifndef FORWARD_MODEL_H
+#define FORWARD_MODEL_H
+
+#include <cstddef>
+#include <vector>
+
+#include "models/transformer/gemm.h"
+#include "models/transformer/tensor_archive.h"
+
+namespace shoplifter {
+
+struct ForwardModelConfig {
+  size_t stateDim = 0;
+  size_t actionDim = 0;
+  size_t hidden = 0;
+  size_t layers = 0;       // Hidden layers
+};
+
+/**
+ * Read the int64 "config" tensor: [state_dim, action_dim, hidden, layers]
+ *
+ * @throws std::runtime_error if it is missing or inconsistent
+ */
+ForwardModelConfig readForwardModelConfig(const TensorArchive& archive);
+
+class ForwardModel {
+ public:
+  /**
+   * Load and pack the forward-model weights
+   *
+   * @param archive Archive written by export_forward_model.py (may be destroyed afterwards)
+   * @param format Precision of the linear layers (gemm.h)
+   * @throws std::runtime_error if a tensor is missing or has the wrong shape
+   */
+  explicit ForwardModel(const TensorArchive& archive, WeightFormat format = WeightFormat::kFloat32);
+
+  const ForwardModelConfig& config() const { return config_; }
+
+  /**
+   * Workspace floats step() needs for up to rows rows
+   */
+  size_t workspaceSize(size_t rows) const;
+
+  /**
+   * Predict the next state of every row
+   *
+   * @param state [rows][stateDim], row stride lds
+   * @param action [rows][actionDim], row stride lda
+   * @param next [rows][stateDim], row stride ldn; may be state itself (same stride)
+   * @param workspace workspaceSize(rows) floats
+   */
+  void step(const float* state, size_t lds, const float* action, size_t lda, size_t rows, float* next, size_t ldn,
+            float* workspace) const;
+
+ private:
+  ForwardModelConfig config_;
+  std::vector<PackedLinear> layers_;
+  PackedLinear out_;
+};
+
+}  // namespace shoplifter
+
+#endif // FORWARD_MODEL_H
@@ -0,0 +1,76 @@
+"""
+Forward model: predicts the next state from the current state and an action.
+
+A residual MLP over [state, action] with ReLU hidden layers:
+
+    next_state = state + out(relu(... relu(layers.0([state, action]))))
+
+The state is whatever the planner tracks (joint positions, or joint
+positions plus encoder features). Predicting the change rather than the
+next state keeps the identity easy to learn for small control steps.
+
+The parameter names are the contract with the C++ runtime
+(forward_model.h); export_forward_model.py writes this module's state_dict
+to a tensor archive.
+
+Usage:
+    model = ForwardModel(state_dim=12, action_dim=6, hidden=256, layers=2)
+    next_state = model(state, action)       # [batch, state_dim], [batch, action_dim] -> [batch, state_dim]
+    states = model.rollout(state, actions)  # [batch, horizon, action_dim] -> [batch, horizon, state_dim]
+"""
+
+import torch
+from torch import nn
+
+
+class ForwardModel(nn.Module):
+    """
+    Residual MLP dynamics model.
+
+    Args:
+        state_dim: State features
+        action_dim: Action features (joint targets or deltas)
+        hidden: Width of the hidden layers
+        layers: Hidden layers (at least 1)
+    """
+
+    def __init__(self, state_dim: int, action_dim: int, hidden: int = 256, layers: int = 2):
+        super().__init__()
+        if layers < 1:
+            raise ValueError("ForwardModel needs at least one hidden layer")
+        widths = [state_dim + action_dim] + [hidden] * layers
+        self.layers = nn.ModuleList(nn.Linear(widths[i], widths[i + 1]) for i in range(layers))
+        self.out = nn.Linear(hidden, state_dim)
+
+    def forward(self, state: torch.Tensor, action: torch.Tensor) -> torch.Tensor:
+        """
+        Predict the next state.
+
+        Args:
+            state: [..., state_dim]
+            action: [..., action_dim]
+
+        Returns:
+            [..., state_dim] predicted next state
+        """
+        h = torch.cat([state, action], dim=-1)
+        for layer in self.layers:
+            h = torch.relu(layer(h))
+        return state + self.out(h)
+
+    def rollout(self, state: torch.Tensor, actions: torch.Tensor) -> torch.Tensor:
+        """
+        Apply a sequence of actions.
+
+        Args:
+            state: [batch, state_dim] initial state
+            actions: [batch, horizon, action_dim]
+
+        Returns:
+            [batch, horizon, state_dim] predicted states after each action
+        """
+        states = []
+        for t in range(actions.shape[1]):
+            state = self(state, actions[:, t])
+            states.append(state)
+        return torch.stack(states, dim=1)
@@ -0,0 +1,85 @@
+/**
+ * Activation Arena Planning
+ */
+
+#include "models/transformer/arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+
+namespace shoplifter {
+
+namespace {
+
+constexpr size_t kAlignFloats = 64 / sizeof(float);
+
+size_t alignUp(size_t floats) { return (floats + kAlignFloats - 1) / kAlignFloats * kAlignFloats; }
+
+}  // namespace
+
+size_t ArenaPlan::add(size_t floats, size_t firstStep, size_t lastStep) {
+  if (planned_) {
+    throw std::invalid_argument("Arena buffer added after plan()");
+  }
+  if (lastStep < firstStep) {
+    throw std::invalid_argument("Arena buffer is last read before it is written");
+  }
+  buffers_.push_back({alignUp(floats), firstStep, lastStep});
+  return buffers_.size() - 1;
+}
+
+void ArenaPlan::plan() {
+  std::vector<size_t> order(buffers_.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return buffers_[a].floats > buffers_[b].floats; });
+
+  std::vector<size_t> placed;
+  std::vector<const Buffer*> live;
+  size_ = 0;
+  for (size_t id : order) {
+    Buffer& buffer = buffers_[id];
+    live.clear();
+    for (size_t other : placed) {
+      const Buffer& o = buffers_[other];
+      if (o.firstStep <= buffer.lastStep && buffer.firstStep <= o.lastStep) {
+        live.push_back(&o);
+      }
+    }
+    std::sort(live.begin(), live.end(), [](const Buffer* a, const Buffer* b) { return a->offset < b->offset; });
+
+    // Smallest gap between live buffers that fits, else after the last one
+    size_t best = SIZE_MAX;
+    size_t bestGap = SIZE_MAX;
+    size_t cursor = 0;
+    for (const Buffer* o : live) {
+      if (o->offset >= cursor + buffer.floats && o->offset - cursor < bestGap) {
+        best = cursor;
+        bestGap = o->offset - cursor;
+      }
+      cursor = std::max(cursor, o->offset + o->floats);
+    }
+    buffer.offset = best != SIZE_MAX ? best : cursor;
+    size_ = std::max(size_, buffer.offset + buffer.floats);
+    placed.push_back(id);
+  }
+  planned_ = true;
+}
+
+size_t ArenaPlan::unshared() const {
+  size_t total = 0;
+  for (const Buffer& buffer : buffers_) total += buffer.floats;
+  return total;
+}
+
+void ArenaPlan::bind(simd::AlignedFloats& arena, std::vector<float*>& pointers) const {
+  arena.assign(size_, 0.0f);
+  pointers.resize(buffers_.size());
+  for (size_t i = 0; i < buffers_.size(); i++) {
+    pointers[i] = arena.data() + buffers_[i].offset;
+  }
+}
+
+}  // namespace shoplifter
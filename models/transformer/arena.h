@@ -0,0 +1,78 @@
+/**
+ * Activation Arena Planning
+ *
+ * Intermediate buffers of a forward pass are declared up front with the
+ * steps they are live in (first write .. last read). plan() gives each one
+ * an offset into a single arena so that buffers live at the same step never
+ * overlap, and buffers that are never live together share memory:
+ *
+ *   qkv      [0, 1]   ####
+ *   context  [1, 2]       ####         offsets:  qkv, hidden  -> 0
+ *   hidden   [4, 5]               ####           context      -> after qkv
+ *
+ * Placement is greedy by size (largest first, each into the lowest gap that
+ * fits among the live buffers already placed), which is near optimal for
+ * the few, regular buffers of a transformer layer. Offsets are 64-byte
+ * aligned. The arena is allocated once at load time, so the forward pass
+ * allocates nothing.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+#include "models/transformer/simd.h"
+
+namespace shoplifter {
+
+class ArenaPlan {
+ public:
+  /**
+   * Declare a buffer
+   *
+   * @param floats Buffer size
+   * @param firstStep First step the buffer is written in
+   * @param lastStep Last step it is read in
+   * @return Buffer id, for offset()
+   * @throws std::invalid_argument if lastStep < firstStep or the plan is already made
+   */
+  size_t add(size_t floats, size_t firstStep, size_t lastStep);
+
+  // Assign offsets; call once after every add()
+  void plan();
+
+  // Offset in floats of a buffer into the arena
+  size_t offset(size_t id) const { return buffers_[id].offset; }
+
+  // Arena size in floats: the peak of simultaneously live buffers, plus gaps
+  size_t size() const { return size_; }
+
+  // Sum of all buffer sizes, i.e. the arena size without reuse
+  size_t unshared() const;
+
+  /**
+   * Allocate an arena for the plan and point each buffer into it
+   *
+   * @param arena Resized to size()
+   * @param pointers One per buffer id, in add() order
+   */
+  void bind(simd::AlignedFloats& arena, std::vector<float*>& pointers) const;
+
+ private:
+  struct Buffer {
+    size_t floats;
+    size_t firstStep;
+    size_t lastStep;
+    size_t offset = 0;
+  };
+
+  std::vector<Buffer> buffers_;
+  size_t size_ = 0;
+  bool planned_ = false;
+};
+
+}  // namespace shoplifter
+
+#endif // ARENA_H
@@ -0,0 +1,241 @@
+/**
+ * Fused Attention Benchmark
+ *
+ * Times fusedAttention() (kernels.h) against an unfused baseline that
+ * writes each head's full [queries][keys] score matrix, softmaxes it in
+ * place and multiplies by V. Cases:
+ *
+ *   self     seq x seq, unmasked (the encoder) and causal
+ *   cross    16 joint-state queries over seq camera tokens, every 8th key
+ *            hidden as padding, older tokens down-weighted by a score bias
+ *
+ * Every case is first checked against a float64 reference on a sample of
+ * query rows. With --threads > 1 the heads also run on a WorkStealingPool.
+ *
+ * Usage:
+ *   bench_attention [--heads H] [--head-dim D] [--max-seq N] [--threads T] [--budget-ms MS]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "inference/planner/work_stealing_pool.h"
+#include "models/transformer/kernels.h"
+#include "models/transformer/simd.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t kJointTokens = 16;
+constexpr size_t kPaddingEvery = 8;
+
+std::vector<float> randomValues(size_t n, float scale, uint64_t seed) {
+  std::vector<float> v(n);
+  for (float& x : v) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    x = scale * (static_cast<float>(seed >> 40) * 0x1p-24f - 0.5f);
+  }
+  return v;
+}
+
+// Median milliseconds per call, running fn for about budgetMs
+template <typename Fn>
+double medianMs(Fn&& fn, double budgetMs) {
+  fn();
+  std::vector<double> times;
+  const auto start = Clock::now();
+  while (times.size() < 5 ||
+         (times.size() < 1000 &&
+          std::chrono::duration<double, std::milli>(Clock::now() - start).count() < budgetMs)) {
+    const auto t0 = Clock::now();
+    fn();
+    times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+  }
+  std::sort(times.begin(), times.end());
+  return times[times.size() / 2];
+}
+
+bool visible(const AttentionMask& mask, size_t queries, size_t keys, size_t i, size_t j) {
+  if (mask.keys && !mask.keys[j]) return false;
+  return !mask.causal || static_cast<ptrdiff_t>(j) <= static_cast<ptrdiff_t>(i + keys) - static_cast<ptrdiff_t>(queries);
+}
+
+float biasAt(const AttentionMask& mask, size_t i, size_t j) { return mask.bias ? mask.bias[i * mask.ldb + j] : 0.0f; }
+
+struct Case {
+  const char* name;
+  size_t queries;
+  size_t keys;
+  AttentionMask mask;
+};
+
+// The unfused baseline: the full score matrix per head, softmaxed in place
+void materialized(const float* q, const float* k, const float* v, size_t ld, const Case& c, size_t heads,
+                  size_t hd, float* out, float* kT, float* scores) {
+  using namespace simd;
+  constexpr size_t kLanes = kFloatLanes;
+  const size_t keysPad = (c.keys + kLanes - 1) / kLanes * kLanes;
+  const float scale = 1.0f / std::sqrt(static_cast<float>(hd));
+  for (size_t h = 0; h < heads; h++) {
+    for (size_t d = 0; d < hd; d++) {
+      for (size_t j = 0; j < keysPad; j++) kT[d * keysPad + j] = j < c.keys ? k[j * ld + h * hd + d] : 0.0f;
+    }
+    for (size_t i = 0; i < c.queries; i++) {
+      float* s = scores + i * keysPad;
+      for (size_t j = 0; j < keysPad; j += kLanes) {
+        VecF acc = zero();
+        for (size_t d = 0; d < hd; d++) acc = fma(broadcast(q[i * ld + h * hd + d] * scale), load(kT + d * keysPad + j), acc);
+        store(s + j, acc);
+      }
+      for (size_t j = 0; j < keysPad; j++) {
+        if (j >= c.keys || !visible(c.mask, c.queries, c.keys, i, j)) {
+          s[j] = -INFINITY;
+        } else {
+          s[j] += biasAt(c.mask, i, j);
+        }
+      }
+    }
+    for (size_t i = 0; i < c.queries; i++) {
+      float* s = scores + i * keysPad;
+      VecF vmax = broadcast(-INFINITY);
+      for (size_t j = 0; j < keysPad; j += kLanes) vmax = max(vmax, load(s + j));
+      const VecF m = broadcast(reduceMax(vmax));
+      VecF vsum = zero();
+      for (size_t j = 0; j < keysPad; j += kLanes) {
+        const VecF e = exp(sub(load(s + j), m));
+        store(s + j, e);
+      }
+      for (size_t j = c.keys; j < keysPad; j++) s[j] = 0.0f;
+      if (c.mask.keys || c.mask.causal) {
+        for (size_t j = 0; j < c.keys; j++) s[j] = visible(c.mask, c.queries, c.keys, i, j) ? s[j] : 0.0f;
+      }
+      for (size_t j = 0; j < keysPad; j += kLanes) vsum = add(vsum, load(s + j));
+      const float inverse = 1.0f / reduceAdd(vsum);
+      for (size_t cc = 0; cc < hd; cc += kLanes) {
+        VecF acc = zero();
+        for (size_t j = 0; j < c.keys; j++) acc = fma(broadcast(s[j]), load(v + j * ld + h * hd + cc), acc);
+        store(out + i * ld + h * hd + cc, mul(acc, broadcast(inverse)));
+      }
+    }
+  }
+}
+
+// Max abs error of out against a float64 reference, on every step-th query row
+double referenceError(const float* q, const float* k, const float* v, size_t ld, const Case& c, size_t heads,
+                      size_t hd, const float* out) {
+  const size_t step = std::max<size_t>(1, c.queries / 16);
+  const double scale = 1.0 / std::sqrt(static_cast<double>(hd));
+  std::vector<double> s(c.keys);
+  double worst = 0.0;
+  for (size_t i = 0; i < c.queries; i += step) {
+    for (size_t h = 0; h < heads; h++) {
+      double m = -INFINITY;
+      for (size_t j = 0; j < c.keys; j++) {
+        double dot = 0.0;
+        for (size_t d = 0; d < hd; d++) dot += static_cast<double>(q[i * ld + h * hd + d]) * k[j * ld + h * hd + d];
+        s[j] = visible(c.mask, c.queries, c.keys, i, j) ? dot * scale + biasAt(c.mask, i, j) : -INFINITY;
+        m = std::max(m, s[j]);
+      }
+      double sum = 0.0;
+      for (size_t j = 0; j < c.keys; j++) {
+        s[j] = s[j] == -INFINITY ? 0.0 : std::exp(s[j] - m);
+        sum += s[j];
+      }
+      for (size_t d = 0; d < hd; d++) {
+        double acc = 0.0;
+        for (size_t j = 0; j < c.keys; j++) acc += s[j] * v[j * ld + h * hd + d];
+        worst = std::max(worst, std::fabs(acc / sum - out[i * ld + h * hd + d]));
+      }
+    }
+  }
+  return worst;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t heads = 4;
+  size_t hd = 32;
+  size_t maxSeq = 4096;
+  size_t threads = 1;
+  double budgetMs = 300.0;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--heads")) heads = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--head-dim")) hd = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--max-seq")) maxSeq = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--threads")) threads = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--budget-ms")) budgetMs = std::atof(next());
+  }
+  if (heads == 0 || hd == 0 || hd % simd::kFloatLanes != 0 || maxSeq < kJointTokens) {
+    std::fprintf(stderr, "--head-dim must be a multiple of %zu and --max-seq at least %zu\n", simd::kFloatLanes,
+                 kJointTokens);
+    return 1;
+  }
+
+  const size_t ld = heads * hd;
+  std::unique_ptr<WorkStealingPool> pool;
+  ParallelFor parallel;
+  if (threads > 1) {
+    pool = std::make_unique<WorkStealingPool>(threads);
+    parallel = [&](size_t tasks, const std::function<void(size_t, size_t)>& fn) { pool->parallelFor(tasks, fn); };
+  }
+  std::vector<uint8_t> padding(maxSeq);
+  for (size_t j = 0; j < maxSeq; j++) padding[j] = j % kPaddingEvery != kPaddingEvery - 1;
+  std::vector<float> recency(kJointTokens * maxSeq);
+
+  std::printf("%zu heads x %zu, %s, %zu thread(s)\n", heads, hd, simd::kTargetName, threads);
+  std::printf("%-8s %7s %6s %11s %12s %10s %8s %13s %12s\n", "case", "queries", "keys", "max error", "unfused ms",
+              "fused ms", "speedup", "scores KiB", "scratch KiB");
+  for (size_t seq = 64; seq <= maxSeq; seq *= 4) {
+    AttentionMask causal;
+    causal.causal = true;
+    AttentionMask cross;
+    cross.keys = padding.data();
+    cross.bias = recency.data();
+    cross.ldb = seq;
+    for (size_t i = 0; i < kJointTokens; i++) {
+      for (size_t j = 0; j < seq; j++) recency[i * seq + j] = -4.0f * static_cast<float>(seq - 1 - j) / static_cast<float>(seq);
+    }
+    const Case cases[] = {{"self", seq, seq, {}}, {"causal", seq, seq, causal}, {"cross", kJointTokens, seq, cross}};
+    for (const Case& c : cases) {
+      const std::vector<float> qkv = randomValues(std::max(c.queries, c.keys) * ld * 3, 4.0f, seq + c.queries);
+      const float* q = qkv.data();
+      const float* k = q + c.queries * ld;
+      const float* v = k + c.keys * ld;
+      simd::AlignedFloats out(c.queries * ld), unfused(c.queries * ld);
+      simd::AlignedFloats scratch(fusedAttentionScratchSize(c.keys, hd, threads));
+      const size_t keysPad = (c.keys + simd::kFloatLanes - 1) / simd::kFloatLanes * simd::kFloatLanes;
+      simd::AlignedFloats kT(hd * keysPad), scores(c.queries * keysPad);
+
+      fusedAttention(q, ld, c.queries, k, ld, v, ld, c.keys, heads, hd, out.data(), ld, scratch.data(), c.mask,
+                     parallel);
+      const double error = referenceError(q, k, v, ld, c, heads, hd, out.data());
+      const double unfusedMs = medianMs(
+          [&] { materialized(q, k, v, ld, c, heads, hd, unfused.data(), kT.data(), scores.data()); }, budgetMs);
+      const double fusedMs = medianMs(
+          [&] {
+            fusedAttention(q, ld, c.queries, k, ld, v, ld, c.keys, heads, hd, out.data(), ld, scratch.data(), c.mask,
+                           parallel);
+          },
+          budgetMs);
+      std::printf("%-8s %7zu %6zu %11.2e %12.3f %10.3f %7.2fx %13.1f %12.1f\n", c.name, c.queries, c.keys, error,
+                  unfusedMs, fusedMs, unfusedMs / fusedMs, static_cast<double>(c.queries * keysPad) * 4.0 / 1024.0,
+                  static_cast<double>(scratch.size()) * 4.0 / 1024.0);
+      if (!(error < 1e-4)) {
+        std::fprintf(stderr, "%s %zu: fused attention differs from the reference\n", c.name, seq);
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * Encoder Inference Benchmark
+ *
+ * Loads an archive from export_weights.py, checks the native forward pass
+ * against the exported reference output (test.input / test.output) and
+ * measures per-call latency against the control tick. The load time is
+ * from opening the archive to a constructed encoder; it is shorter when
+ * the archive carries panels pre-packed for this target (--pack-nr).
+ *
+ * It also reports the activation arena against the sum of its buffers,
+ * and counts heap allocations (operator new) in the timed calls: any is
+ * a failure, like a reference mismatch.
+ *
+ * Usage:
+ *   bench_encoder [--seq N] [--iters N] [--tick-ms MS] encoder.tensors
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "models/transformer/encoder.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+
+double percentile(std::vector<double> v, double p) {
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, static_cast<size_t>(p * static_cast<double>(v.size())))];
+}
+
+double flopsPerCall(const TransformerEncoder& encoder, size_t seq) {
+  const EncoderConfig& c = encoder.config();
+  const double s = static_cast<double>(seq);
+  const double d = static_cast<double>(c.dModel);
+  const double n = static_cast<double>(nextPowerOfTwo(seq));
+  double flops = 2.0 * s * d * static_cast<double>(c.inputDim);
+  for (size_t i = 0; i < c.layers; i++) {
+    flops += 4.0 * s * d * static_cast<double>(c.ffDim);
+    if (encoder.layerMixer(i) == TokenMixer::kFft) {
+      flops += 5.0 * n * std::log2(n) * d;  // Forward and inverse FFT of d / 2 complex columns
+    } else {
+      flops += 8.0 * s * d * d + 4.0 * s * s * d;
+    }
+  }
+  return flops;
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char** argv) {
+  size_t seq = 0;
+  size_t iters = 2000;
+  double tickMs = 20.0;
+  std::string path;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--seq")) seq = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--iters")) iters = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--tick-ms")) tickMs = std::atof(next());
+    else path = argv[i];
+  }
+  if (path.empty()) {
+    std::fprintf(stderr, "Usage: %s [--seq N] [--iters N] [--tick-ms MS] encoder.tensors\n", argv[0]);
+    return 1;
+  }
+
+  bool ok = true;
+  try {
+    const auto loadStart = Clock::now();
+    TensorArchive archive(path);
+    TransformerEncoder encoder(archive);
+    const double loadMs = std::chrono::duration<double, std::milli>(Clock::now() - loadStart).count();
+    const EncoderConfig& c = encoder.config();
+    seq = seq ? std::min(seq, c.maxSeq) : c.maxSeq;
+    size_t fftLayers = 0;
+    for (size_t i = 0; i < c.layers; i++) fftLayers += encoder.layerMixer(i) == TokenMixer::kFft;
+    std::printf("%s: input %zu, d_model %zu, %zu heads, ff %zu, %zu layers (%zu FFT), seq %zu (%s)\n",
+                path.c_str(), c.inputDim, c.dModel, c.heads, c.ffDim, c.layers, fftLayers, seq, simd::kTargetName);
+    const bool prepacked = archive.contains("input_proj.weight.packed" + std::to_string(kGemmNR));
+    std::printf("  load %.2f ms (%s)\n", loadMs, prepacked ? "pre-packed weights, mapped in place" : "packed at load");
+    const ArenaPlan& plan = encoder.workspacePlan();
+    std::printf("  activations %.1f KiB in one arena (%.1f KiB without reuse)\n",
+                static_cast<double>(plan.size() * sizeof(float)) / 1024.0,
+                static_cast<double>(plan.unshared() * sizeof(float)) / 1024.0);
+
+    std::vector<float> input(c.maxSeq * c.inputDim);
+    std::vector<float> out(c.maxSeq * c.dModel);
+    if (archive.contains("test.input") && archive.contains("test.output")) {
+      const Tensor& x = archive.require("test.input", TensorType::kFloat32, {c.maxSeq, c.inputDim});
+      const Tensor& y = archive.require("test.output", TensorType::kFloat32, {c.maxSeq, c.dModel});
+      encoder.encode(x.floats(), c.maxSeq, out.data());
+      double maxError = 0.0;
+      for (size_t i = 0; i < y.count; i++) {
+        maxError = std::max(maxError, std::fabs(static_cast<double>(out[i]) - y.floats()[i]));
+      }
+      ok = maxError < 1e-3;
+      std::printf("  reference check: max abs error %.3g %s\n", maxError, ok ? "ok" : "MISMATCH");
+      std::copy(x.floats(), x.floats() + x.count, input.begin());
+    } else {
+      for (size_t i = 0; i < input.size(); i++) input[i] = std::sin(0.37f * static_cast<float>(i));
+    }
+
+    for (size_t i = 0; i < 20; i++) encoder.encode(input.data(), seq, out.data());
+    std::vector<double> latency(iters);
+    const uint64_t allocationsBefore = allocations.load();
+    for (size_t i = 0; i < iters; i++) {
+      const auto start = Clock::now();
+      encoder.encode(input.data(), seq, out.data());
+      latency[i] = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+    const uint64_t steadyAllocations = allocations.load() - allocationsBefore;
+    const double p50 = percentile(latency, 0.5);
+    const double p99 = percentile(latency, 0.99);
+    std::printf("  latency p50 %.3f ms, p99 %.3f ms, max %.3f ms  (%.1f GFLOP/s at p50)\n", p50, p99,
+                *std::max_element(latency.begin(), latency.end()), flopsPerCall(encoder, seq) / (p50 * 1e6));
+    std::printf("  p99 uses %.1f%% of a %.0f ms tick\n", 100.0 * p99 / tickMs, tickMs);
+    std::printf("  heap allocations in %zu calls: %llu %s\n", iters,
+                static_cast<unsigned long long>(steadyAllocations), steadyAllocations ? "FAIL" : "ok");
+    ok = ok && steadyAllocations == 0;
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+/**
+ * FFT Mixer vs Attention Benchmark
+ *
+ * Times one token-mixing sublayer across sequence lengths: multi-head
+ * self-attention (in_proj, attention, out_proj) against the FFT mixer, with
+ * random weights, and shows where the O(seq^2) term takes over.
+ *
+ * Usage:
+ *   bench_fft_mixer [--d-model D] [--heads H] [--max-seq N] [--budget-ms MS]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "models/transformer/fft_mixer.h"
+#include "models/transformer/gemm.h"
+#include "models/transformer/kernels.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+std::vector<float> randomValues(size_t n, float scale, uint64_t seed) {
+  std::vector<float> v(n);
+  for (float& x : v) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    x = scale * (static_cast<float>(seed >> 40) * 0x1p-24f - 0.5f);
+  }
+  return v;
+}
+
+// Median milliseconds per call, running fn for about budgetMs
+template <typename Fn>
+double medianMs(Fn&& fn, double budgetMs) {
+  fn();
+  std::vector<double> times;
+  const auto start = Clock::now();
+  while (times.size() < 5 ||
+         (times.size() < 1000 &&
+          std::chrono::duration<double, std::milli>(Clock::now() - start).count() < budgetMs)) {
+    const auto t0 = Clock::now();
+    fn();
+    times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+  }
+  std::sort(times.begin(), times.end());
+  return times[times.size() / 2];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t d = 128;
+  size_t heads = 4;
+  size_t maxSeq = 4096;
+  double budgetMs = 300.0;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--d-model")) d = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--heads")) heads = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--max-seq")) maxSeq = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--budget-ms")) budgetMs = std::atof(next());
+  }
+  if (d == 0 || heads == 0 || d % heads != 0 || d % 2 != 0) {
+    std::fprintf(stderr, "d_model must be even and a multiple of heads\n");
+    return 1;
+  }
+
+  PackedLinear inProj, outProj;
+  packLinear(randomValues(3 * d * d, 0.2f, 1).data(), randomValues(3 * d, 0.2f, 2).data(), 3 * d, d, inProj);
+  packLinear(randomValues(d * d, 0.2f, 3).data(), randomValues(d, 0.2f, 4).data(), d, d, outProj);
+  const size_t fftSize = nextPowerOfTwo(maxSeq);
+  const size_t bins = fftSize / 2 + 1;
+  FftFilter filter;
+  packFftFilter(randomValues(bins * d, 1.0f, 5).data(), randomValues(bins * d, 1.0f, 6).data(),
+                randomValues(d, 0.2f, 7).data(), d, fftSize, filter);
+  FftPlanCache plans;
+  plans.prepare(maxSeq);
+
+  const std::vector<float> x = randomValues(maxSeq * d, 2.0f, 8);
+  simd::AlignedFloats qkv(maxSeq * 3 * d), context(maxSeq * d), y(maxSeq * d);
+  simd::AlignedFloats attnScratch(attentionScratchSize(maxSeq, d / heads));
+  simd::AlignedFloats fftScratch(fftMixScratchSize(filter, maxSeq));
+
+  std::printf("d_model %zu, %zu heads (%s)\n", d, heads, simd::kTargetName);
+  std::printf("%8s %14s %14s %9s\n", "seq", "attention ms", "fft mixer ms", "speedup");
+  for (size_t seq = 16; seq <= maxSeq; seq *= 2) {
+    const double attnMs = medianMs([&]() {
+      linear(x.data(), seq, d, inProj, qkv.data(), 3 * d);
+      attention(qkv.data(), seq, d, heads, context.data(), d, attnScratch.data());
+      linear(context.data(), seq, d, outProj, y.data(), d);
+    }, budgetMs);
+    const double fftMs = medianMs([&]() {
+      fftMix(filter, plans, x.data(), seq, d, y.data(), d, fftScratch.data());
+    }, budgetMs);
+    std::printf("%8zu %14.3f %14.3f %8.1fx\n", seq, attnMs, fftMs, attnMs / fftMs);
+  }
+  return 0;
+}
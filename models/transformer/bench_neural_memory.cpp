@@ -0,0 +1,116 @@
+/**
+ * Neural Memory Benchmark
+ *
+ * Checks NeuralMemory against the reference reads in the archive, then runs
+ * a long session of step() calls and reports latency percentiles per
+ * segment of the session (flat: the cost does not grow with the session)
+ * and the mean surprise per segment on a stream that repeats a fixed
+ * pattern, which falls as the memory learns it.
+ *
+ * Usage:
+ *   bench_neural_memory [--ticks 100000] [--period 50] memory.tensors
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "models/transformer/neural_memory.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double percentile(std::vector<double> v, double p) {
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, static_cast<size_t>(p * static_cast<double>(v.size())))];
+}
+
+double checkReference(const TensorArchive& archive, NeuralMemory& memory) {
+  const NeuralMemoryConfig& c = memory.config();
+  const Tensor& input = archive.require("test.input", TensorType::kFloat32);
+  const size_t steps = input.shape[0];
+  archive.require("test.input", TensorType::kFloat32, {steps, c.dim});
+  const Tensor& expected = archive.require("test.output", TensorType::kFloat32, {steps, c.valueDim});
+  std::vector<float> out(c.valueDim);
+  double diff = 0.0, norm = 0.0;
+  for (size_t t = 0; t < steps; t++) {
+    memory.step(input.floats() + t * c.dim, out.data());
+    for (size_t i = 0; i < c.valueDim; i++) {
+      const double e = expected.floats()[t * c.valueDim + i];
+      diff = std::max(diff, std::fabs(out[i] - e));
+      norm = std::max(norm, std::fabs(e));
+    }
+  }
+  memory.reset();
+  return norm > 0.0 ? diff / norm : diff;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t ticks = 100000;
+  size_t period = 50;
+  std::string path;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--ticks")) ticks = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--period")) period = static_cast<size_t>(std::atoi(next()));
+    else path = argv[i];
+  }
+  if (path.empty() || ticks < 10 || period == 0) {
+    std::fprintf(stderr, "Usage: %s [--ticks 100000] [--period 50] memory.tensors\n", argv[0]);
+    return 1;
+  }
+
+  try {
+    TensorArchive archive(path);
+    NeuralMemory memory(archive);
+    const NeuralMemoryConfig& c = memory.config();
+    std::printf("%s: dim %zu, key %zu, hidden %zu, value %zu (%s)\n", path.c_str(), c.dim, c.keyDim, c.hidden,
+                c.valueDim, simd::kTargetName);
+    std::printf("reference max error %.2e (relative to the largest read)\n\n", checkReference(archive, memory));
+
+    // A pattern of `period` embeddings, repeated with a little noise
+    std::vector<float> pattern(period * c.dim);
+    uint64_t rng = 5;
+    auto uniform = [&]() {
+      rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+      return static_cast<float>(static_cast<double>(rng >> 11) * 0x1p-53 - 0.5);
+    };
+    for (float& x : pattern) x = 2.0f * uniform();
+
+    std::printf("%-18s %10s %10s %14s %8s\n", "ticks", "p50 us", "p99 us", "mean surprise", "writes");
+    const size_t segments = 10;
+    const size_t segment = ticks / segments;
+    std::vector<float> x(c.dim), out(c.valueDim);
+    std::vector<double> latency(segment);
+    for (size_t s = 0; s < segments; s++) {
+      double surprise = 0.0;
+      const uint64_t writesBefore = memory.writes();
+      for (size_t i = 0; i < segment; i++) {
+        const size_t t = s * segment + i;
+        const float* p = &pattern[(t % period) * c.dim];
+        for (size_t j = 0; j < c.dim; j++) x[j] = p[j] + 0.05f * uniform();
+        const auto start = Clock::now();
+        surprise += memory.step(x.data(), out.data());
+        latency[i] = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+      }
+      const std::string label = std::to_string(s * segment) + ".." + std::to_string((s + 1) * segment);
+      std::printf("%-18s %10.2f %10.2f %14.4f %8llu\n", label.c_str(), percentile(latency, 0.5),
+                  percentile(latency, 0.99), surprise / segment,
+                  static_cast<unsigned long long>(memory.writes() - writesBefore));
+    }
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * Quantized Inference Benchmark
+ *
+ * Loads the encoder in fp32, fp16 and int8 (gemm.h WeightFormat) and reports,
+ * per format, the error of its embeddings against fp32 on the archive's
+ * test window and the encode() latency and speedup over fp32. int8 uses the
+ * activation scales of calibrate_quantization.py if the archive has them,
+ * else per-row dynamic scales.
+ *
+ * With --forward, the forward model is loaded the same way and the error of
+ * its predicted joint states against fp32 is reported, for one step and
+ * for an open-loop rollout of --horizon steps (where errors compound), in
+ * the units the model was trained in.
+ *
+ * Usage:
+ *   bench_quantized [--iters N] [--forward forward.tensors] [--horizon 20] encoder.tensors
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "models/forward_model/forward_model.h"
+#include "models/transformer/encoder.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr WeightFormat kFormats[] = {WeightFormat::kFloat32, WeightFormat::kFloat16, WeightFormat::kInt8};
+
+double percentile(std::vector<double> v, double p) {
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, static_cast<size_t>(p * static_cast<double>(v.size())))];
+}
+
+// ||y - ref|| / ||ref|| and max |y - ref|
+void compare(const std::vector<float>& y, const std::vector<float>& ref, double& relative, double& maxAbs) {
+  double diff = 0.0, norm = 0.0;
+  maxAbs = 0.0;
+  for (size_t i = 0; i < ref.size(); i++) {
+    const double e = static_cast<double>(y[i]) - ref[i];
+    diff += e * e;
+    norm += static_cast<double>(ref[i]) * ref[i];
+    maxAbs = std::max(maxAbs, std::fabs(e));
+  }
+  relative = norm > 0.0 ? std::sqrt(diff / norm) : std::sqrt(diff);
+}
+
+bool calibrated(const TensorArchive& archive) { return archive.contains("input_proj.weight.act_scale"); }
+
+void benchEncoder(const TensorArchive& archive, size_t iters) {
+  std::vector<float> reference, input;
+  double fp32Ms = 0.0;
+  std::printf("format                rel. error   max abs error   p50 ms   speedup\n");
+  for (WeightFormat format : kFormats) {
+    TransformerEncoder encoder(archive, format);
+    const EncoderConfig& c = encoder.config();
+    const size_t seq = c.maxSeq;
+    if (input.empty()) {
+      input.resize(seq * c.inputDim);
+      if (archive.contains("test.input")) {
+        const Tensor& x = archive.require("test.input", TensorType::kFloat32, {seq, c.inputDim});
+        std::copy(x.floats(), x.floats() + x.count, input.begin());
+      } else {
+        for (size_t i = 0; i < input.size(); i++) input[i] = std::sin(0.37f * static_cast<float>(i));
+      }
+    }
+    std::vector<float> out(seq * c.dModel);
+    encoder.encode(input.data(), seq, out.data());
+    if (format == WeightFormat::kFloat32) reference = out;
+
+    for (size_t i = 0; i < 10; i++) encoder.encode(input.data(), seq, out.data());
+    std::vector<double> latency(iters);
+    for (size_t i = 0; i < iters; i++) {
+      const auto start = Clock::now();
+      encoder.encode(input.data(), seq, out.data());
+      latency[i] = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+    const double p50 = percentile(latency, 0.5);
+    if (format == WeightFormat::kFloat32) fp32Ms = p50;
+
+    double relative, maxAbs;
+    compare(out, reference, relative, maxAbs);
+    const std::string name = format == WeightFormat::kInt8
+                                 ? std::string("int8 (") + (calibrated(archive) ? "calibrated)" : "dynamic)")
+                                 : weightFormatName(format);
+    std::printf("%-20s %10.2e %15.2e %8.3f %8.2fx\n", name.c_str(), relative, maxAbs, p50, fp32Ms / p50);
+  }
+}
+
+void benchForward(const std::string& path, size_t horizon, size_t iters) {
+  TensorArchive archive(path);
+  const Tensor& state = archive.require("test.state", TensorType::kFloat32);
+  const size_t rows = state.shape[0];
+  std::vector<float> reference1, referenceH;
+  double fp32Us = 0.0;
+  std::printf("\n%s: predicted joint states vs fp32, %zu rows\n", path.c_str(), rows);
+  std::printf("format     1-step mean err   1-step max err   %zu-step max err   step us   speedup\n", horizon);
+  for (WeightFormat format : kFormats) {
+    ForwardModel model(archive, format);
+    const ForwardModelConfig& c = model.config();
+    archive.require("test.state", TensorType::kFloat32, {rows, c.stateDim});
+    const Tensor& action = archive.require("test.action", TensorType::kFloat32, {rows, c.actionDim});
+    simd::AlignedFloats workspace(model.workspaceSize(rows));
+    std::vector<float> next(rows * c.stateDim);
+    model.step(state.floats(), c.stateDim, action.floats(), c.actionDim, rows, next.data(), c.stateDim,
+               workspace.data());
+    std::vector<float> rolled(state.floats(), state.floats() + state.count);
+    for (size_t t = 0; t < horizon; t++) {
+      model.step(rolled.data(), c.stateDim, action.floats(), c.actionDim, rows, rolled.data(), c.stateDim,
+                 workspace.data());
+    }
+    if (format == WeightFormat::kFloat32) {
+      reference1 = next;
+      referenceH = rolled;
+    }
+
+    std::vector<double> latency(iters);
+    for (size_t i = 0; i < iters; i++) {
+      const auto start = Clock::now();
+      model.step(state.floats(), c.stateDim, action.floats(), c.actionDim, rows, next.data(), c.stateDim,
+                 workspace.data());
+      latency[i] = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+    const double p50 = percentile(latency, 0.5);
+    if (format == WeightFormat::kFloat32) fp32Us = p50;
+
+    double mean = 0.0, max1 = 0.0, maxH, relative;
+    for (size_t i = 0; i < next.size(); i++) {
+      const double e = std::fabs(static_cast<double>(next[i]) - reference1[i]);
+      mean += e / static_cast<double>(next.size());
+      max1 = std::max(max1, e);
+    }
+    compare(rolled, referenceH, relative, maxH);
+    std::printf("%-10s %16.2e %16.2e %17.2e %9.2f %8.2fx\n", weightFormatName(format), mean, max1, maxH, p50,
+                fp32Us / p50);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t iters = 500;
+  size_t horizon = 20;
+  std::string forwardPath;
+  std::string path;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--iters")) iters = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--forward")) forwardPath = next();
+    else if (!std::strcmp(argv[i], "--horizon")) horizon = static_cast<size_t>(std::atoi(next()));
+    else path = argv[i];
+  }
+  if (path.empty() || iters == 0) {
+    std::fprintf(stderr, "Usage: %s [--iters N] [--forward forward.tensors] [--horizon 20] encoder.tensors\n",
+                 argv[0]);
+    return 1;
+  }
+
+  try {
+    TensorArchive archive(path);
+    const EncoderConfig c = readEncoderConfig(archive);
+    std::printf("%s: d_model %zu, ff %zu, %zu layers, seq %zu (%s)\n", path.c_str(), c.dModel, c.ffDim, c.layers,
+                c.maxSeq, simd::kTargetName);
+    benchEncoder(archive, iters);
+    if (!forwardPath.empty()) {
+      benchForward(forwardPath, horizon, iters);
+    }
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,131 @@
+/**
+ * Streaming Encoder Benchmark
+ *
+ * Pushes a synthetic telemetry stream (smooth multi-frequency joint motion
+ * plus noise) through StreamingEncoder in exact mode and in bounded-staleness
+ * mode at several refresh rates. Reports per-push latency and, against the
+ * exact result of the same tick, the relative error of the newest embedding
+ * and of the whole window.
+ *
+ * Usage:
+ *   bench_streaming_encoder [--window N] [--ticks N] [--full-refresh N] encoder.tensors
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "models/transformer/streaming_encoder.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double percentile(std::vector<double> v, double p) {
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, static_cast<size_t>(p * static_cast<double>(v.size())))];
+}
+
+double relativeError(const float* a, const float* b, size_t n) {
+  double diff = 0.0, norm = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    diff += (double(a[i]) - b[i]) * (double(a[i]) - b[i]);
+    norm += double(b[i]) * b[i];
+  }
+  return norm > 0.0 ? std::sqrt(diff / norm) : 0.0;
+}
+
+std::vector<float> telemetry(size_t ticks, size_t dim) {
+  std::vector<float> x(ticks * dim);
+  uint64_t rng = 7;
+  for (size_t t = 0; t < ticks; t++) {
+    for (size_t j = 0; j < dim; j++) {
+      rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+      const double noise = (static_cast<double>(rng >> 11) * 0x1p-53 - 0.5) * 0.05;
+      const double f = 0.01 * static_cast<double>(j + 1);
+      x[t * dim + j] = static_cast<float>(std::sin(f * double(t) + j) + 0.3 * std::sin(3.1 * f * double(t)) + noise);
+    }
+  }
+  return x;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t window = 0;
+  size_t ticks = 400;
+  size_t fullRefresh = 0;
+  std::string path;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--window")) window = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--ticks")) ticks = static_cast<size_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--full-refresh")) fullRefresh = static_cast<size_t>(std::atoi(next()));
+    else path = argv[i];
+  }
+  if (path.empty()) {
+    std::fprintf(stderr, "Usage: %s [--window N] [--ticks N] [--full-refresh N] encoder.tensors\n", argv[0]);
+    return 1;
+  }
+
+  try {
+    TensorArchive archive(path);
+    TransformerEncoder exactEncoder(archive);
+    TransformerEncoder streamEncoder(archive);
+    const EncoderConfig& c = exactEncoder.config();
+    window = window ? std::min(window, c.maxSeq) : c.maxSeq;
+    const std::vector<float> stream = telemetry(ticks, c.inputDim);
+    std::printf("%s: d_model %zu, %zu layers, window %zu, %zu ticks (%s)\n", path.c_str(), c.dModel, c.layers,
+                window, ticks, simd::kTargetName);
+    std::printf("%-22s %10s %10s %12s %12s %10s\n", "mode", "p50 ms", "p99 ms", "latest err", "window err",
+                "staleness");
+
+    const size_t refreshes[] = {0, 1, 2, 4, 8, 16};
+    for (size_t run = 0; run <= sizeof(refreshes) / sizeof(refreshes[0]); run++) {
+      StreamOptions options;
+      std::string label = "exact";
+      if (run > 0) {
+        options.mode = StreamMode::kBoundedStaleness;
+        options.refreshPerTick = refreshes[run - 1];
+        options.fullRefreshEvery = fullRefresh;
+        label = "stale, refresh " + std::to_string(options.refreshPerTick);
+      }
+      StreamingEncoder exact(exactEncoder, window);
+      StreamingEncoder streaming(streamEncoder, window, options);
+      std::vector<float> a(window * c.dModel), b(window * c.dModel);
+      std::vector<double> latency;
+      double latestError = 0.0, windowError = 0.0;
+      uint64_t staleness = 0;
+
+      for (size_t t = 0; t < ticks; t++) {
+        const float* obs = &stream[t * c.inputDim];
+        const auto start = Clock::now();
+        streaming.push(obs);
+        latency.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        if (run == 0) continue;
+        exact.push(obs);
+        // Error once the window is full (steady state)
+        if (t + 1 >= window) {
+          latestError = std::max(latestError, relativeError(streaming.latest(), exact.latest(), c.dModel));
+          streaming.copyWindow(a.data());
+          exact.copyWindow(b.data());
+          windowError = std::max(windowError, relativeError(a.data(), b.data(), window * c.dModel));
+          staleness = std::max(staleness, streaming.maxStaleness());
+        }
+      }
+      std::printf("%-22s %10.3f %10.3f %12.2e %12.2e %10llu\n", label.c_str(), percentile(latency, 0.5),
+                  percentile(latency, 0.99), latestError, windowError, static_cast<unsigned long long>(staleness));
+    }
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,146 @@
+"""
+Calibrate INT8 activation scales of an encoder archive on recorded episodes.
+
+Runs the numpy reference encoder (export_weights.py) over observation
+windows cut from .episode recordings, collects the absolute values at the
+input of every linear layer, and stores a per-layer step
+
+    <weight>.act_scale   float32 [1] = percentile(|x|) / 127
+
+in the archive. TransformerEncoder(archive, WeightFormat::kInt8) quantizes
+activations with these fixed steps instead of each row's max abs value,
+which saves a pass over every input row and clips rare outliers. A
+percentile below 100 trades clipping error on outliers for resolution on
+the bulk of the values.
+
+Observation windows are built from the episode columns the encoder was
+trained on: --columns in order, then with --velocities their per-sample
+differences, giving [samples, input_dim].
+
+Usage:
+    python models/transformer/calibrate_quantization.py --archive encoder.tensors --episodes episodes/*.episode
+    python models/transformer/calibrate_quantization.py --archive encoder.tensors --catalog episodes.catalog \
+        --columns b,s,e,t,r,g --velocities --windows 512 --percentile 99.99
+"""
+
+import argparse
+import os
+import sys
+from typing import Dict, List
+
+import numpy as np
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+from models.transformer.export_weights import (infer_config, read_archive, reference_encode,  # noqa: E402
+                                               write_archive)
+from training.data.catalog import EpisodeCatalog  # noqa: E402
+from training.data.episode import Episode  # noqa: E402
+
+
+SCALE_SUFFIX = ".act_scale"
+MAX_SAMPLES_PER_LAYER = 1 << 22
+
+
+def episode_observations(path: str, columns: List[str], velocities: bool) -> np.ndarray:
+    """
+    Observation rows of one episode.
+
+    Returns:
+        [samples, len(columns) * (2 if velocities else 1)] float32
+    """
+    with Episode(path) as episode:
+        x = np.stack([np.asarray(episode.column(name), dtype=np.float64) for name in columns], axis=1)
+    if velocities:
+        x = np.concatenate([x, np.diff(x, axis=0, prepend=x[:1])], axis=1)
+    return x.astype(np.float32)
+
+
+def calibration_windows(paths: List[str], columns: List[str], velocities: bool, seq: int, count: int,
+                        seed: int = 0) -> List[np.ndarray]:
+    """
+    Draw windows of seq rows uniformly over all episodes long enough.
+
+    Raises:
+        ValueError: If no episode has seq samples
+    """
+    episodes = [x for x in (episode_observations(p, columns, velocities) for p in paths) if len(x) >= seq]
+    if not episodes:
+        raise ValueError(f"No episode has {seq} samples")
+    starts = np.array([len(x) - seq + 1 for x in episodes], dtype=np.float64)
+    rng = np.random.default_rng(seed)
+    picks = rng.choice(len(episodes), size=count, p=starts / starts.sum())
+    return [episodes[e][s:s + seq] for e, s in ((e, rng.integers(0, starts[e])) for e in picks)]
+
+
+def calibrate(tensors: Dict[str, np.ndarray], heads: int, windows: List[np.ndarray],
+              percentile: float) -> Dict[str, float]:
+    """
+    Activation step per linear layer.
+
+    Returns:
+        {weight name: percentile(|input|) / 127}
+    """
+    config = infer_config(tensors, heads)
+    samples: Dict[str, List[np.ndarray]] = {}
+    kept: Dict[str, int] = {}
+    rng = np.random.default_rng(1)
+
+    def observe(name: str, rows: np.ndarray) -> None:
+        values = np.abs(rows).ravel()
+        # Subsample so long runs stay within memory; the percentile barely moves
+        budget = MAX_SAMPLES_PER_LAYER // len(windows) + 1
+        if len(values) > budget:
+            values = rng.choice(values, budget, replace=False)
+        samples.setdefault(name, []).append(values.astype(np.float32))
+        kept[name] = kept.get(name, 0) + len(values)
+
+    for window in windows:
+        reference_encode(tensors, config, window, observe)
+    scales = {}
+    for name, values in samples.items():
+        limit = float(np.percentile(np.concatenate(values), percentile))
+        scales[name] = max(limit, 1e-12) / 127.0
+    return scales
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Calibrate INT8 activation scales on recorded episodes")
+    parser.add_argument("--archive", required=True, help="Encoder .tensors archive (updated in place)")
+    parser.add_argument("--out", help="Write the calibrated archive here instead")
+    parser.add_argument("--episodes", nargs="*", default=[], help=".episode recordings")
+    parser.add_argument("--catalog", help="Use every episode of this .catalog")
+    parser.add_argument("--columns", default="b,s,e,t,r,g", help="Episode columns of one observation")
+    parser.add_argument("--velocities", action="store_true", help="Append per-sample differences of the columns")
+    parser.add_argument("--windows", type=int, default=256, help="Windows of max_seq samples to run")
+    parser.add_argument("--percentile", type=float, default=99.99, help="Percentile of |x| mapped to 127")
+    parser.add_argument("--heads", type=int, help="Attention heads (default: from the archive config)")
+    args = parser.parse_args()
+
+    tensors = dict(read_archive(args.archive))
+    heads = args.heads or int(tensors["config"][2])
+    config = infer_config(tensors, heads)
+    paths = list(args.episodes)
+    if args.catalog:
+        catalog = EpisodeCatalog(args.catalog)
+        paths += [catalog.path(i) for i in range(len(catalog))]
+    if paths:
+        windows = calibration_windows(paths, args.columns.split(","), args.velocities, config[5], args.windows)
+    elif "test.input" in tensors:
+        print("No episodes given: calibrating on the archive's test.input only")
+        windows = [tensors["test.input"]]
+    else:
+        parser.error("one of --episodes or --catalog is required")
+    if windows[0].shape[1] != config[0]:
+        parser.error(f"observations have {windows[0].shape[1]} features, the encoder expects {config[0]}")
+
+    scales = calibrate(tensors, heads, windows, args.percentile)
+    for name, scale in scales.items():
+        tensors[name + SCALE_SUFFIX] = np.array([scale], dtype=np.float32)
+        print(f"{name:36s} |x| p{args.percentile:g} = {127.0 * scale:10.4f}")
+    out = args.out or args.archive
+    write_archive(out, tensors)
+    print(f"Wrote {len(scales)} activation scales from {len(windows)} windows to {out}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,143 @@
+/**
+ * Observation Encoder Inference
+ */
+
+#include "models/transformer/encoder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "models/transformer/kernels.h"
+
+namespace shoplifter {
+
+namespace {
+
+void loadLayer(const TensorArchive& archive, const std::string& prefix, size_t out, size_t in, WeightFormat format,
+               PackedLinear& packed, const char* weightName = "weight", const char* biasName = "bias") {
+  loadLinear(archive, prefix + weightName, prefix + biasName, out, in, packed, format);
+}
+
+void loadVector(const TensorArchive& archive, const std::string& name, size_t n, simd::AlignedFloats& out) {
+  const Tensor& t = archive.require(name, TensorType::kFloat32, {n});
+  out.assign(t.floats(), t.floats() + n);
+}
+
+}  // namespace
+
+EncoderConfig readEncoderConfig(const TensorArchive& archive) {
+  const int64_t* v = archive.require("config", TensorType::kInt64, {6}).ints();
+  for (size_t i = 0; i < 6; i++) {
+    if (v[i] <= 0) {
+      throw std::runtime_error("Encoder config in " + archive.path() + " has a non-positive entry");
+    }
+  }
+  EncoderConfig config;
+  config.inputDim = static_cast<size_t>(v[0]);
+  config.dModel = static_cast<size_t>(v[1]);
+  config.heads = static_cast<size_t>(v[2]);
+  config.ffDim = static_cast<size_t>(v[3]);
+  config.layers = static_cast<size_t>(v[4]);
+  config.maxSeq = static_cast<size_t>(v[5]);
+  if (config.dModel % config.heads != 0) {
+    throw std::runtime_error("Encoder d_model is not a multiple of heads in " + archive.path());
+  }
+  return config;
+}
+
+TransformerEncoder::TransformerEncoder(const TensorArchive& archive, WeightFormat format)
+    : config_(readEncoderConfig(archive)), format_(format) {
+  const size_t d = config_.dModel;
+  loadLayer(archive, "input_proj.", d, config_.inputDim, format, inputProj_);
+  const Tensor& position = archive.require("position.weight", TensorType::kFloat32, {config_.maxSeq, d});
+  position_.assign(position.floats(), position.floats() + position.count);
+  loadVector(archive, "embed_norm.weight", d, embedNormWeight_);
+  loadVector(archive, "embed_norm.bias", d, embedNormBias_);
+
+  layers_.resize(config_.layers);
+  for (size_t i = 0; i < config_.layers; i++) {
+    const std::string prefix = "layers." + std::to_string(i) + ".";
+    Layer& layer = layers_[i];
+    if (archive.contains(prefix + "mixer.filter_real")) {
+      const size_t fftSize = nextPowerOfTwo(config_.maxSeq);
+      const std::vector<size_t> shape = {fftSize / 2 + 1, d};
+      layer.mixer = TokenMixer::kFft;
+      packFftFilter(archive.require(prefix + "mixer.filter_real", TensorType::kFloat32, shape).floats(),
+                    archive.require(prefix + "mixer.filter_imag", TensorType::kFloat32, shape).floats(),
+                    archive.require(prefix + "mixer.bias", TensorType::kFloat32, {d}).floats(), d, fftSize,
+                    layer.fft);
+    } else {
+      loadLayer(archive, prefix + "attn.", 3 * d, d, format, layer.inProj, "in_proj_weight", "in_proj_bias");
+      loadLayer(archive, prefix + "attn.out_proj.", d, d, format, layer.outProj);
+    }
+    loadLayer(archive, prefix + "ff1.", config_.ffDim, d, format, layer.ff1);
+    loadLayer(archive, prefix + "ff2.", d, config_.ffDim, format, layer.ff2);
+    loadVector(archive, prefix + "norm1.weight", d, layer.norm1Weight);
+    loadVector(archive, prefix + "norm1.bias", d, layer.norm1Bias);
+    loadVector(archive, prefix + "norm2.weight", d, layer.norm2Weight);
+    loadVector(archive, prefix + "norm2.bias", d, layer.norm2Bias);
+  }
+
+  const size_t rows = config_.maxSeq;
+  bool anyAttention = false;
+  size_t scratch = 0;
+  for (const Layer& layer : layers_) {
+    if (layer.mixer == TokenMixer::kFft) {
+      scratch = std::max(scratch, fftMixScratchSize(layer.fft, rows));
+      fftPlans_.prepare(rows);
+    } else {
+      scratch = std::max(scratch, attentionScratchSize(rows, d / config_.heads));
+      anyAttention = true;
+    }
+  }
+
+  // Steps of one layer, in encode() order:
+  //   0 in_proj  1 attention or fftMix  2 out_proj  3 norm1  4 ff1  5 ff2  6 norm2
+  // Every buffer is dead between layers, so one layer's plan serves all.
+  const size_t attentionRows = anyAttention ? rows : 0;
+  plan_.add(attentionRows * 3 * d, 0, 1);    // qkv
+  plan_.add(attentionRows * d, 1, 2);        // context
+  plan_.add(rows * d, 1, 3);                 // mixer branch
+  plan_.add(rows * config_.ffDim, 4, 5);     // hidden
+  plan_.add(rows * d, 5, 6);                 // feed-forward branch
+  plan_.add(scratch, 1, 1);
+  plan_.plan();
+  std::vector<float*> buffers;
+  plan_.bind(arena_, buffers);
+  qkv_ = buffers[0];
+  context_ = buffers[1];
+  mixOut_ = buffers[2];
+  hidden_ = buffers[3];
+  ffOut_ = buffers[4];
+  scratch_ = buffers[5];
+}
+
+void TransformerEncoder::encode(const float* input, size_t seq, float* out) {
+  if (seq == 0 || seq > config_.maxSeq) {
+    throw std::invalid_argument("Encoder sequence length " + std::to_string(seq) + " is outside 1.." +
+                                std::to_string(config_.maxSeq));
+  }
+  const size_t d = config_.dModel;
+  const size_t ff = config_.ffDim;
+
+  // The hidden state lives in out for the whole pass
+  linear(input, seq, config_.inputDim, inputProj_, out, d);
+  addLayerNorm(out, d, position_.data(), d, seq, d, embedNormWeight_.data(), embedNormBias_.data());
+
+  for (Layer& layer : layers_) {
+    if (layer.mixer == TokenMixer::kFft) {
+      fftMix(layer.fft, fftPlans_, out, seq, d, mixOut_, d, scratch_);
+    } else {
+      linear(out, seq, d, layer.inProj, qkv_, 3 * d);
+      attention(qkv_, seq, d, config_.heads, context_, d, scratch_);
+      linear(context_, seq, d, layer.outProj, mixOut_, d);
+    }
+    addLayerNorm(out, d, mixOut_, d, seq, d, layer.norm1Weight.data(), layer.norm1Bias.data());
+
+    linear(out, seq, d, layer.ff1, hidden_, ff, Activation::kRelu);
+    linear(hidden_, seq, ff, layer.ff2, ffOut_, d);
+    addLayerNorm(out, d, ffOut_, d, seq, d, layer.norm2Weight.data(), layer.norm2Bias.data());
+  }
+}
+
+}  // namespace shoplifter
@@ -0,0 +1,123 @@
+/**
+ * Observation Encoder Inference
+ *
+ * CPU forward pass of the BERT-like bidirectional encoder in encoder.py,
+ * with weights loaded from a tensor archive written by export_weights.py:
+ *
+ *   h = LayerNorm(input_proj(x) + position[0..seq))
+ *   per layer (post-norm, like nn.TransformerEncoderLayer):
+ *     h = LayerNorm(h + mix(h))
+ *     h = LayerNorm(h + ff2(relu(ff1(h))))
+ *
+ * where mix is self-attention, out_proj(attention(in_proj(h))), or the FFT
+ * token mixer (fft_mixer.h), chosen per layer by which tensors it exports.
+ *
+ * All linear layers are packed once at load time (gemm.h). The
+ * intermediate buffers of a layer are planned by liveness into one arena
+ * sized for max_seq (arena.h), so buffers that are never live together
+ * share memory, encode() allocates nothing, and it runs single-threaded on
+ * the calling thread.
+ */
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "models/transformer/arena.h"
+#include "models/transformer/fft.h"
+#include "models/transformer/fft_mixer.h"
+#include "models/transformer/gemm.h"
+#include "models/transformer/simd.h"
+#include "models/transformer/tensor_archive.h"
+
+namespace shoplifter {
+
+struct EncoderConfig {
+  size_t inputDim = 0;     // Observation features per step
+  size_t dModel = 0;
+  size_t heads = 0;
+  size_t ffDim = 0;
+  size_t layers = 0;
+  size_t maxSeq = 0;       // Rows of the learned position table
+};
+
+enum class TokenMixer : uint8_t {
+  kAttention = 0,
+  kFft = 1,
+};
+
+/**
+ * Read the int64 "config" tensor: [input_dim, d_model, heads, ff_dim, layers, max_seq]
+ *
+ * @throws std::runtime_error if it is missing or inconsistent
+ */
+EncoderConfig readEncoderConfig(const TensorArchive& archive);
+
+class TransformerEncoder {
+ public:
+  /**
+   * Load and pack the encoder weights
+   *
+   * @param archive Archive written by export_weights.py (may be destroyed afterwards)
+   * @param format Precision of the linear layers (gemm.h); kInt8 uses the
+   *               activation scales of calibrate_quantization.py when present
+   * @throws std::runtime_error if a tensor is missing or has the wrong shape
+   */
+  explicit TransformerEncoder(const TensorArchive& archive, WeightFormat format = WeightFormat::kFloat32);
+
+  const EncoderConfig& config() const { return config_; }
+  WeightFormat format() const { return format_; }
+  TokenMixer layerMixer(size_t layer) const { return layers_[layer].mixer; }
+
+  // Layout of the activation arena, for reporting its size
+  const ArenaPlan& workspacePlan() const { return plan_; }
+
+  /**
+   * Encode a window of observations
+   *
+   * @param input [seq][inputDim] oldest first
+   * @param seq Steps in the window, 1..maxSeq
+   * @param out [seq][dModel] contextual embeddings
+   * @throws std::invalid_argument if seq is out of range
+   */
+  void encode(const float* input, size_t seq, float* out);
+
+ private:
+  friend class StreamingEncoder;
+
+  struct Layer {
+    TokenMixer mixer = TokenMixer::kAttention;
+    PackedLinear inProj;     // d -> 3d (q | k | v)
+    PackedLinear outProj;    // d -> d
+    FftFilter fft;
+    PackedLinear ff1;        // d -> ff, ReLU
+    PackedLinear ff2;        // ff -> d
+    simd::AlignedFloats norm1Weight, norm1Bias;
+    simd::AlignedFloats norm2Weight, norm2Bias;
+  };
+
+  EncoderConfig config_;
+  WeightFormat format_;
+  PackedLinear inputProj_;
+  simd::AlignedFloats position_;
+  simd::AlignedFloats embedNormWeight_, embedNormBias_;
+  std::vector<Layer> layers_;
+
+  // Workspace for maxSeq rows, pointers into arena_
+  ArenaPlan plan_;
+  simd::AlignedFloats arena_;
+  float* qkv_ = nullptr;         // [maxSeq][3d]
+  float* context_ = nullptr;     // [maxSeq][d]
+  float* mixOut_ = nullptr;      // [maxSeq][d] token mixer branch
+  float* hidden_ = nullptr;      // [maxSeq][ff]
+  float* ffOut_ = nullptr;       // [maxSeq][d] feed-forward branch
+  float* scratch_ = nullptr;     // attention() or fftMix()
+  FftPlanCache fftPlans_;
+};
+
+}  // namespace shoplifter
+
+#endif // ENCODER_H
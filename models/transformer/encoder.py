@@ -0,0 +1,130 @@
+"""
+BERT-like bidirectional encoder over past observations.
+
+Each step of an observation window is projected to d_model, given a learned
+position embedding and passed through post-norm encoder layers with ReLU
+feed-forward blocks. Attention is unmasked: every step sees the whole window.
+
+Any layer can mix tokens with FftMixer instead of attention (after "The FFT
+Strikes Back", research/), which costs O(seq log seq) rather than O(seq^2)
+and suits long high-rate telemetry windows.
+
+The parameter names are the contract with the C++ runtime (encoder.h);
+export_weights.py writes this module's state_dict to a tensor archive.
+
+Usage:
+    encoder = ObservationEncoder(input_dim=12, d_model=128, heads=4, ff_dim=512, layers=4, max_seq=64)
+    embeddings = encoder(observations)      # [batch, seq, input_dim] -> [batch, seq, d_model]
+
+    long_encoder = ObservationEncoder(input_dim=12, max_seq=1024, mixers=["fft", "fft", "fft", "attention"])
+"""
+
+from typing import Optional, Sequence
+
+import torch
+from torch import nn
+
+
+MODRELU_EPS = 1e-6
+
+
+class FftMixer(nn.Module):
+    """
+    Global token mixing in the frequency domain.
+
+    rfft along the sequence (zero-padded to a power of two), a learned complex
+    filter per bin and channel, modReLU, and irfft back. The filter is learned
+    for the longest window; shorter windows use every stride-th bin, i.e. the
+    same frequency response sampled on their coarser grid.
+    """
+
+    def __init__(self, d_model: int, max_seq: int):
+        super().__init__()
+        if d_model % 2:
+            raise ValueError("FftMixer needs an even d_model")
+        self.fft_size = 1 << (max_seq - 1).bit_length()
+        bins = self.fft_size // 2 + 1
+        self.filter_real = nn.Parameter(1.0 + 0.02 * torch.randn(bins, d_model))
+        self.filter_imag = nn.Parameter(0.02 * torch.randn(bins, d_model))
+        self.bias = nn.Parameter(torch.zeros(d_model))
+
+    def forward(self, h: torch.Tensor) -> torch.Tensor:
+        seq = h.shape[1]
+        n = 1 << (seq - 1).bit_length()
+        stride = self.fft_size // n
+        z = torch.fft.rfft(h, n=n, dim=1)
+        z = z * torch.complex(self.filter_real[::stride], self.filter_imag[::stride])
+        magnitude = z.abs()
+        z = z * (torch.relu(magnitude + self.bias) / (magnitude + MODRELU_EPS))
+        return torch.fft.irfft(z, n=n, dim=1)[:, :seq]
+
+
+class EncoderLayer(nn.Module):
+    """Post-norm token mixing (attention or FFT) and ReLU feed-forward block."""
+
+    def __init__(self, d_model: int, heads: int, ff_dim: int, dropout: float = 0.0, mixer: str = "attention",
+                 max_seq: int = 0):
+        super().__init__()
+        if mixer == "fft":
+            self.mixer = FftMixer(d_model, max_seq)
+        elif mixer == "attention":
+            self.attn = nn.MultiheadAttention(d_model, heads, dropout=dropout, batch_first=True)
+        else:
+            raise ValueError(f"Unknown token mixer {mixer}")
+        self.norm1 = nn.LayerNorm(d_model)
+        self.ff1 = nn.Linear(d_model, ff_dim)
+        self.ff2 = nn.Linear(ff_dim, d_model)
+        self.norm2 = nn.LayerNorm(d_model)
+        self.dropout = nn.Dropout(dropout)
+
+    def forward(self, h: torch.Tensor) -> torch.Tensor:
+        if hasattr(self, "mixer"):
+            mixed = self.mixer(h)
+        else:
+            mixed, _ = self.attn(h, h, h, need_weights=False)
+        h = self.norm1(h + self.dropout(mixed))
+        return self.norm2(h + self.dropout(self.ff2(torch.relu(self.ff1(h)))))
+
+
+class ObservationEncoder(nn.Module):
+    """Contextual embeddings for a window of past observations."""
+
+    def __init__(self, input_dim: int, d_model: int = 128, heads: int = 4, ff_dim: int = 512,
+                 layers: int = 4, max_seq: int = 64, dropout: float = 0.0,
+                 mixers: Optional[Sequence[str]] = None):
+        """
+        Args:
+            input_dim: Features per observation step
+            d_model: Embedding width (a multiple of heads)
+            heads: Attention heads
+            ff_dim: Feed-forward hidden width
+            layers: Encoder layers
+            max_seq: Longest window (rows of the position table)
+            dropout: Training dropout; the C++ runtime implements eval mode only
+            mixers: "attention" or "fft" per layer (default all attention)
+        """
+        super().__init__()
+        self.config = (input_dim, d_model, heads, ff_dim, layers, max_seq)
+        self.input_proj = nn.Linear(input_dim, d_model)
+        self.position = nn.Embedding(max_seq, d_model)
+        self.embed_norm = nn.LayerNorm(d_model)
+        mixers = list(mixers or ["attention"] * layers)
+        if len(mixers) != layers:
+            raise ValueError(f"{len(mixers)} mixers given for {layers} layers")
+        self.layers = nn.ModuleList(EncoderLayer(d_model, heads, ff_dim, dropout, mixer, max_seq)
+                                    for mixer in mixers)
+
+    def forward(self, observations: torch.Tensor) -> torch.Tensor:
+        """
+        Args:
+            observations: [batch, seq, input_dim], oldest step first
+
+        Returns:
+            [batch, seq, d_model] embeddings
+        """
+        seq = observations.shape[1]
+        positions = torch.arange(seq, device=observations.device)
+        h = self.embed_norm(self.input_proj(observations) + self.position(positions))
+        for layer in self.layers:
+            h = layer(h)
+        return h
@@ -0,0 +1,141 @@
+"""
+Export NeuralMemory weights to a tensor archive for the C++ runtime.
+
+Uses the archive format of export_weights.py. Besides the state_dict
+tensors it carries:
+
+    config       int64   [dim, key_dim, hidden, value_dim]
+    hyper        float32 [momentum, learning_rate, forget, threshold]
+    test.input   a random embedding sequence
+    test.output  its memory reads from the numpy reference below
+
+Usage:
+    python models/transformer/export_neural_memory.py --checkpoint memory.pt --out memory.tensors
+    python models/transformer/export_neural_memory.py --random --dim 128 --out random_memory.tensors
+"""
+
+import argparse
+import os
+import sys
+from typing import Dict, Tuple
+
+import numpy as np
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+from models.transformer.export_weights import write_archive  # noqa: E402
+
+
+TEST_STEPS = 64
+NORM_EPS = 1e-6
+
+
+def infer_config(tensors: Dict[str, np.ndarray]) -> Tuple[int, int, int, int]:
+    """Derive (dim, key_dim, hidden, value_dim) from a NeuralMemory state_dict."""
+    key_dim, dim = tensors["key.weight"].shape
+    value_dim, hidden = tensors["memory.w2"].shape
+    return dim, key_dim, hidden, value_dim
+
+
+def _normalize(x: np.ndarray) -> np.ndarray:
+    return x / max(np.linalg.norm(x), NORM_EPS)
+
+
+def reference_reads(tensors: Dict[str, np.ndarray], hyper: Tuple[float, ...], x: np.ndarray) -> np.ndarray:
+    """
+    Numpy read-then-write recurrence of NeuralMemory in float64.
+
+    Args:
+        hyper: (momentum, learning_rate, forget, threshold)
+        x: [seq, dim]
+
+    Returns:
+        [seq, value_dim] reads
+    """
+    eta, theta, alpha, threshold = hyper
+    t = {k: v.astype(np.float64) for k, v in tensors.items()}
+    w1, w2 = t["memory.w1"].copy(), t["memory.w2"].copy()
+    s1, s2 = np.zeros_like(w1), np.zeros_like(w2)
+    reads = []
+    for xt in x.astype(np.float64):
+        q = _normalize(t["query.weight"] @ xt)
+        reads.append(w2 @ np.maximum(w1 @ q, 0.0))
+        k = _normalize(t["key.weight"] @ xt)
+        v = t["value.weight"] @ xt
+        z = w1 @ k
+        a = np.maximum(z, 0.0)
+        e = w2 @ a - v
+        step = theta if 0.5 * e @ e >= threshold else 0.0
+        grad_z = (w2.T @ e) * (z > 0)
+        s2 = eta * s2 - step * np.outer(e, a)
+        s1 = eta * s1 - step * np.outer(grad_z, k)
+        w2 = (1.0 - alpha) * w2 + s2
+        w1 = (1.0 - alpha) * w1 + s1
+    return np.array(reads)
+
+
+def random_state_dict(dim: int, key_dim: int, hidden: int, value_dim: int, seed: int = 0) -> Dict[str, np.ndarray]:
+    """State dict with PyTorch-like initial weights, for benchmarks and tests."""
+    rng = np.random.default_rng(seed)
+
+    def uniform(out: int, inp: int) -> np.ndarray:
+        bound = 1.0 / np.sqrt(inp)
+        return rng.uniform(-bound, bound, (out, inp)).astype(np.float32)
+
+    return {
+        "key.weight": uniform(key_dim, dim),
+        "value.weight": uniform(value_dim, dim),
+        "query.weight": uniform(key_dim, dim),
+        "memory.w1": (rng.standard_normal((hidden, key_dim)) / np.sqrt(key_dim)).astype(np.float32),
+        "memory.w2": (rng.standard_normal((value_dim, hidden)) / np.sqrt(hidden)).astype(np.float32),
+    }
+
+
+def export(path: str, state_dict: Dict[str, np.ndarray], hyper: Tuple[float, ...], seed: int = 0) -> Tuple[int, ...]:
+    """
+    Write a neural-memory archive with its config, hyperparameters and a reference test vector.
+
+    Returns:
+        The exported config tuple
+    """
+    config = infer_config(state_dict)
+    x = np.random.default_rng(seed + 1).standard_normal((TEST_STEPS, config[0])).astype(np.float32)
+    tensors = dict(state_dict)
+    tensors["config"] = np.array(config, dtype=np.int64)
+    tensors["hyper"] = np.array(hyper, dtype=np.float32)
+    tensors["test.input"] = x
+    tensors["test.output"] = reference_reads(state_dict, hyper, x).astype(np.float32)
+    write_archive(path, tensors)
+    return config
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Export neural-memory weights for the C++ runtime")
+    parser.add_argument("--out", required=True, help="Output .tensors file")
+    parser.add_argument("--checkpoint", help="torch.save()d NeuralMemory state_dict")
+    parser.add_argument("--random", action="store_true", help="Export random weights (benchmarks)")
+    parser.add_argument("--dim", type=int, default=128)
+    parser.add_argument("--key-dim", type=int, default=64)
+    parser.add_argument("--hidden", type=int, default=128)
+    parser.add_argument("--value-dim", type=int, default=128)
+    parser.add_argument("--momentum", type=float, default=0.9)
+    parser.add_argument("--learning-rate", type=float, default=0.01)
+    parser.add_argument("--forget", type=float, default=0.001)
+    parser.add_argument("--threshold", type=float, default=0.0)
+    args = parser.parse_args()
+
+    if args.checkpoint:
+        import torch
+        state = torch.load(args.checkpoint, map_location="cpu")
+        state_dict = {k: v.detach().float().numpy() for k, v in state.items()}
+    elif args.random:
+        state_dict = random_state_dict(args.dim, args.key_dim, args.hidden, args.value_dim)
+    else:
+        parser.error("one of --checkpoint or --random is required")
+
+    hyper = (args.momentum, args.learning_rate, args.forget, args.threshold)
+    config = export(args.out, state_dict, hyper)
+    print(f"Wrote {args.out}: dim={config[0]} key_dim={config[1]} hidden={config[2]} value_dim={config[3]}")
+
+
+if __name__ == "__main__":
+    main()
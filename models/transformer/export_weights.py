@@ -0,0 +1,342 @@
+"""
+Export ObservationEncoder weights to a tensor archive for the C++ runtime.
+
+The archive layout is defined in tensor_archive.h. Besides the state_dict
+tensors it carries:
+
+    config       int64 [input_dim, d_model, heads, ff_dim, layers, max_seq]
+    test.input   a random observation window of max_seq steps
+    test.output  its embeddings from the numpy reference forward pass below
+
+so bench_encoder can check the native output against the exported model.
+
+With --pack-nr, every linear layer is also stored in the GEMM panel layout
+of gemm.h ("<weight>.packed<NR>", "<bias>.packed<NR>") for each given panel
+width: 32 for AVX-512, 16 for AVX2, 8 for NEON and scalar builds. The
+runtime maps those panels and uses them in place instead of packing at
+load time.
+
+Usage:
+    python models/transformer/export_weights.py --checkpoint encoder.pt --heads 4 --out encoder.tensors
+    python models/transformer/export_weights.py --random --input-dim 12 --out random.tensors
+    python models/transformer/export_weights.py --random --max-seq 1024 --mixers fft,fft,fft,attention --out long.tensors
+    python models/transformer/export_weights.py --checkpoint encoder.pt --heads 4 --pack-nr 32,16 --out encoder.tensors
+"""
+
+import argparse
+import os
+import struct
+import tempfile
+from typing import Callable, Dict, List, Optional, Tuple
+
+import numpy as np
+
+
+ARCHIVE_MAGIC = b"SLTENSOR"
+ARCHIVE_VERSION = 1
+HEADER_SIZE = 64
+RECORD_SIZE = 128
+NAME_LENGTH = 80
+MAX_DIMS = 4
+ALIGNMENT = 64
+DTYPES = {np.dtype("<f4"): 1, np.dtype("<i8"): 2}
+LAYER_NORM_EPS = 1e-5
+MODRELU_EPS = 1e-6
+
+
+def _align(n: int) -> int:
+    return (n + ALIGNMENT - 1) & ~(ALIGNMENT - 1)
+
+
+def write_archive(path: str, tensors: Dict[str, np.ndarray]) -> None:
+    """
+    Write named arrays to a tensor archive.
+
+    The archive is written to a temporary file in the same directory and
+    renamed over path, so a process that has the old archive mapped keeps
+    reading the old inode instead of faulting on a truncated file.
+
+    Args:
+        path: Output file
+        tensors: float32 or int64 arrays of up to 4 dimensions
+
+    Raises:
+        ValueError: If a name or array cannot be stored
+    """
+    arrays = []
+    for name, array in tensors.items():
+        array = np.ascontiguousarray(array)
+        if array.dtype == np.float64:
+            array = array.astype(np.float32)
+        array = array.astype(array.dtype.newbyteorder("<"), copy=False)
+        if array.dtype not in DTYPES or array.ndim > MAX_DIMS or len(name.encode()) >= NAME_LENGTH:
+            raise ValueError(f"Cannot store tensor {name} ({array.dtype}, {array.ndim} dims)")
+        arrays.append((name, array))
+
+    offset = _align(HEADER_SIZE + RECORD_SIZE * len(arrays))
+    records, offsets = [], []
+    for name, array in arrays:
+        shape = list(array.shape) + [0] * (MAX_DIMS - array.ndim)
+        records.append(struct.pack(f"<{NAME_LENGTH}sII4QQ", name.encode(), DTYPES[array.dtype], array.ndim,
+                                   *shape, offset))
+        offsets.append(offset)
+        offset = _align(offset + array.nbytes)
+
+    fd, tmp = tempfile.mkstemp(prefix=os.path.basename(path) + ".", suffix=".tmp",
+                               dir=os.path.dirname(os.path.abspath(path)))
+    try:
+        with os.fdopen(fd, "wb") as f:
+            f.write(struct.pack("<8sIIII40x", ARCHIVE_MAGIC, ARCHIVE_VERSION, HEADER_SIZE, len(arrays), RECORD_SIZE))
+            for record in records:
+                f.write(record)
+            for (_, array), start in zip(arrays, offsets):
+                f.write(b"\0" * (start - f.tell()))
+                f.write(array.tobytes())
+            f.flush()
+            os.fsync(f.fileno())
+        # mkstemp creates the file 0600; give it the mode open() would have
+        umask = os.umask(0)
+        os.umask(umask)
+        os.chmod(tmp, 0o666 & ~umask)
+        os.replace(tmp, path)
+    except BaseException:
+        os.unlink(tmp)
+        raise
+
+
+def read_archive(path: str) -> Dict[str, np.ndarray]:
+    """
+    Read every tensor of an archive.
+
+    Raises:
+        ValueError: If the file is not a tensor archive
+    """
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, version, header_size, count, record_size = struct.unpack_from("<8sIIII", data, 0)
+    if magic != ARCHIVE_MAGIC or version != ARCHIVE_VERSION or record_size != RECORD_SIZE:
+        raise ValueError(f"{path} is not a version {ARCHIVE_VERSION} tensor archive")
+    dtypes = {v: k for k, v in DTYPES.items()}
+    tensors = {}
+    for i in range(count):
+        raw, dtype, ndim, *rest = struct.unpack_from(f"<{NAME_LENGTH}sII4QQ", data, header_size + i * RECORD_SIZE)
+        shape, offset = tuple(rest[:ndim]), rest[MAX_DIMS]
+        name = raw.split(b"\0", 1)[0].decode()
+        tensors[name] = np.frombuffer(data, dtype=dtypes[dtype], count=int(np.prod(shape)), offset=offset).reshape(shape)
+    return tensors
+
+
+def pack_linear(weight: np.ndarray, bias: Optional[np.ndarray], nr: int) -> Tuple[np.ndarray, np.ndarray]:
+    """
+    Lay out an nn.Linear as packLinear() in gemm.cpp does.
+
+    Args:
+        weight: [out, in]
+        bias: [out] or None
+        nr: Panel width (kGemmNR of the target)
+
+    Returns:
+        ([panels, in, nr] panels, [panels * nr] zero-padded bias)
+    """
+    out, inp = weight.shape
+    padded = (out + nr - 1) // nr * nr
+    w = np.zeros((padded, inp), dtype=np.float32)
+    w[:out] = weight
+    b = np.zeros(padded, dtype=np.float32)
+    if bias is not None:
+        b[:out] = bias
+    return np.ascontiguousarray(w.reshape(padded // nr, nr, inp).transpose(0, 2, 1)), b
+
+
+def add_packed(tensors: Dict[str, np.ndarray], layers: List[Tuple[str, Optional[str]]], nrs: List[int]) -> None:
+    """
+    Add pre-packed copies of linear layers for each panel width.
+
+    Args:
+        layers: (weight name, bias name or None) per linear layer
+        nrs: Panel widths to pack for
+    """
+    for nr in nrs:
+        for weight, bias in layers:
+            panels, packed_bias = pack_linear(tensors[weight], tensors[bias] if bias else None, nr)
+            tensors[f"{weight}.packed{nr}"] = panels
+            if bias:
+                tensors[f"{bias}.packed{nr}"] = packed_bias
+
+
+def linear_layers(tensors: Dict[str, np.ndarray], layers: int) -> List[Tuple[str, Optional[str]]]:
+    """(weight, bias) names of the encoder's linear layers."""
+    names = [("input_proj.weight", "input_proj.bias")]
+    for i in range(layers):
+        p = f"layers.{i}."
+        if p + "attn.in_proj_weight" in tensors:
+            names.append((p + "attn.in_proj_weight", p + "attn.in_proj_bias"))
+            names.append((p + "attn.out_proj.weight", p + "attn.out_proj.bias"))
+        names += [(p + "ff1.weight", p + "ff1.bias"), (p + "ff2.weight", p + "ff2.bias")]
+    return names
+
+
+def infer_config(tensors: Dict[str, np.ndarray], heads: int) -> Tuple[int, ...]:
+    """(input_dim, d_model, heads, ff_dim, layers, max_seq) from state_dict shapes."""
+    d_model, input_dim = tensors["input_proj.weight"].shape
+    max_seq = tensors["position.weight"].shape[0]
+    ff_dim = tensors["layers.0.ff1.weight"].shape[0]
+    layers = len({key.split(".")[1] for key in tensors if key.startswith("layers.")})
+    if d_model % heads:
+        raise ValueError(f"d_model {d_model} is not a multiple of {heads} heads")
+    return input_dim, d_model, heads, ff_dim, layers, max_seq
+
+
+def _layer_norm(x: np.ndarray, weight: np.ndarray, bias: np.ndarray) -> np.ndarray:
+    mean = x.mean(axis=-1, keepdims=True)
+    var = ((x - mean) ** 2).mean(axis=-1, keepdims=True)
+    return (x - mean) / np.sqrt(var + LAYER_NORM_EPS) * weight + bias
+
+
+def _fft_mix(h: np.ndarray, filter_real: np.ndarray, filter_imag: np.ndarray, bias: np.ndarray) -> np.ndarray:
+    seq = h.shape[0]
+    n = 1 << (seq - 1).bit_length()
+    stride = (filter_real.shape[0] - 1) * 2 // n
+    z = np.fft.rfft(h, n=n, axis=0) * (filter_real[::stride] + 1j * filter_imag[::stride])
+    magnitude = np.abs(z)
+    z = z * (np.maximum(magnitude + bias, 0.0) / (magnitude + MODRELU_EPS))
+    return np.fft.irfft(z, n=n, axis=0)[:seq]
+
+
+def reference_encode(tensors: Dict[str, np.ndarray], config: Tuple[int, ...], x: np.ndarray,
+                     observe: Optional[Callable[[str, np.ndarray], None]] = None) -> np.ndarray:
+    """
+    Float64 forward pass of ObservationEncoder in eval mode, without torch.
+
+    Args:
+        tensors: state_dict arrays
+        config: infer_config() tuple
+        x: [seq, input_dim] observations
+        observe: Called with (weight name, input rows) before every linear layer
+
+    Returns:
+        [seq, d_model] embeddings
+    """
+    observe = observe or (lambda name, rows: None)
+    t = {k: v.astype(np.float64) for k, v in tensors.items()}
+    _, d, heads, _, layers, _ = config
+    seq, hd = x.shape[0], d // heads
+    observe("input_proj.weight", x)
+    h = x.astype(np.float64) @ t["input_proj.weight"].T + t["input_proj.bias"] + t["position.weight"][:seq]
+    h = _layer_norm(h, t["embed_norm.weight"], t["embed_norm.bias"])
+    for i in range(layers):
+        p = f"layers.{i}."
+        if p + "mixer.filter_real" in t:
+            mixed = _fft_mix(h, t[p + "mixer.filter_real"], t[p + "mixer.filter_imag"], t[p + "mixer.bias"])
+        else:
+            observe(p + "attn.in_proj_weight", h)
+            qkv = h @ t[p + "attn.in_proj_weight"].T + t[p + "attn.in_proj_bias"]
+            q, k, v = (qkv[:, j * d:(j + 1) * d].reshape(seq, heads, hd).transpose(1, 0, 2) for j in range(3))
+            scores = q @ k.transpose(0, 2, 1) / np.sqrt(hd)
+            scores = np.exp(scores - scores.max(axis=-1, keepdims=True))
+            scores /= scores.sum(axis=-1, keepdims=True)
+            context = (scores @ v).transpose(1, 0, 2).reshape(seq, d)
+            observe(p + "attn.out_proj.weight", context)
+            mixed = context @ t[p + "attn.out_proj.weight"].T + t[p + "attn.out_proj.bias"]
+        h = _layer_norm(h + mixed, t[p + "norm1.weight"], t[p + "norm1.bias"])
+        observe(p + "ff1.weight", h)
+        ff = np.maximum(h @ t[p + "ff1.weight"].T + t[p + "ff1.bias"], 0.0)
+        observe(p + "ff2.weight", ff)
+        ff = ff @ t[p + "ff2.weight"].T + t[p + "ff2.bias"]
+        h = _layer_norm(h + ff, t[p + "norm2.weight"], t[p + "norm2.bias"])
+    return h
+
+
+def random_state_dict(input_dim: int, d_model: int, ff_dim: int, layers: int, max_seq: int,
+                      mixers: Optional[List[str]] = None, seed: int = 0) -> Dict[str, np.ndarray]:
+    """State dict with PyTorch-like initial weights, for benchmarks and tests."""
+    rng = np.random.default_rng(seed)
+
+    def linear(prefix: str, out: int, inp: int, weight: str = "weight", bias: str = "bias"):
+        bound = 1.0 / np.sqrt(inp)
+        sd[prefix + weight] = rng.uniform(-bound, bound, (out, inp)).astype(np.float32)
+        sd[prefix + bias] = rng.uniform(-bound, bound, out).astype(np.float32)
+
+    def norm(prefix: str):
+        sd[prefix + "weight"] = (1.0 + 0.1 * rng.standard_normal(d_model)).astype(np.float32)
+        sd[prefix + "bias"] = (0.1 * rng.standard_normal(d_model)).astype(np.float32)
+
+    sd: Dict[str, np.ndarray] = {}
+    linear("input_proj.", d_model, input_dim)
+    sd["position.weight"] = rng.standard_normal((max_seq, d_model)).astype(np.float32)
+    norm("embed_norm.")
+    for i in range(layers):
+        p = f"layers.{i}."
+        if mixers and mixers[i] == "fft":
+            bins = (1 << (max_seq - 1).bit_length()) // 2 + 1
+            sd[p + "mixer.filter_real"] = (1.0 + 0.3 * rng.standard_normal((bins, d_model))).astype(np.float32)
+            sd[p + "mixer.filter_imag"] = (0.3 * rng.standard_normal((bins, d_model))).astype(np.float32)
+            sd[p + "mixer.bias"] = (0.1 * rng.standard_normal(d_model)).astype(np.float32)
+        else:
+            linear(p + "attn.", 3 * d_model, d_model, "in_proj_weight", "in_proj_bias")
+            linear(p + "attn.out_proj.", d_model, d_model)
+        linear(p + "ff1.", ff_dim, d_model)
+        linear(p + "ff2.", d_model, ff_dim)
+        norm(p + "norm1.")
+        norm(p + "norm2.")
+    return sd
+
+
+def export(path: str, state_dict: Dict[str, np.ndarray], heads: int, seed: int = 0,
+           pack_nrs: Optional[List[int]] = None) -> Tuple[int, ...]:
+    """
+    Write an encoder archive with its config and a reference test vector.
+
+    Args:
+        pack_nrs: GEMM panel widths to add pre-packed layers for
+
+    Returns:
+        The exported config tuple
+    """
+    config = infer_config(state_dict, heads)
+    x = np.random.default_rng(seed + 1).standard_normal((config[5], config[0])).astype(np.float32)
+    tensors = dict(state_dict)
+    tensors["config"] = np.array(config, dtype=np.int64)
+    tensors["test.input"] = x
+    tensors["test.output"] = reference_encode(state_dict, config, x).astype(np.float32)
+    add_packed(tensors, linear_layers(state_dict, config[4]), pack_nrs or [])
+    write_archive(path, tensors)
+    return config
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Export encoder weights for the C++ runtime")
+    parser.add_argument("--out", required=True, help="Output .tensors file")
+    parser.add_argument("--checkpoint", help="torch.save()d ObservationEncoder state_dict")
+    parser.add_argument("--random", action="store_true", help="Export random weights (benchmarks)")
+    parser.add_argument("--heads", type=int, default=4)
+    parser.add_argument("--input-dim", type=int, default=12)
+    parser.add_argument("--d-model", type=int, default=128)
+    parser.add_argument("--ff-dim", type=int, default=512)
+    parser.add_argument("--layers", type=int, default=4)
+    parser.add_argument("--max-seq", type=int, default=64)
+    parser.add_argument("--mixers", help="Comma-separated attention/fft per layer (--random)")
+    parser.add_argument("--pack-nr", help="Comma-separated GEMM panel widths to pre-pack for (32 AVX-512, 16 AVX2, 8)")
+    args = parser.parse_args()
+
+    if args.checkpoint:
+        import torch
+        state = torch.load(args.checkpoint, map_location="cpu")
+        state_dict = {k: v.detach().float().numpy() for k, v in state.items()}
+    elif args.random:
+        mixers = args.mixers.split(",") if args.mixers else None
+        if mixers and len(mixers) != args.layers:
+            parser.error(f"--mixers needs {args.layers} entries")
+        state_dict = random_state_dict(args.input_dim, args.d_model, args.ff_dim, args.layers, args.max_seq,
+                                       mixers)
+    else:
+        parser.error("one of --checkpoint or --random is required")
+
+    pack_nrs = [int(nr) for nr in args.pack_nr.split(",")] if args.pack_nr else None
+    config = export(args.out, state_dict, args.heads, pack_nrs=pack_nrs)
+    print(f"Wrote {args.out}: input_dim={config[0]} d_model={config[1]} heads={config[2]} "
+          f"ff_dim={config[3]} layers={config[4]} max_seq={config[5]}")
+
+
+if __name__ == "__main__":
+    main()
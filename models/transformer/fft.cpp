@@ -0,0 +1,130 @@
+/**
+ * Row-Batched FFT
+ */
+
+#include "models/transformer/fft.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace shoplifter {
+
+namespace {
+
+using namespace simd;
+
+constexpr size_t kLanes = kFloatLanes;
+
+size_t log2Exact(size_t n) {
+  size_t bits = 0;
+  while ((size_t(1) << bits) < n) bits++;
+  return bits;
+}
+
+void swapRows(float* a, float* b, size_t width) {
+  for (size_t c = 0; c < width; c += kLanes) {
+    const VecF t = load(a + c);
+    store(a + c, load(b + c));
+    store(b + c, t);
+  }
+}
+
+}  // namespace
+
+size_t nextPowerOfTwo(size_t n) {
+  size_t p = 1;
+  while (p < n) p <<= 1;
+  return p;
+}
+
+void FftPlanCache::prepare(size_t maxN) {
+  for (size_t n = 1; n <= nextPowerOfTwo(maxN); n <<= 1) {
+    plan(n);
+  }
+}
+
+const FftPlan& FftPlanCache::plan(size_t n) {
+  if (n == 0 || (n & (n - 1)) != 0) {
+    throw std::invalid_argument("FFT size " + std::to_string(n) + " is not a power of two");
+  }
+  const size_t bits = log2Exact(n);
+  if (plans_.size() <= bits) {
+    plans_.resize(bits + 1);
+  }
+  if (!plans_[bits]) {
+    auto plan = std::make_unique<FftPlan>();
+    plan->n = n;
+    plan->bitReverse.resize(n);
+    for (size_t i = 0; i < n; i++) {
+      uint32_t r = 0;
+      for (size_t b = 0; b < bits; b++) {
+        r |= static_cast<uint32_t>(((i >> b) & 1) << (bits - 1 - b));
+      }
+      plan->bitReverse[i] = r;
+    }
+    plan->cosTable.resize(n / 2);
+    plan->sinTable.resize(n / 2);
+    for (size_t k = 0; k < n / 2; k++) {
+      const double angle = 2.0 * M_PI * static_cast<double>(k) / static_cast<double>(n);
+      plan->cosTable[k] = static_cast<float>(std::cos(angle));
+      plan->sinTable[k] = static_cast<float>(std::sin(angle));
+    }
+    plans_[bits] = std::move(plan);
+  }
+  return *plans_[bits];
+}
+
+void fftRows(const FftPlan& plan, float* re, float* im, size_t width, bool inverse) {
+  const size_t n = plan.n;
+  for (size_t i = 0; i < n; i++) {
+    const size_t j = plan.bitReverse[i];
+    if (i < j) {
+      swapRows(re + i * width, re + j * width, width);
+      swapRows(im + i * width, im + j * width, width);
+    }
+  }
+
+  // Length-2 butterflies have unit twiddles
+  for (size_t i = 0; i + 1 < n; i += 2) {
+    float* r0 = re + i * width;
+    float* i0 = im + i * width;
+    for (size_t c = 0; c < width; c += kLanes) {
+      const VecF ar = load(r0 + c), ai = load(i0 + c);
+      const VecF br = load(r0 + width + c), bi = load(i0 + width + c);
+      store(r0 + c, add(ar, br));
+      store(i0 + c, add(ai, bi));
+      store(r0 + width + c, sub(ar, br));
+      store(i0 + width + c, sub(ai, bi));
+    }
+  }
+
+  const float sign = inverse ? 1.0f : -1.0f;
+  for (size_t len = 4; len <= n; len <<= 1) {
+    const size_t half = len / 2;
+    const size_t step = n / len;
+    for (size_t start = 0; start < n; start += len) {
+      for (size_t k = 0; k < half; k++) {
+        const VecF wr = broadcast(plan.cosTable[k * step]);
+        const VecF wi = broadcast(sign * plan.sinTable[k * step]);
+        float* ur = re + (start + k) * width;
+        float* ui = im + (start + k) * width;
+        float* vr = re + (start + k + half) * width;
+        float* vi = im + (start + k + half) * width;
+        for (size_t c = 0; c < width; c += kLanes) {
+          const VecF xr = load(vr + c), xi = load(vi + c);
+          const VecF tr = sub(mul(xr, wr), mul(xi, wi));
+          const VecF ti = fma(xr, wi, mul(xi, wr));
+          const VecF ar = load(ur + c), ai = load(ui + c);
+          store(ur + c, add(ar, tr));
+          store(ui + c, add(ai, ti));
+          store(vr + c, sub(ar, tr));
+          store(vi + c, sub(ai, ti));
+        }
+      }
+    }
+  }
+}
+
+}  // namespace shoplifter
@@ -0,0 +1,70 @@
+/**
+ * Row-Batched FFT
+ *
+ * Radix-2 complex FFT along the rows of a [n][width] split-complex matrix:
+ * every butterfly combines two whole rows, so the SIMD lanes run across the
+ * width (the channels of a sequence) and no transposes are needed. This is
+ * the layout the FFT token mixer transforms the sequence axis in.
+ *
+ * Plans (bit-reversal permutation and twiddles) are built once per size and
+ * cached; FftPlanCache::prepare() builds every size up front so the hot path
+ * never allocates.
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "models/transformer/simd.h"
+
+namespace shoplifter {
+
+/**
+ * Smallest power of two >= n (1 for n <= 1)
+ */
+size_t nextPowerOfTwo(size_t n);
+
+struct FftPlan {
+  size_t n = 0;                       // Power of two
+  std::vector<uint32_t> bitReverse;   // n entries
+  simd::AlignedFloats cosTable;       // cos(2 pi k / n), k < n / 2
+  simd::AlignedFloats sinTable;       // sin(2 pi k / n), k < n / 2
+};
+
+class FftPlanCache {
+ public:
+  /**
+   * Build plans for every power of two up to nextPowerOfTwo(maxN)
+   */
+  void prepare(size_t maxN);
+
+  /**
+   * Plan for a power-of-two size, built on first use
+   *
+   * @throws std::invalid_argument if n is not a power of two
+   */
+  const FftPlan& plan(size_t n);
+
+ private:
+  std::vector<std::unique_ptr<FftPlan>> plans_;  // Indexed by log2(n)
+};
+
+/**
+ * In-place FFT of each column of a split-complex [n][width] matrix
+ *
+ * Computes X[k] = sum_t x[t] e^(-2 pi i k t / n) (forward) or the unscaled
+ * inverse with e^(+2 pi i k t / n).
+ *
+ * @param re Real parts, row stride width
+ * @param im Imaginary parts, row stride width
+ * @param width Columns; a multiple of simd::kFloatLanes
+ */
+void fftRows(const FftPlan& plan, float* re, float* im, size_t width, bool inverse);
+
+}  // namespace shoplifter
+
+#endif // FFT_H
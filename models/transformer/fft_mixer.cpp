@@ -0,0 +1,118 @@
+/**
+ * FFT Token Mixer
+ */
+
+#include "models/transformer/fft_mixer.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace shoplifter {
+
+namespace {
+
+using namespace simd;
+
+constexpr size_t kLanes = kFloatLanes;
+
+// z = z * w, then modReLU
+inline void filterBin(VecF& zr, VecF& zi, VecF wr, VecF wi, VecF b) {
+  const VecF r = sub(mul(zr, wr), mul(zi, wi));
+  const VecF i = fma(zr, wi, mul(zi, wr));
+  const VecF mag = sqrt(fma(r, r, mul(i, i)));
+  const VecF scale = div(max(add(mag, b), zero()), add(mag, broadcast(kModReluEps)));
+  zr = mul(r, scale);
+  zi = mul(i, scale);
+}
+
+}  // namespace
+
+void packFftFilter(const float* real, const float* imag, const float* bias, size_t dModel, size_t fftSize,
+                   FftFilter& filter) {
+  if (dModel % 2 != 0 || fftSize == 0 || (fftSize & (fftSize - 1)) != 0) {
+    throw std::invalid_argument("FFT mixer needs an even d_model and a power-of-two FFT size");
+  }
+  const size_t half = dModel / 2;
+  const size_t bins = fftSize / 2 + 1;
+  filter.dModel = dModel;
+  filter.fftSize = fftSize;
+  filter.halfPadded = (half + kLanes - 1) / kLanes * kLanes;
+  for (size_t h = 0; h < 2; h++) {
+    filter.real[h].assign(bins * filter.halfPadded, 0.0f);
+    filter.imag[h].assign(bins * filter.halfPadded, 0.0f);
+    filter.bias[h].assign(filter.halfPadded, 0.0f);
+    for (size_t k = 0; k < bins; k++) {
+      std::memcpy(&filter.real[h][k * filter.halfPadded], real + k * dModel + h * half, sizeof(float) * half);
+      std::memcpy(&filter.imag[h][k * filter.halfPadded], imag + k * dModel + h * half, sizeof(float) * half);
+    }
+    std::memcpy(filter.bias[h].data(), bias + h * half, sizeof(float) * half);
+  }
+}
+
+size_t fftMixScratchSize(const FftFilter& filter, size_t maxSeq) {
+  return 2 * nextPowerOfTwo(maxSeq) * filter.halfPadded;
+}
+
+void fftMix(const FftFilter& filter, FftPlanCache& plans, const float* x, size_t seq, size_t ldx, float* y,
+            size_t ldy, float* scratch) {
+  if (seq > filter.fftSize) {
+    throw std::invalid_argument("FFT mixer sequence " + std::to_string(seq) + " exceeds its filter size " +
+                                std::to_string(filter.fftSize));
+  }
+  const size_t n = nextPowerOfTwo(seq);
+  const size_t stride = filter.fftSize / n;
+  const size_t half = filter.dModel / 2;
+  const size_t width = filter.halfPadded;
+  float* re = scratch;
+  float* im = scratch + n * width;
+
+  // Channels [0, d/2) as real parts, [d/2, d) as imaginary parts; zero padding past seq
+  std::memset(scratch, 0, sizeof(float) * 2 * n * width);
+  for (size_t t = 0; t < seq; t++) {
+    std::memcpy(re + t * width, x + t * ldx, sizeof(float) * half);
+    std::memcpy(im + t * width, x + t * ldx + half, sizeof(float) * half);
+  }
+  fftRows(plans.plan(n), re, im, width, false);
+
+  // Split Z into the spectra A (real-part channels) and B (imaginary-part
+  // channels), filter both, and recombine as Z' = A' + i B'. Bins k and
+  // n - k are handled together since each needs the other.
+  const VecF halfVec = broadcast(0.5f);
+  for (size_t k = 0; k <= n / 2; k++) {
+    const size_t j = (n - k) & (n - 1);
+    const size_t bin = k * stride;
+    for (size_t c = 0; c < width; c += kLanes) {
+      const VecF rk = load(re + k * width + c), ik = load(im + k * width + c);
+      const VecF rj = load(re + j * width + c), ij = load(im + j * width + c);
+      VecF ar = mul(add(rk, rj), halfVec), ai = mul(sub(ik, ij), halfVec);
+      VecF br = mul(add(ik, ij), halfVec), bi = mul(sub(rj, rk), halfVec);
+      filterBin(ar, ai, load(&filter.real[0][bin * width + c]), load(&filter.imag[0][bin * width + c]),
+                load(&filter.bias[0][c]));
+      filterBin(br, bi, load(&filter.real[1][bin * width + c]), load(&filter.imag[1][bin * width + c]),
+                load(&filter.bias[1][c]));
+      if (k == j) {
+        // DC and Nyquist bins of a real signal are real (irfft drops the imaginary part)
+        ai = zero();
+        bi = zero();
+      }
+      store(re + k * width + c, sub(ar, bi));
+      store(im + k * width + c, add(ai, br));
+      store(re + j * width + c, add(ar, bi));
+      store(im + j * width + c, sub(br, ai));
+    }
+  }
+  fftRows(plans.plan(n), re, im, width, true);
+
+  const VecF scale = broadcast(1.0f / static_cast<float>(n));
+  for (size_t t = 0; t < seq; t++) {
+    for (size_t c = 0; c < width; c += kLanes) {
+      store(re + t * width + c, mul(load(re + t * width + c), scale));
+      store(im + t * width + c, mul(load(im + t * width + c), scale));
+    }
+    std::memcpy(y + t * ldy, re + t * width, sizeof(float) * half);
+    std::memcpy(y + t * ldy + half, im + t * width, sizeof(float) * half);
+  }
+}
+
+}  // namespace shoplifter
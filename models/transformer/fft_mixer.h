@@ -0,0 +1,78 @@
+/**
+ * FFT Token Mixer
+ *
+ * Drop-in replacement for self-attention in an encoder layer, after "The
+ * FFT Strikes Back" (research/fft-strikes-back-efficient-alternative-to-self-attention.pdf):
+ *
+ *   Z = rfft(x, n) along the sequence, n = nextPowerOfTwo(seq), zero-padded
+ *   Z = Z * W                      learned complex filter per bin and channel
+ *   Z = Z * relu(|Z| + b) / (|Z| + eps)          modReLU
+ *   y = irfft(Z, n)[0..seq)
+ *
+ * O(seq log seq) instead of O(seq^2), so long telemetry windows stay cheap.
+ * The filter is learned on the grid of the longest transform; shorter
+ * windows sample it at their own bin frequencies (every stride-th bin).
+ *
+ * Real input costs one complex FFT per pair of channels: channel c rides
+ * in the real part and channel c + d/2 in the imaginary part, and the two
+ * spectra are separated before filtering and re-interleaved for the
+ * inverse transform.
+ */
+
+#ifndef FFT_MIXER_H
+#define FFT_MIXER_H
+
+#include <cstddef>
+
+#include "models/transformer/fft.h"
+#include "models/transformer/simd.h"
+
+namespace shoplifter {
+
+constexpr float kModReluEps = 1e-6f;
+
+/**
+ * Filter of an FFT mixer, split into the real- and imaginary-part channel
+ * halves and padded to whole vectors
+ */
+struct FftFilter {
+  size_t dModel = 0;
+  size_t fftSize = 0;                 // Longest transform
+  size_t halfPadded = 0;              // dModel / 2 rounded up to kFloatLanes
+  simd::AlignedFloats real[2];        // [fftSize / 2 + 1][halfPadded] per half
+  simd::AlignedFloats imag[2];
+  simd::AlignedFloats bias[2];        // [halfPadded] modReLU bias
+};
+
+/**
+ * Pack an FftMixer's parameters (encoder.py)
+ *
+ * @param real [fftSize / 2 + 1][dModel] filter real parts
+ * @param imag [fftSize / 2 + 1][dModel] filter imaginary parts
+ * @param bias dModel modReLU biases
+ * @param fftSize Power of two the filter was learned at
+ * @throws std::invalid_argument if dModel is odd or fftSize not a power of two
+ */
+void packFftFilter(const float* real, const float* imag, const float* bias, size_t dModel, size_t fftSize,
+                   FftFilter& filter);
+
+/**
+ * Scratch floats fftMix() needs for sequences of up to maxSeq
+ */
+size_t fftMixScratchSize(const FftFilter& filter, size_t maxSeq);
+
+/**
+ * y = FFT mixing of x along the sequence
+ *
+ * @param plans Cache prepared for nextPowerOfTwo(seq)
+ * @param x [seq][dModel] rows, stride ldx
+ * @param y [seq][dModel] rows, stride ldy (may alias x)
+ * @param scratch fftMixScratchSize() floats, 64-byte aligned
+ * @throws std::invalid_argument if seq exceeds the filter's fftSize
+ */
+void fftMix(const FftFilter& filter, FftPlanCache& plans, const float* x, size_t seq, size_t ldx, float* y,
+            size_t ldy, float* scratch);
+
+}  // namespace shoplifter
+
+#endif // FFT_MIXER_H
@@ -0,0 +1,553 @@
+/**
+ * Packed-Weight GEMM
+ */
+
+#include "models/transformer/gemm.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace shoplifter {
+
+namespace {
+
+using namespace simd;
+
+constexpr size_t kLanes = kFloatLanes;
+
+inline VecF loadWeights(const float* p) { return load(p); }
+inline VecF loadWeights(const uint16_t* p) { return loadHalf(p); }
+
+/**
+ * C[MR][NR] (+)= A[MR][kc] * B[kc][NR], then bias and ReLU if requested
+ *
+ * @param b Float or half panel slice
+ * @param accumulate Add to the existing C tile (later reduction blocks)
+ * @param bias NR values, or nullptr (only on the last reduction block)
+ */
+template <size_t MR, typename W>
+inline void microKernel(size_t kc, const float* a, size_t lda, const W* b, float* c, size_t ldc,
+                        bool accumulate, const float* bias, bool relu) {
+  VecF acc0[MR];
+  VecF acc1[MR];
+#pragma GCC unroll 8
+  for (size_t i = 0; i < MR; i++) {
+    acc0[i] = accumulate ? load(c + i * ldc) : zero();
+    acc1[i] = accumulate ? load(c + i * ldc + kLanes) : zero();
+  }
+  for (size_t k = 0; k < kc; k++) {
+    const VecF b0 = loadWeights(b + k * kGemmNR);
+    const VecF b1 = loadWeights(b + k * kGemmNR + kLanes);
+#pragma GCC unroll 8
+    for (size_t i = 0; i < MR; i++) {
+      const VecF ai = broadcast(a[i * lda + k]);
+      acc0[i] = fma(ai, b0, acc0[i]);
+      acc1[i] = fma(ai, b1, acc1[i]);
+    }
+  }
+  if (bias) {
+    const VecF bias0 = load(bias);
+    const VecF bias1 = load(bias + kLanes);
+#pragma GCC unroll 8
+    for (size_t i = 0; i < MR; i++) {
+      acc0[i] = add(acc0[i], bias0);
+      acc1[i] = add(acc1[i], bias1);
+    }
+  }
+  if (relu) {
+#pragma GCC unroll 8
+    for (size_t i = 0; i < MR; i++) {
+      acc0[i] = max(acc0[i], zero());
+      acc1[i] = max(acc1[i], zero());
+    }
+  }
+#pragma GCC unroll 8
+  for (size_t i = 0; i < MR; i++) {
+    store(c + i * ldc, acc0[i]);
+    store(c + i * ldc + kLanes, acc1[i]);
+  }
+}
+
+// INT8 dot products: acc[lane] += sum of 4 byte products, lane = one output column
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+
+constexpr size_t kInt8MR = 8;
+constexpr bool kInt8Offset = true;  // vpdpbusd takes unsigned activations: a + 128, minus 128 * column sum
+
+struct VecI {
+  __m512i v;
+};
+inline VecI zeroI() { return {_mm512_setzero_si512()}; }
+inline VecI loadI(const int8_t* p) { return {_mm512_loadu_si512(p)}; }
+inline VecI loadI(const int32_t* p) { return {_mm512_loadu_si512(p)}; }
+inline VecI subI(VecI a, VecI b) { return {_mm512_sub_epi32(a.v, b.v)}; }
+inline VecI broadcastGroup(const int8_t* a) {
+  int32_t bits;
+  std::memcpy(&bits, a, sizeof(bits));
+  return {_mm512_set1_epi32(static_cast<int32_t>(static_cast<uint32_t>(bits) ^ 0x80808080u))};
+}
+inline VecI dot4(VecI acc, VecI a, VecI b) { return {_mm512_dpbusd_epi32(acc.v, a.v, b.v)}; }
+inline VecF toFloat(VecI a) { return {_mm512_maskz_cvtepi32_ps(0xFFFF, a.v)}; }
+
+#elif defined(__AVX512BW__)
+
+constexpr size_t kInt8MR = 8;
+constexpr bool kInt8Offset = false;
+
+struct VecI {
+  __m512i v;
+};
+inline VecI zeroI() { return {_mm512_setzero_si512()}; }
+inline VecI loadI(const int8_t* p) { return {_mm512_loadu_si512(p)}; }
+inline VecI loadI(const int32_t* p) { return {_mm512_loadu_si512(p)}; }
+inline VecI subI(VecI a, VecI b) { return {_mm512_sub_epi32(a.v, b.v)}; }
+inline VecI broadcastGroup(const int8_t* a) {
+  int32_t bits;
+  std::memcpy(&bits, a, sizeof(bits));
+  return {_mm512_set1_epi32(bits)};
+}
+// |a| * (b with a's sign): byte pairs sum to at most 2 * 127 * 127, so vpmaddubsw never saturates
+inline VecI dot4(VecI acc, VecI a, VecI b) {
+  const __m512i signedB = _mm512_mask_sub_epi8(b.v, _mm512_movepi8_mask(a.v), _mm512_setzero_si512(), b.v);
+  const __m512i pairs = _mm512_maddubs_epi16(_mm512_abs_epi8(a.v), signedB);
+  return {_mm512_add_epi32(acc.v, _mm512_madd_epi16(pairs, _mm512_set1_epi16(1)))};
+}
+inline VecF toFloat(VecI a) { return {_mm512_maskz_cvtepi32_ps(0xFFFF, a.v)}; }
+
+#elif defined(__AVX2__) && defined(__FMA__) && !defined(__AVX512F__)
+
+constexpr size_t kInt8MR = 4;
+constexpr bool kInt8Offset = false;
+
+struct VecI {
+  __m256i v;
+};
+inline VecI zeroI() { return {_mm256_setzero_si256()}; }
+inline VecI loadI(const int8_t* p) { return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))}; }
+inline VecI loadI(const int32_t* p) { return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))}; }
+inline VecI subI(VecI a, VecI b) { return {_mm256_sub_epi32(a.v, b.v)}; }
+inline VecI broadcastGroup(const int8_t* a) {
+  int32_t bits;
+  std::memcpy(&bits, a, sizeof(bits));
+  return {_mm256_set1_epi32(bits)};
+}
+inline VecI dot4(VecI acc, VecI a, VecI b) {
+  const __m256i pairs = _mm256_maddubs_epi16(_mm256_sign_epi8(a.v, a.v), _mm256_sign_epi8(b.v, a.v));
+  return {_mm256_add_epi32(acc.v, _mm256_madd_epi16(pairs, _mm256_set1_epi16(1)))};
+}
+inline VecF toFloat(VecI a) { return {_mm256_cvtepi32_ps(a.v)}; }
+
+#elif defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+
+constexpr size_t kInt8MR = 8;
+constexpr bool kInt8Offset = false;
+
+struct VecI {
+  int32x4_t v;
+};
+inline VecI zeroI() { return {vdupq_n_s32(0)}; }
+inline VecI loadI(const int8_t* p) { return {vreinterpretq_s32_s8(vld1q_s8(p))}; }
+inline VecI loadI(const int32_t* p) { return {vld1q_s32(p)}; }
+inline VecI subI(VecI a, VecI b) { return {vsubq_s32(a.v, b.v)}; }
+inline VecI broadcastGroup(const int8_t* a) {
+  int32_t bits;
+  std::memcpy(&bits, a, sizeof(bits));
+  return {vdupq_n_s32(bits)};
+}
+inline VecI dot4(VecI acc, VecI a, VecI b) {
+  return {vdotq_s32(acc.v, vreinterpretq_s8_s32(a.v), vreinterpretq_s8_s32(b.v))};
+}
+inline VecF toFloat(VecI a) { return {vcvtq_f32_s32(a.v)}; }
+
+#else
+
+constexpr size_t kInt8MR = 4;
+constexpr bool kInt8Offset = false;
+
+struct VecI {
+  int32_t v[kLanes];
+  int8_t bytes[kLanes * 4];  // Operand form: 4 bytes per lane
+};
+inline VecI zeroI() { return VecI{}; }
+inline VecI loadI(const int8_t* p) {
+  VecI r;
+  std::memcpy(r.bytes, p, sizeof(r.bytes));
+  return r;
+}
+inline VecI loadI(const int32_t* p) {
+  VecI r;
+  std::memcpy(r.v, p, sizeof(r.v));
+  return r;
+}
+inline VecI subI(VecI a, VecI b) {
+  for (size_t l = 0; l < kLanes; l++) a.v[l] -= b.v[l];
+  return a;
+}
+inline VecI broadcastGroup(const int8_t* a) {
+  VecI r;
+  for (size_t l = 0; l < kLanes; l++) std::memcpy(r.bytes + 4 * l, a, 4);
+  return r;
+}
+inline VecI dot4(VecI acc, const VecI& a, const VecI& b) {
+  for (size_t l = 0; l < kLanes; l++) {
+    int32_t sum = 0;
+    for (size_t j = 0; j < 4; j++) sum += a.bytes[4 * l + j] * b.bytes[4 * l + j];
+    acc.v[l] += sum;
+  }
+  return acc;
+}
+inline VecF toFloat(const VecI& a) {
+  float f[kLanes];
+  for (size_t l = 0; l < kLanes; l++) f[l] = static_cast<float>(a.v[l]);
+  return load(f);
+}
+
+#endif
+
+constexpr size_t kInt8Group = 4;                   // Inputs per dot-product lane
+constexpr size_t kInt8GroupBytes = kInt8Group * kGemmNR;  // One group of a panel
+
+/**
+ * C[MR][NR] = act((A[MR][groups * 4] * B) * rowScale * colScale + bias)
+ *
+ * @param a int8 activations, row stride lda bytes
+ * @param b int8 panel
+ */
+template <size_t MR>
+inline void int8Kernel(size_t groups, const int8_t* a, size_t lda, const int8_t* b, const float* rowScale,
+                       const float* colScale, const int32_t* columnSums, const float* bias, bool relu, float* c,
+                       size_t ldc) {
+  VecI acc0[MR];
+  VecI acc1[MR];
+#pragma GCC unroll 8
+  for (size_t i = 0; i < MR; i++) {
+    acc0[i] = zeroI();
+    acc1[i] = zeroI();
+  }
+  for (size_t g = 0; g < groups; g++) {
+    const VecI b0 = loadI(b + g * kInt8GroupBytes);
+    const VecI b1 = loadI(b + g * kInt8GroupBytes + kLanes * kInt8Group);
+#pragma GCC unroll 8
+    for (size_t i = 0; i < MR; i++) {
+      const VecI ai = broadcastGroup(a + i * lda + g * kInt8Group);
+      acc0[i] = dot4(acc0[i], ai, b0);
+      acc1[i] = dot4(acc1[i], ai, b1);
+    }
+  }
+  const VecF scale0 = load(colScale);
+  const VecF scale1 = load(colScale + kLanes);
+  const VecF bias0 = load(bias);
+  const VecF bias1 = load(bias + kLanes);
+#pragma GCC unroll 8
+  for (size_t i = 0; i < MR; i++) {
+    if (kInt8Offset) {
+      acc0[i] = subI(acc0[i], loadI(columnSums));
+      acc1[i] = subI(acc1[i], loadI(columnSums + kLanes));
+    }
+    const VecF r = broadcast(rowScale[i]);
+    VecF y0 = fma(toFloat(acc0[i]), mul(scale0, r), bias0);
+    VecF y1 = fma(toFloat(acc1[i]), mul(scale1, r), bias1);
+    if (relu) {
+      y0 = max(y0, zero());
+      y1 = max(y1, zero());
+    }
+    store(c + i * ldc, y0);
+    store(c + i * ldc + kLanes, y1);
+  }
+}
+
+/**
+ * Quantize rows of x to int8 with one step per row
+ *
+ * @param q [rows][ldq] bytes; columns in..ldq are zeroed
+ * @param scales rows steps
+ */
+void quantizeRows(const float* x, size_t rows, size_t ldx, size_t in, float inputScale, int8_t* q, size_t ldq,
+                  float* scales) {
+  const size_t vecEnd = in / kLanes * kLanes;
+  const VecF limit = broadcast(127.0f);
+  const VecF negLimit = broadcast(-127.0f);
+  for (size_t r = 0; r < rows; r++) {
+    const float* row = x + r * ldx;
+    float step = inputScale;
+    if (step <= 0.0f) {
+      VecF maxAbs = zero();
+      for (size_t k = 0; k < vecEnd; k += kLanes) {
+        const VecF v = load(row + k);
+        maxAbs = max(maxAbs, max(v, sub(zero(), v)));
+      }
+      float m = reduceMax(maxAbs);
+      for (size_t k = vecEnd; k < in; k++) m = std::max(m, std::fabs(row[k]));
+      step = m > 0.0f ? m / 127.0f : 1.0f;
+    }
+    const float inverse = 1.0f / step;
+    const VecF inv = broadcast(inverse);
+    int8_t* out = q + r * ldq;
+    alignas(64) float rounded[kLanes];
+    for (size_t k = 0; k < vecEnd; k += kLanes) {
+      store(rounded, roundNearest(min(limit, max(negLimit, mul(load(row + k), inv)))));
+      for (size_t l = 0; l < kLanes; l++) out[k + l] = static_cast<int8_t>(rounded[l]);
+    }
+    for (size_t k = vecEnd; k < in; k++) {
+      const float v = std::nearbyint(row[k] * inverse);
+      out[k] = static_cast<int8_t>(std::min(127.0f, std::max(-127.0f, v)));
+    }
+    std::memset(out + in, 0, ldq - in);
+    scales[r] = step;
+  }
+}
+
+void linearInt8(const float* x, size_t rows, size_t ldx, const PackedLinear& w, float* y, size_t ldy,
+                Activation act) {
+  // Grows to the largest layer on first use, then reused: steady-state calls allocate nothing
+  thread_local AlignedBytes quantized;
+  thread_local AlignedFloats rowScales;
+  const size_t ldq = (w.in + kInt8Group - 1) / kInt8Group * kInt8Group;
+  const size_t paddedRows = (rows + kInt8MR - 1) / kInt8MR * kInt8MR;
+  if (quantized.size() < paddedRows * ldq) quantized.resize(paddedRows * ldq);
+  if (rowScales.size() < paddedRows) rowScales.resize(paddedRows);
+  int8_t* q = reinterpret_cast<int8_t*>(quantized.data());
+  quantizeRows(x, rows, ldx, w.in, w.inputScale, q, ldq, rowScales.data());
+  std::memset(q + rows * ldq, 0, (paddedRows - rows) * ldq);
+
+  const size_t panels = w.outPadded / kGemmNR;
+  const size_t groups = ldq / kInt8Group;
+  const bool relu = act == Activation::kRelu;
+  alignas(64) float tile[kInt8MR * kGemmNR];
+  for (size_t p = 0; p < panels; p++) {
+    const int8_t* panel = w.int8Panels + p * ldq * kGemmNR;
+    const size_t n0 = p * kGemmNR;
+    const size_t nValid = std::min(kGemmNR, w.out - n0);
+    for (size_t i0 = 0; i0 < rows; i0 += kInt8MR) {
+      const size_t mValid = std::min(kInt8MR, rows - i0);
+      const bool full = mValid == kInt8MR && nValid == kGemmNR;
+      int8Kernel<kInt8MR>(groups, q + i0 * ldq, ldq, panel, rowScales.data() + i0, w.weightScales + n0,
+                          w.columnSums + n0, w.bias + n0, relu, full ? y + i0 * ldy + n0 : tile,
+                          full ? ldy : kGemmNR);
+      if (!full) {
+        for (size_t i = 0; i < mValid; i++) {
+          std::memcpy(y + (i0 + i) * ldy + n0, tile + i * kGemmNR, sizeof(float) * nValid);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * The blocked float GEMM over float or half panels
+ */
+template <typename W>
+void linearPanels(const float* x, size_t rows, size_t ldx, const PackedLinear& w, const W* weights, float* y,
+                  size_t ldy, Activation act) {
+  const size_t panels = w.outPadded / kGemmNR;
+  alignas(64) float tile[kGemmMR * kGemmNR];
+  alignas(64) float aTail[kGemmMR * kGemmKC];
+
+  for (size_t k0 = 0; k0 < w.in; k0 += kGemmKC) {
+    const size_t kc = std::min(kGemmKC, w.in - k0);
+    const bool first = k0 == 0;
+    const bool last = k0 + kc >= w.in;
+    const bool relu = last && act == Activation::kRelu;
+
+    for (size_t p = 0; p < panels; p++) {
+      const W* panel = weights + p * w.in * kGemmNR + k0 * kGemmNR;
+      const size_t n0 = p * kGemmNR;
+      const size_t nValid = std::min(kGemmNR, w.out - n0);
+      const float* bias = last ? w.bias + n0 : nullptr;
+
+      for (size_t i0 = 0; i0 < rows; i0 += kGemmMR) {
+        const size_t mValid = std::min(kGemmMR, rows - i0);
+        if (mValid == kGemmMR && nValid == kGemmNR) {
+          microKernel<kGemmMR>(kc, x + i0 * ldx + k0, ldx, panel, y + i0 * ldy + n0, ldy, !first, bias, relu);
+          continue;
+        }
+
+        // Edge tile: compute into a full-size scratch tile, copy the valid part
+        const float* a = x + i0 * ldx + k0;
+        size_t lda = ldx;
+        if (mValid < kGemmMR) {
+          std::memset(aTail, 0, sizeof(float) * kGemmMR * kc);
+          for (size_t i = 0; i < mValid; i++) {
+            std::memcpy(aTail + i * kc, a + i * ldx, sizeof(float) * kc);
+          }
+          a = aTail;
+          lda = kc;
+        }
+        if (!first) {
+          for (size_t i = 0; i < mValid; i++) {
+            std::memcpy(tile + i * kGemmNR, y + (i0 + i) * ldy + n0, sizeof(float) * nValid);
+          }
+        }
+        microKernel<kGemmMR>(kc, a, lda, panel, tile, kGemmNR, !first, bias, relu);
+        for (size_t i = 0; i < mValid; i++) {
+          std::memcpy(y + (i0 + i) * ldy + n0, tile + i * kGemmNR, sizeof(float) * nValid);
+        }
+      }
+    }
+  }
+}
+
+// Back to plain float panels before a layer is (re)loaded
+void resetFormat(PackedLinear& packed) {
+  packed.format = WeightFormat::kFloat32;
+  packed.halfPanels = nullptr;
+  packed.int8Panels = nullptr;
+  packed.weightScales = nullptr;
+  packed.columnSums = nullptr;
+  packed.inputScale = 0.0f;
+  packed.lowStorage.clear();
+}
+
+}  // namespace
+
+const char* weightFormatName(WeightFormat format) {
+  switch (format) {
+    case WeightFormat::kFloat16: return "fp16";
+    case WeightFormat::kInt8: return "int8";
+    default: return "fp32";
+  }
+}
+
+void packLinear(const float* weight, const float* bias, size_t out, size_t in, PackedLinear& packed) {
+  packed.in = in;
+  packed.out = out;
+  packed.outPadded = (out + kGemmNR - 1) / kGemmNR * kGemmNR;
+  packed.storage.assign(packed.outPadded * (in + 1), 0.0f);
+  packed.mapping.reset();
+  resetFormat(packed);
+  float* panels = packed.storage.data();
+  float* packedBias = panels + packed.outPadded * in;
+  for (size_t n = 0; n < out; n++) {
+    float* panel = panels + (n / kGemmNR) * in * kGemmNR + n % kGemmNR;
+    for (size_t k = 0; k < in; k++) {
+      panel[k * kGemmNR] = weight[n * in + k];
+    }
+    if (bias) {
+      packedBias[n] = bias[n];
+    }
+  }
+  packed.panels = panels;
+  packed.bias = packedBias;
+}
+
+void quantizeLinear(PackedLinear& packed, WeightFormat format, float inputScale) {
+  if (packed.format != WeightFormat::kFloat32) {
+    throw std::invalid_argument("Linear layer is already converted to " + std::string(weightFormatName(packed.format)));
+  }
+  if (format == WeightFormat::kFloat32) {
+    return;
+  }
+  const size_t in = packed.in;
+  const size_t outPadded = packed.outPadded;
+  AlignedFloats storage(2 * outPadded, 0.0f);  // Bias, then weight scales
+  std::copy(packed.bias, packed.bias + outPadded, storage.begin());
+
+  if (format == WeightFormat::kFloat16) {
+    packed.lowStorage.assign(outPadded * in * sizeof(uint16_t), 0);
+    uint16_t* half = reinterpret_cast<uint16_t*>(packed.lowStorage.data());
+    for (size_t i = 0; i < outPadded * in; i++) {
+      half[i] = floatToHalf(packed.panels[i]);
+    }
+    packed.halfPanels = half;
+  } else {
+    const size_t ldq = (in + kInt8Group - 1) / kInt8Group * kInt8Group;
+    const size_t sumsOffset = (outPadded * ldq + 63) / 64 * 64;
+    packed.lowStorage.assign(sumsOffset + outPadded * sizeof(int32_t), 0);
+    int8_t* q = reinterpret_cast<int8_t*>(packed.lowStorage.data());
+    int32_t* sums = reinterpret_cast<int32_t*>(packed.lowStorage.data() + sumsOffset);
+    float* scales = storage.data() + outPadded;
+    for (size_t n = 0; n < packed.out; n++) {
+      const float* column = packed.panels + (n / kGemmNR) * in * kGemmNR + n % kGemmNR;
+      float maxAbs = 0.0f;
+      for (size_t k = 0; k < in; k++) maxAbs = std::max(maxAbs, std::fabs(column[k * kGemmNR]));
+      const float step = maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f;
+      int8_t* dst = q + (n / kGemmNR) * ldq * kGemmNR + (n % kGemmNR) * kInt8Group;
+      int32_t sum = 0;
+      for (size_t k = 0; k < in; k++) {
+        const float v = std::min(127.0f, std::max(-127.0f, std::nearbyint(column[k * kGemmNR] / step)));
+        dst[(k / kInt8Group) * kInt8GroupBytes + k % kInt8Group] = static_cast<int8_t>(v);
+        sum += static_cast<int32_t>(v);
+      }
+      scales[n] = step;
+      sums[n] = 128 * sum;
+    }
+    packed.int8Panels = q;
+    packed.weightScales = scales;
+    packed.columnSums = sums;
+    packed.inputScale = inputScale;
+  }
+  packed.storage.swap(storage);
+  packed.bias = packed.storage.data();
+  if (format == WeightFormat::kInt8) {
+    packed.weightScales = packed.storage.data() + outPadded;
+  }
+  packed.panels = nullptr;
+  packed.mapping.reset();
+  packed.format = format;
+}
+
+void loadLinear(const TensorArchive& archive, const std::string& weightName, const std::string& biasName,
+                size_t out, size_t in, PackedLinear& packed, WeightFormat format) {
+  const std::string suffix = ".packed" + std::to_string(kGemmNR);
+  const size_t outPadded = (out + kGemmNR - 1) / kGemmNR * kGemmNR;
+  if (archive.contains(weightName + suffix) && (biasName.empty() || archive.contains(biasName + suffix))) {
+    resetFormat(packed);
+    packed.in = in;
+    packed.out = out;
+    packed.outPadded = outPadded;
+    packed.panels =
+        archive.require(weightName + suffix, TensorType::kFloat32, {outPadded / kGemmNR, in, kGemmNR}).floats();
+    if (biasName.empty()) {
+      packed.storage.assign(outPadded, 0.0f);
+      packed.bias = packed.storage.data();
+    } else {
+      packed.storage.clear();
+      packed.bias = archive.require(biasName + suffix, TensorType::kFloat32, {outPadded}).floats();
+    }
+    packed.mapping = archive.storage();
+  } else {
+    const float* weight = archive.require(weightName, TensorType::kFloat32, {out, in}).floats();
+    const float* bias = biasName.empty() ? nullptr : archive.require(biasName, TensorType::kFloat32, {out}).floats();
+    packLinear(weight, bias, out, in, packed);
+  }
+  if (format != WeightFormat::kFloat32) {
+    const std::string scaleName = weightName + ".act_scale";
+    const float inputScale = format == WeightFormat::kInt8 && archive.contains(scaleName)
+                                 ? archive.require(scaleName, TensorType::kFloat32, {1}).floats()[0]
+                                 : 0.0f;
+    quantizeLinear(packed, format, inputScale);
+  }
+}
+
+void linear(const float* x, size_t rows, size_t ldx, const PackedLinear& w, float* y, size_t ldy,
+            Activation act) {
+  switch (w.format) {
+    case WeightFormat::kFloat16:
+      linearPanels(x, rows, ldx, w, w.halfPanels, y, ldy, act);
+      break;
+    case WeightFormat::kInt8:
+      linearInt8(x, rows, ldx, w, y, ldy, act);
+      break;
+    default:
+      linearPanels(x, rows, ldx, w, w.panels, y, ldy, act);
+      break;
+  }
+}
+
+void linearReference(const float* x, size_t rows, size_t ldx, const float* weight, const float* bias,
+                     size_t out, size_t in, float* y, size_t ldy, Activation act) {
+  for (size_t i = 0; i < rows; i++) {
+    for (size_t n = 0; n < out; n++) {
+      double sum = bias ? bias[n] : 0.0;
+      for (size_t k = 0; k < in; k++) {
+        sum += static_cast<double>(x[i * ldx + k]) * weight[n * in + k];
+      }
+      y[i * ldy + n] = act == Activation::kRelu && sum < 0.0 ? 0.0f : static_cast<float>(sum);
+    }
+  }
+}
+
+}  // namespace shoplifter
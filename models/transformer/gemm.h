@@ -0,0 +1,155 @@
+/**
+ * Packed-Weight GEMM
+ *
+ * Linear layers y = x W^T + b with W in PyTorch's [out][in] layout. Weights
+ * are packed once at load time into panels of kGemmNR output columns:
+ *
+ *   panel p:  for k in 0..in:  W[p*NR + 0][k] .. W[p*NR + NR-1][k]
+ *
+ * so the micro-kernel streams one contiguous panel while broadcasting
+ * activations, keeping a kGemmMR x kGemmNR tile of outputs in registers:
+ *
+ *   AVX-512  8 x 32     AVX2  6 x 16     NEON  8 x 8     scalar  4 x 8
+ *
+ * The reduction dimension is blocked by kGemmKC so a panel slice stays in L1.
+ * Bias and ReLU are applied while the tile is still in registers (no extra
+ * pass over the output).
+ *
+ * An exporter can store the panels for a target in the archive
+ * ("<weight>.packed<NR>", shape [panels][in][NR]). loadLinear() then points
+ * the layer at the memory-mapped archive instead of packing a copy.
+ *
+ * Layers can also run in lower precision (WeightFormat):
+ *
+ *   kFloat16  the same panels stored as halves, widened in the micro-kernel
+ *             (F16C / NEON), float accumulation
+ *   kInt8     weights quantized per output channel, activations per row
+ *             (calibrated or dynamic scale), int32 accumulation with
+ *             AVX-512 VNNI vpdpbusd, AVX-512BW / AVX2 vpmaddubsw, NEON sdot
+ *             or plain C, then scaled back to float with bias and ReLU
+ *
+ * int8 panels keep groups of 4 consecutive inputs per output column
+ * together, the operand layout of the dot-product instructions:
+ *
+ *   panel p, group g:  W[p*NR + 0][4g..4g+3] .. W[p*NR + NR-1][4g..4g+3]
+ */
+
+#ifndef GEMM_H
+#define GEMM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "models/transformer/simd.h"
+#include "models/transformer/tensor_archive.h"
+
+namespace shoplifter {
+
+constexpr size_t kGemmNR = 2 * simd::kFloatLanes;
+#if defined(__AVX512F__) || (defined(__aarch64__) && defined(__ARM_NEON))
+constexpr size_t kGemmMR = 8;
+#elif defined(__AVX2__) && defined(__FMA__)
+constexpr size_t kGemmMR = 6;
+#else
+constexpr size_t kGemmMR = 4;
+#endif
+constexpr size_t kGemmKC = 256;
+
+enum class Activation : uint8_t {
+  kNone = 0,
+  kRelu = 1,
+};
+
+enum class WeightFormat : uint8_t {
+  kFloat32 = 0,
+  kFloat16 = 1,
+  kInt8 = 2,
+};
+
+const char* weightFormatName(WeightFormat format);
+
+/**
+ * A linear layer packed for linear()
+ *
+ * panels and bias point either into storage (packed at load time) or into
+ * a mapped archive that mapping keeps alive. After quantizeLinear() the
+ * weights are in halfPanels or int8Panels instead. Movable, not copyable.
+ */
+struct PackedLinear {
+  size_t in = 0;
+  size_t out = 0;
+  size_t outPadded = 0;                // out rounded up to kGemmNR
+  WeightFormat format = WeightFormat::kFloat32;
+  const float* panels = nullptr;       // outPadded / kGemmNR panels of in x kGemmNR
+  const float* bias = nullptr;         // outPadded values (zero-padded)
+  const uint16_t* halfPanels = nullptr;   // kFloat16: the panels as halves
+  const int8_t* int8Panels = nullptr;     // kInt8: panels of in rounded up to 4, grouped by 4
+  const float* weightScales = nullptr;    // kInt8: outPadded per channel steps
+  const int32_t* columnSums = nullptr;    // kInt8: outPadded sums of quantized weights
+  float inputScale = 0.0f;             // kInt8: calibrated activation step, 0 = per row at run time
+  simd::AlignedFloats storage;         // Owned panels, then bias (then weightScales once quantized)
+  simd::AlignedBytes lowStorage;       // Owned half or int8 panels, then columnSums
+  std::shared_ptr<const void> mapping; // Archive bytes panels and bias point into
+
+  PackedLinear() = default;
+  PackedLinear(PackedLinear&&) = default;
+  PackedLinear& operator=(PackedLinear&&) = default;
+  PackedLinear(const PackedLinear&) = delete;
+  PackedLinear& operator=(const PackedLinear&) = delete;
+};
+
+/**
+ * Pack a PyTorch nn.Linear
+ *
+ * @param weight [out][in] row-major
+ * @param bias out values, or nullptr for none
+ */
+void packLinear(const float* weight, const float* bias, size_t out, size_t in, PackedLinear& packed);
+
+/**
+ * Convert a packed layer to a lower-precision format
+ *
+ * kInt8 quantizes each output channel symmetrically to [-127, 127].
+ * Activations are quantized per row, with inputScale if it is non-zero
+ * (a calibrated max abs / 127) and else with the row's own max abs. The
+ * float panels are released.
+ *
+ * @param inputScale kInt8 activation step, or 0 for dynamic
+ * @throws std::invalid_argument if the layer is already converted
+ */
+void quantizeLinear(PackedLinear& packed, WeightFormat format, float inputScale = 0.0f);
+
+/**
+ * Load an nn.Linear from an archive
+ *
+ * Uses "<weightName>.packed<kGemmNR>" and "<biasName>.packed<kGemmNR>" in
+ * place when the archive has them, else packs weightName and biasName.
+ * For kInt8, a "<weightName>.act_scale" tensor written by
+ * calibrate_quantization.py gives the activation step.
+ *
+ * @param biasName Empty for a layer without bias
+ * @throws std::runtime_error if the tensors are missing or have the wrong shape
+ */
+void loadLinear(const TensorArchive& archive, const std::string& weightName, const std::string& biasName,
+                size_t out, size_t in, PackedLinear& packed, WeightFormat format = WeightFormat::kFloat32);
+
+/**
+ * y[rows][out] = act(x[rows][in] W^T + b)
+ *
+ * @param x Input rows, row stride ldx
+ * @param y Output rows, row stride ldy (must not alias x)
+ */
+void linear(const float* x, size_t rows, size_t ldx, const PackedLinear& w, float* y, size_t ldy,
+            Activation act = Activation::kNone);
+
+/**
+ * Unpacked reference, for tests and benchmarks
+ */
+void linearReference(const float* x, size_t rows, size_t ldx, const float* weight, const float* bias,
+                     size_t out, size_t in, float* y, size_t ldy, Activation act = Activation::kNone);
+
+}  // namespace shoplifter
+
+#endif // GEMM_H
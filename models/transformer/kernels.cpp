@@ -0,0 +1,364 @@
+/**
+ * Encoder Kernels
+ */
+
+#include "models/transformer/kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "models/transformer/simd.h"
+
+namespace shoplifter {
+
+namespace {
+
+using namespace simd;
+
+constexpr size_t kLanes = kFloatLanes;
+
+size_t padLanes(size_t n) { return (n + kLanes - 1) / kLanes * kLanes; }
+
+// scores[j] = exp(scores[j] - max), returns their sum
+float expScores(float* scores, size_t n) {
+  const size_t body = n / kLanes * kLanes;
+  VecF vmax = broadcast(-INFINITY);
+  size_t j = 0;
+  for (; j < body; j += kLanes) vmax = max(vmax, load(scores + j));
+  float m = reduceMax(vmax);
+  for (; j < n; j++) m = scores[j] > m ? scores[j] : m;
+  const VecF vm = broadcast(m);
+  VecF vsum = zero();
+  for (j = 0; j < body; j += kLanes) {
+    const VecF e = exp(sub(load(scores + j), vm));
+    store(scores + j, e);
+    vsum = add(vsum, e);
+  }
+  float sum = reduceAdd(vsum);
+  for (; j < n; j++) {
+    scores[j] = std::exp(scores[j] - m);
+    sum += scores[j];
+  }
+  return sum;
+}
+
+// out[c] = scale * sum_j p[j] v[j * ldv + c], c < hd
+void weightedSum(const float* p, size_t n, const float* v, size_t ldv, size_t hd, float scale, float* out) {
+  const size_t hdBody = hd / kLanes * kLanes;
+  size_t c = 0;
+  for (; c < hdBody; c += kLanes) {
+    VecF acc = zero();
+    for (size_t j = 0; j < n; j++) {
+      acc = fma(broadcast(p[j]), load(v + j * ldv + c), acc);
+    }
+    store(out + c, mul(acc, broadcast(scale)));
+  }
+  for (; c < hd; c++) {
+    float acc = 0.0f;
+    for (size_t j = 0; j < n; j++) acc += p[j] * v[j * ldv + c];
+    out[c] = acc * scale;
+  }
+}
+
+// Fused attention tile: kAttnRows queries x kAttnKeys keys. AVX2 has 16
+// registers, so it keeps 4 x 2 score vectors; wider register files keep 4 x 4.
+// A panel of kAttnPanel queries walks the keys together, so each block of
+// K^T and V is loaded into L1 once per panel instead of once per tile.
+constexpr size_t kAttnRows = 4;
+constexpr size_t kAttnKeyVecs = kLanes == 8 ? 2 : 4;
+constexpr size_t kAttnKeys = kAttnKeyVecs * kLanes;
+constexpr size_t kAttnPanel = 16 * kAttnRows;
+
+size_t padAttnKeys(size_t n) { return (n + kAttnKeys - 1) / kAttnKeys * kAttnKeys; }
+
+size_t fusedWorkerFloats(size_t maxKeys, size_t hd) {
+  // kT [hd][keys] | Q [panel][hd] | S, P [rows][keys per block] | O [panel][hd padded] | m, l, alpha [panel]
+  const size_t floats = hd * padAttnKeys(maxKeys) + kAttnPanel * hd + 2 * kAttnRows * kAttnKeys +
+                        kAttnPanel * padLanes(hd) + 3 * kAttnPanel;
+  return (floats + 15) / 16 * 16;
+}
+
+// s[r][0..kAttnKeys) = sum_d qTile[r][d] kT[d][0..kAttnKeys), kT row stride ldk
+inline void scoreTile(const float* qTile, size_t hd, const float* kT, size_t ldk, float* s) {
+  VecF acc[kAttnRows][kAttnKeyVecs];
+#pragma GCC unroll 4
+  for (size_t r = 0; r < kAttnRows; r++) {
+#pragma GCC unroll 4
+    for (size_t b = 0; b < kAttnKeyVecs; b++) acc[r][b] = zero();
+  }
+  for (size_t d = 0; d < hd; d++) {
+    VecF kv[kAttnKeyVecs];
+#pragma GCC unroll 4
+    for (size_t b = 0; b < kAttnKeyVecs; b++) kv[b] = load(kT + d * ldk + b * kLanes);
+#pragma GCC unroll 4
+    for (size_t r = 0; r < kAttnRows; r++) {
+      const VecF qr = broadcast(qTile[r * hd + d]);
+#pragma GCC unroll 4
+      for (size_t b = 0; b < kAttnKeyVecs; b++) acc[r][b] = fma(qr, kv[b], acc[r][b]);
+    }
+  }
+#pragma GCC unroll 4
+  for (size_t r = 0; r < kAttnRows; r++) {
+#pragma GCC unroll 4
+    for (size_t b = 0; b < kAttnKeyVecs; b++) store(s + r * kAttnKeys + b * kLanes, acc[r][b]);
+  }
+}
+
+// Hide masked scores of a tile with -INFINITY; rows are the tile's valid rows
+void maskTile(const AttentionMask& mask, size_t i0, size_t rows, size_t j0, size_t n, ptrdiff_t diagonal,
+              float* s) {
+  for (size_t r = 0; r < rows; r++) {
+    float* sr = s + r * kAttnKeys;
+    size_t end = n;
+    if (mask.causal) {
+      const ptrdiff_t visible = static_cast<ptrdiff_t>(i0 + r) + diagonal + 1 - static_cast<ptrdiff_t>(j0);
+      end = static_cast<size_t>(std::max<ptrdiff_t>(0, std::min<ptrdiff_t>(visible, static_cast<ptrdiff_t>(n))));
+    }
+    if (mask.keys) {
+      for (size_t jj = 0; jj < end; jj++) sr[jj] = mask.keys[j0 + jj] ? sr[jj] : -INFINITY;
+    }
+    if (mask.bias) {
+      const float* bias = mask.bias + (i0 + r) * mask.ldb + j0;
+      for (size_t jj = 0; jj < end; jj++) sr[jj] += bias[jj];
+    }
+    for (size_t jj = end; jj < kAttnKeys; jj++) sr[jj] = -INFINITY;
+  }
+}
+
+/**
+ * Online softmax of one tile's scores into p: rescale each row's running
+ * sum l to the new running max m and add the block. alpha gets e^(m - m'),
+ * the factor the row's output accumulator must be scaled by.
+ */
+void softmaxTile(const float* s, size_t rows, bool masked, float* p, float* m, float* l, float* alpha) {
+  for (size_t r = 0; r < kAttnRows; r++) {
+    const float* sr = s + r * kAttnKeys;
+    float* pr = p + r * kAttnKeys;
+    VecF vmax = broadcast(-INFINITY);
+#pragma GCC unroll 4
+    for (size_t b = 0; b < kAttnKeyVecs; b++) vmax = max(vmax, load(sr + b * kLanes));
+    const float mNew = r < rows ? std::max(m[r], reduceMax(vmax)) : -INFINITY;
+    if (mNew == -INFINITY) {
+      // Padding row, or nothing visible yet: contributes nothing
+      for (size_t jj = 0; jj < kAttnKeys; jj++) pr[jj] = 0.0f;
+      alpha[r] = 1.0f;
+      continue;
+    }
+    const VecF vm = broadcast(mNew);
+#pragma GCC unroll 4
+    for (size_t b = 0; b < kAttnKeyVecs; b++) store(pr + b * kLanes, exp(sub(load(sr + b * kLanes), vm)));
+    if (masked) {
+      // exp() clamps its input, so hidden scores need an exact zero
+      for (size_t jj = 0; jj < kAttnKeys; jj++) pr[jj] = sr[jj] == -INFINITY ? 0.0f : pr[jj];
+    }
+    VecF vsum = zero();
+#pragma GCC unroll 4
+    for (size_t b = 0; b < kAttnKeyVecs; b++) vsum = add(vsum, load(pr + b * kLanes));
+    alpha[r] = std::exp(m[r] - mNew);
+    l[r] = l[r] * alpha[r] + reduceAdd(vsum);
+    m[r] = mNew;
+  }
+}
+
+// o[r] = o[r] * alpha[r] + sum_j p[r][j] v[j], j < n; o row stride ldo
+void accumulateTile(const float* p, size_t n, const float* v, size_t ldv, size_t hd, const float* alpha, float* o,
+                    size_t ldo) {
+  const size_t hdBody = hd / kLanes * kLanes;
+  size_t c = 0;
+  for (; c < hdBody; c += kLanes) {
+    VecF acc[kAttnRows];
+#pragma GCC unroll 4
+    for (size_t r = 0; r < kAttnRows; r++) acc[r] = mul(load(o + r * ldo + c), broadcast(alpha[r]));
+    for (size_t j = 0; j < n; j++) {
+      const VecF vj = load(v + j * ldv + c);
+#pragma GCC unroll 4
+      for (size_t r = 0; r < kAttnRows; r++) acc[r] = fma(broadcast(p[r * kAttnKeys + j]), vj, acc[r]);
+    }
+#pragma GCC unroll 4
+    for (size_t r = 0; r < kAttnRows; r++) store(o + r * ldo + c, acc[r]);
+  }
+  for (; c < hd; c++) {
+    for (size_t r = 0; r < kAttnRows; r++) {
+      float acc = o[r * ldo + c] * alpha[r];
+      for (size_t j = 0; j < n; j++) acc += p[r * kAttnKeys + j] * v[j * ldv + c];
+      o[r * ldo + c] = acc;
+    }
+  }
+}
+
+// One head of fusedAttention(); q, k, v and out point at the head's columns
+void attendHead(const float* q, size_t ldq, size_t queries, const float* k, size_t ldk, const float* v, size_t ldv,
+                size_t keys, size_t hd, float* out, size_t ldo, const AttentionMask& mask, float* scratch) {
+  const size_t keysPad = padAttnKeys(keys);
+  const size_t hdPad = padLanes(hd);
+  const float scale = 1.0f / std::sqrt(static_cast<float>(hd));
+  const ptrdiff_t diagonal = static_cast<ptrdiff_t>(keys) - static_cast<ptrdiff_t>(queries);
+  float* kT = scratch;                       // [hd][keysPad], zero past keys
+  float* qPanel = kT + hd * keysPad;         // [kAttnPanel][hd], pre-scaled, zero past queries
+  float* s = qPanel + kAttnPanel * hd;       // [kAttnRows][kAttnKeys]
+  float* p = s + kAttnRows * kAttnKeys;      // [kAttnRows][kAttnKeys]
+  float* o = p + kAttnRows * kAttnKeys;      // [kAttnPanel][hdPad], unnormalized output
+  float* m = o + kAttnPanel * hdPad;         // Running max per row
+  float* l = m + kAttnPanel;                 // Running sum per row
+  float* alpha = l + kAttnPanel;             // e^(m - m') of the current block
+
+  for (size_t d = 0; d < hd; d++) {
+    float* dst = kT + d * keysPad;
+    for (size_t j = 0; j < keys; j++) dst[j] = k[j * ldk + d];
+    for (size_t j = keys; j < keysPad; j++) dst[j] = 0.0f;
+  }
+
+  for (size_t p0 = 0; p0 < queries; p0 += kAttnPanel) {
+    const size_t panelRows = std::min(kAttnPanel, queries - p0);
+    const size_t tiles = (panelRows + kAttnRows - 1) / kAttnRows;
+    for (size_t r = 0; r < tiles * kAttnRows; r++) {
+      for (size_t d = 0; d < hd; d++) qPanel[r * hd + d] = r < panelRows ? q[(p0 + r) * ldq + d] * scale : 0.0f;
+      for (size_t c = 0; c < hdPad; c++) o[r * hdPad + c] = 0.0f;
+      m[r] = -INFINITY;
+      l[r] = 0.0f;
+    }
+
+    // Causal: keys past the panel's last diagonal are hidden from every row
+    size_t keyEnd = keys;
+    if (mask.causal) {
+      const ptrdiff_t last = static_cast<ptrdiff_t>(p0 + panelRows) + diagonal;
+      keyEnd = static_cast<size_t>(std::max<ptrdiff_t>(0, std::min<ptrdiff_t>(last, static_cast<ptrdiff_t>(keys))));
+    }
+
+    for (size_t j0 = 0; j0 < keyEnd; j0 += kAttnKeys) {
+      const size_t n = std::min(kAttnKeys, keys - j0);
+      for (size_t t = 0; t < tiles; t++) {
+        const size_t i0 = p0 + t * kAttnRows;
+        const size_t rows = std::min(kAttnRows, queries - i0);
+        const ptrdiff_t firstRowLast = static_cast<ptrdiff_t>(i0) + diagonal;  // Last key the tile's first row sees
+        if (mask.causal && static_cast<ptrdiff_t>(j0) > firstRowLast + static_cast<ptrdiff_t>(rows) - 1) {
+          continue;
+        }
+        const bool masked = n < kAttnKeys || mask.keys || mask.bias ||
+                            (mask.causal && static_cast<ptrdiff_t>(j0 + kAttnKeys - 1) > firstRowLast);
+        float* state = o + t * kAttnRows * hdPad;
+        scoreTile(qPanel + t * kAttnRows * hd, hd, kT + j0, keysPad, s);
+        if (masked) maskTile(mask, i0, rows, j0, n, diagonal, s);
+        softmaxTile(s, rows, masked, p, m + t * kAttnRows, l + t * kAttnRows, alpha + t * kAttnRows);
+        accumulateTile(p, n, v + j0 * ldv, ldv, hd, alpha + t * kAttnRows, state, hdPad);
+      }
+    }
+
+    for (size_t r = 0; r < panelRows; r++) {
+      const float inverse = l[r] > 0.0f ? 1.0f / l[r] : 0.0f;
+      float* dst = out + (p0 + r) * ldo;
+      for (size_t c = 0; c < hd; c++) dst[c] = o[r * hdPad + c] * inverse;
+    }
+  }
+}
+
+}  // namespace
+
+void addLayerNorm(float* x, size_t ldx, const float* delta, size_t ldd, size_t rows, size_t dim,
+                  const float* gamma, const float* beta, float eps) {
+  const size_t body = dim / kLanes * kLanes;
+  for (size_t r = 0; r < rows; r++) {
+    float* row = x + r * ldx;
+    const float* d = delta ? delta + r * ldd : nullptr;
+
+    // Pass 1: residual add and sum
+    VecF vsum = zero();
+    size_t i = 0;
+    for (; i < body; i += kLanes) {
+      VecF v = load(row + i);
+      if (d) {
+        v = add(v, load(d + i));
+        store(row + i, v);
+      }
+      vsum = add(vsum, v);
+    }
+    float sum = reduceAdd(vsum);
+    for (; i < dim; i++) {
+      if (d) row[i] += d[i];
+      sum += row[i];
+    }
+    const float mean = sum / static_cast<float>(dim);
+
+    // Pass 2: variance around the mean (two-pass, no cancellation)
+    const VecF vmean = broadcast(mean);
+    VecF vsq = zero();
+    for (i = 0; i < body; i += kLanes) {
+      const VecF c = sub(load(row + i), vmean);
+      vsq = fma(c, c, vsq);
+    }
+    float sq = reduceAdd(vsq);
+    for (; i < dim; i++) {
+      sq += (row[i] - mean) * (row[i] - mean);
+    }
+    const float inv = 1.0f / std::sqrt(sq / static_cast<float>(dim) + eps);
+
+    // Pass 3: normalize and apply the affine
+    const VecF vinv = broadcast(inv);
+    for (i = 0; i < body; i += kLanes) {
+      const VecF c = mul(sub(load(row + i), vmean), vinv);
+      store(row + i, fma(c, load(gamma + i), load(beta + i)));
+    }
+    for (; i < dim; i++) {
+      row[i] = (row[i] - mean) * inv * gamma[i] + beta[i];
+    }
+  }
+}
+
+size_t fusedAttentionScratchSize(size_t maxKeys, size_t headDim, size_t workers) {
+  return std::max<size_t>(workers, 1) * fusedWorkerFloats(maxKeys, headDim);
+}
+
+void fusedAttention(const float* q, size_t ldq, size_t queries, const float* k, size_t ldk, const float* v,
+                    size_t ldv, size_t keys, size_t heads, size_t headDim, float* out, size_t ldo, float* scratch,
+                    const AttentionMask& mask, const ParallelFor& parallel) {
+  const size_t perWorker = fusedWorkerFloats(keys, headDim);
+  auto head = [&](size_t h, size_t worker) {
+    const size_t col = h * headDim;
+    attendHead(q + col, ldq, queries, k + col, ldk, v + col, ldv, keys, headDim, out + col, ldo, mask,
+               scratch + worker * perWorker);
+  };
+  if (parallel && heads > 1) {
+    parallel(heads, head);
+  } else {
+    for (size_t h = 0; h < heads; h++) head(h, 0);
+  }
+}
+
+size_t attentionScratchSize(size_t maxSeq, size_t headDim) { return fusedAttentionScratchSize(maxSeq, headDim); }
+
+void attention(const float* qkv, size_t seq, size_t dModel, size_t heads, float* out, size_t ldo,
+               float* scratch) {
+  const size_t ld = 3 * dModel;
+  fusedAttention(qkv, ld, seq, qkv + dModel, ld, qkv + 2 * dModel, ld, seq, heads, dModel / heads, out, ldo,
+                 scratch);
+}
+
+size_t attentionQueriesScratchSize(size_t maxKeys) { return padLanes(maxKeys); }
+
+void attentionQueries(const float* q, size_t ldq, size_t queries, const float* kv, size_t ldkv, size_t keys,
+                      size_t dModel, size_t heads, float* out, size_t ldo, float* scratch) {
+  const size_t hd = dModel / heads;
+  const size_t hdBody = hd / kLanes * kLanes;
+  const float scale = 1.0f / std::sqrt(static_cast<float>(hd));
+
+  for (size_t i = 0; i < queries; i++) {
+    for (size_t h = 0; h < heads; h++) {
+      const float* qh = q + i * ldq + h * hd;
+      const float* k = kv + h * hd;
+      for (size_t j = 0; j < keys; j++) {
+        const float* kj = k + j * ldkv;
+        VecF acc = zero();
+        size_t c = 0;
+        for (; c < hdBody; c += kLanes) acc = fma(load(qh + c), load(kj + c), acc);
+        float dot = reduceAdd(acc);
+        for (; c < hd; c++) dot += qh[c] * kj[c];
+        scratch[j] = dot * scale;
+      }
+      const float sum = expScores(scratch, keys);
+      weightedSum(scratch, keys, kv + dModel + h * hd, ldkv, hd, 1.0f / sum, out + i * ldo + h * hd);
+    }
+  }
+}
+
+}  // namespace shoplifter
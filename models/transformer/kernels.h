@@ -0,0 +1,132 @@
+/**
+ * Encoder Kernels
+ *
+ * The non-GEMM parts of an encoder layer, vectorized with simd.h:
+ *
+ *   addLayerNorm()      x = LayerNorm(x + delta), the post-norm residual step
+ *   fusedAttention()    softmax(Q K^T / sqrt(dh) + mask) V for every head, tiled
+ *   attention()         fusedAttention() for unmasked self-attention over q | k | v rows
+ *   attentionQueries()  the same for a few queries over cached keys and values
+ *
+ * All buffers are row-major [rows][dim] with explicit row strides so the
+ * encoder can run them on slices of its workspace without copies.
+ *
+ * fusedAttention() never forms the [queries][keys] score matrix. Per head
+ * it walks blocks of 4 queries against blocks of 2-4 vector widths of keys
+ * (FlashAttention, sized for L1 instead of GPU shared memory):
+ *
+ *   S = Q_blk K_blk^T            register tile, K^T packed once per head
+ *   m' = max(m, rowmax S)        online softmax: running max and sum per row
+ *   P = exp(S - m'), l = l e^(m - m') + rowsum P
+ *   O = O e^(m - m') + P V_blk
+ *
+ * and writes O / l once at the end. Scratch is O(keys * dh) per worker and
+ * each output row is written once, instead of O(queries * keys) scores
+ * written and read back per head.
+ */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace shoplifter {
+
+constexpr float kLayerNormEps = 1e-5f;  // nn.LayerNorm default
+
+/**
+ * x[i] = (x[i] + delta[i] - mean) / sqrt(var + eps) * gamma + beta, per row
+ *
+ * @param x Rows to normalize in place, row stride ldx
+ * @param delta Residual branch to add first (row stride ldd), or nullptr
+ * @param gamma dim scales
+ * @param beta dim offsets
+ */
+void addLayerNorm(float* x, size_t ldx, const float* delta, size_t ldd, size_t rows, size_t dim,
+                  const float* gamma, const float* beta, float eps = kLayerNormEps);
+
+/**
+ * Runs fn(task, worker) for every task in [0, tasks) and returns when all are
+ * done, e.g. WorkStealingPool::parallelFor (inference/planner). worker must
+ * be below the worker count the scratch was sized for.
+ */
+using ParallelFor = std::function<void(size_t tasks, const std::function<void(size_t task, size_t worker)>& fn)>;
+
+/**
+ * Keys hidden from queries; the default hides none
+ *
+ * A query whose keys are all hidden gets a zero output row.
+ */
+struct AttentionMask {
+  bool causal = false;              // Query i sees keys j <= i + keys - queries (the last query sees all)
+  const uint8_t* keys = nullptr;    // [keys]: 0 hides the key from every query (padding, a dropped camera)
+  const float* bias = nullptr;      // [queries][ldb] added to the scaled scores; -INFINITY hides
+  size_t ldb = 0;
+};
+
+/**
+ * Scratch floats fusedAttention() needs for up to maxKeys keys
+ *
+ * @param workers Parallel workers that each get their own slice
+ */
+size_t fusedAttentionScratchSize(size_t maxKeys, size_t headDim, size_t workers = 1);
+
+/**
+ * Multi-head attention of queries over keys and values, fused and tiled
+ *
+ * Head h reads columns [h * headDim, (h + 1) * headDim) of q, k and v and
+ * writes the same columns of out. Self-attention passes one buffer of
+ * q | k | v rows three times; cross-attention (joint tokens over camera
+ * tokens) passes queries and keys of different lengths.
+ *
+ * @param q [queries] rows, stride ldq
+ * @param k [keys] rows, stride ldk
+ * @param v [keys] rows, stride ldv
+ * @param out [queries] rows, stride ldo; must not overlap q, k or v
+ * @param scratch fusedAttentionScratchSize(keys, headDim, workers) floats, 64-byte aligned
+ * @param parallel Runs the heads as tasks, or nullptr for the calling thread
+ */
+void fusedAttention(const float* q, size_t ldq, size_t queries, const float* k, size_t ldk, const float* v,
+                    size_t ldv, size_t keys, size_t heads, size_t headDim, float* out, size_t ldo, float* scratch,
+                    const AttentionMask& mask = {}, const ParallelFor& parallel = nullptr);
+
+/**
+ * Scratch floats attention() needs for a sequence of up to maxSeq and a head size of headDim
+ */
+size_t attentionScratchSize(size_t maxSeq, size_t headDim);
+
+/**
+ * Unmasked multi-head self-attention over projected Q, K and V
+ *
+ * @param qkv [seq][3 * dModel] rows laid out q | k | v, each split into
+ *            heads contiguous chunks of dModel / heads (nn.MultiheadAttention order)
+ * @param out [seq][dModel] concatenated head outputs, row stride ldo
+ * @param scratch attentionScratchSize(seq, dModel / heads) floats, 64-byte aligned
+ */
+void attention(const float* qkv, size_t seq, size_t dModel, size_t heads, float* out, size_t ldo,
+               float* scratch);
+
+/**
+ * Scratch floats attentionQueries() needs for up to maxKeys keys
+ */
+size_t attentionQueriesScratchSize(size_t maxKeys);
+
+/**
+ * Multi-head attention of a few query rows over a key/value cache
+ *
+ * Cheaper than attention() when only some rows changed: each query is a
+ * dot product per key and head, with no K^T copy.
+ *
+ * @param q [queries][dModel] query rows, stride ldq
+ * @param kv [keys] rows holding k at kv and v at kv + dModel, stride ldkv
+ * @param out [queries][dModel] head outputs, stride ldo
+ * @param scratch attentionQueriesScratchSize(keys) floats, 64-byte aligned
+ */
+void attentionQueries(const float* q, size_t ldq, size_t queries, const float* kv, size_t ldkv, size_t keys,
+                      size_t dModel, size_t heads, float* out, size_t ldo, float* scratch);
+
+}  // namespace shoplifter
+
+#endif // KERNELS_H
@@ -0,0 +1,167 @@
+/**
+ * Test-Time Neural Memory
+ */
+
+#include "models/transformer/neural_memory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace shoplifter {
+
+namespace {
+
+using namespace simd;
+
+constexpr float kNormEps = 1e-6f;
+
+float dot(const float* a, const float* b, size_t n) {
+  const size_t body = n / kFloatLanes * kFloatLanes;
+  VecF acc = zero();
+  size_t i = 0;
+  for (; i < body; i += kFloatLanes) acc = fma(load(a + i), load(b + i), acc);
+  float sum = reduceAdd(acc);
+  for (; i < n; i++) sum += a[i] * b[i];
+  return sum;
+}
+
+void normalize(float* x, size_t n) {
+  const float scale = 1.0f / std::max(std::sqrt(dot(x, x, n)), kNormEps);
+  for (size_t i = 0; i < n; i++) x[i] *= scale;
+}
+
+// s = eta * s + c * g;  w = keep * w + s  (one row of the fused memory update)
+void updateRow(float* w, float* s, const float* g, size_t n, float c, float eta, float keep) {
+  const size_t body = n / kFloatLanes * kFloatLanes;
+  const VecF vc = broadcast(c), veta = broadcast(eta), vkeep = broadcast(keep);
+  size_t i = 0;
+  for (; i < body; i += kFloatLanes) {
+    const VecF sv = fma(vc, load(g + i), mul(veta, load(s + i)));
+    store(s + i, sv);
+    store(w + i, fma(vkeep, load(w + i), sv));
+  }
+  for (; i < n; i++) {
+    s[i] = eta * s[i] + c * g[i];
+    w[i] = keep * w[i] + s[i];
+  }
+}
+
+// acc += c * x
+void axpy(float* acc, const float* x, size_t n, float c) {
+  const size_t body = n / kFloatLanes * kFloatLanes;
+  const VecF vc = broadcast(c);
+  size_t i = 0;
+  for (; i < body; i += kFloatLanes) store(acc + i, fma(vc, load(x + i), load(acc + i)));
+  for (; i < n; i++) acc[i] += c * x[i];
+}
+
+void loadMatrix(const TensorArchive& archive, const std::string& name, size_t rows, size_t cols,
+                simd::AlignedFloats& out) {
+  const Tensor& t = archive.require(name, TensorType::kFloat32, {rows, cols});
+  out.assign(t.floats(), t.floats() + t.count);
+}
+
+}  // namespace
+
+NeuralMemory::NeuralMemory(const TensorArchive& archive) {
+  const int64_t* v = archive.require("config", TensorType::kInt64, {4}).ints();
+  for (size_t i = 0; i < 4; i++) {
+    if (v[i] <= 0) {
+      throw std::runtime_error("Neural memory config in " + archive.path() + " has a non-positive entry");
+    }
+  }
+  config_.dim = static_cast<size_t>(v[0]);
+  config_.keyDim = static_cast<size_t>(v[1]);
+  config_.hidden = static_cast<size_t>(v[2]);
+  config_.valueDim = static_cast<size_t>(v[3]);
+  const float* hyper = archive.require("hyper", TensorType::kFloat32, {4}).floats();
+  options_.momentum = hyper[0];
+  options_.learningRate = hyper[1];
+  options_.forget = hyper[2];
+  options_.surpriseThreshold = hyper[3];
+
+  const NeuralMemoryConfig& c = config_;
+  loadLinear(archive, "key.weight", "", c.keyDim, c.dim, key_);
+  loadLinear(archive, "value.weight", "", c.valueDim, c.dim, value_);
+  loadLinear(archive, "query.weight", "", c.keyDim, c.dim, query_);
+  loadMatrix(archive, "memory.w1", c.hidden, c.keyDim, w1Init_);
+  loadMatrix(archive, "memory.w2", c.valueDim, c.hidden, w2Init_);
+
+  k_.assign(c.keyDim, 0.0f);
+  v_.assign(c.valueDim, 0.0f);
+  z_.assign(c.hidden, 0.0f);
+  a_.assign(c.hidden, 0.0f);
+  y_.assign(c.valueDim, 0.0f);
+  gradA_.assign(c.hidden, 0.0f);
+  reset();
+}
+
+void NeuralMemory::reset() {
+  w1_ = w1Init_;
+  w2_ = w2Init_;
+  s1_.assign(w1_.size(), 0.0f);
+  s2_.assign(w2_.size(), 0.0f);
+  writes_ = 0;
+}
+
+void NeuralMemory::memoryForward(const float* key) {
+  const NeuralMemoryConfig& c = config_;
+  for (size_t j = 0; j < c.hidden; j++) {
+    z_[j] = dot(&w1_[j * c.keyDim], key, c.keyDim);
+    a_[j] = z_[j] > 0.0f ? z_[j] : 0.0f;
+  }
+  for (size_t i = 0; i < c.valueDim; i++) {
+    y_[i] = dot(&w2_[i * c.hidden], a_.data(), c.hidden);
+  }
+}
+
+void NeuralMemory::read(const float* x, float* out) {
+  linear(x, 1, config_.dim, query_, k_.data(), config_.keyDim);
+  normalize(k_.data(), config_.keyDim);
+  memoryForward(k_.data());
+  std::memcpy(out, y_.data(), sizeof(float) * config_.valueDim);
+}
+
+float NeuralMemory::write(const float* x) {
+  const NeuralMemoryConfig& c = config_;
+  linear(x, 1, c.dim, key_, k_.data(), c.keyDim);
+  normalize(k_.data(), c.keyDim);
+  linear(x, 1, c.dim, value_, v_.data(), c.valueDim);
+  memoryForward(k_.data());
+
+  // y_ becomes the error M(k) - v
+  float loss = 0.0f;
+  for (size_t i = 0; i < c.valueDim; i++) {
+    y_[i] -= v_[i];
+    loss += y_[i] * y_[i];
+  }
+  loss *= 0.5f;
+  const float theta = loss >= options_.surpriseThreshold ? options_.learningRate : 0.0f;
+  writes_ += theta > 0.0f;
+  const float eta = options_.momentum;
+  const float keep = 1.0f - options_.forget;
+
+  // W2: grad = e a^T. Backpropagate e through each row before it changes.
+  std::fill(gradA_.begin(), gradA_.end(), 0.0f);
+  for (size_t i = 0; i < c.valueDim; i++) {
+    float* row = &w2_[i * c.hidden];
+    if (theta > 0.0f) axpy(gradA_.data(), row, c.hidden, y_[i]);
+    updateRow(row, &s2_[i * c.hidden], a_.data(), c.hidden, -theta * y_[i], eta, keep);
+  }
+  // W1: grad = (W2^T e * relu'(z)) k^T
+  for (size_t j = 0; j < c.hidden; j++) {
+    const float g = z_[j] > 0.0f ? gradA_[j] : 0.0f;
+    updateRow(&w1_[j * c.keyDim], &s1_[j * c.keyDim], k_.data(), c.keyDim, -theta * g, eta, keep);
+  }
+  return loss;
+}
+
+float NeuralMemory::step(const float* x, float* out) {
+  read(x, out);
+  return write(x);
+}
+
+}  // namespace shoplifter
@@ -0,0 +1,108 @@
+/**
+ * Test-Time Neural Memory
+ *
+ * Long-term memory in the style of Titans (research/titans-paper.pdf): a
+ * small MLP whose weights are the memory, written by gradient steps while
+ * the policy runs, so context from minutes ago survives without a longer
+ * attention window. Every tick, with x the newest embedding:
+ *
+ *   k = normalize(W_K x), v = W_V x, q = normalize(W_Q x)
+ *   M(k)  = W2 relu(W1 k)
+ *   loss  = 0.5 |M(k) - v|^2                  (surprise)
+ *   S     = eta * S - theta * grad loss       (momentum: past surprise)
+ *   W     = (1 - alpha) * W + S               (forgetting)
+ *   read  = M(q)
+ *
+ * The write is surprise-gated: ticks whose loss is below surpriseThreshold
+ * take no gradient step (theta = 0), so familiar input only decays the
+ * momentum and the weights. eta, theta and alpha are constants here, not
+ * the data-dependent gates of the paper.
+ *
+ * The gradient of each weight matrix is a rank-1 outer product, so the
+ * update is fused into one pass per matrix: for each row, accumulate the
+ * backpropagated error from the old row, then momentum and decay in place.
+ * Memory and per-tick cost are fixed by the memory size, however long the
+ * session runs.
+ */
+
+#ifndef NEURAL_MEMORY_H
+#define NEURAL_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "models/transformer/gemm.h"
+#include "models/transformer/simd.h"
+#include "models/transformer/tensor_archive.h"
+
+namespace shoplifter {
+
+struct NeuralMemoryConfig {
+  size_t dim = 0;          // Input embedding width
+  size_t keyDim = 0;
+  size_t hidden = 0;       // Memory MLP width
+  size_t valueDim = 0;     // Read width
+};
+
+struct NeuralMemoryOptions {
+  float momentum = 0.9f;           // eta
+  float learningRate = 0.01f;      // theta
+  float forget = 0.001f;           // alpha
+  float surpriseThreshold = 0.0f;  // no write below this loss
+};
+
+class NeuralMemory {
+ public:
+  /**
+   * Load projections, initial memory weights and hyperparameters
+   *
+   * @param archive Archive written by export_neural_memory.py (may be destroyed afterwards)
+   * @throws std::runtime_error if a tensor is missing or has the wrong shape
+   */
+  explicit NeuralMemory(const TensorArchive& archive);
+
+  const NeuralMemoryConfig& config() const { return config_; }
+  const NeuralMemoryOptions& options() const { return options_; }
+  void setOptions(const NeuralMemoryOptions& options) { options_ = options; }
+
+  // Back to the learned initial memory with no momentum, e.g. at session start
+  void reset();
+
+  /**
+   * Read the memory for x, then write x into it
+   *
+   * @param x dim values
+   * @param out valueDim values read before the write
+   * @return Surprise (loss) of x
+   */
+  float step(const float* x, float* out);
+
+  // Read only: out = M(normalize(W_Q x))
+  void read(const float* x, float* out);
+
+  // Write only; returns the surprise
+  float write(const float* x);
+
+  // Ticks whose surprise passed the threshold, since reset()
+  uint64_t writes() const { return writes_; }
+
+ private:
+  void memoryForward(const float* key);
+
+  NeuralMemoryConfig config_;
+  NeuralMemoryOptions options_;
+  PackedLinear key_;
+  PackedLinear value_;
+  PackedLinear query_;
+  simd::AlignedFloats w1Init_, w2Init_;
+  simd::AlignedFloats w1_, w2_;        // [hidden][keyDim], [valueDim][hidden]
+  simd::AlignedFloats s1_, s2_;        // momentum of each
+  uint64_t writes_ = 0;
+
+  // Per-tick workspace
+  simd::AlignedFloats k_, v_, z_, a_, y_, gradA_;
+};
+
+}  // namespace shoplifter
+
+#endif // NEURAL_MEMORY_H
@@ -0,0 +1,90 @@
+"""
+Titans-style neural long-term memory, written at test time.
+
+The memory is a two-layer MLP M(k) = W2 relu(W1 k). Every step it is read
+with a query and then written with a gradient step on the surprise
+0.5 |M(k) - v|^2, with momentum (eta) and forgetting (alpha):
+
+    S = eta * S - theta * grad,  W = (1 - alpha) * W + S
+
+Steps whose surprise is below `threshold` take no gradient step. The key,
+value and query projections and the initial memory weights are trained in
+the outer loop, through the unrolled updates. neural_memory.h runs the same
+recurrence natively; export_neural_memory.py writes this module to a tensor
+archive.
+
+Reference: Titans: Learning to Memorize at Test Time, https://arxiv.org/abs/2501.00663
+(research/titans-paper.pdf)
+
+Usage:
+    memory = NeuralMemory(dim=128, key_dim=64, hidden=128)
+    reads = memory(embeddings)          # [batch, seq, dim] -> [batch, seq, value_dim]
+"""
+
+from typing import Optional
+
+import torch
+from torch import nn
+
+
+class NeuralMemory(nn.Module):
+    """
+    Test-time-trained memory MLP.
+
+    Args:
+        dim: Input embedding width
+        key_dim: Key and query width
+        hidden: Memory MLP width
+        value_dim: Read width (defaults to dim)
+        momentum: eta, decay of past surprise
+        learning_rate: theta, step size on the momentary surprise
+        forget: alpha, weight decay per step
+        threshold: Surprise below which a step does not write
+    """
+
+    def __init__(self, dim: int, key_dim: int = 64, hidden: int = 128, value_dim: Optional[int] = None,
+                 momentum: float = 0.9, learning_rate: float = 0.01, forget: float = 0.001, threshold: float = 0.0):
+        super().__init__()
+        value_dim = value_dim or dim
+        self.key = nn.Linear(dim, key_dim, bias=False)
+        self.value = nn.Linear(dim, value_dim, bias=False)
+        self.query = nn.Linear(dim, key_dim, bias=False)
+        self.memory = nn.ParameterDict({
+            "w1": nn.Parameter(torch.randn(hidden, key_dim) / key_dim ** 0.5),
+            "w2": nn.Parameter(torch.randn(value_dim, hidden) / hidden ** 0.5),
+        })
+        self.hyper = (momentum, learning_rate, forget, threshold)
+
+    def forward(self, x: torch.Tensor) -> torch.Tensor:
+        """
+        Read then write every step of a sequence.
+
+        Args:
+            x: [batch, seq, dim]
+
+        Returns:
+            [batch, seq, value_dim] memory reads, each taken before that step's write
+        """
+        eta, theta, alpha, threshold = self.hyper
+        batch = x.shape[0]
+        w1 = self.memory["w1"].expand(batch, -1, -1)
+        w2 = self.memory["w2"].expand(batch, -1, -1)
+        s1 = torch.zeros_like(w1)
+        s2 = torch.zeros_like(w2)
+        k = nn.functional.normalize(self.key(x), dim=-1, eps=1e-6)
+        q = nn.functional.normalize(self.query(x), dim=-1, eps=1e-6)
+        v = self.value(x)
+
+        reads = []
+        for t in range(x.shape[1]):
+            reads.append(torch.einsum("bvh,bh->bv", w2, torch.relu(torch.einsum("bhk,bk->bh", w1, q[:, t]))))
+            z = torch.einsum("bhk,bk->bh", w1, k[:, t])
+            a = torch.relu(z)
+            e = torch.einsum("bvh,bh->bv", w2, a) - v[:, t]
+            gate = theta * (0.5 * (e * e).sum(-1) >= threshold).to(x.dtype)[:, None, None]
+            grad_z = torch.einsum("bvh,bv->bh", w2, e) * (z > 0).to(x.dtype)
+            s2 = eta * s2 - gate * torch.einsum("bv,bh->bvh", e, a)
+            s1 = eta * s1 - gate * torch.einsum("bh,bk->bhk", grad_z, k[:, t])
+            w2 = (1.0 - alpha) * w2 + s2
+            w1 = (1.0 - alpha) * w1 + s1
+        return torch.stack(reads, dim=1)
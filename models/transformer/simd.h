@@ -0,0 +1,340 @@
+/**
+ * SIMD Float Vectors
+ *
+ * Thin wrapper over the float vector registers of the build target, so the
+ * encoder kernels are written once:
+ *
+ *   AVX-512F         16 lanes
+ *   AVX2 + FMA        8 lanes
+ *   NEON (AArch64)    4 lanes
+ *   scalar            4 lanes, plain loops
+ *
+ * The target is chosen at compile time (-march=native on the edge box).
+ * exp() is a Cephes-style polynomial, accurate to a few ulp; inputs are
+ * clamped to [-87.3, 88.3], which is all softmax needs. sincos() is the
+ * Cephes pair of polynomials after reduction by multiples of pi/2. loadHalf() widens
+ * IEEE half-precision storage to a float vector (F16C / NEON when built
+ * for them).
+ */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <vector>
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace shoplifter {
+namespace simd {
+
+/**
+ * IEEE binary16 <-> float, round to nearest even (portable, for packing and fallbacks)
+ */
+inline float halfToFloat(uint16_t h) {
+  const uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+  const uint32_t exponent = (h >> 10) & 0x1Fu;
+  const uint32_t mantissa = h & 0x3FFu;
+  float magnitude;
+  if (exponent == 0) {
+    magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+  } else if (exponent == 31) {
+    magnitude = mantissa ? std::numeric_limits<float>::quiet_NaN() : std::numeric_limits<float>::infinity();
+  } else {
+    magnitude = std::ldexp(static_cast<float>(mantissa | 0x400u), static_cast<int>(exponent) - 25);
+  }
+  uint32_t bits;
+  __builtin_memcpy(&bits, &magnitude, sizeof(bits));
+  bits |= sign;
+  float out;
+  __builtin_memcpy(&out, &bits, sizeof(out));
+  return out;
+}
+
+inline uint16_t floatToHalf(float f) {
+  uint32_t bits;
+  __builtin_memcpy(&bits, &f, sizeof(bits));
+  const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+  const float a = std::fabs(f);
+  if (std::isnan(f)) return static_cast<uint16_t>(sign | 0x7E00u);
+  if (a >= 65520.0f) return static_cast<uint16_t>(sign | 0x7C00u);  // Rounds past the largest half
+  if (a < 6.103515625e-05f) {
+    // Subnormal: units of 2^-24, rounded to nearest even
+    return static_cast<uint16_t>(sign | static_cast<uint16_t>(std::nearbyint(std::ldexp(a, 24))));
+  }
+  int e;
+  const float m = std::frexp(a, &e);                     // a = m 2^e, m in [0.5, 1)
+  uint32_t mantissa = static_cast<uint32_t>(std::nearbyint(std::ldexp(m, 11)));  // 1024..2048
+  if (mantissa == 2048) {
+    mantissa = 1024;
+    e++;
+  }
+  return static_cast<uint16_t>(sign | static_cast<uint32_t>(e + 14) << 10 | (mantissa & 0x3FFu));
+}
+
+#if defined(__AVX512F__)
+
+constexpr size_t kFloatLanes = 16;
+constexpr const char* kTargetName = "avx512";
+
+struct VecF {
+  __m512 v;
+};
+
+inline VecF load(const float* p) { return {_mm512_loadu_ps(p)}; }
+inline VecF loadHalf(const uint16_t* p) {
+  return {_mm512_maskz_cvtph_ps(0xFFFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)))};
+}
+inline void store(float* p, VecF a) { _mm512_storeu_ps(p, a.v); }
+inline VecF broadcast(float x) { return {_mm512_set1_ps(x)}; }
+inline VecF zero() { return {_mm512_setzero_ps()}; }
+inline VecF add(VecF a, VecF b) { return {_mm512_add_ps(a.v, b.v)}; }
+inline VecF sub(VecF a, VecF b) { return {_mm512_sub_ps(a.v, b.v)}; }
+inline VecF mul(VecF a, VecF b) { return {_mm512_mul_ps(a.v, b.v)}; }
+inline VecF fma(VecF a, VecF b, VecF c) { return {_mm512_fmadd_ps(a.v, b.v, c.v)}; }
+inline VecF div(VecF a, VecF b) { return {_mm512_div_ps(a.v, b.v)}; }
+inline VecF sqrt(VecF a) { return {_mm512_mask_sqrt_ps(a.v, 0xFFFF, a.v)}; }
+// Masked forms: GCC 12 reports the unmasked ones' undefined source operand as uninitialized
+inline VecF max(VecF a, VecF b) { return {_mm512_mask_max_ps(a.v, 0xFFFF, a.v, b.v)}; }
+inline VecF min(VecF a, VecF b) { return {_mm512_mask_min_ps(a.v, 0xFFFF, a.v, b.v)}; }
+// Masked extract: GCC 12's _mm512_castps512_ps256 trips the same warning
+template <int kHalf>
+inline __m256 half(VecF a) {
+  return _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xF, _mm512_castps_pd(a.v), kHalf));
+}
+inline float reduceAdd(VecF a) {
+  const __m256 h = _mm256_add_ps(half<0>(a), half<1>(a));
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(h), _mm256_extractf128_ps(h, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+inline float reduceMax(VecF a) {
+  const __m256 h = _mm256_max_ps(half<0>(a), half<1>(a));
+  __m128 s = _mm_max_ps(_mm256_castps256_ps128(h), _mm256_extractf128_ps(h, 1));
+  s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_max_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+inline VecF roundNearest(VecF a) {
+  return {_mm512_mask_roundscale_ps(a.v, 0xFFFF, a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)};
+}
+// 2^n for integral n in [-126, 127]
+inline VecF pow2(VecF n) {
+  const __m512i e = _mm512_add_epi32(_mm512_maskz_cvtps_epi32(0xFFFF, n.v), _mm512_set1_epi32(127));
+  return {_mm512_castsi512_ps(_mm512_mask_slli_epi32(e, 0xFFFF, e, 23))};
+}
+
+#elif defined(__AVX2__) && defined(__FMA__)
+
+constexpr size_t kFloatLanes = 8;
+constexpr const char* kTargetName = "avx2";
+
+struct VecF {
+  __m256 v;
+};
+
+inline VecF load(const float* p) { return {_mm256_loadu_ps(p)}; }
+#if defined(__F16C__)
+inline VecF loadHalf(const uint16_t* p) { return {_mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)))}; }
+#else
+inline VecF loadHalf(const uint16_t* p) {
+  alignas(32) float f[8];
+  for (int i = 0; i < 8; i++) f[i] = halfToFloat(p[i]);
+  return {_mm256_load_ps(f)};
+}
+#endif
+inline void store(float* p, VecF a) { _mm256_storeu_ps(p, a.v); }
+inline VecF broadcast(float x) { return {_mm256_set1_ps(x)}; }
+inline VecF zero() { return {_mm256_setzero_ps()}; }
+inline VecF add(VecF a, VecF b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline VecF sub(VecF a, VecF b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline VecF mul(VecF a, VecF b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline VecF fma(VecF a, VecF b, VecF c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; }
+inline VecF div(VecF a, VecF b) { return {_mm256_div_ps(a.v, b.v)}; }
+inline VecF sqrt(VecF a) { return {_mm256_sqrt_ps(a.v)}; }
+inline VecF max(VecF a, VecF b) { return {_mm256_max_ps(a.v, b.v)}; }
+inline VecF min(VecF a, VecF b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline float reduceAdd(VecF a) {
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+inline float reduceMax(VecF a) {
+  __m128 s = _mm_max_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+  s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_max_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+inline VecF roundNearest(VecF a) { return {_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)}; }
+inline VecF pow2(VecF n) {
+  const __m256i e = _mm256_add_epi32(_mm256_cvtps_epi32(n.v), _mm256_set1_epi32(127));
+  return {_mm256_castsi256_ps(_mm256_slli_epi32(e, 23))};
+}
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+
+constexpr size_t kFloatLanes = 4;
+constexpr const char* kTargetName = "neon";
+
+struct VecF {
+  float32x4_t v;
+};
+
+inline VecF load(const float* p) { return {vld1q_f32(p)}; }
+inline VecF loadHalf(const uint16_t* p) { return {vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p)))}; }
+inline void store(float* p, VecF a) { vst1q_f32(p, a.v); }
+inline VecF broadcast(float x) { return {vdupq_n_f32(x)}; }
+inline VecF zero() { return {vdupq_n_f32(0.0f)}; }
+inline VecF add(VecF a, VecF b) { return {vaddq_f32(a.v, b.v)}; }
+inline VecF sub(VecF a, VecF b) { return {vsubq_f32(a.v, b.v)}; }
+inline VecF mul(VecF a, VecF b) { return {vmulq_f32(a.v, b.v)}; }
+inline VecF fma(VecF a, VecF b, VecF c) { return {vfmaq_f32(c.v, a.v, b.v)}; }
+inline VecF div(VecF a, VecF b) { return {vdivq_f32(a.v, b.v)}; }
+inline VecF sqrt(VecF a) { return {vsqrtq_f32(a.v)}; }
+inline VecF max(VecF a, VecF b) { return {vmaxq_f32(a.v, b.v)}; }
+inline VecF min(VecF a, VecF b) { return {vminq_f32(a.v, b.v)}; }
+inline float reduceAdd(VecF a) { return vaddvq_f32(a.v); }
+inline float reduceMax(VecF a) { return vmaxvq_f32(a.v); }
+inline VecF roundNearest(VecF a) { return {vrndnq_f32(a.v)}; }
+inline VecF pow2(VecF n) {
+  const int32x4_t e = vaddq_s32(vcvtq_s32_f32(n.v), vdupq_n_s32(127));
+  return {vreinterpretq_f32_s32(vshlq_n_s32(e, 23))};
+}
+
+#else
+
+constexpr size_t kFloatLanes = 4;
+constexpr const char* kTargetName = "scalar";
+
+struct VecF {
+  float v[4];
+};
+
+#define SIMD_SCALAR_OP(expr) \
+  VecF r;                    \
+  for (int i = 0; i < 4; i++) r.v[i] = (expr); \
+  return r
+
+inline VecF load(const float* p) { SIMD_SCALAR_OP(p[i]); }
+inline VecF loadHalf(const uint16_t* p) { SIMD_SCALAR_OP(halfToFloat(p[i])); }
+inline void store(float* p, VecF a) {
+  for (int i = 0; i < 4; i++) p[i] = a.v[i];
+}
+inline VecF broadcast(float x) { SIMD_SCALAR_OP(x); }
+inline VecF zero() { SIMD_SCALAR_OP(0.0f); }
+inline VecF add(VecF a, VecF b) { SIMD_SCALAR_OP(a.v[i] + b.v[i]); }
+inline VecF sub(VecF a, VecF b) { SIMD_SCALAR_OP(a.v[i] - b.v[i]); }
+inline VecF mul(VecF a, VecF b) { SIMD_SCALAR_OP(a.v[i] * b.v[i]); }
+inline VecF fma(VecF a, VecF b, VecF c) { SIMD_SCALAR_OP(a.v[i] * b.v[i] + c.v[i]); }
+inline VecF div(VecF a, VecF b) { SIMD_SCALAR_OP(a.v[i] / b.v[i]); }
+inline VecF sqrt(VecF a) { SIMD_SCALAR_OP(std::sqrt(a.v[i])); }
+inline VecF max(VecF a, VecF b) { SIMD_SCALAR_OP(a.v[i] > b.v[i] ? a.v[i] : b.v[i]); }
+inline VecF min(VecF a, VecF b) { SIMD_SCALAR_OP(a.v[i] < b.v[i] ? a.v[i] : b.v[i]); }
+inline float reduceAdd(VecF a) { return (a.v[0] + a.v[1]) + (a.v[2] + a.v[3]); }
+inline float reduceMax(VecF a) {
+  const float x = a.v[0] > a.v[1] ? a.v[0] : a.v[1];
+  const float y = a.v[2] > a.v[3] ? a.v[2] : a.v[3];
+  return x > y ? x : y;
+}
+inline VecF roundNearest(VecF a) { SIMD_SCALAR_OP(std::nearbyint(a.v[i])); }
+inline VecF pow2(VecF n) { SIMD_SCALAR_OP(std::ldexp(1.0f, static_cast<int>(n.v[i]))); }
+
+#undef SIMD_SCALAR_OP
+
+#endif
+
+/**
+ * e^x, lane-wise
+ */
+inline VecF exp(VecF x) {
+  x = min(max(x, broadcast(-87.3f)), broadcast(88.3f));
+  const VecF n = roundNearest(mul(x, broadcast(1.44269504088896341f)));
+  // r = x - n ln2, with ln2 split in two for precision
+  VecF r = fma(n, broadcast(-0.693359375f), x);
+  r = fma(n, broadcast(2.12194440e-4f), r);
+  VecF p = broadcast(1.9875691500e-4f);
+  p = fma(p, r, broadcast(1.3981999507e-3f));
+  p = fma(p, r, broadcast(8.3334519073e-3f));
+  p = fma(p, r, broadcast(4.1665795894e-2f));
+  p = fma(p, r, broadcast(1.6666665459e-1f));
+  p = fma(p, r, broadcast(5.0000001201e-1f));
+  p = fma(p, mul(r, r), add(r, broadcast(1.0f)));
+  return mul(p, pow2(n));
+}
+
+/**
+ * sin(x) and cos(x), lane-wise
+ *
+ * x is reduced to [-pi/4, pi/4] by the nearest multiple of pi/2 (three-part
+ * Cody-Waite); accurate to a few ulp for |x| up to about 1e4. The quadrant
+ * is picked with float arithmetic only, so every target shares the code.
+ */
+inline void sincos(VecF x, VecF& s, VecF& c) {
+  const VecF n = roundNearest(mul(x, broadcast(0.636619772367581343f)));
+  VecF r = fma(n, broadcast(-1.5703125f), x);
+  r = fma(n, broadcast(-4.837512969970703125e-4f), r);
+  r = fma(n, broadcast(-7.54978995489188216e-8f), r);
+  const VecF r2 = mul(r, r);
+  VecF ps = broadcast(-1.9515295891e-4f);
+  ps = fma(ps, r2, broadcast(8.3321608736e-3f));
+  ps = fma(ps, r2, broadcast(-1.6666654611e-1f));
+  ps = fma(mul(ps, r2), r, r);
+  VecF pc = broadcast(2.443315711809948e-5f);
+  pc = fma(pc, r2, broadcast(-1.388731625493765e-3f));
+  pc = fma(pc, r2, broadcast(4.166664568298827e-2f));
+  pc = fma(mul(pc, r2), r2, fma(r2, broadcast(-0.5f), broadcast(1.0f)));
+  // n mod 4 = 2 high + odd: odd swaps sin and cos, high negates both
+  const VecF k = roundNearest(mul(sub(n, broadcast(1.5f)), broadcast(0.25f)));
+  const VecF q = fma(k, broadcast(-4.0f), n);
+  const VecF high = roundNearest(mul(sub(q, broadcast(0.75f)), broadcast(0.5f)));
+  const VecF odd = fma(high, broadcast(-2.0f), q);
+  const VecF even = sub(broadcast(1.0f), odd);
+  const VecF sign = fma(high, broadcast(-2.0f), broadcast(1.0f));
+  s = mul(sign, fma(odd, pc, mul(even, ps)));
+  c = mul(sign, sub(mul(even, pc), mul(odd, ps)));
+}
+
+/**
+ * Allocator returning 64-byte aligned storage (one cache line, one AVX-512 register)
+ */
+template <typename T>
+struct AlignedAllocator {
+  using value_type = T;
+
+  AlignedAllocator() = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    void* p = nullptr;
+    if (n > std::numeric_limits<size_t>::max() / sizeof(T) || ::posix_memalign(&p, 64, n * sizeof(T)) != 0) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(p);
+  }
+  void deallocate(T* p, size_t) { std::free(p); }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U>&) const { return true; }
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+using AlignedFloats = std::vector<float, AlignedAllocator<float>>;
+using AlignedBytes = std::vector<uint8_t, AlignedAllocator<uint8_t>>;
+
+}  // namespace simd
+}  // namespace shoplifter
+
+#endif // SIMD_H
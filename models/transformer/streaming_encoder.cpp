@@ -0,0 +1,179 @@
+/**
+ * Streaming Sliding-Window Encoder
+ */
+
+#include "models/transformer/streaming_encoder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "models/transformer/kernels.h"
+
+namespace shoplifter {
+
+StreamingEncoder::StreamingEncoder(TransformerEncoder& encoder, size_t window, const StreamOptions& options)
+    : encoder_(encoder), window_(window), options_(options) {
+  const EncoderConfig& c = encoder.config();
+  if (window == 0 || window > c.maxSeq) {
+    throw std::invalid_argument("Streaming window " + std::to_string(window) + " is outside 1.." +
+                                std::to_string(c.maxSeq));
+  }
+  const size_t d = c.dModel;
+  output_.assign(window * d, 0.0f);
+
+  if (options_.mode == StreamMode::kExact) {
+    observations_.assign(window * c.inputDim, 0.0f);
+    ordered_.assign(window * c.inputDim, 0.0f);
+    return;
+  }
+
+  for (size_t i = 0; i < c.layers; i++) {
+    if (encoder.layerMixer(i) != TokenMixer::kAttention) {
+      throw std::invalid_argument("Bounded-staleness streaming needs attention in every layer");
+    }
+  }
+  projected_.assign(window * d, 0.0f);
+  qkv_.assign(c.layers, simd::AlignedFloats(window * 3 * d, 0.0f));
+  computedAt_.assign(window, 0);
+  batch_.reserve(window);
+  hidden_.assign(window * d, 0.0f);
+  batchQkv_.assign(window * 3 * d, 0.0f);
+  context_.assign(window * d, 0.0f);
+  branch_.assign(window * d, 0.0f);
+  ff_.assign(window * c.ffDim, 0.0f);
+  scratch_.assign(std::max(attentionScratchSize(window, d / c.heads), attentionQueriesScratchSize(window)), 0.0f);
+}
+
+void StreamingEncoder::reset() {
+  head_ = 0;
+  count_ = 0;
+  tick_ = 0;
+  lastComputed_ = 0;
+}
+
+void StreamingEncoder::push(const float* observation) {
+  const EncoderConfig& c = encoder_.config();
+  const size_t slot = head_;
+  head_ = (head_ + 1) % window_;
+  count_ = std::min(count_ + 1, window_);
+  tick_++;
+
+  if (options_.mode == StreamMode::kExact) {
+    std::memcpy(&observations_[slot * c.inputDim], observation, sizeof(float) * c.inputDim);
+    for (size_t p = 0; p < count_; p++) {
+      std::memcpy(&ordered_[p * c.inputDim], &observations_[slotAt(p) * c.inputDim], sizeof(float) * c.inputDim);
+    }
+    encoder_.encode(ordered_.data(), count_, output_.data());
+    lastComputed_ = count_;
+    return;
+  }
+
+  linear(observation, 1, c.inputDim, encoder_.inputProj_, &projected_[slot * c.dModel], c.dModel);
+  if (options_.fullRefreshEvery && tick_ % options_.fullRefreshEvery == 0) {
+    recomputeAll();
+    return;
+  }
+
+  // The new token, then the stalest cached ones (oldest position first on ties)
+  batch_.clear();
+  batch_.push_back(static_cast<uint32_t>(slot));
+  const size_t refresh = std::min(options_.refreshPerTick, count_ - 1);
+  for (size_t r = 0; r < refresh; r++) {
+    size_t best = window_;
+    for (size_t p = 0; p + 1 < count_; p++) {
+      const size_t s = slotAt(p);
+      if (std::find(batch_.begin(), batch_.end(), s) == batch_.end() &&
+          (best == window_ || computedAt_[s] < computedAt_[best])) {
+        best = s;
+      }
+    }
+    batch_.push_back(static_cast<uint32_t>(best));
+  }
+  recompute(batch_);
+}
+
+void StreamingEncoder::recomputeAll() {
+  batch_.clear();
+  for (size_t s = 0; s < count_; s++) {
+    batch_.push_back(static_cast<uint32_t>(s));
+  }
+  recompute(batch_);
+}
+
+void StreamingEncoder::recompute(const std::vector<uint32_t>& slots) {
+  const EncoderConfig& c = encoder_.config();
+  const size_t d = c.dModel;
+  const size_t n = slots.size();
+  // Every occupied slot in slot order: layer outputs go straight into the caches
+  const bool all = n == count_ && std::is_sorted(slots.begin(), slots.end());
+
+  for (size_t b = 0; b < n; b++) {
+    std::memcpy(&hidden_[b * d], &projected_[slots[b] * d], sizeof(float) * d);
+  }
+  for (size_t b = 0; b < n; b++) {
+    addLayerNorm(&hidden_[b * d], d, &encoder_.position_[positionOf(slots[b]) * d], d, 1, d,
+                 encoder_.embedNormWeight_.data(), encoder_.embedNormBias_.data());
+  }
+
+  for (size_t l = 0; l < c.layers; l++) {
+    const TransformerEncoder::Layer& layer = encoder_.layers_[l];
+    float* cache = qkv_[l].data();
+    if (all) {
+      linear(hidden_.data(), n, d, layer.inProj, cache, 3 * d);
+      attention(cache, n, d, c.heads, context_.data(), d, scratch_.data());
+    } else {
+      linear(hidden_.data(), n, d, layer.inProj, batchQkv_.data(), 3 * d);
+      for (size_t b = 0; b < n; b++) {
+        std::memcpy(cache + slots[b] * 3 * d, &batchQkv_[b * 3 * d], sizeof(float) * 3 * d);
+      }
+      attentionQueries(batchQkv_.data(), 3 * d, n, cache + d, 3 * d, count_, d, c.heads, context_.data(), d,
+                       scratch_.data());
+    }
+    linear(context_.data(), n, d, layer.outProj, branch_.data(), d);
+    addLayerNorm(hidden_.data(), d, branch_.data(), d, n, d, layer.norm1Weight.data(), layer.norm1Bias.data());
+    linear(hidden_.data(), n, d, layer.ff1, ff_.data(), c.ffDim, Activation::kRelu);
+    linear(ff_.data(), n, c.ffDim, layer.ff2, branch_.data(), d);
+    addLayerNorm(hidden_.data(), d, branch_.data(), d, n, d, layer.norm2Weight.data(), layer.norm2Bias.data());
+  }
+
+  for (size_t b = 0; b < n; b++) {
+    std::memcpy(&output_[slots[b] * d], &hidden_[b * d], sizeof(float) * d);
+    computedAt_[slots[b]] = tick_;
+  }
+  lastComputed_ = n;
+}
+
+const float* StreamingEncoder::latest() const {
+  const size_t d = encoder_.config().dModel;
+  if (options_.mode == StreamMode::kExact) {
+    return &output_[(count_ ? count_ - 1 : 0) * d];
+  }
+  return &output_[slotAt(count_ ? count_ - 1 : 0) * d];
+}
+
+void StreamingEncoder::copyWindow(float* out) const {
+  const size_t d = encoder_.config().dModel;
+  if (options_.mode == StreamMode::kExact) {
+    std::memcpy(out, output_.data(), sizeof(float) * count_ * d);
+    return;
+  }
+  for (size_t p = 0; p < count_; p++) {
+    std::memcpy(out + p * d, &output_[slotAt(p) * d], sizeof(float) * d);
+  }
+}
+
+uint64_t StreamingEncoder::maxStaleness() const {
+  if (options_.mode == StreamMode::kExact || count_ == 0) {
+    return 0;
+  }
+  uint64_t oldest = std::numeric_limits<uint64_t>::max();
+  for (size_t p = 0; p < count_; p++) {
+    oldest = std::min(oldest, computedAt_[slotAt(p)]);
+  }
+  return tick_ - oldest;
+}
+
+}  // namespace shoplifter
@@ -0,0 +1,121 @@
+/**
+ * Streaming Sliding-Window Encoder
+ *
+ * Runs the encoder over the last `window` observations once per control
+ * tick, as a new observation arrives and the oldest drops out.
+ *
+ * With bidirectional attention and absolute positions, a new token shifts
+ * every position and changes every output, so an exact update is a full
+ * pass over the window (StreamMode::kExact).
+ *
+ * StreamMode::kBoundedStaleness keeps, per layer, the q | k | v rows of
+ * every token in a ring buffer and each tick only runs
+ *
+ *   - the new token, attending over the cached keys and values, and
+ *   - refreshPerTick cached tokens, stalest first,
+ *
+ * through the layers (as one small batch). Older tokens keep the states they
+ * were last computed with, so no cached row is more than about
+ * (window - 1) / refreshPerTick ticks old; fullRefreshEvery adds a periodic
+ * exact pass. Per-tick cost scales with 1 + refreshPerTick tokens instead of
+ * the window. Attention is permutation invariant, so rows stay in ring order
+ * and only the position embedding needs the window order.
+ */
+
+#ifndef STREAMING_ENCODER_H
+#define STREAMING_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "models/transformer/encoder.h"
+#include "models/transformer/simd.h"
+
+namespace shoplifter {
+
+enum class StreamMode : uint8_t {
+  kExact = 0,
+  kBoundedStaleness = 1,
+};
+
+struct StreamOptions {
+  StreamMode mode = StreamMode::kExact;
+  size_t refreshPerTick = 2;     // kBoundedStaleness: cached tokens recomputed per push
+  size_t fullRefreshEvery = 0;   // kBoundedStaleness: exact pass every N pushes (0 = never)
+};
+
+class StreamingEncoder {
+ public:
+  /**
+   * @param encoder Loaded encoder; must outlive this object
+   * @param window Observations kept, 1..maxSeq
+   * @throws std::invalid_argument if the window is out of range, or
+   *         kBoundedStaleness is asked of an encoder with FFT mixer layers
+   *         (their output depends on token order)
+   */
+  StreamingEncoder(TransformerEncoder& encoder, size_t window, const StreamOptions& options = StreamOptions());
+
+  StreamingEncoder(const StreamingEncoder&) = delete;
+  StreamingEncoder& operator=(const StreamingEncoder&) = delete;
+
+  /**
+   * Append an observation (inputDim values), dropping the oldest if the window is full
+   */
+  void push(const float* observation);
+
+  void reset();
+
+  size_t size() const { return count_; }
+  size_t window() const { return window_; }
+
+  // Embedding of the newest observation (dModel values); valid after a push
+  const float* latest() const;
+
+  /**
+   * Copy the window's embeddings, oldest first
+   *
+   * @param out size() x dModel values
+   */
+  void copyWindow(float* out) const;
+
+  // Pushes since the stalest cached row was computed (0 in exact mode)
+  uint64_t maxStaleness() const;
+
+  // Token-layer passes run by the last push (window size for a full pass)
+  size_t lastTokensComputed() const { return lastComputed_; }
+
+ private:
+  size_t slotAt(size_t position) const { return (head_ + window_ - count_ + position) % window_; }
+  size_t positionOf(size_t slot) const { return (slot + window_ - (head_ + window_ - count_) % window_) % window_; }
+  void recomputeAll();
+  void recompute(const std::vector<uint32_t>& slots);
+
+  TransformerEncoder& encoder_;
+  size_t window_;
+  StreamOptions options_;
+  size_t head_ = 0;                    // Next slot to write
+  size_t count_ = 0;
+  uint64_t tick_ = 0;
+  size_t lastComputed_ = 0;
+
+  simd::AlignedFloats observations_;   // [window][inputDim] ring (exact mode)
+  simd::AlignedFloats ordered_;        // [window][inputDim] window order (exact mode)
+  simd::AlignedFloats projected_;      // [window][d] input_proj per slot, reusable exactly
+  std::vector<simd::AlignedFloats> qkv_;  // Per layer [window][3d]
+  simd::AlignedFloats output_;         // [window][d] per slot (window order in exact mode)
+  std::vector<uint64_t> computedAt_;   // Tick each slot was last computed
+
+  // Batch workspace
+  std::vector<uint32_t> batch_;
+  simd::AlignedFloats hidden_;         // [window][d]
+  simd::AlignedFloats batchQkv_;       // [window][3d]
+  simd::AlignedFloats context_;        // [window][d]
+  simd::AlignedFloats branch_;         // [window][d]
+  simd::AlignedFloats ff_;             // [window][ff]
+  simd::AlignedFloats scratch_;
+};
+
+}  // namespace shoplifter
+
+#endif // STREAMING_ENCODER_H
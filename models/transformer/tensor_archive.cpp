@@ -0,0 +1,117 @@
+/**
+ * Tensor Archive
+ */
+
+#include "models/transformer/tensor_archive.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace shoplifter {
+
+namespace {
+
+size_t dtypeSize(uint32_t dtype) {
+  switch (static_cast<TensorType>(dtype)) {
+    case TensorType::kFloat32: return 4;
+    case TensorType::kInt64: return 8;
+  }
+  return 0;
+}
+
+std::string shapeString(const std::vector<size_t>& shape) {
+  std::string s = "[";
+  for (size_t i = 0; i < shape.size(); i++) {
+    s += (i ? ", " : "") + std::to_string(shape[i]);
+  }
+  return s + "]";
+}
+
+}  // namespace
+
+TensorArchive::TensorArchive(const std::string& path) : path_(path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open tensor archive " + path + ": " + std::strerror(errno));
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    const int err = errno;
+    ::close(fd);
+    throw std::runtime_error("Cannot stat tensor archive " + path + ": " + std::strerror(err));
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ < sizeof(TensorArchiveHeader)) {
+    ::close(fd);
+    throw std::runtime_error("Tensor archive " + path + " is too short");
+  }
+  void* base = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  const int err = errno;
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    throw std::runtime_error("Cannot map tensor archive " + path + ": " + std::strerror(err));
+  }
+  const size_t size = size_;
+  mapping_ = std::shared_ptr<const void>(base, [size](const void* p) { ::munmap(const_cast<void*>(p), size); });
+  const uint8_t* bytes = static_cast<const uint8_t*>(base);
+
+  TensorArchiveHeader header;
+  std::memcpy(&header, bytes, sizeof(header));
+  if (std::memcmp(header.magic, kTensorArchiveMagic, sizeof(header.magic)) != 0 ||
+      header.version != kTensorArchiveVersion || header.headerSize != kTensorArchiveHeaderSize ||
+      header.recordSize != kTensorRecordSize ||
+      size_ < kTensorArchiveHeaderSize + static_cast<size_t>(header.recordCount) * kTensorRecordSize) {
+    throw std::runtime_error("Tensor archive " + path + " has an invalid header");
+  }
+
+  for (uint32_t i = 0; i < header.recordCount; i++) {
+    TensorRecord record;
+    std::memcpy(&record, bytes + kTensorArchiveHeaderSize + i * kTensorRecordSize, sizeof(record));
+    const std::string name(record.name, strnlen(record.name, kTensorNameLength));
+    const size_t elementSize = dtypeSize(record.dtype);
+    if (name.empty() || name.size() == kTensorNameLength || elementSize == 0 || record.ndim > kTensorMaxDims ||
+        record.offset % 64 != 0) {
+      throw std::runtime_error("Tensor archive " + path + " has an invalid record " + std::to_string(i));
+    }
+
+    Tensor tensor;
+    tensor.dtype = static_cast<TensorType>(record.dtype);
+    tensor.count = 1;
+    for (uint32_t d = 0; d < record.ndim; d++) {
+      tensor.shape.push_back(static_cast<size_t>(record.shape[d]));
+      tensor.count *= tensor.shape.back();
+    }
+    if (record.offset > size_ || tensor.count > (size_ - record.offset) / elementSize) {
+      throw std::runtime_error("Tensor " + name + " runs past the end of " + path);
+    }
+    tensor.data = bytes + record.offset;
+    if (!tensors_.emplace(name, std::move(tensor)).second) {
+      throw std::runtime_error("Tensor archive " + path + " has a duplicate tensor " + name);
+    }
+  }
+}
+
+const Tensor& TensorArchive::require(const std::string& name, TensorType dtype,
+                                     const std::vector<size_t>& shape) const {
+  const auto it = tensors_.find(name);
+  if (it == tensors_.end()) {
+    throw std::runtime_error("Tensor archive " + path_ + " has no tensor " + name);
+  }
+  const Tensor& tensor = it->second;
+  if (tensor.dtype != dtype) {
+    throw std::runtime_error("Tensor " + name + " in " + path_ + " has the wrong dtype");
+  }
+  if (!shape.empty() && tensor.shape != shape) {
+    throw std::runtime_error("Tensor " + name + " in " + path_ + " has shape " + shapeString(tensor.shape) +
+                             ", expected " + shapeString(shape));
+  }
+  return tensor;
+}
+
+}  // namespace shoplifter
@@ -0,0 +1,114 @@
+/**
+ * Tensor Archive
+ *
+ * Named tensors exported from PyTorch by export_weights.py:
+ *
+ *   64-byte header   magic "SLTENSOR", version, record count
+ *   records          128 bytes each: name, dtype, shape, data offset
+ *   data             one little-endian array per tensor, 64-byte aligned
+ *
+ * Names are the state_dict keys ("layers.0.attn.in_proj_weight"), so the
+ * C++ side looks weights up exactly as the PyTorch module stores them.
+ *
+ * The file is memory-mapped read-only and tensors point straight into the
+ * mapping. Opening an archive costs a parse of the records, and weights
+ * are paged in on first use. Processes that map the same file share the
+ * page-cache pages. Writers must replace the file by rename (as
+ * write_archive() in export_weights.py does), never rewrite it in place:
+ * a running process keeps the old inode until it reopens the archive.
+ */
+
+#ifndef TENSOR_ARCHIVE_H
+#define TENSOR_ARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace shoplifter {
+
+constexpr char kTensorArchiveMagic[8] = {'S', 'L', 'T', 'E', 'N', 'S', 'O', 'R'};
+constexpr uint32_t kTensorArchiveVersion = 1;
+constexpr size_t kTensorArchiveHeaderSize = 64;
+constexpr size_t kTensorRecordSize = 128;
+constexpr size_t kTensorNameLength = 80;
+constexpr size_t kTensorMaxDims = 4;
+
+enum class TensorType : uint32_t {
+  kFloat32 = 1,
+  kInt64 = 2,
+};
+
+struct TensorArchiveHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint32_t recordCount;
+  uint32_t recordSize;
+  uint8_t reserved[40];
+};
+
+struct TensorRecord {
+  char name[kTensorNameLength];      // NUL-terminated
+  uint32_t dtype;                    // TensorType
+  uint32_t ndim;
+  uint64_t shape[kTensorMaxDims];
+  uint64_t offset;                   // From the start of the file
+};
+
+static_assert(sizeof(TensorArchiveHeader) == kTensorArchiveHeaderSize, "Archive header must be 64 bytes");
+static_assert(sizeof(TensorRecord) == kTensorRecordSize, "Tensor record must be 128 bytes");
+
+struct Tensor {
+  TensorType dtype = TensorType::kFloat32;
+  std::vector<size_t> shape;
+  size_t count = 0;                  // Product of shape
+  const void* data = nullptr;        // Into the mapping, 64-byte aligned
+
+  const float* floats() const { return static_cast<const float*>(data); }
+  const int64_t* ints() const { return static_cast<const int64_t*>(data); }
+};
+
+class TensorArchive {
+ public:
+  /**
+   * Map an archive
+   *
+   * @throws std::runtime_error if the file cannot be mapped or is malformed
+   */
+  explicit TensorArchive(const std::string& path);
+
+  TensorArchive(const TensorArchive&) = delete;
+  TensorArchive& operator=(const TensorArchive&) = delete;
+
+  const std::string& path() const { return path_; }
+  bool contains(const std::string& name) const { return tensors_.count(name) != 0; }
+
+  /**
+   * Look up a tensor and check its type and shape
+   *
+   * @param shape Expected shape; empty to accept any
+   * @throws std::runtime_error if the tensor is missing or does not match
+   */
+  const Tensor& require(const std::string& name, TensorType dtype, const std::vector<size_t>& shape = {}) const;
+
+  /**
+   * The mapping behind every Tensor::data
+   *
+   * Holding a copy keeps tensor data valid after the archive is destroyed.
+   */
+  const std::shared_ptr<const void>& storage() const { return mapping_; }
+
+ private:
+  std::string path_;
+  std::shared_ptr<const void> mapping_;
+  size_t size_ = 0;
+  std::unordered_map<std::string, Tensor> tensors_;
+};
+
+}  // namespace shoplifter
+
+#endif // TENSOR_ARCHIVE_H
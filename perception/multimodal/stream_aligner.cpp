@@ -0,0 +1,410 @@
+/**
+ * Multi-Stream Time Alignment
+ */
+
+#include "perception/multimodal/stream_aligner.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "training/data/episode_reader.h"
+#include "training/data/frame_log.h"
+
+namespace shoplifter {
+
+namespace detail {
+
+namespace {
+
+void copySample(const double* const* channels, size_t count, size_t i, double* out) {
+  for (size_t c = 0; c < count; c++) {
+    out[c] = channels[c][i];
+  }
+}
+
+/**
+ * Evaluate at time t given the left neighbour i (-1 if t precedes every sample)
+ */
+uint8_t evaluateAt(const AlignStreamConfig& config, const double* times, size_t n,
+                   const double* const* channels, double t, ptrdiff_t i, double* out, int64_t& index) {
+  const size_t count = config.channels;
+  if (n == 0) {
+    std::fill(out, out + count, NAN);
+    index = -1;
+    return kAlignMissing;
+  }
+
+  // Outside the recorded range: hold the edge sample
+  if (i < 0 || static_cast<size_t>(i) >= n - 1) {
+    const size_t edge = i < 0 ? 0 : n - 1;
+    copySample(channels, count, edge, out);
+    index = static_cast<int64_t>(edge);
+    uint8_t flags = t == times[edge] ? 0 : kAlignOutOfRange;
+    if (std::fabs(t - times[edge]) > config.maxGap) {
+      flags |= kAlignGap;
+    }
+    return flags;
+  }
+
+  const size_t l = static_cast<size_t>(i);
+  const double dt = times[l + 1] - times[l];
+  const double w = (t - times[l]) / dt;
+
+  if (config.mode == AlignMode::kNearest) {
+    const size_t k = w <= 0.5 ? l : l + 1;
+    copySample(channels, count, k, out);
+    index = static_cast<int64_t>(k);
+    return std::fabs(times[k] - t) > config.maxGap ? kAlignGap : 0;
+  }
+
+  index = static_cast<int64_t>(l);
+  const uint8_t flags = dt > config.maxGap ? kAlignGap : 0;
+  if (config.mode == AlignMode::kLinear) {
+    for (size_t c = 0; c < count; c++) {
+      const double* v = channels[c];
+      out[c] = v[l] + w * (v[l + 1] - v[l]);
+    }
+    return flags;
+  }
+
+  // Cubic Hermite with finite-difference tangents (one-sided at the ends)
+  const double w2 = w * w;
+  const double w3 = w2 * w;
+  const double h00 = 2 * w3 - 3 * w2 + 1;
+  const double h10 = w3 - 2 * w2 + w;
+  const double h01 = -2 * w3 + 3 * w2;
+  const double h11 = w3 - w2;
+  for (size_t c = 0; c < count; c++) {
+    const double* v = channels[c];
+    const double secant = (v[l + 1] - v[l]) / dt;
+    const double m0 = l > 0 ? (v[l + 1] - v[l - 1]) / (times[l + 1] - times[l - 1]) : secant;
+    const double m1 = l + 2 < n ? (v[l + 2] - v[l]) / (times[l + 2] - times[l]) : secant;
+    out[c] = h00 * v[l] + h10 * dt * m0 + h01 * v[l + 1] + h11 * dt * m1;
+  }
+  return flags;
+}
+
+}  // namespace
+
+uint8_t evaluateStream(const AlignStreamConfig& config, const double* times, size_t n,
+                       const double* const* channels, double t, double* out, int64_t& index) {
+  const ptrdiff_t i = std::upper_bound(times, times + n, t) - times - 1;
+  return evaluateAt(config, times, n, channels, t, i, out, index);
+}
+
+void interpolateLinear(const double* v, const uint32_t* left, const double* w, size_t count, double* out) {
+  size_t j = 0;
+#if defined(__AVX2__)
+  for (; j + 4 <= count; j += 4) {
+    const __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + j));
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    const __m256d a = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), v, idx, all, 8);
+    const __m256d b = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), v + 1, idx, all, 8);
+    const __m256d weight = _mm256_loadu_pd(w + j);
+    _mm256_storeu_pd(out + j, _mm256_add_pd(a, _mm256_mul_pd(weight, _mm256_sub_pd(b, a))));
+  }
+#endif
+  for (; j < count; j++) {
+    const double a = v[left[j]];
+    const double b = v[left[j] + 1];
+    out[j] = a + w[j] * (b - a);
+  }
+}
+
+}  // namespace detail
+
+StreamSeries OwnedSeries::view() const {
+  StreamSeries series;
+  series.times = Span<const double>(times.data(), times.size());
+  for (const auto& c : channels) {
+    series.channels.emplace_back(c.data(), c.size());
+  }
+  return series;
+}
+
+bool commonTimeRange(const std::vector<AlignStreamConfig>& configs, const std::vector<StreamSeries>& series,
+                     double& start, double& end) {
+  start = -INFINITY;
+  end = INFINITY;
+  for (size_t s = 0; s < series.size() && s < configs.size(); s++) {
+    const Span<const double>& t = series[s].times;
+    if (t.empty()) {
+      continue;
+    }
+    start = std::max(start, t[0] + configs[s].clockOffset);
+    end = std::min(end, t[t.size - 1] + configs[s].clockOffset);
+  }
+  return std::isfinite(start) && std::isfinite(end) && start <= end;
+}
+
+void alignOffline(const std::vector<AlignStreamConfig>& configs, const std::vector<StreamSeries>& series,
+                  double start, double period, size_t count, AlignedTable& out) {
+  if (configs.size() != series.size()) {
+    throw std::runtime_error("alignOffline: one series per stream config is required");
+  }
+  out.time.resize(count);
+  for (size_t j = 0; j < count; j++) {
+    out.time[j] = start + static_cast<double>(j) * period;
+  }
+  out.values.resize(configs.size());
+  out.sampleIndex.resize(configs.size());
+  out.flags.resize(configs.size());
+
+  std::vector<uint32_t> left(count);
+  std::vector<double> weight(count);
+  std::vector<double> grid(count);
+  std::vector<double> sample;
+
+  for (size_t s = 0; s < configs.size(); s++) {
+    const AlignStreamConfig& config = configs[s];
+    const StreamSeries& in = series[s];
+    if (in.channels.size() != config.channels) {
+      throw std::runtime_error("alignOffline: stream " + config.name + " has the wrong channel count");
+    }
+    for (const auto& c : in.channels) {
+      if (c.size != in.times.size) {
+        throw std::runtime_error("alignOffline: stream " + config.name + " has ragged channels");
+      }
+    }
+
+    const size_t n = in.times.size;
+    const size_t channels = config.channels;
+    std::vector<double>& values = out.values[s];
+    std::vector<int64_t>& index = out.sampleIndex[s];
+    std::vector<uint8_t>& flags = out.flags[s];
+    values.assign(channels * count, NAN);
+    index.resize(count);
+    flags.resize(count);
+
+    std::vector<const double*> channelPtrs(channels);
+    for (size_t c = 0; c < channels; c++) {
+      channelPtrs[c] = in.channels[c].data;
+    }
+    for (size_t j = 0; j < count; j++) {
+      grid[j] = out.time[j] - config.clockOffset;
+    }
+
+    // The grid is sorted, so neighbours come from one merge walk
+    const double* times = in.times.data;
+    const bool vectorLinear = config.mode == AlignMode::kLinear && n >= 2 && n <= UINT32_MAX;
+    AlignStreamConfig meta = config;
+    if (vectorLinear) {
+      meta.channels = 0;   // flags and indices only; values come from interpolateLinear()
+    }
+    sample.resize(channels);
+    size_t i = 0;
+    for (size_t j = 0; j < count; j++) {
+      const double g = grid[j];
+      while (i < n && times[i] <= g) {
+        i++;
+      }
+      const ptrdiff_t l = static_cast<ptrdiff_t>(i) - 1;
+      flags[j] = detail::evaluateAt(meta, times, n, channelPtrs.data(), g, l, sample.data(), index[j]);
+      if (vectorLinear) {
+        // Clamp so that held edge values fall out of the same kernel
+        if (l < 0) {
+          left[j] = 0;
+          weight[j] = 0.0;
+        } else if (static_cast<size_t>(l) >= n - 1) {
+          left[j] = static_cast<uint32_t>(n - 2);
+          weight[j] = 1.0;
+        } else {
+          left[j] = static_cast<uint32_t>(l);
+          weight[j] = (g - times[l]) / (times[l + 1] - times[l]);
+        }
+      } else {
+        for (size_t c = 0; c < channels; c++) {
+          values[c * count + j] = sample[c];
+        }
+      }
+    }
+
+    if (vectorLinear) {
+      for (size_t c = 0; c < channels; c++) {
+        detail::interpolateLinear(channelPtrs[c], left.data(), weight.data(), count, values.data() + c * count);
+      }
+    }
+  }
+}
+
+OwnedSeries loadEpisodeSeries(const EpisodeReader& episode, const std::vector<size_t>& channels) {
+  OwnedSeries series;
+  series.times.resize(episode.sampleCount());
+  episode.copyColumn(episode.schema().time_channel, series.times.data());
+  for (size_t channel : channels) {
+    series.channels.emplace_back(episode.sampleCount());
+    episode.copyColumn(channel, series.channels.back().data());
+  }
+  return series;
+}
+
+OwnedSeries loadFrameSeries(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open frame log " + path + ": " + std::strerror(errno));
+  }
+  struct stat st;
+  FrameLogHeader header;
+  if (::fstat(fd, &st) != 0 || ::pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+      std::memcmp(header.magic, kFrameLogMagic, sizeof(header.magic)) != 0) {
+    ::close(fd);
+    throw std::runtime_error(path + " is not a frame log");
+  }
+
+  // Walk the record headers only; a torn final record is ignored
+  OwnedSeries series;
+  const uint64_t size = static_cast<uint64_t>(st.st_size);
+  uint64_t offset = header.header_size;
+  FrameRecordHeader record;
+  while (offset + sizeof(record) <= size &&
+         ::pread(fd, &record, sizeof(record), static_cast<off_t>(offset)) == sizeof(record) &&
+         std::memcmp(record.magic, kFrameRecordMagic, sizeof(record.magic)) == 0 &&
+         offset + frameRecordSize(record.length) <= size) {
+    series.times.push_back(record.timestamp);
+    offset += frameRecordSize(record.length);
+  }
+  ::close(fd);
+  return series;
+}
+
+StreamAligner::StreamAligner(double period, double maxLatency, size_t historySamples)
+    : period_(period), maxLatency_(maxLatency), capacity_(std::max<size_t>(historySamples, 4)) {
+  if (!(period > 0.0)) {
+    throw std::runtime_error("StreamAligner period must be positive");
+  }
+}
+
+int StreamAligner::addStream(const AlignStreamConfig& config) {
+  Stream s;
+  s.config = config;
+  s.times.resize(capacity_);
+  s.values.resize(config.channels * capacity_);
+  s.ids.resize(capacity_);
+  s.out.resize(config.channels);
+  streams_.push_back(std::move(s));
+  for (Stream& stream : streams_) {
+    stream.channelPtrs.resize(stream.config.channels);
+    for (size_t c = 0; c < stream.config.channels; c++) {
+      stream.channelPtrs[c] = stream.values.data() + c * capacity_;
+    }
+  }
+  recordValues_.resize(streams_.size());
+  recordIndex_.resize(streams_.size());
+  recordFlags_.resize(streams_.size());
+  return static_cast<int>(streams_.size() - 1);
+}
+
+void StreamAligner::setGridStart(double start) {
+  gridStart_ = start;
+  gridIndex_ = 0;
+  started_ = true;
+}
+
+bool StreamAligner::push(int stream, double time, const double* values) {
+  return append(streams_[static_cast<size_t>(stream)], time, values, -1);
+}
+
+bool StreamAligner::pushFrame(int stream, double time, int64_t frameId) {
+  return append(streams_[static_cast<size_t>(stream)], time, nullptr, frameId);
+}
+
+bool StreamAligner::append(Stream& s, double time, const double* values, int64_t id) {
+  if (s.size > 0 && time <= s.times[s.size - 1]) {
+    dropped_++;
+    return false;
+  }
+  if (s.size == capacity_) {
+    compact(s, nextGridTime());
+    if (s.size == capacity_) {
+      dropped_++;
+      return false;
+    }
+  }
+  if (!started_) {
+    setGridStart(time + s.config.clockOffset);
+  }
+  s.times[s.size] = time;
+  for (size_t c = 0; c < s.config.channels; c++) {
+    s.values[c * capacity_ + s.size] = values[c];
+  }
+  s.ids[s.size] = id;
+  s.size++;
+  return true;
+}
+
+void StreamAligner::compact(Stream& s, double t) {
+  // Keep the left neighbour of the next grid point and one more for the spline tangent
+  const double tg = t - s.config.clockOffset;
+  const size_t upper = static_cast<size_t>(std::upper_bound(s.times.data(), s.times.data() + s.size, tg) -
+                                           s.times.data());
+  const size_t keepFrom = upper >= 2 ? upper - 2 : 0;
+  if (keepFrom == 0) {
+    return;
+  }
+  const size_t keep = s.size - keepFrom;
+  std::memmove(s.times.data(), s.times.data() + keepFrom, keep * sizeof(double));
+  std::memmove(s.ids.data(), s.ids.data() + keepFrom, keep * sizeof(int64_t));
+  for (size_t c = 0; c < s.config.channels; c++) {
+    double* v = s.values.data() + c * capacity_;
+    std::memmove(v, v + keepFrom, keep * sizeof(double));
+  }
+  s.size = keep;
+  s.discarded += keepFrom;
+}
+
+bool StreamAligner::ready(const Stream& s, double t) const {
+  // A grid point is final once a later sample exists (two for the spline's right tangent)
+  const double tg = t - s.config.clockOffset;
+  if (s.size == 0 || s.times[s.size - 1] < tg) {
+    return false;
+  }
+  return s.config.mode != AlignMode::kCubic || (s.size >= 2 && s.times[s.size - 2] >= tg);
+}
+
+bool StreamAligner::next(double now) {
+  if (!started_ || streams_.empty()) {
+    return false;
+  }
+  const double t = nextGridTime();
+  bool allReady = true;
+  for (const Stream& s : streams_) {
+    allReady = allReady && ready(s, t);
+  }
+  if (!allReady && now < t + maxLatency_) {
+    return false;
+  }
+
+  for (size_t i = 0; i < streams_.size(); i++) {
+    Stream& s = streams_[i];
+    int64_t index;
+    recordFlags_[i] = detail::evaluateStream(s.config, s.times.data(), s.size, s.channelPtrs.data(),
+                                             t - s.config.clockOffset, s.out.data(), index);
+    recordValues_[i] = s.config.channels ? s.out.data() : nullptr;
+    if (index < 0) {
+      recordIndex_[i] = -1;
+    } else if (s.config.channels == 0) {
+      recordIndex_[i] = s.ids[static_cast<size_t>(index)];
+    } else {
+      recordIndex_[i] = index + static_cast<int64_t>(s.discarded);
+    }
+  }
+  record_.time = t;
+  record_.values = recordValues_.data();
+  record_.sampleIndex = recordIndex_.data();
+  record_.flags = recordFlags_.data();
+  gridIndex_++;
+  return true;
+}
+
+}  // namespace shoplifter
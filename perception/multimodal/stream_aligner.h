@@ -0,0 +1,235 @@
+/**
+ * Multi-Stream Time Alignment
+ *
+ * Resamples asynchronous sensor streams onto one common time grid: arm
+ * telemetry at 50-500 Hz and camera frames at 15-30 fps, each with its own
+ * (clock-corrected) host timestamps.
+ *
+ * - Continuous streams (joint angles, EE pose) are interpolated linearly or
+ *   with a cubic Hermite spline
+ * - Frame streams pick the nearest frame
+ * - Grid points whose neighbouring samples are further apart than the
+ *   stream's maxGap are flagged, as are points outside the recorded range
+ *
+ * alignOffline() processes whole recordings with vectorized interpolation.
+ * StreamAligner does the same online: samples are pushed as they arrive and
+ * aligned records are emitted once every stream has data past the grid
+ * point, or at the latest maxLatency seconds after it.
+ */
+
+#ifndef STREAM_ALIGNER_H
+#define STREAM_ALIGNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "utils/span.h"
+
+namespace shoplifter {
+
+class EpisodeReader;
+
+enum class AlignMode : uint8_t {
+  kLinear,
+  kCubic,      // cubic Hermite, finite-difference tangents
+  kNearest,    // nearest sample, values held (camera frames, discrete signals)
+};
+
+/**
+ * Per-stream, per-grid-point quality bits
+ */
+enum AlignFlag : uint8_t {
+  kAlignGap        = 1u << 0,  // neighbouring samples further apart than maxGap
+  kAlignOutOfRange = 1u << 1,  // before the first or after the last sample; edge value held
+  kAlignMissing    = 1u << 2,  // the stream has no samples yet
+};
+
+struct AlignStreamConfig {
+  std::string name;
+  size_t channels = 0;         // values per sample; 0 for frame streams
+  AlignMode mode = AlignMode::kLinear;
+  double maxGap = 0.1;         // seconds
+  double clockOffset = 0.0;    // seconds added to every timestamp of the stream
+};
+
+/**
+ * Offline input: sample times plus one array per channel
+ */
+struct StreamSeries {
+  Span<const double> times;
+  std::vector<Span<const double>> channels;
+};
+
+/**
+ * Owning StreamSeries, e.g. loaded from a recording
+ */
+struct OwnedSeries {
+  std::vector<double> times;
+  std::vector<std::vector<double>> channels;
+
+  StreamSeries view() const;
+};
+
+/**
+ * Offline output, one column per stream channel
+ */
+struct AlignedTable {
+  std::vector<double> time;
+  std::vector<std::vector<double>> values;        // [stream]: channel-major, channels x gridSize()
+  std::vector<std::vector<int64_t>> sampleIndex;  // [stream]: left neighbour, or nearest for kNearest
+  std::vector<std::vector<uint8_t>> flags;        // [stream]: AlignFlag bits
+
+  size_t gridSize() const { return time.size(); }
+  const double* channel(size_t stream, size_t c) const { return values[stream].data() + c * time.size(); }
+};
+
+/**
+ * Resample recorded streams onto start + k * period, k < count
+ *
+ * @throws std::runtime_error if configs and series disagree in size or channel count
+ */
+void alignOffline(const std::vector<AlignStreamConfig>& configs, const std::vector<StreamSeries>& series,
+                  double start, double period, size_t count, AlignedTable& out);
+
+/**
+ * Time range covered by every non-empty stream (after clock offsets)
+ *
+ * @return false if the streams do not overlap
+ */
+bool commonTimeRange(const std::vector<AlignStreamConfig>& configs, const std::vector<StreamSeries>& series,
+                     double& start, double& end);
+
+/**
+ * Load the time channel and the given channels of an episode
+ */
+OwnedSeries loadEpisodeSeries(const EpisodeReader& episode, const std::vector<size_t>& channels);
+
+/**
+ * Load frame timestamps from a .frames log (sample index = frame index)
+ *
+ * @throws std::runtime_error if the file is not a frame log
+ */
+OwnedSeries loadFrameSeries(const std::string& path);
+
+/**
+ * One aligned grid point handed to StreamAligner::poll() callbacks
+ *
+ * Pointers are valid only during the callback.
+ */
+struct AlignedRecord {
+  double time;
+  const double* const* values;   // [stream] -> channels values (nullptr for frame streams)
+  const int64_t* sampleIndex;    // [stream] frame id / sample index, -1 if none
+  const uint8_t* flags;          // [stream] AlignFlag bits
+};
+
+namespace detail {
+
+/**
+ * Evaluate one stream at one time (shared by the online and offline paths)
+ *
+ * @param t Grid time already shifted into the stream's clock
+ * @param channels Channel arrays parallel to times
+ * @param out channelCount values
+ * @param index Receives the sample index (left neighbour or nearest)
+ * @return AlignFlag bits
+ */
+uint8_t evaluateStream(const AlignStreamConfig& config, const double* times, size_t n,
+                       const double* const* channels, double t, double* out, int64_t& index);
+
+/**
+ * out[j] = v[left[j]] + w[j] * (v[left[j] + 1] - v[left[j]])
+ */
+void interpolateLinear(const double* v, const uint32_t* left, const double* w, size_t count, double* out);
+
+}  // namespace detail
+
+class StreamAligner {
+ public:
+  /**
+   * @param period Grid period in seconds
+   * @param maxLatency Longest a grid point waits for late streams before it is emitted anyway
+   * @param historySamples Per-stream sample buffer capacity
+   */
+  StreamAligner(double period, double maxLatency, size_t historySamples = 1024);
+
+  /**
+   * Add a stream; call before the first push
+   *
+   * @return Stream index
+   */
+  int addStream(const AlignStreamConfig& config);
+
+  /**
+   * Set the first grid time; by default it is the first pushed timestamp
+   */
+  void setGridStart(double start);
+
+  /**
+   * Append a sample (timestamps must increase per stream)
+   *
+   * @return false if out of order or the buffer is full; the sample is dropped
+   */
+  bool push(int stream, double time, const double* values);
+
+  /**
+   * Append a camera frame
+   */
+  bool pushFrame(int stream, double time, int64_t frameId);
+
+  /**
+   * Emit every grid point that is ready at host time now
+   *
+   * @param callback Called with const AlignedRecord&
+   * @return Number of records emitted
+   */
+  template <typename Callback>
+  size_t poll(double now, Callback&& callback) {
+    size_t emitted = 0;
+    while (next(now)) {
+      callback(record_);
+      emitted++;
+    }
+    return emitted;
+  }
+
+  uint64_t dropped() const { return dropped_; }
+  double nextGridTime() const { return gridStart_ + gridIndex_ * period_; }
+
+ private:
+  struct Stream {
+    AlignStreamConfig config;
+    std::vector<double> times;       // [capacity]
+    std::vector<double> values;      // channel-major [channel * capacity + i]
+    std::vector<int64_t> ids;        // frame ids for frame streams
+    std::vector<const double*> channelPtrs;
+    std::vector<double> out;
+    size_t size = 0;
+    uint64_t discarded = 0;          // samples compacted away (keeps sample indices absolute)
+  };
+
+  bool append(Stream& s, double time, const double* values, int64_t id);
+  bool ready(const Stream& s, double t) const;
+  bool next(double now);
+  void compact(Stream& s, double t);
+
+  double period_;
+  double maxLatency_;
+  size_t capacity_;
+  double gridStart_ = 0.0;
+  bool started_ = false;
+  uint64_t gridIndex_ = 0;
+  uint64_t dropped_ = 0;
+  std::vector<Stream> streams_;
+
+  AlignedRecord record_{};
+  std::vector<const double*> recordValues_;
+  std::vector<int64_t> recordIndex_;
+  std::vector<uint8_t> recordFlags_;
+};
+
+}  // namespace shoplifter
+
+#endif // STREAM_ALIGNER_H
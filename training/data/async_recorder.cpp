@@ -0,0 +1,377 @@
+/**
+ * Asynchronous Recording Writer
+ */
+
+#include "training/data/async_recorder.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+#include "hardware/telemetry/position_parser.h"
+#include "training/data/episode_writer.h"
+#include "training/data/frame_log.h"
+
+namespace shoplifter {
+
+namespace {
+
+constexpr size_t kStagingAlignment = 4096;
+constexpr size_t kCommitHistory = 8192;
+
+double nowSeconds() {
+  return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Page-aligned, growable byte buffer reused across commits
+ */
+class StagingBuffer {
+ public:
+  ~StagingBuffer() { std::free(data_); }
+
+  uint8_t* grow(size_t extra) {
+    if (size_ + extra > capacity_) {
+      size_t capacity = std::max<size_t>(capacity_ * 2, kStagingAlignment);
+      while (capacity < size_ + extra) {
+        capacity *= 2;
+      }
+      uint8_t* data = static_cast<uint8_t*>(std::aligned_alloc(kStagingAlignment, capacity));
+      if (!data) {
+        throw std::bad_alloc();
+      }
+      if (size_) {
+        std::memcpy(data, data_, size_);
+      }
+      std::free(data_);
+      data_ = data;
+      capacity_ = capacity;
+    }
+    uint8_t* p = data_ + size_;
+    size_ += extra;
+    return p;
+  }
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+  void clear() { size_ = 0; }
+
+ private:
+  uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+};
+
+void pwriteAll(int fd, const uint8_t* data, size_t length, uint64_t offset, const std::string& path) {
+  while (length > 0) {
+    const ssize_t n = ::pwrite(fd, data, length, static_cast<off_t>(offset));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("pwrite failed on " + path + ": " + std::strerror(errno));
+    }
+    data += n;
+    length -= static_cast<size_t>(n);
+    offset += static_cast<uint64_t>(n);
+  }
+}
+
+std::string sessionStamp() {
+  const std::time_t now = std::time(nullptr);
+  std::tm local;
+  localtime_r(&now, &local);
+  char buf[32];
+  std::strftime(buf, sizeof(buf), "%Y%m%d_%H%M%S", &local);
+  return buf;
+}
+
+}  // namespace
+
+struct AsyncRecorder::Stream {
+  Stream(bool isCamera, size_t ringBytes) : camera(isCamera), ring(ringBytes) {}
+
+  bool camera;
+  std::string path;
+  int fd = -1;
+  uint64_t offset = 0;
+  SpscByteRing ring;
+  std::atomic<uint64_t> dropped{0};
+
+  // Arm streams: samples drained since the last commit, column-wise
+  std::vector<std::vector<double>> columns;
+  size_t pending = 0;
+
+  // Camera streams: encoded frame records since the last commit
+  uint64_t sequence = 0;
+  size_t pendingFrames = 0;
+
+  StagingBuffer staging;
+};
+
+AsyncRecorder::AsyncRecorder(const RecorderOptions& options)
+    : options_(options), session_(sessionStamp()) {
+  if (options_.commitIntervalMs == 0) {
+    options_.commitIntervalMs = 1;
+  }
+  if (options_.drainIntervalMs == 0 || options_.drainIntervalMs > options_.commitIntervalMs) {
+    options_.drainIntervalMs = options_.commitIntervalMs;
+  }
+  commitMs_.reserve(kCommitHistory);
+}
+
+AsyncRecorder::~AsyncRecorder() {
+  try {
+    stop();
+  } catch (...) {
+    // Destructors must not throw; call stop() explicitly to see I/O errors
+  }
+  for (auto& stream : streams_) {
+    if (stream->fd >= 0) {
+      ::close(stream->fd);
+    }
+  }
+}
+
+std::unique_ptr<AsyncRecorder::Stream> AsyncRecorder::openStream(const std::string& id, bool camera) {
+  if (running_) {
+    throw std::runtime_error("Streams must be added before AsyncRecorder::start()");
+  }
+  auto stream = std::make_unique<Stream>(camera, camera ? options_.cameraRingBytes : options_.armRingBytes);
+  stream->path = options_.directory + "/" + id + "_" + session_ + (camera ? ".frames" : ".episode");
+  stream->fd = ::open(stream->path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (stream->fd < 0) {
+    throw std::runtime_error("Cannot create " + stream->path + ": " + std::strerror(errno));
+  }
+  return stream;
+}
+
+int AsyncRecorder::addArmStream(const std::string& armId) {
+  auto stream = openStream(armId, false);
+  const EpisodeFileHeader header = makeEpisodeHeader(armId, positionSchema());
+  pwriteAll(stream->fd, reinterpret_cast<const uint8_t*>(&header), sizeof(header), 0, stream->path);
+  stream->offset = sizeof(header);
+  stream->columns.resize(kPositionChannelCount);
+  for (auto& column : stream->columns) {
+    column.reserve(4096);
+  }
+  streams_.push_back(std::move(stream));
+  return static_cast<int>(streams_.size() - 1);
+}
+
+int AsyncRecorder::addCameraStream(const std::string& cameraId) {
+  auto stream = openStream(cameraId, true);
+  FrameLogHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kFrameLogMagic, sizeof(header.magic));
+  header.version = kFrameLogVersion;
+  header.header_size = sizeof(header);
+  std::strncpy(header.camera_id, cameraId.c_str(), sizeof(header.camera_id) - 1);
+  header.created_time = nowSeconds();
+  pwriteAll(stream->fd, reinterpret_cast<const uint8_t*>(&header), sizeof(header), 0, stream->path);
+  stream->offset = sizeof(header);
+  streams_.push_back(std::move(stream));
+  return static_cast<int>(streams_.size() - 1);
+}
+
+void AsyncRecorder::start() {
+  if (running_.exchange(true)) {
+    return;
+  }
+  writer_ = std::thread(&AsyncRecorder::run, this);
+}
+
+void AsyncRecorder::stop() {
+  if (!writer_.joinable()) {
+    return;
+  }
+  running_.store(false, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex_);
+  }
+  wake_.notify_all();
+  writer_.join();
+
+  // Whatever producers queued before stop() returned
+  if (stats().error.empty()) {
+    drainAll();
+    commit();
+  }
+}
+
+bool AsyncRecorder::recordSample(int stream, const double* values) {
+  Stream& s = *streams_[static_cast<size_t>(stream)];
+  if (!s.ring.tryWrite(values, kPositionChannelCount * sizeof(double))) {
+    s.dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+bool AsyncRecorder::recordSample(int stream, const PositionSample& sample) {
+  double values[kPositionChannelCount];
+  positionSampleValues(sample, values);
+  return recordSample(stream, values);
+}
+
+bool AsyncRecorder::recordFrame(int stream, double timestamp, const void* data, size_t length) {
+  Stream& s = *streams_[static_cast<size_t>(stream)];
+  if (!s.ring.tryWrite(&timestamp, sizeof(timestamp), data, length)) {
+    s.dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void AsyncRecorder::run() {
+  using Clock = std::chrono::steady_clock;
+  const auto drainInterval = std::chrono::milliseconds(options_.drainIntervalMs);
+  const auto commitInterval = std::chrono::milliseconds(options_.commitIntervalMs);
+  auto nextCommit = Clock::now() + commitInterval;
+
+  try {
+    while (running_.load(std::memory_order_acquire)) {
+      {
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wake_.wait_until(lock, std::min(Clock::now() + drainInterval, nextCommit),
+                         [this] { return !running_.load(std::memory_order_acquire); });
+      }
+      drainAll();
+      if (Clock::now() >= nextCommit) {
+        commit();
+        nextCommit += commitInterval;
+        if (nextCommit < Clock::now()) {
+          nextCommit = Clock::now() + commitInterval;  // fell behind; don't burst
+        }
+      }
+    }
+  } catch (const std::exception& e) {
+    // Producers keep running and start dropping once the rings fill up
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.error = e.what();
+  }
+}
+
+void AsyncRecorder::drainAll() {
+  for (auto& stream : streams_) {
+    Stream& s = *stream;
+    if (s.camera) {
+      s.ring.drain([&s](const uint8_t* record, size_t length) {
+        const size_t frameLength = length - sizeof(double);
+        FrameRecordHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kFrameRecordMagic, sizeof(header.magic));
+        header.length = static_cast<uint32_t>(frameLength);
+        std::memcpy(&header.timestamp, record, sizeof(double));
+        header.sequence = s.sequence++;
+        header.crc32 = episodeCrc32(record + sizeof(double), frameLength);
+
+        const size_t total = frameRecordSize(frameLength);
+        uint8_t* out = s.staging.grow(total);
+        std::memcpy(out, &header, sizeof(header));
+        std::memcpy(out + sizeof(header), record + sizeof(double), frameLength);
+        std::memset(out + sizeof(header) + frameLength, 0, total - sizeof(header) - frameLength);
+        s.pendingFrames++;
+      });
+    } else {
+      s.ring.drain([&s](const uint8_t* record, size_t) {
+        for (size_t c = 0; c < kPositionChannelCount; c++) {
+          double v;
+          std::memcpy(&v, record + c * sizeof(double), sizeof(double));
+          s.columns[c].push_back(v);
+        }
+        s.pending++;
+      });
+    }
+  }
+}
+
+void AsyncRecorder::commit() {
+  const auto start = std::chrono::steady_clock::now();
+  uint64_t samples = 0;
+  uint64_t frames = 0;
+  uint64_t bytes = 0;
+
+  for (auto& stream : streams_) {
+    Stream& s = *stream;
+    if (!s.camera && s.pending > 0) {
+      const double* columns[kPositionChannelCount];
+      for (size_t c = 0; c < kPositionChannelCount; c++) {
+        columns[c] = s.columns[c].data();
+      }
+      uint8_t* out = s.staging.grow(rawChunkBytes(positionSchema(), s.pending));
+      encodeRawChunk(positionSchema(), columns, s.pending, out);
+      samples += s.pending;
+      for (auto& column : s.columns) {
+        column.clear();
+      }
+      s.pending = 0;
+    }
+    frames += s.pendingFrames;
+    s.pendingFrames = 0;
+  }
+
+  // One large write per file, then one sync per file
+  for (auto& stream : streams_) {
+    Stream& s = *stream;
+    if (s.staging.size() == 0) {
+      continue;
+    }
+    pwriteAll(s.fd, s.staging.data(), s.staging.size(), s.offset, s.path);
+    s.offset += s.staging.size();
+    bytes += s.staging.size();
+    s.staging.clear();
+    if (options_.syncOnCommit && ::fdatasync(s.fd) != 0) {
+      throw std::runtime_error("fdatasync failed on " + s.path + ": " + std::strerror(errno));
+    }
+  }
+
+  const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  uint64_t dropped = 0;
+  for (auto& stream : streams_) {
+    dropped += stream->dropped.load(std::memory_order_relaxed);
+  }
+
+  std::lock_guard<std::mutex> lock(statsMutex_);
+  stats_.samplesWritten += samples;
+  stats_.framesWritten += frames;
+  stats_.bytesWritten += bytes;
+  stats_.dropped = dropped;
+  stats_.commits++;
+  stats_.commitMaxMs = std::max(stats_.commitMaxMs, ms);
+  if (commitMs_.size() < kCommitHistory) {
+    commitMs_.push_back(ms);
+  } else {
+    commitMs_[commitMsNext_] = ms;
+    commitMsNext_ = (commitMsNext_ + 1) % kCommitHistory;
+  }
+}
+
+RecorderStats AsyncRecorder::stats() const {
+  std::vector<double> history;
+  RecorderStats stats;
+  {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats = stats_;
+    history = commitMs_;
+  }
+  if (!history.empty()) {
+    std::sort(history.begin(), history.end());
+    auto at = [&history](double q) {
+      return history[std::min(history.size() - 1, static_cast<size_t>(q * history.size()))];
+    };
+    stats.commitP50Ms = at(0.5);
+    stats.commitP99Ms = at(0.99);
+    stats.commitP999Ms = at(0.999);
+  }
+  return stats;
+}
+
+}  // namespace shoplifter
@@ -0,0 +1,146 @@
+/**
+ * Asynchronous Recording Writer
+ *
+ * Records many arm telemetry streams and camera streams without putting
+ * disk I/O on the producer threads. Each stream has a lock-free SPSC ring;
+ * a dedicated writer thread drains the rings into per-file staging buffers
+ * and, every commit interval, issues one large pwrite() per file followed by
+ * an optional fdatasync() (group commit).
+ *
+ * Arm streams are written as .episode files (one chunk per commit), camera
+ * streams as .frames logs (see frame_log.h). Producers never block: when a
+ * ring is full the sample is dropped and counted.
+ */
+
+#ifndef ASYNC_RECORDER_H
+#define ASYNC_RECORDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "training/data/episode_format.h"
+#include "utils/spsc_byte_ring.h"
+
+namespace shoplifter {
+
+struct PositionSample;
+
+struct RecorderOptions {
+  std::string directory = ".";
+  uint32_t commitIntervalMs = 500;     // group commit period; also the episode chunk length
+  uint32_t drainIntervalMs = 5;        // how often the writer empties the rings
+  bool syncOnCommit = true;            // fdatasync() every file written in a commit
+  size_t armRingBytes = 256 << 10;     // per arm stream
+  size_t cameraRingBytes = 32 << 20;   // per camera stream
+};
+
+struct RecorderStats {
+  uint64_t samplesWritten = 0;
+  uint64_t framesWritten = 0;
+  uint64_t bytesWritten = 0;
+  uint64_t dropped = 0;                // samples and frames rejected by full rings
+  uint64_t commits = 0;
+  double commitP50Ms = 0.0;            // write + sync time of one commit
+  double commitP99Ms = 0.0;
+  double commitP999Ms = 0.0;
+  double commitMaxMs = 0.0;
+  std::string error;                   // set if the writer thread hit an I/O error
+};
+
+class AsyncRecorder {
+ public:
+  /**
+   * @param options Output directory, commit interval and ring sizes
+   */
+  explicit AsyncRecorder(const RecorderOptions& options);
+  ~AsyncRecorder();
+
+  AsyncRecorder(const AsyncRecorder&) = delete;
+  AsyncRecorder& operator=(const AsyncRecorder&) = delete;
+
+  /**
+   * Add an arm stream; call before start()
+   *
+   * @param armId Arm identity; the file is <directory>/<armId>_<session>.episode
+   * @return Stream handle for recordSample()
+   * @throws std::runtime_error if the file cannot be created
+   */
+  int addArmStream(const std::string& armId);
+
+  /**
+   * Add a camera stream; call before start()
+   *
+   * @param cameraId Camera name; the file is <directory>/<cameraId>_<session>.frames
+   * @return Stream handle for recordFrame()
+   * @throws std::runtime_error if the file cannot be created
+   */
+  int addCameraStream(const std::string& cameraId);
+
+  /**
+   * Start the writer thread
+   */
+  void start();
+
+  /**
+   * Drain everything, commit, and stop the writer thread
+   */
+  void stop();
+
+  /**
+   * Queue one position schema sample (one producer thread per stream)
+   *
+   * @param stream Handle from addArmStream()
+   * @param values kPositionChannelCount values in column order
+   * @return false if the ring was full and the sample was dropped
+   */
+  bool recordSample(int stream, const double* values);
+  bool recordSample(int stream, const PositionSample& sample);
+
+  /**
+   * Queue one camera frame (one producer thread per stream)
+   *
+   * @param stream Handle from addCameraStream()
+   * @param timestamp Host capture time, Unix seconds
+   * @param data Encoded frame bytes (copied)
+   * @param length Frame size
+   * @return false if the ring was full and the frame was dropped
+   */
+  bool recordFrame(int stream, double timestamp, const void* data, size_t length);
+
+  RecorderStats stats() const;
+
+  // Session suffix shared by all files of this recorder (YYYYmmdd_HHMMSS)
+  const std::string& session() const { return session_; }
+
+ private:
+  struct Stream;
+
+  void run();
+  void drainAll();
+  void commit();
+  std::unique_ptr<Stream> openStream(const std::string& id, bool camera);
+
+  RecorderOptions options_;
+  std::string session_;
+  std::vector<std::unique_ptr<Stream>> streams_;
+  std::thread writer_;
+  std::atomic<bool> running_{false};
+  std::mutex wakeMutex_;
+  std::condition_variable wake_;
+
+  mutable std::mutex statsMutex_;
+  RecorderStats stats_;
+  std::vector<double> commitMs_;       // recent commit durations for percentiles
+  size_t commitMsNext_ = 0;
+};
+
+}  // namespace shoplifter
+
+#endif // ASYNC_RECORDER_H
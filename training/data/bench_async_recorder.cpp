@@ -0,0 +1,178 @@
+/**
+ * Async Recorder Benchmark
+ *
+ * Simulates a recording rig: arm telemetry producers and camera producers
+ * feeding one AsyncRecorder. Reports sustained samples per second, producer
+ * enqueue latency and group-commit (write + fdatasync) latency.
+ *
+ * Usage:
+ *   bench_async_recorder [--dir DIR] [--seconds S] [--arms N] [--cameras N]
+ *                        [--arm-hz HZ] [--camera-fps FPS] [--frame-kb KB]
+ *                        [--commit-ms MS] [--no-sync]
+ *
+ * Defaults: 16 arms at 500 Hz, 4 cameras at 30 fps with 60 KB frames,
+ * 100 ms group commit with fdatasync. --arm-hz 0 runs the arms unpaced.
+ */
+
+#include "training/data/async_recorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct ProducerResult {
+  std::vector<double> enqueueNs;
+  uint64_t sent = 0;
+};
+
+double percentile(std::vector<double>& v, double q) {
+  if (v.empty()) {
+    return 0.0;
+  }
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, static_cast<size_t>(q * v.size()))];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  RecorderOptions options;
+  options.directory = "/tmp";
+  options.commitIntervalMs = 100;
+  double seconds = 5.0;
+  int arms = 16;
+  int cameras = 4;
+  double armHz = 500.0;
+  double cameraFps = 30.0;
+  size_t frameBytes = 60 * 1024;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--dir")) options.directory = next();
+    else if (!std::strcmp(argv[i], "--seconds")) seconds = std::atof(next());
+    else if (!std::strcmp(argv[i], "--arms")) arms = std::atoi(next());
+    else if (!std::strcmp(argv[i], "--cameras")) cameras = std::atoi(next());
+    else if (!std::strcmp(argv[i], "--arm-hz")) armHz = std::atof(next());
+    else if (!std::strcmp(argv[i], "--camera-fps")) cameraFps = std::atof(next());
+    else if (!std::strcmp(argv[i], "--frame-kb")) frameBytes = static_cast<size_t>(std::atof(next()) * 1024);
+    else if (!std::strcmp(argv[i], "--commit-ms")) options.commitIntervalMs = static_cast<uint32_t>(std::atoi(next()));
+    else if (!std::strcmp(argv[i], "--no-sync")) options.syncOnCommit = false;
+  }
+
+  AsyncRecorder recorder(options);
+  std::vector<int> armStreams;
+  std::vector<int> cameraStreams;
+  for (int i = 0; i < arms; i++) {
+    armStreams.push_back(recorder.addArmStream("bench_arm" + std::to_string(i)));
+  }
+  for (int i = 0; i < cameras; i++) {
+    cameraStreams.push_back(recorder.addCameraStream("bench_cam" + std::to_string(i)));
+  }
+  recorder.start();
+
+  std::atomic<bool> stop{false};
+  std::vector<ProducerResult> results(static_cast<size_t>(arms + cameras));
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < arms; i++) {
+    threads.emplace_back([&, i] {
+      ProducerResult& r = results[static_cast<size_t>(i)];
+      r.enqueueNs.reserve(1 << 20);
+      double values[kPositionChannelCount] = {};
+      const auto period = armHz > 0 ? std::chrono::nanoseconds(static_cast<int64_t>(1e9 / armHz))
+                                    : std::chrono::nanoseconds(0);
+      auto next = Clock::now();
+      while (!stop.load(std::memory_order_relaxed)) {
+        values[kChannelHostTime] = std::chrono::duration<double>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        values[kChannelBase] = static_cast<double>(r.sent) * 1e-3;
+        const auto t0 = Clock::now();
+        recorder.recordSample(armStreams[static_cast<size_t>(i)], values);
+        const auto t1 = Clock::now();
+        if (r.enqueueNs.size() < r.enqueueNs.capacity()) {
+          r.enqueueNs.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+        }
+        r.sent++;
+        if (period.count() > 0) {
+          next += period;
+          std::this_thread::sleep_until(next);
+        }
+      }
+    });
+  }
+
+  for (int i = 0; i < cameras; i++) {
+    threads.emplace_back([&, i] {
+      ProducerResult& r = results[static_cast<size_t>(arms + i)];
+      std::vector<uint8_t> frame(frameBytes, static_cast<uint8_t>(i));
+      const auto period = std::chrono::nanoseconds(static_cast<int64_t>(1e9 / std::max(cameraFps, 1.0)));
+      auto next = Clock::now();
+      while (!stop.load(std::memory_order_relaxed)) {
+        const double ts = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+        const auto t0 = Clock::now();
+        recorder.recordFrame(cameraStreams[static_cast<size_t>(i)], ts, frame.data(), frame.size());
+        const auto t1 = Clock::now();
+        r.enqueueNs.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+        r.sent++;
+        next += period;
+        std::this_thread::sleep_until(next);
+      }
+    });
+  }
+
+  const auto start = Clock::now();
+  std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+  stop = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+  recorder.stop();
+  const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::vector<double> armLatency;
+  std::vector<double> cameraLatency;
+  uint64_t armSent = 0;
+  uint64_t framesSent = 0;
+  for (int i = 0; i < arms + cameras; i++) {
+    auto& r = results[static_cast<size_t>(i)];
+    auto& dst = i < arms ? armLatency : cameraLatency;
+    dst.insert(dst.end(), r.enqueueNs.begin(), r.enqueueNs.end());
+    (i < arms ? armSent : framesSent) += r.sent;
+  }
+
+  const RecorderStats stats = recorder.stats();
+  std::printf("rig: %d arms @ %.0f Hz, %d cameras @ %.0f fps x %zu KB, commit %u ms%s\n",
+              arms, armHz, cameras, cameraFps, frameBytes / 1024, options.commitIntervalMs,
+              options.syncOnCommit ? " + fdatasync" : "");
+  std::printf("sustained:   %.0f samples/s, %.1f frames/s, %.1f MB/s written\n",
+              stats.samplesWritten / elapsed, stats.framesWritten / elapsed,
+              stats.bytesWritten / elapsed / 1e6);
+  std::printf("produced:    %llu samples, %llu frames, %llu dropped\n",
+              static_cast<unsigned long long>(armSent), static_cast<unsigned long long>(framesSent),
+              static_cast<unsigned long long>(stats.dropped));
+  std::printf("arm enqueue: p50 %.0f ns, p99 %.0f ns, p99.9 %.0f ns, max %.0f ns\n",
+              percentile(armLatency, 0.5), percentile(armLatency, 0.99),
+              percentile(armLatency, 0.999), percentile(armLatency, 1.0));
+  std::printf("cam enqueue: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+              percentile(cameraLatency, 0.5) / 1e3, percentile(cameraLatency, 0.99) / 1e3,
+              percentile(cameraLatency, 1.0) / 1e3);
+  std::printf("commit:      %llu commits, p50 %.2f ms, p99 %.2f ms, p99.9 %.2f ms, max %.2f ms\n",
+              static_cast<unsigned long long>(stats.commits), stats.commitP50Ms, stats.commitP99Ms,
+              stats.commitP999Ms, stats.commitMaxMs);
+  if (!stats.error.empty()) {
+    std::printf("error: %s\n", stats.error.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,116 @@
+/**
+ * Episode Catalog Benchmark
+ *
+ * Measures training-window sampling throughput: a random episode and time
+ * are drawn, then the window is resolved to a sample range from the catalog
+ * (and optionally trimmed to the exact range with the mapped time column).
+ *
+ * Usage:
+ *   bench_episode_catalog --catalog FILE [--before S] [--after S] [--windows N] [--trim]
+ *   bench_episode_catalog --dir DIR [--episodes N] [--samples N] [--rate HZ] ...
+ *
+ * With --dir, synthetic position episodes are generated there first.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "training/data/episode_catalog.h"
+#include "training/data/episode_reader.h"
+#include "training/data/episode_writer.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+  std::string catalogPath;
+  std::string dir;
+  int episodes = 32;
+  int samples = 20000;
+  double rate = 200.0;
+  double before = 2.0;
+  double after = 1.0;
+  size_t windows = 5000000;
+  bool trim = false;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--catalog")) catalogPath = next();
+    else if (!std::strcmp(argv[i], "--dir")) dir = next();
+    else if (!std::strcmp(argv[i], "--episodes")) episodes = std::atoi(next());
+    else if (!std::strcmp(argv[i], "--samples")) samples = std::atoi(next());
+    else if (!std::strcmp(argv[i], "--rate")) rate = std::atof(next());
+    else if (!std::strcmp(argv[i], "--before")) before = std::atof(next());
+    else if (!std::strcmp(argv[i], "--after")) after = std::atof(next());
+    else if (!std::strcmp(argv[i], "--windows")) windows = static_cast<size_t>(std::atof(next()));
+    else if (!std::strcmp(argv[i], "--trim")) trim = true;
+  }
+
+  if (!dir.empty()) {
+    // Jittered timestamps, like real host receive times
+    std::vector<CatalogInput> inputs;
+    double values[kPositionChannelCount] = {};
+    for (int e = 0; e < episodes; e++) {
+      const std::string path = dir + "/bench_" + std::to_string(e) + ".episode";
+      EpisodeWriter writer(path, "follower_" + std::to_string(e % 2));
+      double t = 1.7e9 + e * 3600.0;
+      for (int s = 0; s < samples; s++) {
+        t += (1.0 + 0.2 * std::sin(s * 0.7)) / rate;
+        values[kChannelHostTime] = t;
+        values[kChannelBase] = std::sin(s * 0.01);
+        writer.append(values);
+      }
+      writer.close();
+      inputs.push_back({path, {e % 4 == 0 ? "pick" : "place"}});
+    }
+    catalogPath = dir + "/bench.catalog";
+    const auto t0 = Clock::now();
+    buildEpisodeCatalog(inputs, catalogPath);
+    std::printf("built %s from %d episodes x %d samples in %.1f ms\n", catalogPath.c_str(), episodes, samples,
+                std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+  }
+  if (catalogPath.empty()) {
+    std::fprintf(stderr, "Usage: %s (--catalog FILE | --dir DIR) [--windows N] [--trim]\n", argv[0]);
+    return 2;
+  }
+
+  EpisodeCatalog catalog(catalogPath);
+  WindowSampler sampler(catalog, before, after);
+  std::printf("catalog: %zu episodes, stride %u, %zu eligible for %.1f s + %.1f s windows\n",
+              catalog.size(), catalog.indexStride(), sampler.eligibleEpisodes(), before, after);
+  if (sampler.eligibleEpisodes() == 0) {
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<EpisodeReader>> readers;
+  if (trim) {
+    for (size_t i = 0; i < catalog.size(); i++) {
+      readers.emplace_back(new EpisodeReader(catalog.path(i)));
+    }
+  }
+
+  SampledWindow w;
+  uint64_t totalSamples = 0;
+  uint64_t bytes = 0;
+  const auto t0 = Clock::now();
+  for (size_t i = 0; i < windows; i++) {
+    sampler.sample(w);
+    if (trim) {
+      w.range = trimWindow(*readers[w.episode], w.range, w.time - before, w.time + after);
+    }
+    const size_t chunk = catalog.chunkOf(w.episode, w.range.first);
+    bytes += catalog.columnBytes(w.episode, chunk, kChannelBase, w.range.first, w.range.end).length;
+    totalSamples += w.range.end - w.range.first;
+  }
+  const double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+  std::printf("sampled %zu windows%s: %.2f M windows/s, %.0f ns each, mean %.1f samples, %.0f bytes/column\n",
+              windows, trim ? " (trimmed)" : "", windows / seconds / 1e6, seconds / windows * 1e9,
+              static_cast<double>(totalSamples) / windows, static_cast<double>(bytes) / windows);
+  return 0;
+}
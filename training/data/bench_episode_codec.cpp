@@ -0,0 +1,255 @@
+/**
+ * Episode Codec Benchmark
+ *
+ * Compares packed chunks (episode_codec.h) with raw chunks and with the JSONL
+ * text they replace: compression ratio, encode throughput and decode
+ * throughput, and checks that every column round-trips (bit-exact, or within
+ * step / 2 with --quantize).
+ *
+ * Usage:
+ *   bench_episode_codec [--quantize STEP] recording.episode [...]
+ *   bench_episode_codec [--quantize STEP] [--samples N] [--rate HZ] [--dir DIR]
+ *
+ * Without inputs, a synthetic follower recording is generated: joints on the
+ * 12-bit servo encoder grid, alternating still phases and smooth moves, with
+ * jittered host receive times.
+ */
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "training/data/episode_codec.h"
+#include "training/data/episode_reader.h"
+#include "training/data/episode_writer.h"
+
+using namespace shoplifter;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double seconds(Clock::time_point since) {
+  return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+// Column-major sample values of a follower recording
+std::vector<std::vector<double>> syntheticRecording(size_t samples, double rate) {
+  std::vector<std::vector<double>> columns(kPositionChannelCount, std::vector<double>(samples));
+  const double tick = 2.0 * M_PI / 4096.0;
+  double t = 1.7e9;
+  double target[6] = {};
+  double from[6] = {};
+  size_t phaseStart = 0;
+  size_t phaseLength = 1;
+  bool moving = false;
+  uint64_t rng = 42;
+  auto uniform = [&rng]() {
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<double>(rng >> 11) * 0x1p-53;
+  };
+
+  for (size_t i = 0; i < samples; i++) {
+    if (i - phaseStart >= phaseLength) {
+      phaseStart = i;
+      moving = !moving;
+      phaseLength = static_cast<size_t>(rate * (moving ? 0.5 + 1.5 * uniform() : 0.2 + 2.0 * uniform()));
+      phaseLength = phaseLength ? phaseLength : 1;
+      for (int j = 0; j < 6; j++) {
+        from[j] = target[j];
+        if (moving) {
+          target[j] = (uniform() - 0.5) * (j == 5 ? 1.0 : 2.5);
+        }
+      }
+    }
+    const double a = moving ? 0.5 - 0.5 * std::cos(M_PI * double(i - phaseStart) / double(phaseLength)) : 1.0;
+    double joint[6];
+    for (int j = 0; j < 6; j++) {
+      joint[j] = std::round((from[j] + (target[j] - from[j]) * a) / tick) * tick;
+    }
+
+    t += (1.0 + 0.3 * (uniform() - 0.5)) / rate;
+    columns[kChannelHostTime][i] = t;
+    columns[kChannelDeviceMs][i] = std::floor((t - 1.7e9) * 1000.0) + 12345.0;
+    columns[kChannelBase][i] = joint[0];
+    columns[kChannelShoulder][i] = joint[1];
+    columns[kChannelElbow][i] = joint[2];
+    columns[kChannelWrist][i] = joint[3];
+    columns[kChannelRoll][i] = joint[4];
+    columns[kChannelGripper][i] = joint[5];
+    const double reach = 236.82 * std::sin(joint[1]) + 144.49 * std::cos(joint[1] + joint[2]);
+    columns[kChannelX][i] = reach * std::cos(joint[0]);
+    columns[kChannelY][i] = reach * std::sin(joint[0]);
+    columns[kChannelZ][i] = 236.82 * std::cos(joint[1]) - 144.49 * std::sin(joint[1] + joint[2]);
+    columns[kChannelTilt][i] = joint[1] + joint[2] + joint[3];
+  }
+  return columns;
+}
+
+// Approximate size of the same samples as JSONL written by the Python recorders
+size_t jsonlBytes(const std::vector<std::vector<double>>& columns) {
+  char line[512];
+  size_t bytes = 0;
+  for (size_t i = 0; i < columns[0].size(); i++) {
+    bytes += static_cast<size_t>(std::snprintf(
+        line, sizeof(line),
+        "{\"arm_id\": \"follower_left\", \"t\": %.0f, \"b\": %.17g, \"s\": %.17g, \"e\": %.17g, \"r\": %.17g, "
+        "\"g\": %.17g, \"x\": %.17g, \"y\": %.17g, \"z\": %.17g, \"tilt\": %.17g, \"host_time\": %.17g, "
+        "\"host_datetime\": \"2025-01-01T12:00:00.000000\"}\n",
+        columns[kChannelDeviceMs][i], columns[kChannelBase][i], columns[kChannelShoulder][i],
+        columns[kChannelElbow][i], columns[kChannelRoll][i], columns[kChannelGripper][i],
+        columns[kChannelX][i], columns[kChannelY][i], columns[kChannelZ][i], columns[kChannelTilt][i],
+        columns[kChannelHostTime][i]));
+  }
+  return bytes;
+}
+
+std::vector<std::vector<double>> readRecording(const std::string& path, EpisodeSchema& schema) {
+  EpisodeReader reader(path);
+  schema = reader.schema();
+  std::vector<std::vector<double>> columns(schema.channels.size(), std::vector<double>(reader.sampleCount()));
+  for (size_t c = 0; c < schema.channels.size(); c++) {
+    if (schema.channels[c].type != ColumnType::kFloat64) {
+      throw std::runtime_error("bench_episode_codec only handles float64 schemas");
+    }
+    reader.copyColumn(c, columns[c].data());
+  }
+  return columns;
+}
+
+/**
+ * Benchmark one recording
+ *
+ * @return false if a column did not round-trip
+ */
+bool run(const std::string& label, const EpisodeSchema& schema, const std::vector<std::vector<double>>& columns,
+         const std::string& dir, const EpisodeCodecOptions& options) {
+  const size_t samples = columns[0].size();
+  const size_t channels = columns.size();
+  const size_t chunkSamples = EpisodeWriter::kDefaultChunkSamples;
+  const std::string rawPath = dir + "/bench_codec_raw.episode";
+  const std::string packedPath = dir + "/bench_codec_packed.episode";
+
+  // File sizes through the real writer
+  size_t fileBytes[2] = {};
+  for (int packed = 0; packed < 2; packed++) {
+    EpisodeCodecOptions codec = options;
+    codec.codec = packed ? kCodecPacked : kCodecRaw;
+    EpisodeWriter writer(packed ? packedPath : rawPath, "bench", schema, chunkSamples, codec);
+    std::vector<double> row(channels);
+    for (size_t i = 0; i < samples; i++) {
+      for (size_t c = 0; c < channels; c++) {
+        row[c] = columns[c][i];
+      }
+      writer.append(row.data());
+    }
+    writer.close();
+    struct stat st;
+    if (::stat((packed ? packedPath : rawPath).c_str(), &st) == 0) {
+      fileBytes[packed] = static_cast<size_t>(st.st_size);
+    }
+  }
+
+  // Encode throughput, chunk by chunk, measured on raw column bytes
+  std::vector<uint8_t> chunk;
+  std::vector<const double*> pointers(channels);
+  const int passes = 5;
+  auto t0 = Clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    for (size_t first = 0; first < samples; first += chunkSamples) {
+      const size_t n = std::min(chunkSamples, samples - first);
+      for (size_t c = 0; c < channels; c++) {
+        pointers[c] = columns[c].data() + first;
+      }
+      encodePackedChunk(schema, pointers.data(), n, options, chunk);
+    }
+  }
+  const double encodeSeconds = seconds(t0);
+
+  // Decode throughput and round-trip check
+  EpisodeReader reader(packedPath);
+  std::vector<double> decoded(samples);
+  bool ok = reader.sampleCount() == samples;
+  double maxError = 0.0;
+  t0 = Clock::now();
+  for (int pass = 0; pass < passes && ok; pass++) {
+    for (size_t c = 0; c < channels; c++) {
+      reader.copyColumn(c, decoded.data());
+      if (pass > 0) {
+        continue;
+      }
+      for (size_t i = 0; i < samples; i++) {
+        const double a = columns[c][i];
+        const double b = decoded[i];
+        const bool same = std::memcmp(&a, &b, sizeof(a)) == 0 || (std::isnan(a) && std::isnan(b));
+        if (!same) {
+          maxError = std::max(maxError, std::fabs(a - b));
+          ok = ok && options.quantizeStep > 0.0 && c != schema.time_channel &&
+               std::fabs(a - b) <= options.quantizeStep * 0.5 * (1.0 + 1e-9);
+        }
+      }
+    }
+  }
+  const double decodeSeconds = seconds(t0);
+
+  const double rawMB = double(samples) * channels * sizeof(double) / 1e6;
+  std::printf("%s: %zu samples x %zu channels\n", label.c_str(), samples, channels);
+  std::printf("  raw episode    %10zu bytes\n", fileBytes[0]);
+  std::printf("  packed episode %10zu bytes  (%.2fx vs raw)\n", fileBytes[1], double(fileBytes[0]) / fileBytes[1]);
+  if (schema.channels.size() == kPositionChannelCount) {
+    const size_t text = jsonlBytes(columns);
+    std::printf("  jsonl text     %10zu bytes  (%.2fx vs jsonl)\n", text, double(text) / fileBytes[1]);
+  }
+  std::printf("  encode %.0f MB/s, decode %.0f MB/s (of raw column data)\n", rawMB * passes / encodeSeconds,
+              rawMB * passes / decodeSeconds);
+  if (options.quantizeStep > 0.0) {
+    std::printf("  max quantization error %.3g (step %.3g)\n", maxError, options.quantizeStep);
+  }
+  std::printf("  round trip: %s\n", ok ? "ok" : "MISMATCH");
+  std::remove(rawPath.c_str());
+  std::remove(packedPath.c_str());
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  EpisodeCodecOptions options;
+  options.codec = kCodecPacked;
+  size_t samples = 200000;
+  double rate = 200.0;
+  std::string dir = "/tmp";
+  std::vector<std::string> inputs;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+    if (!std::strcmp(argv[i], "--quantize")) options.quantizeStep = std::atof(next());
+    else if (!std::strcmp(argv[i], "--samples")) samples = static_cast<size_t>(std::atof(next()));
+    else if (!std::strcmp(argv[i], "--rate")) rate = std::atof(next());
+    else if (!std::strcmp(argv[i], "--dir")) dir = next();
+    else inputs.push_back(argv[i]);
+  }
+
+  bool ok = true;
+  try {
+    if (inputs.empty()) {
+      ok = run("synthetic", positionSchema(), syntheticRecording(samples, rate), dir, options);
+    }
+    for (const std::string& path : inputs) {
+      EpisodeSchema schema;
+      const auto columns = readRecording(path, schema);
+      ok = run(path, schema, columns, dir, options) && ok;
+    }
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return ok ? 0 : 1;
+}
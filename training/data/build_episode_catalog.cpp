@@ -0,0 +1,73 @@
+/**
+ * Episode Catalog Builder
+ *
+ * Writes a .catalog file (see episode_catalog.h) over a set of episodes.
+ *
+ * Usage:
+ *   build_episode_catalog --out episodes.catalog [--stride N]
+ *                         [--tags TAG,TAG] episode.episode [...] [--tags TAG] [...]
+ *
+ * --tags applies to the episodes that follow it, until the next --tags
+ * (an empty list clears the tags).
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "training/data/episode_catalog.h"
+
+namespace {
+
+std::vector<std::string> splitTags(const std::string& list) {
+  std::vector<std::string> tags;
+  size_t start = 0;
+  while (start < list.size()) {
+    size_t comma = list.find(',', start);
+    if (comma == std::string::npos) {
+      comma = list.size();
+    }
+    if (comma > start) {
+      tags.push_back(list.substr(start, comma - start));
+    }
+    start = comma + 1;
+  }
+  return tags;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string out;
+  uint32_t stride = shoplifter::kDefaultIndexStride;
+  std::vector<std::string> tags;
+  std::vector<shoplifter::CatalogInput> inputs;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      out = argv[++i];
+    } else if (std::strcmp(argv[i], "--stride") == 0 && i + 1 < argc) {
+      stride = static_cast<uint32_t>(std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--tags") == 0 && i + 1 < argc) {
+      tags = splitTags(argv[++i]);
+    } else {
+      inputs.push_back({argv[i], tags});
+    }
+  }
+  if (out.empty() || inputs.empty()) {
+    std::fprintf(stderr, "Usage: %s --out CATALOG [--stride N] [--tags A,B] episode [...]\n", argv[0]);
+    return 2;
+  }
+
+  try {
+    const size_t n = shoplifter::buildEpisodeCatalog(inputs, out, stride);
+    std::printf("%s: %zu of %zu episodes cataloged\n", out.c_str(), n, inputs.size());
+    return n == inputs.size() ? 0 : 1;
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s: %s\n", out.c_str(), e.what());
+    return 1;
+  }
+}
@@ -0,0 +1,247 @@
+"""
+Reader for columnar .episode recordings.
+
+Python counterpart of training/data/episode_reader.h. The file is memory-mapped
+and every column is exposed as a zero-copy numpy view, so loading a day of
+demonstrations costs a few page faults instead of re-parsing JSON text.
+
+Chunks written with the packed codec (episode_codec.h) are decoded with
+vectorized numpy instead and returned as ordinary arrays.
+
+Usage:
+    episode = Episode("follower_left_20250101_120000.episode")
+    base = episode.column("b")          # numpy array over the mapped file
+    times = episode.column("host_time")
+"""
+
+import mmap
+import struct
+from typing import Dict, List, Tuple
+
+import numpy as np
+
+
+EPISODE_MAGIC = b"SLEPISOD"
+CHUNK_MAGIC = b"CHNK"
+CHUNK_FOOTER_MAGIC = b"CEND"
+FORMAT_VERSION = 1
+ALIGNMENT = 64
+HEADER_SIZE = 512
+CHUNK_HEADER_SIZE = 64
+CHUNK_FOOTER_SIZE = 64
+
+# Chunk codecs and column transforms from episode_codec.h
+CODEC_RAW = 0
+CODEC_PACKED = 1
+PACKED_BLOCK_VALUES = 128
+PACKED_COLUMN_HEADER_SIZE = 32
+TRANSFORM_XOR = 1
+TRANSFORM_DELTA_OF_DELTA = 2
+TRANSFORM_QUANTIZED_DELTA = 3
+
+# ColumnType values from episode_format.h
+COLUMN_DTYPES = {
+    1: np.dtype("<f8"),
+    2: np.dtype("<f4"),
+    3: np.dtype("<i8"),
+    4: np.dtype("<u4"),
+}
+
+
+def _align(n: int) -> int:
+    return (n + ALIGNMENT - 1) & ~(ALIGNMENT - 1)
+
+
+def _unzigzag(v: np.ndarray) -> np.ndarray:
+    return ((v >> np.uint64(1)) ^ (np.uint64(0) - (v & np.uint64(1)))).view(np.int64)
+
+
+def _unpack_blocks(buffer, offset: int, end: int, n: int) -> np.ndarray:
+    """
+    Unpack n residuals from a stream of bit-packed blocks.
+
+    Raises:
+        ValueError: If the stream is shorter or longer than its blocks
+    """
+    out = np.zeros(n, dtype=np.uint64)
+    one = np.uint64(1)
+    for start in range(0, n, PACKED_BLOCK_VALUES):
+        k = min(PACKED_BLOCK_VALUES, n - start)
+        if offset + 8 > end:
+            raise ValueError("Packed column is truncated")
+        width, shift = buffer[offset], buffer[offset + 1]
+        words = (width * k + 63) // 64
+        offset += 8
+        if width > 64 or width + shift > 64 or offset + 8 * words > end:
+            raise ValueError("Packed column is malformed")
+        if width:
+            packed = np.zeros(words + 1, dtype=np.uint64)
+            packed[:words] = np.frombuffer(buffer, dtype="<u8", count=words, offset=offset)
+            pos = np.arange(k, dtype=np.uint64) * np.uint64(width)
+            word = (pos >> np.uint64(6)).astype(np.intp)
+            bit = pos & np.uint64(63)
+            v = (packed[word] >> bit) | ((packed[word + 1] << one) << (np.uint64(63) - bit))
+            mask = np.uint64(0xFFFFFFFFFFFFFFFF) if width == 64 else np.uint64((1 << width) - 1)
+            out[start:start + k] = (v & mask) << np.uint64(shift)
+        offset += 8 * words
+    if offset != end:
+        raise ValueError("Packed column has trailing bytes")
+    return out
+
+
+def decode_packed_column(buffer, payload_offset: int, channel_count: int, channel: int,
+                         dtype: np.dtype, count: int) -> np.ndarray:
+    """
+    Decode one column of a packed chunk, like decodePackedColumn() in C++.
+
+    Args:
+        buffer: Mapped file
+        payload_offset: Offset of the chunk payload (after the chunk header)
+        channel_count: Number of channels in the schema
+        channel: Column to decode
+        dtype: Column dtype
+        count: Samples in the chunk
+
+    Returns:
+        numpy array with count values
+    """
+    offset = payload_offset + channel_count * PACKED_COLUMN_HEADER_SIZE
+    for c in range(channel):
+        offset += struct.unpack_from("<I", buffer, payload_offset + c * PACKED_COLUMN_HEADER_SIZE + 4)[0]
+    transform, size, step, first, second = struct.unpack_from(
+        "<B3xIdQQ", buffer, payload_offset + channel * PACKED_COLUMN_HEADER_SIZE)
+    end = offset + size
+    if count == 0:
+        return np.empty(0, dtype=dtype)
+
+    if transform == TRANSFORM_QUANTIZED_DELTA:
+        q = np.empty(count, dtype=np.int64)
+        q[0] = np.uint64(first).astype(np.int64)
+        q[1:] = _unzigzag(_unpack_blocks(buffer, offset, end, count - 1))
+        return (np.cumsum(q) * step).astype(dtype)
+
+    bits = np.empty(count, dtype=np.uint64)
+    bits[0] = first
+    if transform == TRANSFORM_XOR:
+        bits[1:] = _unpack_blocks(buffer, offset, end, count - 1)
+        bits = np.bitwise_xor.accumulate(bits)
+    elif transform == TRANSFORM_DELTA_OF_DELTA:
+        if count > 1:
+            deltas = np.empty(count - 1, dtype=np.uint64)
+            deltas[0] = second
+            deltas[1:] = _unzigzag(_unpack_blocks(buffer, offset, end, count - 2)).view(np.uint64)
+            bits[1:] = np.cumsum(deltas, dtype=np.uint64)
+            bits = np.cumsum(bits, dtype=np.uint64)
+        elif size:
+            raise ValueError("Packed column has trailing bytes")
+    else:
+        raise ValueError(f"Unknown column transform {transform}")
+    if dtype.itemsize == 4:
+        return bits.astype(np.uint32).view(dtype)
+    return bits.view(dtype)
+
+
+class Episode:
+    """Memory-mapped view of one .episode file."""
+
+    def __init__(self, path: str):
+        """
+        Map an episode file and index its committed chunks.
+
+        Args:
+            path: Path of the .episode file
+
+        Raises:
+            ValueError: If the file header is invalid
+        """
+        self.path = path
+        with open(path, "rb") as f:
+            self._map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+        magic, version, header_size, channel_count, time_channel = struct.unpack_from("<8sIIII", self._map, 0)
+        if magic != EPISODE_MAGIC or version != FORMAT_VERSION or header_size != HEADER_SIZE:
+            raise ValueError(f"{path} is not a version {FORMAT_VERSION} episode file")
+
+        self.arm_id = self._map[24:56].split(b"\0", 1)[0].decode("utf-8")
+        self.created_time = struct.unpack_from("<d", self._map, 56)[0]
+        self.time_channel = time_channel
+
+        self.channels: List[Tuple[str, np.dtype]] = []
+        for i in range(channel_count):
+            offset = 128 + 24 * i
+            name = self._map[offset:offset + 16].split(b"\0", 1)[0].decode("utf-8")
+            self.channels.append((name, COLUMN_DTYPES[self._map[offset + 16]]))
+        self._index: Dict[str, int] = {name: i for i, (name, _) in enumerate(self.channels)}
+
+        # (offset, sample_count, codec, first_time, last_time) per committed chunk
+        self.chunks = []
+        offset = header_size
+        size = len(self._map)
+        while offset + CHUNK_HEADER_SIZE + CHUNK_FOOTER_SIZE <= size:
+            magic, count, payload, first_time, last_time, codec = struct.unpack_from("<4sIQddI", self._map, offset)
+            footer_offset = offset + CHUNK_HEADER_SIZE + payload
+            if magic != CHUNK_MAGIC or footer_offset + CHUNK_FOOTER_SIZE > size:
+                break
+            f_magic, f_count, f_payload = struct.unpack_from("<4sIQ", self._map, footer_offset)
+            if f_magic != CHUNK_FOOTER_MAGIC or f_count != count or f_payload != payload:
+                break
+            self.chunks.append((offset, count, codec, first_time, last_time))
+            offset = footer_offset + CHUNK_FOOTER_SIZE
+        self.truncated = offset != size
+        self.sample_count = sum(chunk[1] for chunk in self.chunks)
+
+    def chunk_column(self, chunk: int, name: str) -> np.ndarray:
+        """
+        One column within one chunk.
+
+        Args:
+            chunk: Chunk index
+            name: Channel name (e.g. "b", "host_time")
+
+        Returns:
+            Read-only numpy array backed by the mapped file for raw chunks,
+            a decoded array for packed chunks
+
+        Raises:
+            ValueError: If the chunk codec is unknown or the payload is malformed
+        """
+        offset, count, codec, _, _ = self.chunks[chunk]
+        channel = self._index[name]
+        if codec == CODEC_PACKED:
+            return decode_packed_column(self._map, offset + CHUNK_HEADER_SIZE, len(self.channels), channel,
+                                        self.channels[channel][1], count)
+        if codec != CODEC_RAW:
+            raise ValueError(f"Unknown chunk codec {codec}")
+        position = offset + CHUNK_HEADER_SIZE
+        for _, dtype in self.channels[:channel]:
+            position += _align(dtype.itemsize * count)
+        dtype = self.channels[channel][1]
+        return np.frombuffer(self._map, dtype=dtype, count=count, offset=position)
+
+    def column(self, name: str) -> np.ndarray:
+        """
+        Whole column across all chunks.
+
+        Zero-copy for single raw-chunk episodes, concatenated otherwise.
+
+        Args:
+            name: Channel name
+
+        Returns:
+            numpy array with sample_count values
+        """
+        if len(self.chunks) == 1:
+            return self.chunk_column(0, name)
+        if not self.chunks:
+            return np.empty(0, dtype=self.channels[self._index[name]][1])
+        return np.concatenate([self.chunk_column(i, name) for i in range(len(self.chunks))])
+
+    def close(self) -> None:
+        """Unmap the file. Arrays returned by column() must be released first."""
+        self._map.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
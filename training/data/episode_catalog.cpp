@@ -0,0 +1,395 @@
+/**
+ * Episode Catalog and Time Index
+ */
+
+#include "training/data/episode_catalog.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+#include "training/data/episode_reader.h"
+
+namespace shoplifter {
+
+namespace {
+
+size_t tagSectionBytes(uint32_t tagCount) {
+  return alignEpisode(tagCount * kCatalogTagLength);
+}
+
+struct CatalogLayout {
+  uint64_t tags;
+  uint64_t entries;
+  uint64_t chunks;
+  uint64_t index;
+  uint64_t strings;
+  uint64_t total;
+};
+
+CatalogLayout catalogLayout(const CatalogHeader& h) {
+  CatalogLayout l;
+  l.tags = sizeof(CatalogHeader);
+  l.entries = l.tags + tagSectionBytes(h.tag_count);
+  l.chunks = l.entries + alignEpisode(h.episode_count * sizeof(CatalogEntry));
+  l.index = l.chunks + alignEpisode(h.chunk_total * sizeof(CatalogChunk));
+  l.strings = l.index + alignEpisode(h.index_total * sizeof(double));
+  l.total = l.strings + h.strings_bytes;
+  return l;
+}
+
+// First sample in [lo, hi) whose time is >= t, or hi; raw chunks only
+uint64_t firstAtOrAfter(const EpisodeReader& episode, uint64_t lo, uint64_t hi, double t) {
+  size_t c = 0;
+  size_t last = episode.chunkCount();
+  while (last - c > 1) {
+    const size_t mid = (c + last) / 2;
+    if (episode.chunk(mid).first_sample <= lo) {
+      c = mid;
+    } else {
+      last = mid;
+    }
+  }
+  // Times are sorted, so the answer is in the first chunk whose tail reaches t
+  for (; c < episode.chunkCount() && lo < hi; c++) {
+    const EpisodeChunk& chunk = episode.chunk(c);
+    const Span<const double> times = episode.column<double>(c, episode.schema().time_channel);
+    const uint64_t end = std::min<uint64_t>(hi, chunk.first_sample + chunk.sample_count);
+    const double* begin = times.data + (lo - chunk.first_sample);
+    const double* found = std::lower_bound(begin, times.data + (end - chunk.first_sample), t);
+    lo += static_cast<uint64_t>(found - begin);
+    if (lo < end) {
+      return lo;
+    }
+  }
+  return hi;
+}
+
+}  // namespace
+
+size_t buildEpisodeCatalog(const std::vector<CatalogInput>& inputs, const std::string& outPath,
+                           uint32_t indexStride) {
+  if (indexStride == 0) {
+    indexStride = kDefaultIndexStride;
+  }
+  std::vector<CatalogEntry> entries;
+  std::vector<CatalogChunk> chunks;
+  std::vector<double> index;
+  std::string strings;
+  std::vector<std::string> tagNames;
+  std::map<std::string, uint32_t> tagBits;
+
+  for (const CatalogInput& input : inputs) {
+    std::unique_ptr<EpisodeReader> episode;
+    try {
+      episode.reset(new EpisodeReader(input.path));
+    } catch (const std::runtime_error&) {
+      continue;
+    }
+    if (episode->sampleCount() == 0 ||
+        episode->schema().channels[episode->schema().time_channel].type != ColumnType::kFloat64) {
+      continue;
+    }
+
+    CatalogEntry e;
+    std::memset(&e, 0, sizeof(e));
+    std::memcpy(e.arm_id, episode->header().arm_id, kEpisodeArmIdLength);
+    e.arm_id[kEpisodeArmIdLength - 1] = '\0';
+    e.start_time = episode->chunk(0).first_time;
+    e.end_time = episode->chunk(episode->chunkCount() - 1).last_time;
+    e.sample_count = episode->sampleCount();
+    e.file_size = episode->size();
+    e.path_offset = strings.size();
+    e.path_length = static_cast<uint32_t>(input.path.size());
+    e.chunk_count = static_cast<uint32_t>(episode->chunkCount());
+    e.chunk_offset = chunks.size();
+    e.index_offset = index.size();
+    e.channel_count = static_cast<uint32_t>(episode->schema().channels.size());
+    for (size_t c = 0; c < episode->schema().channels.size(); c++) {
+      e.column_sizes[c] = static_cast<uint8_t>(columnTypeSize(episode->schema().channels[c].type));
+    }
+    for (const std::string& tag : input.tags) {
+      auto it = tagBits.find(tag);
+      if (it == tagBits.end()) {
+        if (tagNames.size() == kMaxCatalogTags || tag.size() >= kCatalogTagLength) {
+          throw std::runtime_error("Catalog supports up to 64 tags of at most 31 characters: " + tag);
+        }
+        it = tagBits.emplace(tag, static_cast<uint32_t>(tagNames.size())).first;
+        tagNames.push_back(tag);
+      }
+      e.tags |= uint64_t(1) << it->second;
+    }
+
+    // Sparse index: the time of every indexStride-th sample
+    try {
+      std::vector<double> decoded;
+      for (size_t i = 0; i < episode->chunkCount(); i++) {
+        const EpisodeChunk& chunk = episode->chunk(i);
+        chunks.push_back({chunk.offset, chunk.first_sample, chunk.sample_count, chunk.codec, chunk.first_time});
+        const double* times;
+        if (chunk.codec == kCodecRaw) {
+          times = episode->column<double>(i, episode->schema().time_channel).data;
+        } else {
+          decoded.resize(chunk.sample_count);
+          episode->decodeColumn(i, episode->schema().time_channel, decoded.data());
+          times = decoded.data();
+        }
+        const uint64_t firstIndexed = (chunk.first_sample + indexStride - 1) / indexStride * indexStride;
+        for (uint64_t s = firstIndexed; s < chunk.first_sample + chunk.sample_count; s += indexStride) {
+          index.push_back(times[s - chunk.first_sample]);
+        }
+      }
+    } catch (const std::runtime_error&) {
+      // Corrupt chunk or a time column that is not float64; skip the episode
+      chunks.resize(e.chunk_offset);
+      index.resize(e.index_offset);
+      continue;
+    }
+    e.index_count = static_cast<uint32_t>(index.size() - e.index_offset);
+    strings += input.path;
+    entries.push_back(e);
+  }
+
+  CatalogHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kCatalogMagic, sizeof(header.magic));
+  header.version = kCatalogVersion;
+  header.header_size = sizeof(CatalogHeader);
+  header.episode_count = static_cast<uint32_t>(entries.size());
+  header.index_stride = indexStride;
+  header.tag_count = static_cast<uint32_t>(tagNames.size());
+  header.chunk_total = chunks.size();
+  header.index_total = index.size();
+  header.strings_bytes = strings.size();
+  header.created_time = std::chrono::duration<double>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+
+  const CatalogLayout layout = catalogLayout(header);
+  std::vector<uint8_t> file(layout.total, 0);
+  std::memcpy(file.data(), &header, sizeof(header));
+  for (size_t i = 0; i < tagNames.size(); i++) {
+    std::memcpy(file.data() + layout.tags + i * kCatalogTagLength, tagNames[i].data(), tagNames[i].size());
+  }
+  std::memcpy(file.data() + layout.entries, entries.data(), entries.size() * sizeof(CatalogEntry));
+  std::memcpy(file.data() + layout.chunks, chunks.data(), chunks.size() * sizeof(CatalogChunk));
+  std::memcpy(file.data() + layout.index, index.data(), index.size() * sizeof(double));
+  std::memcpy(file.data() + layout.strings, strings.data(), strings.size());
+
+  // Write to a temporary name and rename, so readers never map a partial catalog
+  const std::string tmpPath = outPath + ".tmp";
+  const int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot create catalog " + tmpPath + ": " + std::strerror(errno));
+  }
+  const uint8_t* p = file.data();
+  size_t remaining = file.size();
+  while (remaining > 0) {
+    const ssize_t n = ::write(fd, p, remaining);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      const int err = errno;
+      ::close(fd);
+      throw std::runtime_error("Write failed on " + tmpPath + ": " + std::strerror(err));
+    }
+    p += n;
+    remaining -= static_cast<size_t>(n);
+  }
+  ::close(fd);
+  if (std::rename(tmpPath.c_str(), outPath.c_str()) != 0) {
+    throw std::runtime_error("Cannot rename catalog to " + outPath + ": " + std::strerror(errno));
+  }
+  return entries.size();
+}
+
+EpisodeCatalog::EpisodeCatalog(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open catalog " + path + ": " + std::strerror(errno));
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(CatalogHeader)) {
+    ::close(fd);
+    throw std::runtime_error("Catalog " + path + " is too short");
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  void* map = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    throw std::runtime_error("Cannot mmap catalog " + path + ": " + std::strerror(errno));
+  }
+  base_ = static_cast<const uint8_t*>(map);
+  header_ = reinterpret_cast<const CatalogHeader*>(base_);
+
+  if (std::memcmp(header_->magic, kCatalogMagic, sizeof(kCatalogMagic)) != 0 ||
+      header_->version != kCatalogVersion || header_->header_size != sizeof(CatalogHeader) ||
+      header_->index_stride == 0 || header_->tag_count > kMaxCatalogTags ||
+      catalogLayout(*header_).total != size_) {
+    ::munmap(const_cast<uint8_t*>(base_), size_);
+    base_ = nullptr;
+    throw std::runtime_error("Catalog " + path + " has an invalid header");
+  }
+  const CatalogLayout layout = catalogLayout(*header_);
+  tagNames_ = reinterpret_cast<const char (*)[kCatalogTagLength]>(base_ + layout.tags);
+  entries_ = reinterpret_cast<const CatalogEntry*>(base_ + layout.entries);
+  chunks_ = reinterpret_cast<const CatalogChunk*>(base_ + layout.chunks);
+  index_ = reinterpret_cast<const double*>(base_ + layout.index);
+  strings_ = reinterpret_cast<const char*>(base_ + layout.strings);
+}
+
+EpisodeCatalog::~EpisodeCatalog() {
+  if (base_) {
+    ::munmap(const_cast<uint8_t*>(base_), size_);
+  }
+}
+
+std::string EpisodeCatalog::path(size_t episode) const {
+  const CatalogEntry& e = entries_[episode];
+  return std::string(strings_ + e.path_offset, e.path_length);
+}
+
+std::string EpisodeCatalog::armId(size_t episode) const {
+  const char* id = entries_[episode].arm_id;
+  return std::string(id, strnlen(id, kEpisodeArmIdLength));
+}
+
+uint64_t EpisodeCatalog::tagMask(const std::string& tag) const {
+  for (uint32_t i = 0; i < header_->tag_count; i++) {
+    if (tag == std::string(tagNames_[i], strnlen(tagNames_[i], kCatalogTagLength))) {
+      return uint64_t(1) << i;
+    }
+  }
+  return 0;
+}
+
+std::vector<std::string> EpisodeCatalog::tags(size_t episode) const {
+  std::vector<std::string> names;
+  for (uint32_t i = 0; i < header_->tag_count; i++) {
+    if (entries_[episode].tags & (uint64_t(1) << i)) {
+      names.emplace_back(tagNames_[i], strnlen(tagNames_[i], kCatalogTagLength));
+    }
+  }
+  return names;
+}
+
+Span<const CatalogChunk> EpisodeCatalog::chunks(size_t episode) const {
+  const CatalogEntry& e = entries_[episode];
+  return Span<const CatalogChunk>(chunks_ + e.chunk_offset, e.chunk_count);
+}
+
+Span<const double> EpisodeCatalog::timeIndex(size_t episode) const {
+  const CatalogEntry& e = entries_[episode];
+  return Span<const double>(index_ + e.index_offset, e.index_count);
+}
+
+uint64_t EpisodeCatalog::lowerBracket(size_t episode, double t) const {
+  // index[j] is the first entry >= t, so the first sample >= t lies in ((j-1)*S, j*S]
+  const Span<const double> idx = timeIndex(episode);
+  const size_t j = static_cast<size_t>(std::lower_bound(idx.begin(), idx.end(), t) - idx.begin());
+  return j > 0 ? static_cast<uint64_t>(j - 1) * header_->index_stride : 0;
+}
+
+uint64_t EpisodeCatalog::upperBracket(size_t episode, double t) const {
+  // Every sample before index entry j has time < t only up to sample j*S
+  const Span<const double> idx = timeIndex(episode);
+  const size_t j = static_cast<size_t>(std::lower_bound(idx.begin(), idx.end(), t) - idx.begin());
+  return j < idx.size ? static_cast<uint64_t>(j) * header_->index_stride : entries_[episode].sample_count;
+}
+
+size_t EpisodeCatalog::chunkOf(size_t episode, uint64_t sample) const {
+  const Span<const CatalogChunk> c = chunks(episode);
+  size_t lo = 0;
+  size_t hi = c.size;
+  while (hi - lo > 1) {
+    const size_t mid = (lo + hi) / 2;
+    if (c[mid].first_sample <= sample) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+ByteRange EpisodeCatalog::columnBytes(size_t episode, size_t chunk, size_t channel,
+                                      uint64_t first, uint64_t end) const {
+  const CatalogEntry& e = entries_[episode];
+  const CatalogChunk& c = chunks(episode)[chunk];
+  first = std::max(first, c.first_sample);
+  end = std::min(end, c.first_sample + c.sample_count);
+  if (first >= end || channel >= e.channel_count) {
+    return {0, 0};
+  }
+  uint64_t offset = c.offset + sizeof(ChunkHeader);
+  for (size_t ch = 0; ch < channel; ch++) {
+    offset += alignEpisode(size_t(e.column_sizes[ch]) * c.sample_count);
+  }
+  const uint64_t width = e.column_sizes[channel];
+  return {offset + (first - c.first_sample) * width, (end - first) * width};
+}
+
+WindowRange trimWindow(const EpisodeReader& episode, WindowRange range, double t0, double t1) {
+  for (size_t i = 0; i < episode.chunkCount(); i++) {
+    const EpisodeChunk& c = episode.chunk(i);
+    if (c.codec != kCodecRaw && c.first_sample < range.end && c.first_sample + c.sample_count > range.first) {
+      return range;
+    }
+  }
+  range.end = std::min<uint64_t>(range.end, episode.sampleCount());
+  range.first = firstAtOrAfter(episode, range.first, range.end, t0);
+  range.end = firstAtOrAfter(episode, range.first, range.end, t1);
+  return range;
+}
+
+WindowSampler::WindowSampler(const EpisodeCatalog& catalog, double before, double after,
+                             const std::string& armId, uint64_t tagMask, uint64_t seed)
+    : catalog_(catalog), before_(before), after_(after), state_(seed) {
+  double total = 0.0;
+  for (size_t i = 0; i < catalog.size(); i++) {
+    const CatalogEntry& e = catalog.entry(i);
+    const double span = (e.end_time - e.start_time) - (before + after);
+    if (span <= 0.0 || (tagMask & e.tags) != tagMask || (!armId.empty() && armId != catalog.armId(i))) {
+      continue;
+    }
+    total += span;
+    episodes_.push_back(static_cast<uint32_t>(i));
+    cumulative_.push_back(total);
+  }
+}
+
+uint64_t WindowSampler::next() {
+  // splitmix64
+  uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+bool WindowSampler::sample(SampledWindow& out) {
+  if (episodes_.empty()) {
+    return false;
+  }
+  const double u = static_cast<double>(next() >> 11) * 0x1.0p-53 * cumulative_.back();
+  const size_t k = std::min(static_cast<size_t>(std::upper_bound(cumulative_.begin(), cumulative_.end(), u) -
+                                                cumulative_.begin()),
+                            episodes_.size() - 1);
+  const double offset = u - (k > 0 ? cumulative_[k - 1] : 0.0);
+  const uint32_t episode = episodes_[k];
+  out.episode = episode;
+  out.time = catalog_.entry(episode).start_time + before_ + offset;
+  out.range = catalog_.window(episode, out.time - before_, out.time + after_);
+  return true;
+}
+
+}  // namespace shoplifter
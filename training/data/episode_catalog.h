@@ -0,0 +1,243 @@
+/**
+ * Episode Catalog and Time Index
+ *
+ * Compact binary catalog (.catalog) over a collection of .episode files, so
+ * training can sample random time windows without opening or scanning
+ * recordings. For every episode it stores the arm ID, time range, tags, the
+ * chunk table and a sparse time index (the timestamp of every
+ * index_stride-th sample).
+ *
+ *   CatalogHeader                              64 bytes
+ *   char tags[tag_count][32]                   tag names
+ *   CatalogEntry[episode_count]                128 bytes each
+ *   CatalogChunk[chunk_total]                  32 bytes each
+ *   double index[index_total]                  sparse time index
+ *   char strings[strings_bytes]                episode paths
+ *
+ * Every section starts on a 64-byte boundary; the file is mmapped.
+ *
+ * Resolving "window [t0, t1) of episode e" is two binary searches over the
+ * sparse index, giving a sample range that is exact to within index_stride
+ * samples at each end, and from there one byte range per column and chunk.
+ * trimWindow() makes the range exact using the mapped time column.
+ */
+
+#ifndef EPISODE_CATALOG_H
+#define EPISODE_CATALOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "training/data/episode_format.h"
+#include "utils/span.h"
+
+namespace shoplifter {
+
+class EpisodeReader;
+
+constexpr char kCatalogMagic[8] = {'S', 'L', 'C', 'A', 'T', 'L', 'O', 'G'};
+constexpr uint32_t kCatalogVersion = 1;
+constexpr uint32_t kDefaultIndexStride = 64;
+constexpr size_t kCatalogTagLength = 32;
+constexpr size_t kMaxCatalogTags = 64;
+
+struct CatalogHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t episode_count;
+  uint32_t index_stride;           // samples between sparse index entries
+  uint32_t tag_count;
+  uint32_t reserved0;
+  uint64_t chunk_total;
+  uint64_t index_total;
+  uint64_t strings_bytes;
+  double created_time;             // Unix seconds
+};
+
+struct CatalogEntry {
+  char arm_id[kEpisodeArmIdLength];
+  double start_time;               // first sample time
+  double end_time;                 // last sample time
+  uint64_t sample_count;
+  uint64_t file_size;              // size when cataloged; a mismatch means the file changed
+  uint64_t path_offset;            // into the string table
+  uint32_t path_length;
+  uint32_t chunk_count;
+  uint64_t chunk_offset;           // first CatalogChunk of this episode
+  uint64_t index_offset;           // first sparse index entry of this episode
+  uint32_t index_count;
+  uint32_t channel_count;
+  uint8_t column_sizes[kMaxEpisodeChannels];  // bytes per value, per channel
+  uint64_t tags;                   // bit i = tag i of the tag table
+};
+
+struct CatalogChunk {
+  uint64_t offset;                 // file offset of the ChunkHeader
+  uint64_t first_sample;
+  uint32_t sample_count;
+  uint32_t codec;
+  double first_time;
+};
+
+static_assert(sizeof(CatalogHeader) == 64, "CatalogHeader layout");
+static_assert(sizeof(CatalogEntry) == 128, "CatalogEntry layout");
+static_assert(sizeof(CatalogChunk) == 32, "CatalogChunk layout");
+
+/**
+ * One episode to add to a catalog
+ */
+struct CatalogInput {
+  std::string path;
+  std::vector<std::string> tags;
+};
+
+/**
+ * Build a catalog file from episodes (reads only chunk headers and time columns)
+ *
+ * @param inputs Episodes and their tags; unreadable or empty episodes are skipped
+ * @param outPath Catalog file to write
+ * @param indexStride Samples between sparse index entries
+ * @return Number of episodes cataloged
+ * @throws std::runtime_error on write errors or more than 64 distinct tags
+ */
+size_t buildEpisodeCatalog(const std::vector<CatalogInput>& inputs, const std::string& outPath,
+                           uint32_t indexStride = kDefaultIndexStride);
+
+/**
+ * Sample range [first, end) of one episode; end is exclusive
+ */
+struct WindowRange {
+  uint64_t first;
+  uint64_t end;
+};
+
+/**
+ * Contiguous bytes of one column inside one chunk
+ */
+struct ByteRange {
+  uint64_t offset;
+  uint64_t length;
+};
+
+class EpisodeCatalog {
+ public:
+  /**
+   * Map a catalog file
+   *
+   * @throws std::runtime_error if it is missing or malformed
+   */
+  explicit EpisodeCatalog(const std::string& path);
+  ~EpisodeCatalog();
+
+  EpisodeCatalog(const EpisodeCatalog&) = delete;
+  EpisodeCatalog& operator=(const EpisodeCatalog&) = delete;
+
+  size_t size() const { return header_->episode_count; }
+  uint32_t indexStride() const { return header_->index_stride; }
+  const CatalogEntry& entry(size_t episode) const { return entries_[episode]; }
+  std::string path(size_t episode) const;
+  std::string armId(size_t episode) const;
+
+  // Tag bit for a tag name, or 0 if the catalog has no such tag
+  uint64_t tagMask(const std::string& tag) const;
+  std::vector<std::string> tags(size_t episode) const;
+
+  Span<const CatalogChunk> chunks(size_t episode) const;
+  Span<const double> timeIndex(size_t episode) const;
+
+  /**
+   * Resolve a time window from the catalog alone
+   *
+   * The result contains every sample with t0 <= time < t1 and at most
+   * indexStride() extra samples at each end.
+   */
+  WindowRange window(size_t episode, double t0, double t1) const {
+    return {lowerBracket(episode, t0), upperBracket(episode, t1)};
+  }
+
+  /**
+   * Index of the chunk holding a sample
+   */
+  size_t chunkOf(size_t episode, uint64_t sample) const;
+
+  /**
+   * Bytes of samples [first, end) of one column within one chunk
+   *
+   * The range is clamped to the chunk. Only meaningful for raw chunks
+   * (codec 0); compressed chunks must be read whole.
+   */
+  ByteRange columnBytes(size_t episode, size_t chunk, size_t channel, uint64_t first, uint64_t end) const;
+
+ private:
+  uint64_t lowerBracket(size_t episode, double t) const;
+  uint64_t upperBracket(size_t episode, double t) const;
+
+  const uint8_t* base_ = nullptr;
+  size_t size_ = 0;
+  const CatalogHeader* header_ = nullptr;
+  const char (*tagNames_)[kCatalogTagLength] = nullptr;
+  const CatalogEntry* entries_ = nullptr;
+  const CatalogChunk* chunks_ = nullptr;
+  const double* index_ = nullptr;
+  const char* strings_ = nullptr;
+};
+
+/**
+ * Narrow a catalog window to exactly t0 <= time < t1 using the episode's time column
+ *
+ * Chunks that are not raw are left at the catalog's resolution.
+ */
+WindowRange trimWindow(const EpisodeReader& episode, WindowRange range, double t0, double t1);
+
+/**
+ * A sampled training window
+ */
+struct SampledWindow {
+  uint32_t episode;
+  double time;                     // split point between observations and actions
+  WindowRange range;               // samples in [time - before, time + after), catalog resolution
+};
+
+/**
+ * Uniform random windows over the time covered by matching episodes
+ */
+class WindowSampler {
+ public:
+  /**
+   * @param catalog Catalog to sample from (must outlive the sampler)
+   * @param before Observation history in seconds (e.g. 2.0)
+   * @param after Action horizon in seconds (e.g. 1.0)
+   * @param armId Only episodes of this arm, or empty for all
+   * @param tagMask Only episodes carrying all these tags, or 0
+   * @param seed RNG seed
+   */
+  WindowSampler(const EpisodeCatalog& catalog, double before, double after,
+                const std::string& armId = "", uint64_t tagMask = 0, uint64_t seed = 1);
+
+  // Number of episodes long enough to hold a window
+  size_t eligibleEpisodes() const { return episodes_.size(); }
+
+  /**
+   * Draw one window
+   *
+   * @return false if no episode is eligible
+   */
+  bool sample(SampledWindow& out);
+
+ private:
+  uint64_t next();
+
+  const EpisodeCatalog& catalog_;
+  double before_;
+  double after_;
+  std::vector<uint32_t> episodes_;
+  std::vector<double> cumulative_;   // running total of valid start-time span per episode
+  uint64_t state_;
+};
+
+}  // namespace shoplifter
+
+#endif // EPISODE_CATALOG_H
@@ -0,0 +1,332 @@
+/**
+ * Episode Chunk Compression
+ */
+
+#include "training/data/episode_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace shoplifter {
+
+namespace {
+
+constexpr size_t kBlockHeaderBytes = 8;
+
+uint64_t zigzag(int64_t v) {
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v) {
+  return static_cast<int64_t>((v >> 1) ^ (~(v & 1) + 1));
+}
+
+uint64_t valueBits(double v, ColumnType type) {
+  switch (type) {
+    case ColumnType::kFloat64: {
+      uint64_t bits;
+      std::memcpy(&bits, &v, sizeof(bits));
+      return bits;
+    }
+    case ColumnType::kFloat32: {
+      const float f = static_cast<float>(v);
+      uint32_t bits;
+      std::memcpy(&bits, &f, sizeof(bits));
+      return bits;
+    }
+    case ColumnType::kInt64: return static_cast<uint64_t>(static_cast<int64_t>(v));
+    case ColumnType::kUInt32: return static_cast<uint32_t>(v);
+  }
+  return 0;
+}
+
+uint64_t quantizedBits(int64_t q, double step, ColumnType type) {
+  return valueBits(static_cast<double>(q) * step, type);
+}
+
+size_t blockWords(unsigned width, size_t values) {
+  return (width * values + 63) / 64;
+}
+
+// Bytes needed to pack residuals in blocks of kPackedBlockValues
+size_t packedSize(const uint64_t* r, size_t n) {
+  size_t bytes = 0;
+  for (size_t start = 0; start < n; start += kPackedBlockValues) {
+    const size_t k = std::min(kPackedBlockValues, n - start);
+    uint64_t any = 0;
+    for (size_t j = 0; j < k; j++) {
+      any |= r[start + j];
+    }
+    const unsigned width = any ? 64 - __builtin_clzll(any) - __builtin_ctzll(any) : 0;
+    bytes += kBlockHeaderBytes + 8 * blockWords(width, k);
+  }
+  return bytes;
+}
+
+void packBlocks(const uint64_t* r, size_t n, uint8_t* out) {
+  for (size_t start = 0; start < n; start += kPackedBlockValues) {
+    const size_t k = std::min(kPackedBlockValues, n - start);
+    uint64_t any = 0;
+    for (size_t j = 0; j < k; j++) {
+      any |= r[start + j];
+    }
+    const unsigned shift = any ? __builtin_ctzll(any) : 0;
+    const unsigned width = any ? 64 - __builtin_clzll(any) - shift : 0;
+    std::memset(out, 0, kBlockHeaderBytes);
+    out[0] = static_cast<uint8_t>(width);
+    out[1] = static_cast<uint8_t>(shift);
+    out += kBlockHeaderBytes;
+
+    const size_t words = blockWords(width, k);
+    uint64_t packed[kPackedBlockValues];  // at most 128 words (width 64)
+    std::memset(packed, 0, words * 8);
+    if (width > 0) {
+      for (size_t j = 0; j < k; j++) {
+        const uint64_t v = r[start + j] >> shift;
+        const size_t pos = j * width;
+        const size_t word = pos >> 6;
+        const unsigned offset = pos & 63;
+        packed[word] |= v << offset;
+        if (offset + width > 64) {
+          packed[word + 1] |= v >> (64 - offset);
+        }
+      }
+    }
+    std::memcpy(out, packed, words * 8);
+    out += words * 8;
+  }
+}
+
+// Returns bytes consumed, or 0 if the stream is too short or malformed
+size_t unpackBlocks(const uint8_t* in, size_t available, size_t n, uint64_t* r) {
+  const uint8_t* p = in;
+  for (size_t start = 0; start < n; start += kPackedBlockValues) {
+    const size_t k = std::min(kPackedBlockValues, n - start);
+    if (available < kBlockHeaderBytes) {
+      return 0;
+    }
+    const unsigned width = p[0];
+    const unsigned shift = p[1];
+    if (width > 64 || width + shift > 64) {
+      return 0;
+    }
+    const size_t words = blockWords(width, k);
+    if (available < kBlockHeaderBytes + words * 8) {
+      return 0;
+    }
+    p += kBlockHeaderBytes;
+    available -= kBlockHeaderBytes + words * 8;
+
+    uint64_t* out = r + start;
+    if (width == 0) {
+      std::fill(out, out + k, 0);
+      continue;
+    }
+    uint64_t packed[kPackedBlockValues + 1];
+    std::memcpy(packed, p, words * 8);
+    packed[words] = 0;
+    const uint64_t mask = width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+    for (size_t j = 0; j < k; j++) {
+      const size_t pos = j * width;
+      const size_t word = pos >> 6;
+      const unsigned offset = pos & 63;
+      // (x << 1) << (63 - offset) avoids the undefined shift by 64 when offset is 0
+      const uint64_t v = (packed[word] >> offset) | ((packed[word + 1] << 1) << (63 - offset));
+      out[j] = (v & mask) << shift;
+    }
+    p += words * 8;
+  }
+  return static_cast<size_t>(p - in);
+}
+
+struct ColumnPlan {
+  PackedColumnHeader header;
+  std::vector<uint64_t> residuals;
+  size_t bytes;
+};
+
+void planTransform(ColumnTransform transform, const std::vector<uint64_t>& bits, const double* values,
+                   double step, ColumnPlan& plan) {
+  const size_t n = bits.size();
+  std::memset(&plan.header, 0, sizeof(plan.header));
+  plan.header.transform = static_cast<uint8_t>(transform);
+  plan.residuals.clear();
+
+  switch (transform) {
+    case ColumnTransform::kXor:
+      plan.header.first = n ? bits[0] : 0;
+      for (size_t i = 1; i < n; i++) {
+        plan.residuals.push_back(bits[i] ^ bits[i - 1]);
+      }
+      break;
+    case ColumnTransform::kDeltaOfDelta:
+      plan.header.first = n ? bits[0] : 0;
+      plan.header.second = n > 1 ? bits[1] - bits[0] : 0;
+      for (size_t i = 2; i < n; i++) {
+        const uint64_t d = bits[i] - bits[i - 1];
+        const uint64_t prev = bits[i - 1] - bits[i - 2];
+        plan.residuals.push_back(zigzag(static_cast<int64_t>(d - prev)));
+      }
+      break;
+    case ColumnTransform::kQuantizedDelta: {
+      plan.header.step = step;
+      int64_t prev = 0;
+      for (size_t i = 0; i < n; i++) {
+        const int64_t q = std::llround(values[i] / step);
+        if (i == 0) {
+          plan.header.first = static_cast<uint64_t>(q);
+        } else {
+          plan.residuals.push_back(zigzag(q - prev));
+        }
+        prev = q;
+      }
+      break;
+    }
+  }
+  plan.bytes = packedSize(plan.residuals.data(), plan.residuals.size());
+}
+
+bool quantizable(const double* values, size_t n, double step) {
+  for (size_t i = 0; i < n; i++) {
+    if (!std::isfinite(values[i]) || std::fabs(values[i] / step) > 0x1p50) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void encodePackedChunk(const EpisodeSchema& schema, const double* const* columns, size_t sampleCount,
+                       const EpisodeCodecOptions& options, std::vector<uint8_t>& out) {
+  const size_t channelCount = schema.channels.size();
+  std::vector<ColumnPlan> plans(channelCount);
+  std::vector<uint64_t> bits(sampleCount);
+  ColumnPlan candidate;
+
+  for (size_t c = 0; c < channelCount; c++) {
+    const ColumnType type = schema.channels[c].type;
+    for (size_t i = 0; i < sampleCount; i++) {
+      bits[i] = valueBits(columns[c][i], type);
+    }
+
+    planTransform(ColumnTransform::kXor, bits, columns[c], 0.0, plans[c]);
+    planTransform(ColumnTransform::kDeltaOfDelta, bits, columns[c], 0.0, candidate);
+    if (candidate.bytes < plans[c].bytes) {
+      std::swap(plans[c], candidate);
+    }
+    const bool isFloat = type == ColumnType::kFloat64 || type == ColumnType::kFloat32;
+    if (options.quantizeStep > 0.0 && isFloat && c != schema.time_channel &&
+        quantizable(columns[c], sampleCount, options.quantizeStep)) {
+      planTransform(ColumnTransform::kQuantizedDelta, bits, columns[c], options.quantizeStep, candidate);
+      if (candidate.bytes < plans[c].bytes) {
+        std::swap(plans[c], candidate);
+      }
+    }
+    plans[c].header.bytes = static_cast<uint32_t>(plans[c].bytes);
+  }
+
+  size_t payload = channelCount * sizeof(PackedColumnHeader);
+  for (const ColumnPlan& plan : plans) {
+    payload += plan.bytes;
+  }
+  payload = alignEpisode(payload);
+
+  out.assign(sizeof(ChunkHeader) + payload + sizeof(ChunkFooter), 0);
+  uint8_t* p = out.data() + sizeof(ChunkHeader);
+  for (const ColumnPlan& plan : plans) {
+    std::memcpy(p, &plan.header, sizeof(plan.header));
+    p += sizeof(plan.header);
+  }
+  for (const ColumnPlan& plan : plans) {
+    packBlocks(plan.residuals.data(), plan.residuals.size(), p);
+    p += plan.bytes;
+  }
+
+  ChunkHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kChunkMagic, sizeof(header.magic));
+  header.sample_count = static_cast<uint32_t>(sampleCount);
+  header.payload_bytes = payload;
+  header.first_time = sampleCount ? columns[schema.time_channel][0] : NAN;
+  header.last_time = sampleCount ? columns[schema.time_channel][sampleCount - 1] : NAN;
+  header.codec = kCodecPacked;
+  std::memcpy(out.data(), &header, sizeof(header));
+
+  ChunkFooter footer;
+  std::memset(&footer, 0, sizeof(footer));
+  std::memcpy(footer.magic, kChunkFooterMagic, sizeof(footer.magic));
+  footer.sample_count = header.sample_count;
+  footer.payload_bytes = payload;
+  footer.crc32 = episodeCrc32(out.data() + sizeof(ChunkHeader), payload);
+  std::memcpy(out.data() + sizeof(ChunkHeader) + payload, &footer, sizeof(footer));
+}
+
+bool decodePackedColumn(const uint8_t* payload, size_t payloadBytes, size_t channelCount,
+                        size_t channel, ColumnType type, size_t sampleCount, uint64_t* bits) {
+  const size_t headersBytes = channelCount * sizeof(PackedColumnHeader);
+  if (channel >= channelCount || payloadBytes < headersBytes) {
+    return false;
+  }
+  size_t offset = headersBytes;
+  PackedColumnHeader header;
+  for (size_t c = 0; c <= channel; c++) {
+    std::memcpy(&header, payload + c * sizeof(PackedColumnHeader), sizeof(header));
+    if (c < channel) {
+      offset += header.bytes;
+    }
+  }
+  if (offset > payloadBytes || header.bytes > payloadBytes - offset) {
+    return false;
+  }
+  if (sampleCount == 0) {
+    return true;
+  }
+
+  const uint8_t* stream = payload + offset;
+  const auto transform = static_cast<ColumnTransform>(header.transform);
+  switch (transform) {
+    case ColumnTransform::kXor: {
+      bits[0] = header.first;
+      if (unpackBlocks(stream, header.bytes, sampleCount - 1, bits + 1) != header.bytes) {
+        return false;
+      }
+      for (size_t i = 1; i < sampleCount; i++) {
+        bits[i] ^= bits[i - 1];
+      }
+      return true;
+    }
+    case ColumnTransform::kDeltaOfDelta: {
+      bits[0] = header.first;
+      if (sampleCount == 1) {
+        return header.bytes == 0;
+      }
+      bits[1] = header.first + header.second;
+      if (unpackBlocks(stream, header.bytes, sampleCount - 2, bits + 2) != header.bytes) {
+        return false;
+      }
+      uint64_t delta = header.second;
+      for (size_t i = 2; i < sampleCount; i++) {
+        delta += static_cast<uint64_t>(unzigzag(bits[i]));
+        bits[i] = bits[i - 1] + delta;
+      }
+      return true;
+    }
+    case ColumnTransform::kQuantizedDelta: {
+      if (unpackBlocks(stream, header.bytes, sampleCount - 1, bits + 1) != header.bytes) {
+        return false;
+      }
+      int64_t q = static_cast<int64_t>(header.first);
+      bits[0] = quantizedBits(q, header.step, type);
+      for (size_t i = 1; i < sampleCount; i++) {
+        q += unzigzag(bits[i]);
+        bits[i] = quantizedBits(q, header.step, type);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace shoplifter
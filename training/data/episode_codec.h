@@ -0,0 +1,95 @@
+/**
+ * Episode Chunk Compression
+ *
+ * Packed chunk codec (ChunkHeader::codec = kCodecPacked) for slowly changing
+ * telemetry. Each column is turned into small residuals by one of:
+ *
+ *   kXor             XOR with the previous value's bits (Gorilla-style floats)
+ *   kDeltaOfDelta    second difference of the integer bit patterns (timestamps,
+ *                    counters; lossless for positive doubles of one binade)
+ *   kQuantizedDelta  round(value / step), then first differences; lossy, the
+ *                    error is bounded by step / 2 (opt-in, e.g. 1e-4 rad)
+ *
+ * The encoder tries every allowed transform per column and keeps the
+ * smallest. Residuals are zigzag coded where signed and bit-packed in blocks
+ * of 128 at the block's minimal width, after removing common trailing zero
+ * bits. Every value of a block has the same width, so unpacking has no
+ * per-value branches, unlike Gorilla's per-value control bits.
+ *
+ * Payload layout:
+ *
+ *   PackedColumnHeader[channel_count]          32 bytes each
+ *   column 0 .. column N-1 streams, each a sequence of blocks:
+ *     uint8 width, uint8 shift, uint8 pad[6]
+ *     uint64 words[ceil(width * values / 64)]
+ *
+ * Values are handled as 64-bit patterns of their column type (float32 and
+ * uint32 zero-extended), so every column type round-trips bit-exactly
+ * unless quantization is requested.
+ */
+
+#ifndef EPISODE_CODEC_H
+#define EPISODE_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "training/data/episode_format.h"
+
+namespace shoplifter {
+
+constexpr uint32_t kCodecRaw = 0;
+constexpr uint32_t kCodecPacked = 1;
+constexpr size_t kPackedBlockValues = 128;
+
+enum class ColumnTransform : uint8_t {
+  kXor = 1,
+  kDeltaOfDelta = 2,
+  kQuantizedDelta = 3,
+};
+
+struct PackedColumnHeader {
+  uint8_t transform;               // ColumnTransform
+  uint8_t reserved[3];
+  uint32_t bytes;                  // size of this column's block stream
+  double step;                     // quantization step (kQuantizedDelta)
+  uint64_t first;                  // first value (bits, or quantized integer)
+  uint64_t second;                 // first delta (kDeltaOfDelta)
+};
+
+static_assert(sizeof(PackedColumnHeader) == 32, "PackedColumnHeader layout");
+
+struct EpisodeCodecOptions {
+  uint32_t codec = kCodecRaw;
+  // > 0 allows kQuantizedDelta for float columns other than the time channel
+  double quantizeStep = 0.0;
+};
+
+/**
+ * Serialize one packed chunk (header, packed payload, footer)
+ *
+ * @param columns One pointer per channel to sampleCount doubles (converted to the column type)
+ * @param out Resized to the chunk size
+ */
+void encodePackedChunk(const EpisodeSchema& schema, const double* const* columns, size_t sampleCount,
+                       const EpisodeCodecOptions& options, std::vector<uint8_t>& out);
+
+/**
+ * Decode one column of a packed chunk payload into 64-bit value patterns
+ *
+ * @param payload Bytes after the ChunkHeader
+ * @param payloadBytes ChunkHeader::payload_bytes
+ * @param channelCount Number of schema channels
+ * @param channel Column to decode
+ * @param type Column type (needed to rebuild quantized values)
+ * @param sampleCount ChunkHeader::sample_count
+ * @param bits Receives sampleCount patterns (float32/uint32 in the low 32 bits)
+ * @return false if the payload is malformed
+ */
+bool decodePackedColumn(const uint8_t* payload, size_t payloadBytes, size_t channelCount,
+                        size_t channel, ColumnType type, size_t sampleCount, uint64_t* bits);
+
+}  // namespace shoplifter
+
+#endif // EPISODE_CODEC_H
@@ -0,0 +1,81 @@
+/**
+ * Columnar Episode Recording Format
+ *
+ * Schema helpers and checksums shared by the episode writer and reader.
+ */
+
+#include "training/data/episode_format.h"
+
+namespace shoplifter {
+
+size_t columnTypeSize(ColumnType type) {
+  switch (type) {
+    case ColumnType::kFloat64: return 8;
+    case ColumnType::kFloat32: return 4;
+    case ColumnType::kInt64: return 8;
+    case ColumnType::kUInt32: return 4;
+  }
+  return 0;
+}
+
+int EpisodeSchema::find(const std::string& name) const {
+  for (size_t i = 0; i < channels.size(); i++) {
+    if (channels[i].name == name) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+const EpisodeSchema& positionSchema() {
+  static const EpisodeSchema schema = [] {
+    EpisodeSchema s;
+    const char* names[kPositionChannelCount] = {
+      "host_time", "device_ms", "b", "s", "e", "t", "r", "g", "x", "y", "z", "tilt",
+    };
+    for (const char* name : names) {
+      s.channels.push_back({name, ColumnType::kFloat64});
+    }
+    s.time_channel = kChannelHostTime;
+    return s;
+  }();
+  return schema;
+}
+
+size_t rawChunkPayloadBytes(const EpisodeSchema& schema, size_t sampleCount) {
+  size_t bytes = 0;
+  for (const auto& channel : schema.channels) {
+    bytes += alignEpisode(columnTypeSize(channel.type) * sampleCount);
+  }
+  return bytes;
+}
+
+namespace {
+
+struct Crc32Table {
+  uint32_t entries[256];
+
+  Crc32Table() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      entries[i] = c;
+    }
+  }
+};
+
+}  // namespace
+
+uint32_t episodeCrc32(const void* data, size_t length, uint32_t crc) {
+  static const Crc32Table table;
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc = table.entries[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+}  // namespace shoplifter
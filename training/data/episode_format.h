@@ -0,0 +1,153 @@
+/**
+ * Columnar Episode Recording Format
+ *
+ * On-disk layout of a recorded episode (.episode). All integers are
+ * little-endian and every section starts on a 64-byte boundary, so a reader
+ * can mmap the file and use the columns in place.
+ *
+ *   EpisodeFileHeader                      512 bytes: schema and arm identity
+ *   repeated chunks:
+ *     ChunkHeader                          64 bytes: sample count, time range
+ *     column 0 .. column N-1               typed arrays, each padded to 64 bytes
+ *     ChunkFooter                          64 bytes: commit marker and CRC32
+ *
+ * Chunks are appended sequentially. A chunk counts as written only once its
+ * footer matches its header, so a recording cut short by a crash or power
+ * loss still opens, minus the torn last chunk.
+ */
+
+#ifndef EPISODE_FORMAT_H
+#define EPISODE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace shoplifter {
+
+constexpr char kEpisodeMagic[8] = {'S', 'L', 'E', 'P', 'I', 'S', 'O', 'D'};
+constexpr char kChunkMagic[4] = {'C', 'H', 'N', 'K'};
+constexpr char kChunkFooterMagic[4] = {'C', 'E', 'N', 'D'};
+
+constexpr uint32_t kEpisodeFormatVersion = 1;
+constexpr size_t kEpisodeAlignment = 64;
+constexpr size_t kMaxEpisodeChannels = 16;
+constexpr size_t kChannelNameLength = 16;
+constexpr size_t kEpisodeArmIdLength = 32;
+
+/**
+ * Element type of a column
+ */
+enum class ColumnType : uint8_t {
+  kFloat64 = 1,
+  kFloat32 = 2,
+  kInt64 = 3,
+  kUInt32 = 4,
+};
+
+size_t columnTypeSize(ColumnType type);
+
+struct ChannelDescriptor {
+  char name[kChannelNameLength];   // NUL-padded
+  uint8_t type;                    // ColumnType
+  uint8_t reserved[7];
+};
+
+struct EpisodeFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t channel_count;
+  uint32_t time_channel;           // index of the timestamp column
+  char arm_id[kEpisodeArmIdLength];
+  double created_time;             // Unix seconds when the writer opened the file
+  uint8_t reserved[64];
+  ChannelDescriptor channels[kMaxEpisodeChannels];
+};
+
+struct ChunkHeader {
+  char magic[4];
+  uint32_t sample_count;
+  uint64_t payload_bytes;          // bytes between this header and the footer
+  double first_time;               // time_channel value of the first sample
+  double last_time;                // time_channel value of the last sample
+  uint32_t codec;                  // 0 = raw columns
+  uint8_t reserved[28];
+};
+
+struct ChunkFooter {
+  char magic[4];
+  uint32_t sample_count;
+  uint64_t payload_bytes;
+  uint32_t crc32;                  // CRC32 of the payload
+  uint8_t reserved[44];
+};
+
+static_assert(sizeof(ChannelDescriptor) == 24, "ChannelDescriptor layout");
+static_assert(sizeof(EpisodeFileHeader) == 512, "EpisodeFileHeader layout");
+static_assert(sizeof(ChunkHeader) == 64, "ChunkHeader layout");
+static_assert(sizeof(ChunkFooter) == 64, "ChunkFooter layout");
+
+/**
+ * Column names and types of an episode
+ */
+struct EpisodeSchema {
+  struct Channel {
+    std::string name;
+    ColumnType type;
+  };
+  std::vector<Channel> channels;
+  uint32_t time_channel = 0;
+
+  int find(const std::string& name) const;
+};
+
+/**
+ * Channels of the arm position schema, in column order
+ */
+enum PositionChannel : uint32_t {
+  kChannelHostTime = 0,   // Unix seconds on the host
+  kChannelDeviceMs,       // ESP32 millis(), NaN when the firmware did not send it
+  kChannelBase,
+  kChannelShoulder,
+  kChannelElbow,
+  kChannelWrist,
+  kChannelRoll,
+  kChannelGripper,
+  kChannelX,
+  kChannelY,
+  kChannelZ,
+  kChannelTilt,
+  kPositionChannelCount,
+};
+
+/**
+ * Schema for follower arm position recordings (all columns float64)
+ */
+const EpisodeSchema& positionSchema();
+
+/**
+ * Round up to the format alignment
+ */
+inline size_t alignEpisode(size_t n) {
+  return (n + kEpisodeAlignment - 1) & ~(kEpisodeAlignment - 1);
+}
+
+/**
+ * Payload size of a raw chunk with the given sample count
+ */
+size_t rawChunkPayloadBytes(const EpisodeSchema& schema, size_t sampleCount);
+
+/**
+ * CRC32 (IEEE, reflected) used for chunk payloads
+ *
+ * @param data Bytes to checksum
+ * @param length Number of bytes
+ * @param crc Running CRC from a previous call, or 0
+ */
+uint32_t episodeCrc32(const void* data, size_t length, uint32_t crc = 0);
+
+}  // namespace shoplifter
+
+#endif // EPISODE_FORMAT_H
@@ -0,0 +1,174 @@
+/**
+ * Episode Reader
+ */
+
+#include "training/data/episode_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace shoplifter {
+
+EpisodeReader::EpisodeReader(const std::string& path, bool verifyChecksums) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open episode " + path + ": " + std::strerror(errno));
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw std::runtime_error("Cannot stat episode " + path + ": " + std::strerror(errno));
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ < sizeof(EpisodeFileHeader)) {
+    ::close(fd);
+    throw std::runtime_error("Episode " + path + " is too short");
+  }
+  void* map = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    throw std::runtime_error("Cannot mmap episode " + path + ": " + std::strerror(errno));
+  }
+  base_ = static_cast<const uint8_t*>(map);
+  header_ = reinterpret_cast<const EpisodeFileHeader*>(base_);
+
+  if (std::memcmp(header_->magic, kEpisodeMagic, sizeof(kEpisodeMagic)) != 0 ||
+      header_->version != kEpisodeFormatVersion ||
+      header_->header_size != sizeof(EpisodeFileHeader) ||
+      header_->channel_count == 0 || header_->channel_count > kMaxEpisodeChannels ||
+      header_->time_channel >= header_->channel_count) {
+    release();
+    throw std::runtime_error("Episode " + path + " has an invalid header");
+  }
+
+  for (uint32_t c = 0; c < header_->channel_count; c++) {
+    const ChannelDescriptor& d = header_->channels[c];
+    const ColumnType type = static_cast<ColumnType>(d.type);
+    if (columnTypeSize(type) == 0) {
+      release();
+      throw std::runtime_error("Episode " + path + " has an unknown column type");
+    }
+    schema_.channels.push_back({std::string(d.name, strnlen(d.name, kChannelNameLength)), type});
+  }
+  schema_.time_channel = header_->time_channel;
+
+  // Walk committed chunks; stop at the first torn or corrupt one
+  uint64_t offset = header_->header_size;
+  while (offset + sizeof(ChunkHeader) + sizeof(ChunkFooter) <= size_) {
+    const ChunkHeader* ch = reinterpret_cast<const ChunkHeader*>(base_ + offset);
+    if (std::memcmp(ch->magic, kChunkMagic, sizeof(kChunkMagic)) != 0 ||
+        ch->payload_bytes > size_ - offset - sizeof(ChunkHeader) - sizeof(ChunkFooter)) {
+      break;
+    }
+    if (ch->codec == 0 && ch->payload_bytes != rawChunkPayloadBytes(schema_, ch->sample_count)) {
+      break;
+    }
+    const uint64_t footerOffset = offset + sizeof(ChunkHeader) + ch->payload_bytes;
+    const ChunkFooter* footer = reinterpret_cast<const ChunkFooter*>(base_ + footerOffset);
+    if (std::memcmp(footer->magic, kChunkFooterMagic, sizeof(kChunkFooterMagic)) != 0 ||
+        footer->sample_count != ch->sample_count || footer->payload_bytes != ch->payload_bytes) {
+      break;
+    }
+    if (verifyChecksums &&
+        episodeCrc32(base_ + offset + sizeof(ChunkHeader), ch->payload_bytes) != footer->crc32) {
+      break;
+    }
+    chunks_.push_back({offset, sampleCount_, ch->sample_count, ch->codec, ch->first_time, ch->last_time});
+    sampleCount_ += ch->sample_count;
+    offset = footerOffset + sizeof(ChunkFooter);
+  }
+  truncated_ = offset != size_;
+}
+
+EpisodeReader::~EpisodeReader() {
+  release();
+}
+
+EpisodeReader::EpisodeReader(EpisodeReader&& other) noexcept {
+  *this = std::move(other);
+}
+
+EpisodeReader& EpisodeReader::operator=(EpisodeReader&& other) noexcept {
+  if (this != &other) {
+    release();
+    base_ = std::exchange(other.base_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    header_ = std::exchange(other.header_, nullptr);
+    schema_ = std::move(other.schema_);
+    chunks_ = std::move(other.chunks_);
+    sampleCount_ = std::exchange(other.sampleCount_, 0);
+    truncated_ = other.truncated_;
+  }
+  return *this;
+}
+
+void EpisodeReader::release() {
+  if (base_) {
+    ::munmap(const_cast<uint8_t*>(base_), size_);
+    base_ = nullptr;
+    header_ = nullptr;
+  }
+}
+
+std::string EpisodeReader::armId() const {
+  return std::string(header_->arm_id, strnlen(header_->arm_id, kEpisodeArmIdLength));
+}
+
+const uint8_t* EpisodeReader::columnAddress(size_t chunkIndex, size_t channel, ColumnType expected) const {
+  if (chunkIndex >= chunks_.size() || channel >= schema_.channels.size()) {
+    throw std::runtime_error("Episode column index out of range");
+  }
+  if (schema_.channels[channel].type != expected) {
+    throw std::runtime_error("Episode column " + schema_.channels[channel].name + " has a different type");
+  }
+  const EpisodeChunk& chunk = chunks_[chunkIndex];
+  if (chunk.codec != kCodecRaw) {
+    throw std::runtime_error("Episode chunk is compressed; use decodeColumn() instead of mapping columns");
+  }
+  size_t offset = chunk.offset + sizeof(ChunkHeader);
+  for (size_t c = 0; c < channel; c++) {
+    offset += alignEpisode(columnTypeSize(schema_.channels[c].type) * chunk.sample_count);
+  }
+  return base_ + offset;
+}
+
+Span<const double> EpisodeReader::column(size_t channel) const {
+  if (chunks_.empty()) {
+    return Span<const double>();
+  }
+  if (chunks_.size() != 1) {
+    throw std::runtime_error("Episode has several chunks; use column(chunk, channel) or copyColumn()");
+  }
+  return column<double>(0, channel);
+}
+
+void EpisodeReader::decodeBits(size_t chunkIndex, size_t channel, ColumnType expected, uint64_t* bits) const {
+  if (chunkIndex >= chunks_.size() || channel >= schema_.channels.size()) {
+    throw std::runtime_error("Episode column index out of range");
+  }
+  if (schema_.channels[channel].type != expected) {
+    throw std::runtime_error("Episode column " + schema_.channels[channel].name + " has a different type");
+  }
+  const EpisodeChunk& chunk = chunks_[chunkIndex];
+  const ChunkHeader* header = reinterpret_cast<const ChunkHeader*>(base_ + chunk.offset);
+  if (chunk.codec != kCodecPacked ||
+      !decodePackedColumn(base_ + chunk.offset + sizeof(ChunkHeader), header->payload_bytes,
+                          schema_.channels.size(), channel, expected, chunk.sample_count, bits)) {
+    throw std::runtime_error("Episode chunk has an unsupported codec or a corrupt payload");
+  }
+}
+
+void EpisodeReader::copyColumn(size_t channel, double* out) const {
+  for (size_t i = 0; i < chunks_.size(); i++) {
+    decodeColumn(i, channel, out + chunks_[i].first_sample);
+  }
+}
+
+}  // namespace shoplifter
@@ -0,0 +1,156 @@
+/**
+ * Episode Reader
+ *
+ * Memory-maps a columnar .episode file (see episode_format.h) and hands out
+ * zero-copy spans over its columns. Opening only walks the chunk headers, so
+ * load time is independent of the episode length apart from page faults on
+ * the columns actually touched.
+ */
+
+#ifndef EPISODE_READER_H
+#define EPISODE_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "training/data/episode_codec.h"
+#include "training/data/episode_format.h"
+#include "utils/span.h"
+
+namespace shoplifter {
+
+/**
+ * Location of one committed chunk in the mapped file
+ */
+struct EpisodeChunk {
+  uint64_t offset;          // file offset of the ChunkHeader
+  uint64_t first_sample;    // index of the chunk's first sample in the episode
+  uint32_t sample_count;
+  uint32_t codec;
+  double first_time;
+  double last_time;
+};
+
+class EpisodeReader {
+ public:
+  /**
+   * Map an episode file
+   *
+   * @param path Episode file path
+   * @param verifyChecksums Check the CRC32 of every chunk (touches all pages)
+   * @throws std::runtime_error if the file is missing or its header is invalid
+   */
+  explicit EpisodeReader(const std::string& path, bool verifyChecksums = false);
+  ~EpisodeReader();
+
+  EpisodeReader(const EpisodeReader&) = delete;
+  EpisodeReader& operator=(const EpisodeReader&) = delete;
+  EpisodeReader(EpisodeReader&& other) noexcept;
+  EpisodeReader& operator=(EpisodeReader&& other) noexcept;
+
+  const EpisodeFileHeader& header() const { return *header_; }
+  std::string armId() const;
+  const EpisodeSchema& schema() const { return schema_; }
+
+  size_t sampleCount() const { return sampleCount_; }
+  size_t chunkCount() const { return chunks_.size(); }
+  const EpisodeChunk& chunk(size_t i) const { return chunks_[i]; }
+
+  // True if trailing bytes after the last committed chunk were ignored
+  bool truncated() const { return truncated_; }
+
+  /**
+   * Zero-copy view of one column within one chunk
+   *
+   * @param chunkIndex Chunk index
+   * @param channel Channel index in the schema
+   * @throws std::runtime_error if T does not match the column type or the chunk is compressed
+   */
+  template <typename T>
+  Span<const T> column(size_t chunkIndex, size_t channel) const;
+
+  /**
+   * Zero-copy view of a whole float64 column
+   *
+   * Only possible when the episode has a single chunk (the usual case for
+   * demonstrations shorter than one chunk); otherwise use column(chunk, channel)
+   * or copyColumn().
+   *
+   * @throws std::runtime_error if the episode has more than one chunk
+   */
+  Span<const double> column(size_t channel) const;
+
+  /**
+   * Copy (decoding if needed) one column of one chunk
+   *
+   * Works for raw and packed chunks alike.
+   *
+   * @param chunkIndex Chunk index
+   * @param channel Channel index in the schema
+   * @param out Destination with room for the chunk's sample count
+   * @throws std::runtime_error if T does not match the column type or the chunk is corrupt
+   */
+  template <typename T>
+  void decodeColumn(size_t chunkIndex, size_t channel, T* out) const;
+
+  /**
+   * Copy a float64 column across all chunks, decoding compressed chunks
+   *
+   * @param channel Channel index in the schema
+   * @param out Destination with room for sampleCount() values
+   */
+  void copyColumn(size_t channel, double* out) const;
+
+  /**
+   * Base address and size of the mapping
+   */
+  const uint8_t* data() const { return base_; }
+  size_t size() const { return size_; }
+
+ private:
+  const uint8_t* columnAddress(size_t chunkIndex, size_t channel, ColumnType expected) const;
+  void decodeBits(size_t chunkIndex, size_t channel, ColumnType expected, uint64_t* bits) const;
+  void release();
+
+  const uint8_t* base_ = nullptr;
+  size_t size_ = 0;
+  const EpisodeFileHeader* header_ = nullptr;
+  EpisodeSchema schema_;
+  std::vector<EpisodeChunk> chunks_;
+  size_t sampleCount_ = 0;
+  bool truncated_ = false;
+};
+
+template <typename T>
+struct ColumnTypeOf;
+template <> struct ColumnTypeOf<double> { static constexpr ColumnType value = ColumnType::kFloat64; };
+template <> struct ColumnTypeOf<float> { static constexpr ColumnType value = ColumnType::kFloat32; };
+template <> struct ColumnTypeOf<int64_t> { static constexpr ColumnType value = ColumnType::kInt64; };
+template <> struct ColumnTypeOf<uint32_t> { static constexpr ColumnType value = ColumnType::kUInt32; };
+
+template <typename T>
+Span<const T> EpisodeReader::column(size_t chunkIndex, size_t channel) const {
+  const uint8_t* p = columnAddress(chunkIndex, channel, ColumnTypeOf<T>::value);
+  return Span<const T>(reinterpret_cast<const T*>(p), chunks_[chunkIndex].sample_count);
+}
+
+template <typename T>
+void EpisodeReader::decodeColumn(size_t chunkIndex, size_t channel, T* out) const {
+  if (chunkIndex < chunks_.size() && chunks_[chunkIndex].codec == kCodecRaw) {
+    const Span<const T> span = column<T>(chunkIndex, channel);
+    std::memcpy(out, span.data, span.size * sizeof(T));
+    return;
+  }
+  std::vector<uint64_t> bits(chunkIndex < chunks_.size() ? chunks_[chunkIndex].sample_count : 0);
+  decodeBits(chunkIndex, channel, ColumnTypeOf<T>::value, bits.data());
+  for (size_t i = 0; i < bits.size(); i++) {
+    std::memcpy(&out[i], &bits[i], sizeof(T));  // little-endian: low bytes hold 32-bit types
+  }
+}
+
+}  // namespace shoplifter
+
+#endif // EPISODE_READER_H
@@ -0,0 +1,221 @@
+/**
+ * Episode Writer
+ */
+
+#include "training/data/episode_writer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "hardware/telemetry/position_parser.h"
+
+namespace shoplifter {
+
+namespace {
+
+template <typename T>
+void storeColumn(uint8_t* dst, const double* src, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    const T v = static_cast<T>(src[i]);
+    std::memcpy(dst + i * sizeof(T), &v, sizeof(T));
+  }
+}
+
+}  // namespace
+
+EpisodeFileHeader makeEpisodeHeader(const std::string& armId, const EpisodeSchema& schema) {
+  if (schema.channels.empty() || schema.channels.size() > kMaxEpisodeChannels) {
+    throw std::runtime_error("Episode schema must have 1 to 16 channels");
+  }
+  if (schema.time_channel >= schema.channels.size()) {
+    throw std::runtime_error("Episode schema time channel out of range");
+  }
+
+  EpisodeFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kEpisodeMagic, sizeof(header.magic));
+  header.version = kEpisodeFormatVersion;
+  header.header_size = sizeof(EpisodeFileHeader);
+  header.channel_count = static_cast<uint32_t>(schema.channels.size());
+  header.time_channel = schema.time_channel;
+  std::strncpy(header.arm_id, armId.c_str(), kEpisodeArmIdLength - 1);
+  header.created_time = std::chrono::duration<double>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  for (size_t i = 0; i < schema.channels.size(); i++) {
+    std::strncpy(header.channels[i].name, schema.channels[i].name.c_str(), kChannelNameLength - 1);
+    header.channels[i].type = static_cast<uint8_t>(schema.channels[i].type);
+  }
+  return header;
+}
+
+size_t rawChunkBytes(const EpisodeSchema& schema, size_t sampleCount) {
+  return sizeof(ChunkHeader) + rawChunkPayloadBytes(schema, sampleCount) + sizeof(ChunkFooter);
+}
+
+void encodeRawChunk(const EpisodeSchema& schema, const double* const* columns,
+                    size_t sampleCount, std::vector<uint8_t>& out) {
+  out.resize(rawChunkBytes(schema, sampleCount));
+  encodeRawChunk(schema, columns, sampleCount, out.data());
+}
+
+void encodeRawChunk(const EpisodeSchema& schema, const double* const* columns,
+                    size_t sampleCount, uint8_t* out) {
+  const size_t payload = rawChunkPayloadBytes(schema, sampleCount);
+
+  uint8_t* column = out + sizeof(ChunkHeader);
+  for (size_t c = 0; c < schema.channels.size(); c++) {
+    const ColumnType type = schema.channels[c].type;
+    switch (type) {
+      case ColumnType::kFloat64: storeColumn<double>(column, columns[c], sampleCount); break;
+      case ColumnType::kFloat32: storeColumn<float>(column, columns[c], sampleCount); break;
+      case ColumnType::kInt64: storeColumn<int64_t>(column, columns[c], sampleCount); break;
+      case ColumnType::kUInt32: storeColumn<uint32_t>(column, columns[c], sampleCount); break;
+    }
+    const size_t bytes = columnTypeSize(type) * sampleCount;
+    std::memset(column + bytes, 0, alignEpisode(bytes) - bytes);
+    column += alignEpisode(bytes);
+  }
+
+  ChunkHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kChunkMagic, sizeof(header.magic));
+  header.sample_count = static_cast<uint32_t>(sampleCount);
+  header.payload_bytes = payload;
+  header.first_time = sampleCount ? columns[schema.time_channel][0] : NAN;
+  header.last_time = sampleCount ? columns[schema.time_channel][sampleCount - 1] : NAN;
+  header.codec = 0;
+  std::memcpy(out, &header, sizeof(header));
+
+  ChunkFooter footer;
+  std::memset(&footer, 0, sizeof(footer));
+  std::memcpy(footer.magic, kChunkFooterMagic, sizeof(footer.magic));
+  footer.sample_count = header.sample_count;
+  footer.payload_bytes = payload;
+  footer.crc32 = episodeCrc32(out + sizeof(ChunkHeader), payload);
+  std::memcpy(out + sizeof(ChunkHeader) + payload, &footer, sizeof(footer));
+}
+
+EpisodeWriter::EpisodeWriter(const std::string& path, const std::string& armId,
+                             const EpisodeSchema& schema, size_t chunkSamples,
+                             const EpisodeCodecOptions& codec)
+    : schema_(schema), chunkSamples_(chunkSamples ? chunkSamples : kDefaultChunkSamples), codec_(codec),
+      path_(path) {
+  const EpisodeFileHeader header = makeEpisodeHeader(armId, schema_);
+
+  fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    throw std::runtime_error("Cannot create episode " + path + ": " + std::strerror(errno));
+  }
+  writeAll(&header, sizeof(header));
+
+  columns_.resize(schema_.channels.size());
+  for (auto& column : columns_) {
+    column.resize(chunkSamples_);
+  }
+}
+
+EpisodeWriter::~EpisodeWriter() {
+  try {
+    close();
+  } catch (...) {
+    // Destructors must not throw; call close() explicitly to see I/O errors
+  }
+}
+
+void EpisodeWriter::append(const double* values) {
+  if (fd_ < 0) {
+    throw std::runtime_error("Episode " + path_ + " is closed");
+  }
+  for (size_t c = 0; c < columns_.size(); c++) {
+    columns_[c][buffered_] = values[c];
+  }
+  if (++buffered_ == chunkSamples_) {
+    flush();
+  }
+}
+
+void positionSampleValues(const PositionSample& sample, double* values) {
+  const bool hasMs = (sample.fields & kFieldDeviceMs) != 0;
+  values[kChannelHostTime] = (sample.fields & kFieldHostTime) ? sample.host_time
+                             : hasMs ? sample.device_ms / 1000.0 : NAN;
+  values[kChannelDeviceMs] = hasMs ? sample.device_ms : NAN;
+  values[kChannelBase] = sample.b;
+  values[kChannelShoulder] = sample.s;
+  values[kChannelElbow] = sample.e;
+  values[kChannelWrist] = sample.t;
+  values[kChannelRoll] = sample.r;
+  values[kChannelGripper] = sample.g;
+  values[kChannelX] = sample.x;
+  values[kChannelY] = sample.y;
+  values[kChannelZ] = sample.z;
+  values[kChannelTilt] = sample.tilt;
+}
+
+void EpisodeWriter::append(const PositionSample& sample) {
+  double values[kPositionChannelCount];
+  positionSampleValues(sample, values);
+  append(values);
+}
+
+void EpisodeWriter::flush(bool sync) {
+  if (fd_ < 0) {
+    return;
+  }
+  if (buffered_ > 0) {
+    std::vector<const double*> columns(columns_.size());
+    for (size_t c = 0; c < columns_.size(); c++) {
+      columns[c] = columns_[c].data();
+    }
+    if (codec_.codec == kCodecPacked) {
+      encodePackedChunk(schema_, columns.data(), buffered_, codec_, chunk_);
+    } else {
+      encodeRawChunk(schema_, columns.data(), buffered_, chunk_);
+    }
+    try {
+      writeAll(chunk_.data(), chunk_.size());
+    } catch (...) {
+      // The file may end in a torn chunk; drop the samples and refuse further appends
+      buffered_ = 0;
+      ::close(fd_);
+      fd_ = -1;
+      throw;
+    }
+    written_ += buffered_;
+    buffered_ = 0;
+  }
+  if (sync && ::fdatasync(fd_) != 0) {
+    throw std::runtime_error("fdatasync failed on " + path_ + ": " + std::strerror(errno));
+  }
+}
+
+void EpisodeWriter::close() {
+  if (fd_ < 0) {
+    return;
+  }
+  flush();
+  ::close(fd_);
+  fd_ = -1;
+}
+
+void EpisodeWriter::writeAll(const void* data, size_t length) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  while (length > 0) {
+    const ssize_t n = ::write(fd_, p, length);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("Write failed on " + path_ + ": " + std::strerror(errno));
+    }
+    p += n;
+    length -= static_cast<size_t>(n);
+  }
+}
+
+}  // namespace shoplifter
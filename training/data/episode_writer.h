@@ -0,0 +1,132 @@
+/**
+ * Episode Writer
+ *
+ * Appends samples to a columnar .episode file (see episode_format.h).
+ * Samples are buffered column-wise in memory and written one chunk at a
+ * time, so each chunk lands on disk as a few large sequential writes.
+ */
+
+#ifndef EPISODE_WRITER_H
+#define EPISODE_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "training/data/episode_codec.h"
+#include "training/data/episode_format.h"
+
+namespace shoplifter {
+
+struct PositionSample;
+
+/**
+ * Total size of a raw chunk including its header and footer
+ */
+size_t rawChunkBytes(const EpisodeSchema& schema, size_t sampleCount);
+
+/**
+ * Serialize one raw chunk (header, columns, footer)
+ *
+ * @param schema Column layout
+ * @param columns One pointer per channel to sampleCount doubles
+ * @param sampleCount Number of samples in the chunk
+ * @param out Destination with room for rawChunkBytes(schema, sampleCount) bytes
+ */
+void encodeRawChunk(const EpisodeSchema& schema, const double* const* columns,
+                    size_t sampleCount, uint8_t* out);
+
+/**
+ * Serialize one raw chunk into a vector (resized, previous contents discarded)
+ */
+void encodeRawChunk(const EpisodeSchema& schema, const double* const* columns,
+                    size_t sampleCount, std::vector<uint8_t>& out);
+
+/**
+ * Convert a decoded position report to position schema columns
+ *
+ * host_time falls back to device_ms / 1000 when the line had no host timestamp.
+ *
+ * @param sample Decoded report
+ * @param values Receives kPositionChannelCount values
+ */
+void positionSampleValues(const PositionSample& sample, double* values);
+
+/**
+ * Build the file header for an episode
+ */
+EpisodeFileHeader makeEpisodeHeader(const std::string& armId, const EpisodeSchema& schema);
+
+class EpisodeWriter {
+ public:
+  // Default chunk length: about 80 s of 50 Hz telemetry
+  static constexpr size_t kDefaultChunkSamples = 4096;
+
+  /**
+   * Create (truncate) an episode file and write its header
+   *
+   * @param path Output file path
+   * @param armId Arm identity stored in the header
+   * @param schema Column layout; all values are passed as doubles and converted to the column type
+   * @param chunkSamples Samples per chunk
+   * @param codec Chunk codec; kCodecPacked compresses each chunk (see episode_codec.h)
+   * @throws std::runtime_error if the file cannot be created
+   */
+  EpisodeWriter(const std::string& path, const std::string& armId,
+                const EpisodeSchema& schema = positionSchema(),
+                size_t chunkSamples = kDefaultChunkSamples,
+                const EpisodeCodecOptions& codec = EpisodeCodecOptions());
+  ~EpisodeWriter();
+
+  EpisodeWriter(const EpisodeWriter&) = delete;
+  EpisodeWriter& operator=(const EpisodeWriter&) = delete;
+
+  /**
+   * Append one sample
+   *
+   * @param values One value per schema channel, in column order
+   * @throws std::runtime_error if the writer is closed, or a full chunk
+   *         cannot be written (the writer is closed then)
+   */
+  void append(const double* values);
+
+  /**
+   * Append a decoded position report (position schema only)
+   */
+  void append(const PositionSample& sample);
+
+  /**
+   * Write buffered samples as a complete chunk and fsync if requested
+   *
+   * @param sync Call fdatasync() after writing
+   * @throws std::runtime_error on a write error, after which the buffered
+   *         samples are dropped and the writer is closed
+   */
+  void flush(bool sync = false);
+
+  /**
+   * Flush remaining samples and close the file
+   */
+  void close();
+
+  size_t sampleCount() const { return written_ + buffered_; }
+  const EpisodeSchema& schema() const { return schema_; }
+
+ private:
+  void writeAll(const void* data, size_t length);
+
+  EpisodeSchema schema_;
+  size_t chunkSamples_;
+  EpisodeCodecOptions codec_;
+  int fd_ = -1;
+  std::vector<std::vector<double>> columns_;
+  std::vector<uint8_t> chunk_;
+  size_t buffered_ = 0;
+  size_t written_ = 0;
+  std::string path_;
+};
+
+}  // namespace shoplifter
+
+#endif // EPISODE_WRITER_H
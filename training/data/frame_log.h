@@ -0,0 +1,56 @@
+/**
+ * Camera Frame Log Format
+ *
+ * Append-only file of timestamped camera frames (.frames), written next to
+ * the arm episodes of the same recording session. Frames are stored as
+ * received (JPEG from the XIAO ESP32S3 cameras).
+ *
+ *   FrameLogHeader               64 bytes
+ *   repeated:
+ *     FrameRecordHeader          32 bytes
+ *     frame bytes                padded to 8 bytes
+ *
+ * A record is valid only if its magic matches and the file holds all of its
+ * bytes, so a torn final frame is simply ignored.
+ */
+
+#ifndef FRAME_LOG_H
+#define FRAME_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace shoplifter {
+
+constexpr char kFrameLogMagic[8] = {'S', 'L', 'F', 'R', 'A', 'M', 'E', 'S'};
+constexpr char kFrameRecordMagic[4] = {'F', 'R', 'M', 'E'};
+constexpr uint32_t kFrameLogVersion = 1;
+
+struct FrameLogHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  char camera_id[32];
+  double created_time;             // Unix seconds
+  uint8_t reserved[8];
+};
+
+struct FrameRecordHeader {
+  char magic[4];
+  uint32_t length;                 // frame bytes, excluding padding
+  double timestamp;                // host capture time, Unix seconds
+  uint64_t sequence;               // frame index within the log
+  uint32_t crc32;                  // CRC32 of the frame bytes
+  uint32_t reserved;
+};
+
+static_assert(sizeof(FrameLogHeader) == 64, "FrameLogHeader layout");
+static_assert(sizeof(FrameRecordHeader) == 32, "FrameRecordHeader layout");
+
+inline size_t frameRecordSize(size_t length) {
+  return sizeof(FrameRecordHeader) + ((length + 7) & ~static_cast<size_t>(7));
+}
+
+}  // namespace shoplifter
+
+#endif // FRAME_LOG_H
@@ -0,0 +1,145 @@
+/**
+ * JSONL to Episode Converter
+ *
+ * Converts position recordings written by read_follower_positions.py and
+ * read_multi_follower_positions.py into columnar .episode files.
+ *
+ * Usage:
+ *   jsonl_to_episode [--out-dir DIR] [--compress] [--quantize STEP] recording.jsonl [...]
+ *
+ * Each input produces <stem>.episode next to it (or in DIR). If a recording
+ * contains several arm IDs, one <stem>_<arm_id>.episode is written per arm.
+ * --compress writes packed chunks (episode_codec.h); --quantize STEP also
+ * allows lossy quantization of float channels to STEP (implies --compress).
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "hardware/telemetry/position_parser.h"
+#include "training/data/episode_writer.h"
+
+using shoplifter::PositionSample;
+
+namespace {
+
+std::string stemOf(const std::string& path) {
+  const size_t slash = path.find_last_of('/');
+  std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+  const size_t dot = name.find_last_of('.');
+  return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+std::string dirOf(const std::string& path) {
+  const size_t slash = path.find_last_of('/');
+  return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+/**
+ * Convert one recording
+ *
+ * @return Number of samples written, or -1 on error
+ */
+long convert(const std::string& input, const std::string& outDir,
+             const shoplifter::EpisodeCodecOptions& codec) {
+  const int fd = ::open(input.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    std::fprintf(stderr, "Cannot open %s: %s\n", input.c_str(), std::strerror(errno));
+    return -1;
+  }
+  struct stat st;
+  ::fstat(fd, &st);
+  const size_t size = static_cast<size_t>(st.st_size);
+  const char* data = nullptr;
+  if (size > 0) {
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      ::close(fd);
+      std::fprintf(stderr, "Cannot mmap %s: %s\n", input.c_str(), std::strerror(errno));
+      return -1;
+    }
+    ::madvise(map, size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(map);
+  }
+  ::close(fd);
+
+  // Group samples by arm, keeping file order
+  std::map<std::string, std::vector<PositionSample>> byArm;
+  uint64_t rejected = 0;
+  shoplifter::parsePositionBuffer(data, size, [&](const PositionSample& s) {
+    byArm[std::string(s.arm_id, s.arm_id_length)].push_back(s);
+  }, &rejected);
+  if (data) {
+    ::munmap(const_cast<char*>(data), size);
+  }
+
+  const std::string dir = outDir.empty() ? dirOf(input) : outDir;
+  const std::string stem = stemOf(input);
+  long total = 0;
+  for (const auto& entry : byArm) {
+    const std::string out = byArm.size() == 1
+        ? dir + "/" + stem + ".episode"
+        : dir + "/" + stem + "_" + entry.first + ".episode";
+    shoplifter::EpisodeWriter writer(out, entry.first, shoplifter::positionSchema(),
+                                     shoplifter::EpisodeWriter::kDefaultChunkSamples, codec);
+    for (const PositionSample& s : entry.second) {
+      writer.append(s);
+    }
+    writer.close();
+    std::printf("%s -> %s: %zu samples (%s)\n", input.c_str(), out.c_str(),
+                entry.second.size(), entry.first.c_str());
+    total += static_cast<long>(entry.second.size());
+  }
+  if (rejected) {
+    std::printf("%s: skipped %llu invalid lines\n", input.c_str(),
+                static_cast<unsigned long long>(rejected));
+  }
+  return total;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string outDir;
+  shoplifter::EpisodeCodecOptions codec;
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--out-dir") == 0 && i + 1 < argc) {
+      outDir = argv[++i];
+    } else if (std::strcmp(argv[i], "--compress") == 0) {
+      codec.codec = shoplifter::kCodecPacked;
+    } else if (std::strcmp(argv[i], "--quantize") == 0 && i + 1 < argc) {
+      codec.codec = shoplifter::kCodecPacked;
+      codec.quantizeStep = std::atof(argv[++i]);
+    } else {
+      inputs.push_back(argv[i]);
+    }
+  }
+  if (inputs.empty()) {
+    std::fprintf(stderr, "Usage: %s [--out-dir DIR] [--compress] [--quantize STEP] recording.jsonl [...]\n", argv[0]);
+    return 2;
+  }
+
+  int status = 0;
+  for (const std::string& input : inputs) {
+    try {
+      if (convert(input, outDir, codec) < 0) {
+        status = 1;
+      }
+    } catch (const std::exception& e) {
+      std::fprintf(stderr, "%s: %s\n", input.c_str(), e.what());
+      status = 1;
+    }
+  }
+  return status;
+}
@@ -0,0 +1,38 @@
+/**
+ * Monotonic clock and absolute-deadline sleep
+ *
+ * The time base of the host control loops (episode replay, chunk execution,
+ * Cartesian velocity streaming, the real-time loop): CLOCK_MONOTONIC in
+ * nanoseconds, never stepped by NTP. Sleeping to an absolute deadline keeps
+ * a periodic loop from drifting by its own wake-up latency.
+ */
+
+#ifndef DEADLINE_CLOCK_H
+#define DEADLINE_CLOCK_H
+
+#include <time.h>
+
+#include <cerrno>
+#include <cstdint>
+
+namespace shoplifter {
+
+// CLOCK_MONOTONIC in nanoseconds
+inline int64_t monotonicNs() {
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Sleep until monotonicNs() reaches deadline (returns at once if it has); signals do not cut it short
+inline void sleepUntilNs(int64_t deadline) {
+  struct timespec ts;
+  ts.tv_sec = static_cast<time_t>(deadline / 1000000000);
+  ts.tv_nsec = static_cast<long>(deadline % 1000000000);
+  while (::clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+  }
+}
+
+}  // namespace shoplifter
+
+#endif // DEADLINE_CLOCK_H
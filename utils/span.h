@@ -0,0 +1,33 @@
+/**
+ * Minimal non-owning view over a contiguous array
+ *
+ * Stand-in for std::span so host code builds with C++17 toolchains
+ * (JetPack ships GCC 9).
+ */
+
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <cstddef>
+
+namespace shoplifter {
+
+template <typename T>
+struct Span {
+  T* data = nullptr;
+  size_t size = 0;
+
+  Span() = default;
+  Span(T* d, size_t n) : data(d), size(n) {}
+
+  T* begin() const { return data; }
+  T* end() const { return data + size; }
+  T& operator[](size_t i) const { return data[i]; }
+  bool empty() const { return size == 0; }
+
+  Span subspan(size_t offset, size_t count) const { return Span(data + offset, count); }
+};
+
+}  // namespace shoplifter
+
+#endif // SPAN_H
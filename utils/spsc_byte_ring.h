@@ -0,0 +1,140 @@
+/**
+ * Single-producer / single-consumer ring of variable-length records
+ *
+ * The producer never blocks and never allocates: tryWrite() either copies
+ * the record into the ring or returns false when it is full. Records are
+ * contiguous in memory (a padding marker is inserted at wrap-around), so the
+ * consumer can hand them out without copying.
+ */
+
+#ifndef SPSC_BYTE_RING_H
+#define SPSC_BYTE_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace shoplifter {
+
+class SpscByteRing {
+ public:
+  /**
+   * @param capacity Ring size in bytes, rounded up to a power of two
+   */
+  explicit SpscByteRing(size_t capacity) {
+    capacity_ = 64;
+    while (capacity_ < capacity) {
+      capacity_ <<= 1;
+    }
+    buffer_ = static_cast<uint8_t*>(std::aligned_alloc(64, capacity_));
+    if (!buffer_) {
+      throw std::bad_alloc();
+    }
+  }
+
+  ~SpscByteRing() { std::free(buffer_); }
+
+  SpscByteRing(const SpscByteRing&) = delete;
+  SpscByteRing& operator=(const SpscByteRing&) = delete;
+
+  size_t capacity() const { return capacity_; }
+
+  /**
+   * Append one record made of two parts (producer thread only)
+   *
+   * @return false if the ring does not have room; nothing is written then
+   */
+  bool tryWrite(const void* prefix, size_t prefixLength, const void* body, size_t bodyLength) {
+    const size_t payload = prefixLength + bodyLength;
+    const size_t need = recordSize(payload);
+    if (need > capacity_ / 2) {
+      return false;
+    }
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    size_t offset = static_cast<size_t>(tail & (capacity_ - 1));
+    size_t pad = (capacity_ - offset < need) ? capacity_ - offset : 0;
+
+    if (tail + pad + need - headCache_ > capacity_) {
+      headCache_ = head_.load(std::memory_order_acquire);
+      if (tail + pad + need - headCache_ > capacity_) {
+        return false;
+      }
+    }
+
+    if (pad) {
+      const uint32_t marker = kPadMarker;
+      std::memcpy(buffer_ + offset, &marker, sizeof(marker));
+      offset = 0;
+    }
+    const uint32_t length = static_cast<uint32_t>(payload);
+    std::memcpy(buffer_ + offset, &length, sizeof(length));
+    std::memcpy(buffer_ + offset + kLengthBytes, prefix, prefixLength);
+    if (bodyLength) {
+      std::memcpy(buffer_ + offset + kLengthBytes + prefixLength, body, bodyLength);
+    }
+    tail_.store(tail + pad + need, std::memory_order_release);
+    return true;
+  }
+
+  bool tryWrite(const void* record, size_t length) {
+    return tryWrite(record, length, nullptr, 0);
+  }
+
+  /**
+   * Consume every available record (consumer thread only)
+   *
+   * @param onRecord Called as onRecord(const uint8_t* data, size_t length)
+   * @return Number of records consumed
+   */
+  template <typename Callback>
+  size_t drain(Callback&& onRecord) {
+    uint64_t h = head_.load(std::memory_order_relaxed);
+    const uint64_t t = tail_.load(std::memory_order_acquire);
+    size_t count = 0;
+    while (h != t) {
+      const size_t offset = static_cast<size_t>(h & (capacity_ - 1));
+      uint32_t length;
+      std::memcpy(&length, buffer_ + offset, sizeof(length));
+      if (length == kPadMarker) {
+        h += capacity_ - offset;
+        continue;
+      }
+      onRecord(static_cast<const uint8_t*>(buffer_ + offset + kLengthBytes), static_cast<size_t>(length));
+      h += recordSize(length);
+      count++;
+    }
+    head_.store(h, std::memory_order_release);
+    return count;
+  }
+
+  /**
+   * Bytes currently queued (approximate when called concurrently)
+   */
+  size_t used() const {
+    return static_cast<size_t>(tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire));
+  }
+
+ private:
+  // Length prefix; 8 bytes keeps payloads 8-byte aligned, and since every
+  // offset is a multiple of 8 there is always room for a padding marker
+  static constexpr size_t kLengthBytes = 8;
+  static constexpr uint32_t kPadMarker = 0xFFFFFFFFu;
+
+  static size_t recordSize(size_t payload) {
+    return (kLengthBytes + payload + 7) & ~static_cast<size_t>(7);
+  }
+
+  uint8_t* buffer_ = nullptr;
+  size_t capacity_ = 0;
+
+  alignas(64) std::atomic<uint64_t> head_{0};  // consumer position
+  alignas(64) std::atomic<uint64_t> tail_{0};  // producer position
+  uint64_t headCache_ = 0;                     // producer's view of head
+};
+
+}  // namespace shoplifter
+
+#endif // SPSC_BYTE_RING_H